@@ -30,6 +30,11 @@
 #include "gdal_priv.h"
 #include "libpq-fe.h"
 #include <float.h>
+#include <time.h>
+
+#if GDAL_VERSION_NUM >= 1110000
+#include "cpl_virtualmem.h"
+#endif
 //#include "liblwgeom.h"
 
 // General defines
@@ -44,16 +49,111 @@
 #define DEFAULT_BLOCK_X_SIZE	256
 #define DEFAULT_BLOCK_Y_SIZE	256
 
+/* Memory budget per read request, in MB (0 = no limit) */
+#define DEFAULT_MEMORY_BUDGET   "0"
+
+/* Order of the tiles inserted by CreateCopy: NONE, ROW_MAJOR or HILBERT */
+#define DEFAULT_SPATIAL_ORDER   "NONE"
+
+/* Size of the statements sent at once by a write, in bytes */
+#define WRITE_BATCH_SIZE        (1024 * 1024)
+
+/* Tiles inserted, updated or deleted per statement by an incremental copy */
+#define DEFAULT_INCREMENTAL_BATCH_SIZE  "1000"
+
+/* Seconds the raster tables listed when browsing a database are kept, and
+ * for how many databases */
+#define DEFAULT_CATALOG_CACHE_TTL       "60"
+#define CATALOG_CACHE_SIZE              16
+
+/* Seconds the descriptors of the opened coverages are kept, and how many */
+#define DEFAULT_DESCRIPTOR_CACHE_TTL    "60"
+#define DESCRIPTOR_CACHE_SIZE           256
+
+/* Tile rows a page of a virtual memory mapping may span, at most. Pages
+ * start on a tile row and on a system page: they're the least common
+ * multiple of both sizes */
+#define MAX_VIRTUALMEM_PAGE_TILE_ROWS   16
+
+/* Tiles deleted per transaction by Delete with a where clause */
+#define DEFAULT_DELETE_CHUNK_SIZE       "10000"
+
+/* Tiles sampled to get the scale and block size with open_mode=approx */
+#define APPROX_SAMPLE_SIZE      100
+
+/* Length, in pixels of the dataset, of the segments a window is cut into
+ * before it's transformed to the srid of reprojected tiles, so its edges
+ * follow the curved edges of the warped tiles */
+#define WINDOW_SEGMENT_PIXELS   64
+
+/* Sidecar columns with the per-band minimum and maximum of each tile */
+#define TILE_STATS_MIN_SUFFIX   "_min"
+#define TILE_STATS_MAX_SUFFIX   "_max"
+
 
 #define POSTGIS_RASTER_VERSION         (GUInt16)0
 #define RASTER_HEADER_SIZE              61
 #define RASTER_BAND_HEADER_FIXED_SIZE   1
 
-#define BAND_SIZE(nodatasize, datasize) \
-        (RASTER_BAND_HEADER_FIXED_SIZE + nodatasize + datasize)
+/* Band header flags (the lowest 4 bits are the pixel type) */
+#define BAND_FLAG_OFFLINE               0x80
+#define BAND_FLAG_HAS_NODATA            0x40
+#define BAND_FLAG_IS_NODATA             0x20
+#define BAND_PIXTYPE_MASK               0x0F
+
+/* Raster header, as serialized in the WKB format */
+typedef struct
+{
+    GByte nEndianness;  /* 0 = XDR (big endian), 1 = NDR (little endian) */
+    GUInt16 nVersion;
+    GUInt16 nBands;
+    double dfScaleX;
+    double dfScaleY;
+    double dfUpperLeftX;
+    double dfUpperLeftY;
+    double dfSkewX;
+    double dfSkewY;
+    GInt32 nSrid;
+    GUInt16 nWidth;
+    GUInt16 nHeight;
+} PostGISRasterWKBHeader;
+
+/**
+ * Band of a WKB raster. When parsed, it's a view into the WKB buffer: the
+ * offsets and the out-db path point into it, and have been checked against
+ * its length.
+ */
+typedef struct
+{
+    int nPixelType;
+    GDALDataType eDataType;
+    int nPixelSize;     /* bytes per pixel (and per nodata value) */
+    GBool bIsOffline;
+    GBool bHasNoDataValue;
+    GBool bIsNoData;
+    double dfNoDataValue;
+    int nBandOffset;    /* offset of the band header from the raster start */
+    int nDataOffset;    /* offset of the pixels (in-db bands) */
+    int nDataLength;    /* length of the pixels (in-db bands) */
+    int nNextBandOffset;
+    int nOutDbBandNumber;       /* 0-based, out-db bands */
+    const char * pszOutDbPath;  /* out-db bands */
+} PostGISRasterWKBBandHeader;
 
-#define GET_BAND_DATA(raster, nband, nodatasize, datasize) \
-    (raster + RASTER_HEADER_SIZE + nband * BAND_SIZE(nodatasize, datasize) - datasize)
+GBool PostGISRasterParseWKBHeader(const GByte *, int, PostGISRasterWKBHeader *);
+GBool PostGISRasterParseWKBBandHeader(const GByte *, int, int,
+    const PostGISRasterWKBHeader *, PostGISRasterWKBBandHeader *);
+GBool PostGISRasterGetWKBBand(const GByte *, int,
+    const PostGISRasterWKBHeader *, int, PostGISRasterWKBBandHeader *);
+GBool PostGISRasterWKBNeedsSwap(const PostGISRasterWKBHeader *);
+GDALDataType PostGISRasterPixelTypeToGDAL(int, int *);
+int PostGISRasterHexToBinary(const char *, int, GByte *);
+GIntBig PostGISRasterGetWKBBandSize(const PostGISRasterWKBHeader *,
+    const PostGISRasterWKBBandHeader *);
+int PostGISRasterWriteWKBHeader(GByte *, int, const PostGISRasterWKBHeader *);
+int PostGISRasterWriteWKBBand(GByte *, int, int,
+    const PostGISRasterWKBHeader *, const PostGISRasterWKBBandHeader *,
+    const void *);
 
 #define FLT_NEQ(x, y) (fabs(x - y) > FLT_EPSILON)
 #define FLT_EQ(x, y) (fabs(x - y) <= FLT_EPSILON)
@@ -86,6 +186,423 @@ typedef enum
 
 class PostGISRasterRasterBand;
 
+/*****************************************************************************
+ * PostGISRasterArena: scratch memory for the read requests of a band. It's
+ * taken from 64-byte aligned slabs that are kept from one request to the
+ * next, so once warmed up a request does no heap allocation at all.
+ *****************************************************************************/
+#define ARENA_ALIGNMENT         64
+#define ARENA_MIN_SLAB_SIZE     (1024 * 1024)
+#define ARENA_MAX_RETAINED_SIZE (64 * 1024 * 1024)
+
+class PostGISRasterArena {
+private:
+    GByte ** papabySlabs;
+    size_t * panSlabSizes;
+    int nSlabs;
+    int nCurrentSlab;
+    size_t nCurrentOffset;
+    size_t nUsedBytes;
+    size_t nPeakUsedBytes;
+    GBool AddSlab(size_t);
+    void FreeSlabs();
+
+public:
+    PostGISRasterArena();
+    ~PostGISRasterArena();
+    void * Alloc(size_t);
+    void Reset();
+    size_t GetUsedBytes();
+};
+
+/**
+ * Copy kernel: converts nCount tile pixels (picked through a column index,
+ * if not NULL) into a buffer line, keeping the destination of nodata pixels
+ */
+typedef void (*PostGISRasterCopyFunc)(const GByte *, const int *, int, GByte *,
+    int, GBool, double);
+
+PostGISRasterCopyFunc PostGISRasterGetCopyKernel(GDALDataType, GDALDataType,
+    GBool);
+
+/*****************************************************************************
+ * PostGISRasterResampler: resamples the tiles of a read request into a buffer
+ * whose size is not the window size. Each tile is accumulated into per buffer
+ * pixel weighted sums as it's decoded, so the window is never materialized
+ * at full resolution. Nodata pixels get no weight.
+ *****************************************************************************/
+#define DEFAULT_RESAMPLING      "NEAREST"
+
+typedef enum
+{
+    RESAMPLING_NEAREST,
+    RESAMPLING_AVERAGE,
+    RESAMPLING_BILINEAR,
+    RESAMPLING_CUBIC
+} PostGISRasterResampling;
+
+/* Source pixels (taps) contributing to each buffer pixel along one axis */
+typedef struct
+{
+    int nBufStart;
+    int nBufEnd;
+    int nMaxTaps;
+    int * panFirst;
+    int * panCount;
+    double * padfWeights;
+    int nCapacity;
+    int nWeightCapacity;
+} PostGISRasterTaps;
+
+class PostGISRasterResampler {
+private:
+    PostGISRasterResampling eResampling;
+    int nXSize;
+    int nYSize;
+    int nBufXSize;
+    int nBufYSize;
+    double * padfSum;
+    double * padfWeight;
+    double * padfRow;
+    PostGISRasterTaps sXTaps;
+    PostGISRasterTaps sYTaps;
+    GBool ComputeTaps(PostGISRasterTaps *, int, int, int, int, int);
+
+public:
+    PostGISRasterResampler();
+    ~PostGISRasterResampler();
+    static PostGISRasterResampling GetResampling();
+    GBool Init(PostGISRasterArena *, PostGISRasterResampling, int, int, int,
+        int);
+    void AddTile(const GByte *, GDALDataType, int, int, GBool, double, int,
+        int, int, int);
+    void Finish(GByte *, GDALDataType, int, int, double);
+};
+
+/*****************************************************************************
+ * PostGISRasterSharedTileCache: tile cache segment shared by all the processes
+ * of a host, in a memory mapped file (use a file in /dev/shm to keep it in
+ * memory). It's a fixed array of slots, TILE_CACHE_SHM_WAYS way set
+ * associative on the key hash, each slot holding one block. Readers take a
+ * reference on the slot with an atomic increment, writers take the slot
+ * exclusively (reference count -1) once it's unused, and victims are chosen
+ * with the clock algorithm. Only hashes of the keys are stored, so the
+ * connection strings aren't exposed to the other processes.
+ *
+ * The segment outlives the processes, and the tables can be changed by other
+ * tools, so each slot is stamped with the time it was stored and with the
+ * generation of the segment. Slots older than
+ * POSTGIS_RASTER_SHARED_TILE_CACHE_TTL seconds are misses, and the driver
+ * bumps the generation when it rewrites or drops a table, which drops all
+ * the slots at once, in every process.
+ *****************************************************************************/
+#define DEFAULT_SHARED_TILE_CACHE_SIZE      "64"    /* MB */
+#define DEFAULT_SHARED_TILE_CACHE_SLOT_SIZE "256"   /* KB */
+#define DEFAULT_SHARED_TILE_CACHE_TTL       "300"   /* seconds, 0: no expiry */
+#define TILE_CACHE_SHM_MAGIC                0x50475243  /* PGRC */
+#define TILE_CACHE_SHM_VERSION              2
+#define TILE_CACHE_SHM_WAYS                 8
+
+typedef struct
+{
+    volatile GUInt32 nMagic;
+    GUInt32 nVersion;
+    GUInt32 nSlots;
+    GUInt32 nSlotSize;      /* payload bytes per slot */
+    GUInt32 nSlotStride;    /* slot header + payload, aligned */
+    volatile GUInt32 nClockHand;
+    volatile GUInt32 nGeneration;   /* bumped to drop all the slots */
+    GByte abyPadding[ARENA_ALIGNMENT - 7 * sizeof(GUInt32)];
+} PostGISRasterShmHeader;
+
+typedef struct
+{
+    volatile GInt32 nRefCount;     /* -1: being written */
+    volatile GInt32 bReferenced;   /* clock bit */
+    GUInt32 nHash1;
+    GUInt32 nHash2;
+    GInt32 nSize;
+    GInt32 bEmpty;
+    GUInt32 nGeneration;    /* of the segment, when stored */
+    GUInt32 nStoreTime;     /* seconds since the epoch */
+} PostGISRasterShmSlot;
+
+class PostGISRasterSharedTileCache {
+private:
+    volatile GBool bAttached;
+    GBool bFailed;
+    char * pszPath;
+    GByte * pabyBase;
+    size_t nMapSize;
+    PostGISRasterShmHeader * volatile psHeader;
+    volatile GUInt32 nTTL;
+    GByte ** papabyRetired;     /* detached segments, still mapped */
+    size_t * panRetiredSizes;
+    int nRetired;
+    GBool Attach(const char *);
+    void Detach();
+    PostGISRasterShmSlot * GetSlot(PostGISRasterShmHeader *, GUInt32);
+    GBool IsFresh(PostGISRasterShmHeader *, PostGISRasterShmSlot *, GUInt32);
+    GBool AcquireSlot(PostGISRasterShmSlot *);
+    void ReleaseSlot(PostGISRasterShmSlot *);
+
+public:
+    PostGISRasterSharedTileCache();
+    ~PostGISRasterSharedTileCache();
+    GBool Configure();
+    GBool IsEnabled();
+    GBool Get(GUInt32, GUInt32, GByte *, int, GBool *);
+    void Put(GUInt32, GUInt32, const GByte *, int, GBool);
+    void Invalidate(GUInt32, GUInt32);
+    void InvalidateAll();
+};
+
+/*****************************************************************************
+ * PostGISRasterTileCache: process wide cache of decoded blocks, shared by all
+ * the datasets. Unlike the GDAL block cache, it survives the datasets, so
+ * servers opening a dataset per request don't fetch the same tiles again.
+ * Entries can be empty (the block has no tiles), to skip the query too.
+ *
+ * The cache is split in shards by key hash, each one with its own lock, so
+ * reader threads hitting different blocks don't wait for each other. There's
+ * one shard per TILE_CACHE_MIN_SHARD_SIZE of cache, up to
+ * TILE_CACHE_MAX_SHARDS. Reads, inserts and invalidations only take the
+ * lock of their shard, which also keeps its hit and miss counters. The
+ * settings are read once, on first use, and again by Reconfigure() (each
+ * time a dataset is opened), which is the only user of the cache mutex.
+ *
+ * The most recently used entries (the hot tier) are kept as is. If
+ * compression is enabled, the hot tier only takes a part of the cache, and
+ * the entries falling out of it are LZ4 compressed into the cold tier,
+ * then decompressed on hit. The hot tier is evicted in CLOCK order: a hit
+ * only sets the reference bit of the entry, and the eviction hand gives
+ * referenced entries a second turn. The cold tier is FIFO.
+ *
+ * Entries are also given the Hilbert index of their block as position, and
+ * each shard follows the centroid of the blocks recently accessed. Among the
+ * first TILE_CACHE_EVICTION_CANDIDATES entries the hand can evict, the one
+ * farthest from the centroid goes first, so a panning viewer keeps the
+ * neighbours of what it's looking at.
+ *****************************************************************************/
+#define DEFAULT_TILE_CACHE_SIZE         "0"
+#define DEFAULT_TILE_CACHE_COMPRESS     "NO"
+#define TILE_CACHE_HOT_FRACTION         4   /* 1/4 of the cache, if compressed */
+#define TILE_CACHE_MIN_BUCKETS          256
+#define TILE_CACHE_MAX_SHARDS           16
+#define TILE_CACHE_MIN_SHARD_SIZE       (4 * 1024 * 1024)
+#define TILE_CACHE_EVICTION_CANDIDATES  4
+#define TILE_CACHE_CENTROID_WEIGHT      8   /* 1/8 of the way per access */
+
+typedef struct _PostGISRasterTileCacheEntry
+{
+    char * pszKey;
+    GUInt32 nHash;
+    int nBlockX;        /* block, from the Hilbert index given as position */
+    int nBlockY;
+    GByte * pabyData;
+    int nSize;          /* decoded size */
+    int nStoredSize;    /* size of pabyData */
+    GBool bEmpty;
+    GBool bCompressed;
+    GBool bHot;
+    GBool bReferenced;  /* hit since the CLOCK hand last passed */
+    struct _PostGISRasterTileCacheEntry * psPrev;
+    struct _PostGISRasterTileCacheEntry * psNext;
+    struct _PostGISRasterTileCacheEntry * psNextInBucket;
+} PostGISRasterTileCacheEntry;
+
+class PostGISRasterTileCacheShard {
+private:
+    void * hMutex;
+    PostGISRasterTileCacheEntry ** papsBuckets;
+    int nBuckets;
+    int nEntries;
+    PostGISRasterTileCacheEntry * psHotHead;
+    PostGISRasterTileCacheEntry * psHotTail;
+    PostGISRasterTileCacheEntry * psColdHead;
+    PostGISRasterTileCacheEntry * psColdTail;
+    GIntBig nHotBytes;
+    GIntBig nColdBytes;
+    GIntBig nMaxBytes;
+    GBool bCompress;
+    double dfCentroidX;
+    double dfCentroidY;
+    GIntBig nHits;
+    GIntBig nSharedHits;    /* misses found in the shared tier */
+    GIntBig nMisses;
+    PostGISRasterTileCacheEntry * Find(const char *, GUInt32);
+    void Unlink(PostGISRasterTileCacheEntry *);
+    void PushFront(PostGISRasterTileCacheEntry *, GBool);
+    void Remove(PostGISRasterTileCacheEntry *);
+    GBool Grow();
+    void Demote(PostGISRasterTileCacheEntry *);
+    void MoveCentroid(GUInt32);
+    PostGISRasterTileCacheEntry * ClockHand();
+    void Trim();
+    void RemoveAll();
+
+public:
+    PostGISRasterTileCacheShard();
+    ~PostGISRasterTileCacheShard();
+    GBool Get(const char *, GUInt32, GUInt32, GByte *, int, GBool *);
+    void Put(const char *, GUInt32, GUInt32, const GByte *, int, GBool);
+    void SetLimits(GIntBig, GBool);
+    void Invalidate(const char *, GUInt32);
+    void InvalidatePrefix(const char *);
+    void Clear();
+    void AddSharedHit();
+    void AddMiss();
+    GIntBig GetHits();
+    GIntBig GetMisses();
+};
+
+class PostGISRasterTileCache {
+private:
+    void * hMutex;      /* Reconfigure() only */
+    PostGISRasterTileCacheShard aoShards[TILE_CACHE_MAX_SHARDS];
+    volatile int nShards;   /* the settings are read without the mutex */
+    volatile int bConfigured;
+    volatile int bEnabled;
+    GIntBig nMaxBytes;
+    GBool bCompress;
+    PostGISRasterSharedTileCache oShared;
+    PostGISRasterTileCacheShard * GetShard(GUInt32);
+    void Put(const char *, GUInt32, const GByte *, int, GBool);
+
+public:
+    PostGISRasterTileCache();
+    ~PostGISRasterTileCache();
+    static PostGISRasterTileCache * GetInstance();
+    void Reconfigure();
+    GBool IsEnabled();
+    GBool Get(const char *, GUInt32, GByte *, int, GBool *);
+    void Insert(const char *, GUInt32, const GByte *, int);
+    void InsertEmpty(const char *, GUInt32);
+    void Invalidate(const char *);
+    void InvalidateTable(const char *, const char *);
+    void Clear();
+    GIntBig GetHits();
+    GIntBig GetMisses();
+};
+
+GUInt32 PostGISRasterHilbertIndex(int, int);
+
+int PostGISRasterLZ4Compress(const GByte *, int, GByte *, int);
+int PostGISRasterLZ4Decompress(const GByte *, int, GByte *, int);
+
+/*****************************************************************************
+ * PostGISRasterDBAccess: thin layer over the libpq calls made by the driver.
+ * Every connection and query goes through the current instance, so it can be
+ * replaced by a fake (PostGISRasterReplayDBAccess) and the number of round
+ * trips and bytes received can be checked without a live database.
+ *****************************************************************************/
+class PostGISRasterDBAccess {
+protected:
+    int nQueries;
+    GIntBig nBytesReceived;
+    void AccountResult(PGresult *);
+
+public:
+    PostGISRasterDBAccess();
+    virtual ~PostGISRasterDBAccess();
+
+    virtual PGconn * Connect(const char *);
+    virtual GBool IsConnected(PGconn *);
+    virtual void Disconnect(PGconn *);
+    virtual PGresult * Exec(PGconn *, const char *);
+    virtual const char * GetErrorMessage(PGconn *);
+
+    int GetQueryCount();
+    GIntBig GetBytesReceived();
+    void ResetCounters();
+
+    static PostGISRasterDBAccess * GetInstance();
+    static PostGISRasterDBAccess * SetInstance(PostGISRasterDBAccess *);
+};
+
+/*****************************************************************************
+ * PostGISRasterReplayDBAccess: recording/replaying fake. Built on top of
+ * another instance it forwards and records every query; built without one
+ * it replays the recorded (or scripted) results, in order, with an optional
+ * injected latency per round trip.
+ *****************************************************************************/
+class PostGISRasterReplayDBAccess : public PostGISRasterDBAccess {
+private:
+    PostGISRasterDBAccess * poTarget;
+    char ** papszQueries;
+    PGresult ** papoResults;
+    int nRecords;
+    int nNextRecord;
+    int nLatencyMs;
+    void AddRecord(const char *, PGresult *);
+
+public:
+    PostGISRasterReplayDBAccess(PostGISRasterDBAccess * poTarget = NULL);
+    virtual ~PostGISRasterReplayDBAccess();
+
+    virtual PGconn * Connect(const char *);
+    virtual GBool IsConnected(PGconn *);
+    virtual void Disconnect(PGconn *);
+    virtual PGresult * Exec(PGconn *, const char *);
+    virtual const char * GetErrorMessage(PGconn *);
+
+    void SetLatency(int);
+    void AddTuples(const char *, int, const char * const *, int,
+        const char * const *);
+    void AddCommand(const char *, GBool);
+    int GetRecordCount();
+    const char * GetRecordedQuery(int);
+    int GetRecordedPayloadSize(int);
+    void Rewind();
+    GBool Save(const char *);
+    GBool Load(const char *);
+};
+
+PGresult * PostGISRasterExec(PGconn *, const char *);
+const char * PostGISRasterErrorMessage(PGconn *);
+
+/******************************************************************************
+ * PostGISRasterDescriptor: what opening a raster coverage finds out about it
+ * (georeference, bands and overviews). The driver keeps the descriptors, to
+ * open the same coverage again without any query
+ *****************************************************************************/
+typedef struct
+{
+    GDALDataType eDataType;
+    GBool bHasNoDataValue;
+    double dfNoDataValue;
+    GBool bSignedByte;
+    int nBitDepth;
+} PostGISRasterBandSpec;
+
+class PostGISRasterDescriptor {
+public:
+    char* pszSchema;            /* to find the descriptors of a table */
+    char* pszTable;
+    time_t nTime;
+    double adfGeoTransform[6];
+    double xmin, ymin, xmax, ymax;
+    int nRasterXSize;
+    int nRasterYSize;
+    int nSrid;
+    int nTiles;
+    GBool bRegularBlocking;
+    GBool bRegisteredInRasterColumns;
+    GBool bApproxOpen;
+    int nBlockXSize;
+    int nBlockYSize;
+    int nBands;
+    PostGISRasterBandSpec* pasBands;
+    int nOverviewCount;
+    int* panOverviewFactors;
+    int nTileSrids;
+    int* panTileSrids;
+
+    PostGISRasterDescriptor();
+    ~PostGISRasterDescriptor();
+    PostGISRasterDescriptor* Clone();
+};
+
 /*****************************************************************************
  * PostGISRasterDriver: extends GDALDriver to support PostGIS Raster connect.
  *****************************************************************************/
@@ -94,12 +611,28 @@ class PostGISRasterDriver : public GDALDriver {
 
 private:
     PGconn** papoConnection;
+    char** papszConnectionKeys;
     int nRefCount;
+    void * hCatalogMutex;
+    char** papszCatalogKeys;
+    char*** papapszCatalogs;
+    time_t* panCatalogTimes;
+    int nCatalogs;
+    void * hDescriptorMutex;
+    char** papszDescriptorKeys;
+    PostGISRasterDescriptor** papoDescriptors;
+    int nDescriptors;
 public:
     PostGISRasterDriver();
     virtual ~PostGISRasterDriver();
     PGconn* GetConnection(const char *, const char *, const char *,
             const char *, const char *);
+    char** GetCatalog(const char *);
+    void SetCatalog(const char *, char **);
+    void InvalidateCatalogs();
+    PostGISRasterDescriptor* GetDescriptor(const char *);
+    void SetDescriptor(const char *, PostGISRasterDescriptor *);
+    void InvalidateDescriptors(const char *, const char *);
 };
 
 /******************************************************************************
@@ -120,16 +653,43 @@ private:
     char* pszTable;
     char* pszColumn;
     char* pszWhere;
+    char* pszValueFilter;
+    int nHasTileStats;  /* -1: not checked yet */
+    GBool bApproxOpen;          /* georeference from open_mode=approx */
+    GBool bApproxValidated;     /* tiles checked against it by a read */
+    int nTargetSrid;            /* target_srid, 0 if the tiles aren't reprojected */
+    int nTileSrids;             /* distinct srids of the tiles, if reprojected */
+    int* panTileSrids;
+    char* pszQuickLook;         /* quicklook: ST_AsPNG or ST_AsJPEG, NULL if not */
+    int nOverviewCount;         /* -1: not fetched yet */
+    int* panOverviewFactors;
     char* pszProjection;
 	ResolutionStrategy resolutionStrategy;
     int nMode;
 	int nTiles;
 	double xmin, ymin, xmax, ymax;
     GBool bBlocksCached;// TODO: future use?
+    GIntBig nBytesInFlight;
+    GIntBig nPeakBytesInFlight;
+    char** papszInstrumentation;
+    void AddBytesInFlight(GIntBig);
     GBool SetRasterProperties(const char *);
-    GBool BrowseDatabase(const char *, char *);
+    GBool GetRasterColumnsMetadata(int *, int *);
+    GBool GetApproxMetadata(int *, int *);
+    GBool SetTransformedRasterProperties();
+    CPLString GetRasterExpression();
+    CPLString GetIntersectingRows(const char *, const char *);
+    GBool SetRasterBands(int, int);
+    GBool SetValueFilter(const char *);
+    static GBool HasTileStats(PGconn *, const char *, const char *,
+        const char *);
+    GBool BrowseDatabase(const char *, char *, const char *);
     GBool SetOverviewCount();
+    PostGISRasterDescriptor* GetDescriptor();
+    GBool SetFromDescriptor(PostGISRasterDescriptor *);
 	GBool GetRasterMetadata(char *, double, double, double *, double *, int *, int *);
+    static GBool GetHilbertOrderBy(PGconn *, PostGISRasterDataset *,
+        CPLString *);
 
 public:
     PostGISRasterDataset(ResolutionStrategy inResolutionStrategy);
@@ -138,8 +698,14 @@ public:
     static GDALDataset* CreateCopy(const char *, GDALDataset *, 
         int, char **, GDALProgressFunc, void *);
     static GBool InsertRaster(PGconn *, PostGISRasterDataset *, 
-        const char *, const char *, const char *);
+        const char *, const char *, const char *, const char * = NULL,
+        int = 0, int = 0);
+    static GBool SyncRaster(PGconn *, PostGISRasterDataset *, 
+        const char *, const char *, const char *, int, int, int, 
+        GDALProgressFunc, void *);
     static CPLErr Delete(const char*);
+    static GBool UpdateTileStats(PGconn *, const char *, const char *,
+        const char *, GBool);
     char ** GetMetadata(const char *);
     const char* GetProjectionRef();
     CPLErr SetProjection(const char*);
@@ -159,7 +725,16 @@ private:
     GBool bIsOffline;
     int nOverviewCount;
     PostGISRasterRasterBand ** papoOverviews;
+    PostGISRasterArena oArena;
 	GDALDataType TranslateDataType(const char *);
+    static GIntBig GetMemoryBudget();
+    GIntBig EstimateRequestMemory(int, int, int, int);
+    GBool GetTileCacheKey(int, int, int, int, CPLString *, GUInt32 *);
+    GBool SplitRasterIO(int, int, int, int, void *, int, int, GDALDataType,
+        int, int, CPLErr *);
+    GBool QuickLookRasterIO(int, int, int, int, void *, int, int, GDALDataType,
+        int, int, CPLErr *);
+    CPLErr WriteRaster(int, int, int, int, void *, GDALDataType, int, int);
 
 public:
 
@@ -175,10 +750,15 @@ public:
 	virtual CPLErr IRasterIO(GDALRWFlag, int, int, int, int, void *, int, int, GDALDataType, 
 		int, int);
     virtual CPLErr IReadBlock(int, int, void *);
+    virtual CPLErr IWriteBlock(int, int, void *);
     int GetBand();
     GDALDataset* GetDataset();
     virtual int HasArbitraryOverviews();
     virtual int GetOverviewCount();
     virtual GDALRasterBand * GetOverview(int);
+#if GDAL_VERSION_NUM >= 1110000
+    virtual CPLVirtualMem * GetVirtualMemAuto(GDALRWFlag, int *, GIntBig *,
+        char **);
+#endif
 };
 
@@ -0,0 +1,165 @@
+/******************************************************************************
+ * File :    postgisrasterarena.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Scratch memory arena for the read requests of PostGIS Raster
+ *           bands
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+
+/* First aligned address in a slab allocation */
+#define ALIGNED_PTR(p) \
+    ((p) + ((ARENA_ALIGNMENT - (size_t)(p) % ARENA_ALIGNMENT) % ARENA_ALIGNMENT))
+
+/************************
+ * \brief Constructor
+ ************************/
+PostGISRasterArena::PostGISRasterArena() {
+    papabySlabs = NULL;
+    panSlabSizes = NULL;
+    nSlabs = 0;
+    nCurrentSlab = 0;
+    nCurrentOffset = 0;
+    nUsedBytes = 0;
+    nPeakUsedBytes = 0;
+}
+
+/************************
+ * \brief Destructor
+ ************************/
+PostGISRasterArena::~PostGISRasterArena() {
+    FreeSlabs();
+}
+
+/***********************************************************************
+ * \brief Release all the slabs
+ ***********************************************************************/
+void PostGISRasterArena::FreeSlabs() {
+    int i;
+
+    for (i = 0; i < nSlabs; i++)
+        VSIFree(papabySlabs[i]);
+
+    CPLFree(papabySlabs);
+    CPLFree(panSlabSizes);
+
+    papabySlabs = NULL;
+    panSlabSizes = NULL;
+    nSlabs = 0;
+    nCurrentSlab = 0;
+    nCurrentOffset = 0;
+}
+
+/***********************************************************************
+ * \brief Append a new slab with, at least, nSize usable bytes
+ ***********************************************************************/
+GBool PostGISRasterArena::AddSlab(size_t nSize) {
+    GByte * pabySlab = (GByte *) VSIMalloc(nSize + ARENA_ALIGNMENT);
+
+    if (pabySlab == NULL)
+        return false;
+
+    papabySlabs = (GByte **) CPLRealloc(papabySlabs,
+        sizeof (GByte *) * (nSlabs + 1));
+    panSlabSizes = (size_t *) CPLRealloc(panSlabSizes,
+        sizeof (size_t) * (nSlabs + 1));
+
+    papabySlabs[nSlabs] = pabySlab;
+    panSlabSizes[nSlabs] = nSize;
+    nSlabs++;
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Get a 64-byte aligned block of memory.
+ *
+ * The block is valid until the next call to Reset, and must not be
+ * freed. NULL is returned (without error) if it can't be allocated.
+ ***********************************************************************/
+void * PostGISRasterArena::Alloc(size_t nSize) {
+    GByte * pabyBlock = NULL;
+
+    /* Keep the next block aligned too */
+    nSize = (nSize + ARENA_ALIGNMENT - 1) & ~((size_t) ARENA_ALIGNMENT - 1);
+    if (nSize == 0)
+        nSize = ARENA_ALIGNMENT;
+
+    while (nCurrentSlab < nSlabs &&
+            nCurrentOffset + nSize > panSlabSizes[nCurrentSlab]) {
+        nCurrentSlab++;
+        nCurrentOffset = 0;
+    }
+
+    if (nCurrentSlab == nSlabs) {
+        if (!AddSlab(MAX(nSize, (size_t) ARENA_MIN_SLAB_SIZE)))
+            return NULL;
+
+        nCurrentSlab = nSlabs - 1;
+        nCurrentOffset = 0;
+    }
+
+    pabyBlock = ALIGNED_PTR(papabySlabs[nCurrentSlab]) + nCurrentOffset;
+    nCurrentOffset += nSize;
+
+    nUsedBytes += nSize;
+    if (nUsedBytes > nPeakUsedBytes)
+        nPeakUsedBytes = nUsedBytes;
+
+    return pabyBlock;
+}
+
+/***********************************************************************
+ * \brief Release all the blocks at once.
+ *
+ * The slabs are kept for the next request. If the last requests needed
+ * more than one slab, they're merged into one big enough for all of
+ * them. If that would retain too much memory, everything is released.
+ ***********************************************************************/
+void PostGISRasterArena::Reset() {
+    if (nPeakUsedBytes > ARENA_MAX_RETAINED_SIZE) {
+        FreeSlabs();
+        nPeakUsedBytes = 0;
+    }
+
+    else if (nSlabs > 1) {
+        FreeSlabs();
+        AddSlab(MAX(nPeakUsedBytes, (size_t) ARENA_MIN_SLAB_SIZE));
+    }
+
+    nCurrentSlab = 0;
+    nCurrentOffset = 0;
+    nUsedBytes = 0;
+}
+
+/***********************************************************************
+ * \brief Bytes handed out since the last Reset
+ ***********************************************************************/
+size_t PostGISRasterArena::GetUsedBytes() {
+    return nUsedBytes;
+}
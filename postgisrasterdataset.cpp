@@ -73,6 +73,16 @@ PostGISRasterDataset::PostGISRasterDataset(ResolutionStrategy inResolutionStrate
     pszTable = NULL;
     pszColumn = NULL;
     pszWhere = NULL;
+    pszValueFilter = NULL;
+    nHasTileStats = -1;
+    bApproxOpen = false;
+    bApproxValidated = false;
+    nTargetSrid = 0;
+    nTileSrids = 0;
+    panTileSrids = NULL;
+    pszQuickLook = NULL;
+    nOverviewCount = -1;
+    panOverviewFactors = NULL;
     pszProjection = NULL;
 	resolutionStrategy = inResolutionStrategy;
 	nTiles = 0;
@@ -85,6 +95,9 @@ PostGISRasterDataset::PostGISRasterDataset(ResolutionStrategy inResolutionStrate
     adfGeoTransform[GEOTRSFRM_ROTATION_PARAM2] = 0.0;
     adfGeoTransform[GEOTRSFRM_NS_RES] = 0.0;
     bBlocksCached = false;
+    nBytesInFlight = 0;
+    nPeakBytesInFlight = 0;
+    papszInstrumentation = NULL;
     bRegularBlocking = true;// do not change! (need to be 'true' for SetRasterProperties)
     bAllTilesSnapToSameGrid = false;
 
@@ -111,6 +124,14 @@ PostGISRasterDataset::~PostGISRasterDataset() {
         CPLFree(pszColumn);
     if (pszWhere)
         CPLFree(pszWhere);
+    if (pszValueFilter)
+        CPLFree(pszValueFilter);
+    if (panOverviewFactors)
+        CPLFree(panOverviewFactors);
+    if (panTileSrids)
+        CPLFree(panTileSrids);
+    if (pszQuickLook)
+        CPLFree(pszQuickLook);
     if (pszProjection)
         CPLFree(pszProjection);
 	if (pszOriginalConnectionString)
@@ -118,6 +139,19 @@ PostGISRasterDataset::~PostGISRasterDataset() {
 
     if (papszSubdatasets)
         CSLDestroy(papszSubdatasets);
+    if (papszInstrumentation)
+        CSLDestroy(papszInstrumentation);
+}
+
+/**************************************************************
+ * \brief Account for memory taken (or released, if negative)
+ * by a read request, keeping track of the peak
+ *************************************************************/
+void PostGISRasterDataset::AddBytesInFlight(GIntBig nBytes) {
+    nBytesInFlight += nBytes;
+
+    if (nBytesInFlight > nPeakBytesInFlight)
+        nPeakBytesInFlight = nBytesInFlight;
 }
 
 /**************************************************************
@@ -201,6 +235,122 @@ char** ParseConnectionString(const char * pszConnectionString) {
 
 }
 
+/*****************************************************************************
+ * \brief Options of the connection string handled by the driver, not by
+ * libpq, other than the ones that select the raster (schema, table, column,
+ * where and mode)
+ *****************************************************************************/
+static const char * const apszDriverOptions[] = {
+    "value_filter",     /* prune tiles by value: band1>30 and band2<=5 */
+    "tile_stats",       /* refresh: compute the missing tile stats */
+    "schema_like",      /* browsing: LIKE pattern for the schema names */
+    "table_like",       /* browsing: LIKE pattern for the table names */
+    "limit",            /* browsing: number of tables listed */
+    "offset",           /* browsing: tables skipped before listing them */
+    "open_mode",        /* approx: georeference from statistics and a sample */
+    "target_srid",      /* srid the tiles are reprojected to by the server */
+    "quicklook",        /* png, jpeg: downsampled Byte reads rendered by the server */
+    NULL
+};
+
+/*****************************************************************************
+ * \brief Get the value of a driver option from a connection string.
+ *
+ * The returned string must be freed with CPLFree. NULL if not present
+ *****************************************************************************/
+static
+char * FetchDriverOption(const char * pszConnectionString, 
+    const char * pszName) {
+    char ** papszParams = ParseConnectionString(pszConnectionString);
+    char * pszValue = NULL;
+    int nPos;
+
+    nPos = CSLFindName(papszParams, pszName);
+    if (nPos != -1)
+        pszValue = ReplaceQuotes(CPLParseNameValue(papszParams[nPos], NULL), -1);
+
+    CSLDestroy(papszParams);
+
+    return pszValue;
+}
+
+/*****************************************************************************
+ * \brief Check if two connection strings point to the same database: the
+ * same dbname, host and port (PGHOST and PGPORT when they aren't given)
+ *****************************************************************************/
+static
+GBool IsSameDatabase(const char * pszConnectionString1,
+    const char * pszConnectionString2) {
+    static const char * const apszNames[] = { "dbname", "host", "port", NULL };
+    static const char * const apszEnvNames[] = { NULL, "PGHOST", "PGPORT" };
+    char * pszValue1 = NULL;
+    char * pszValue2 = NULL;
+    const char * pszDefault = NULL;
+    GBool bSame = true;
+    int i;
+
+    if (pszConnectionString1 == NULL || pszConnectionString2 == NULL)
+        return false;
+
+    for (i = 0; bSame && apszNames[i] != NULL; i++) {
+        pszValue1 = FetchDriverOption(pszConnectionString1, apszNames[i]);
+        pszValue2 = FetchDriverOption(pszConnectionString2, apszNames[i]);
+        pszDefault = (apszEnvNames[i] != NULL) ? getenv(apszEnvNames[i]) : NULL;
+        if (pszDefault == NULL)
+            pszDefault = "";
+
+        /* database names are case sensitive, host names aren't */
+        if (i == 0)
+            bSame = (strcmp((pszValue1 != NULL) ? pszValue1 : pszDefault,
+                (pszValue2 != NULL) ? pszValue2 : pszDefault) == 0);
+        else
+            bSame = EQUAL((pszValue1 != NULL) ? pszValue1 : pszDefault,
+                (pszValue2 != NULL) ? pszValue2 : pszDefault);
+
+        CPLFree(pszValue1);
+        CPLFree(pszValue2);
+    }
+
+    return bSame;
+}
+
+/**************************************************************************
+ * \brief Match a string against a SQL LIKE pattern: % matches any
+ * sequence of characters, _ any single character, and \ escapes them.
+ *
+ * On a mismatch after a %, the match resumes from that % only, one
+ * character later, so it takes linear time per %.
+ **************************************************************************/
+static
+GBool MatchLikePattern(const char * pszPattern, const char * pszString) {
+    const char * pszStar = NULL;
+    const char * pszStarString = NULL;
+
+    while (*pszString != '\0') {
+        if (*pszPattern == '%') {
+            pszStar = pszPattern++;
+            pszStarString = pszString;
+        }
+        else if (*pszPattern == '_' || (*pszPattern == '\\' && 
+            pszPattern[1] != '\0' && pszPattern[1] == *pszString) ||
+            (*pszPattern != '\\' && *pszPattern == *pszString)) {
+            pszPattern += (*pszPattern == '\\') ? 2 : 1;
+            pszString++;
+        }
+        else if (pszStar != NULL) {
+            pszPattern = pszStar + 1;
+            pszString = ++pszStarString;
+        }
+        else
+            return false;
+    }
+
+    while (*pszPattern == '%')
+        pszPattern++;
+
+    return *pszPattern == '\0';
+}
+
 /**************************************************************************
  * \brief Look for raster tables in database and store them as subdatasets
  *
@@ -209,112 +359,144 @@ char** ParseConnectionString(const char * pszConnectionString) {
  * however, is optional. If a NULL value is provided, the driver looks for
  * all raster tables in all schemas of the user-provided database.
  *
+ * The raster tables of the database are listed once, and kept by the
+ * driver for POSTGIS_RASTER_CATALOG_CACHE_TTL seconds (see
+ * PostGISRasterDriver::GetCatalog). They're filtered by the options of the
+ * connection string pszFilename:
+ *  - schema_like, table_like: LIKE patterns for the schema and table names
+ *  - limit, offset: page of the (filtered) tables, ordered by schema,
+ *    table and column
+ *
  * NOTE: Permissions are managed by libpq. The driver only returns an error
  * if an error is returned when trying to access to tables not allowed to
  * the current user.
  **************************************************************************/
 GBool PostGISRasterDataset::BrowseDatabase(const char* pszCurrentSchema,
-        char* pszValidConnectionString) {
-    /* Be careful! These 3 vars override the class ones! */
-    char* pszSchema = NULL;
-    char* pszTable = NULL;
-    char* pszColumn = NULL;
+        char* pszValidConnectionString, const char * pszFilename) {
+    PostGISRasterDriver * poDriver = 
+        (PostGISRasterDriver *)GDALGetDriverByName("PostGISRaster");
+    char ** papszCatalog = NULL;
+    char * pszSchemaLike = NULL;
+    char * pszTableLike = NULL;
+    char * pszOption = NULL;
+    int nLimit = -1, nOffset = 0;
+    int nMatches = 0, nSubdatasets = 0;
     int i = 0;
     int nTuples = 0;
     PGresult * poResult = NULL;
     CPLString osCommand;
 
-
     /*************************************************************
-     * Fetch all the raster tables and store them as subdatasets
+     * Fetch all the raster tables, unless they were fetched
+     * recently
      *************************************************************/
-    if (pszCurrentSchema == NULL) {
+    if (poDriver != NULL)
+        papszCatalog = poDriver->GetCatalog(pszValidConnectionString);
+
+    if (papszCatalog == NULL) {
         osCommand.Printf("select pg_namespace.nspname as schema, pg_class.relname as \
 					table, pg_attribute.attname as column from pg_class, \
 					pg_namespace,pg_attribute, pg_type where \
 					pg_class.relnamespace = pg_namespace.oid and pg_class.oid = \
 					pg_attribute.attrelid and pg_attribute.atttypid = pg_type.oid \
-					and pg_type.typname = 'raster'");
+					and pg_type.typname = 'raster' order by 1, 2, 3");
 
-        poResult = PQexec(poConn, osCommand.c_str());
+        poResult = PostGISRasterExec(poConn, osCommand.c_str());
         if (
                 poResult == NULL ||
                 PQresultStatus(poResult) != PGRES_TUPLES_OK ||
                 PQntuples(poResult) <= 0
                 ) {
             CPLError(CE_Failure, CPLE_AppDefined,
-                    "Error browsing database for PostGIS Raster tables: %s", PQerrorMessage(poConn));
+                    "Error browsing database for PostGIS Raster tables: %s", PostGISRasterErrorMessage(poConn));
             if (poResult != NULL)
                 PQclear(poResult);
 
             return false;
         }
 
-
+        /* Built at once: CSLAddString would count the list each time */
         nTuples = PQntuples(poResult);
-        for (i = 0; i < nTuples; i++) {
-            pszSchema = PQgetvalue(poResult, i, 0);
-            pszTable = PQgetvalue(poResult, i, 1);
-            pszColumn = PQgetvalue(poResult, i, 2);
-
-            papszSubdatasets = CSLSetNameValue(papszSubdatasets,
-                    CPLSPrintf("SUBDATASET_%d_NAME", (i + 1)),
-                    CPLSPrintf("PG:%s schema=%s table=%s column=%s",
-                    pszValidConnectionString, pszSchema, pszTable, pszColumn));
-
-            papszSubdatasets = CSLSetNameValue(papszSubdatasets,
-                    CPLSPrintf("SUBDATASET_%d_DESC", (i + 1)),
-                    CPLSPrintf("PostGIS Raster table at %s.%s (%s)", pszSchema, pszTable, pszColumn));
-        }
+        papszCatalog = (char **) CPLCalloc(3 * nTuples + 1, sizeof (char *));
+        for (i = 0; i < 3 * nTuples; i++)
+            papszCatalog[i] = CPLStrdup(PQgetvalue(poResult, i / 3, i % 3));
 
         PQclear(poResult);
 
+        if (poDriver != NULL)
+            poDriver->SetCatalog(pszValidConnectionString, papszCatalog);
     }
-        /**********************************************************************
-         * Fetch all the schema's raster tables and store them as subdatasets
-         **********************************************************************/
-    else {
-        osCommand.Printf("select pg_class.relname as table, pg_attribute.attname \
-			 as column from pg_class, pg_namespace,pg_attribute, pg_type where \
-			 pg_class.relnamespace = pg_namespace.oid and pg_class.oid = \
-			 pg_attribute.attrelid and pg_attribute.atttypid = pg_type.oid \
-			 and pg_type.typname = 'raster' and pg_namespace.nspname = '%s'",
-                pszCurrentSchema);
-
-        poResult = PQexec(poConn, osCommand.c_str());
-        if (
-                poResult == NULL ||
-                PQresultStatus(poResult) != PGRES_TUPLES_OK ||
-                PQntuples(poResult) <= 0
-                ) {
-            CPLError(CE_Failure, CPLE_AppDefined,
-                    "Error browsing database for PostGIS Raster tables: %s", PQerrorMessage(poConn));
-            if (poResult != NULL)
-                PQclear(poResult);
 
-            return false;
-        }
+    /*************************************************************
+     * Filters and page
+     *************************************************************/
+    pszSchemaLike = FetchDriverOption(pszFilename, "schema_like");
+    pszTableLike = FetchDriverOption(pszFilename, "table_like");
 
+    pszOption = FetchDriverOption(pszFilename, "limit");
+    if (pszOption != NULL)
+        nLimit = MAX(atoi(pszOption), 0);
+    CPLFree(pszOption);
 
-        nTuples = PQntuples(poResult);
-        for (i = 0; i < nTuples; i++) {
-            pszTable = PQgetvalue(poResult, i, 0);
-            pszColumn = PQgetvalue(poResult, i, 1);
+    pszOption = FetchDriverOption(pszFilename, "offset");
+    if (pszOption != NULL)
+        nOffset = MAX(atoi(pszOption), 0);
+    CPLFree(pszOption);
 
-            papszSubdatasets = CSLSetNameValue(papszSubdatasets,
-                    CPLSPrintf("SUBDATASET_%d_NAME", (i + 1)),
-                    CPLSPrintf("PG:%s schema=%s table=%s column=%s",
-                    pszValidConnectionString, pszCurrentSchema, pszTable, pszColumn));
+    /*************************************************************
+     * Store the raster tables as subdatasets. The list is built
+     * at once, not with CSLSetNameValue, that looks for the name
+     * in the whole list each time
+     *************************************************************/
+    nTuples = CSLCount(papszCatalog) / 3;
+    papszSubdatasets = (char **) CPLCalloc(2 * ((nLimit >= 0) ? 
+        MIN(nLimit, nTuples) : nTuples) + 1, sizeof (char *));
 
-            papszSubdatasets = CSLSetNameValue(papszSubdatasets,
-                    CPLSPrintf("SUBDATASET_%d_DESC", (i + 1)),
-                    CPLSPrintf("PostGIS Raster table at %s.%s (%s)", pszCurrentSchema,
-                    pszTable, pszColumn));
-        }
+    for (i = 0; i < nTuples && (nLimit < 0 || nSubdatasets < nLimit); i++) {
+        const char * pszSchema = papszCatalog[3 * i];
+        const char * pszTable = papszCatalog[3 * i + 1];
+        const char * pszColumn = papszCatalog[3 * i + 2];
 
-        PQclear(poResult);
+        if ((pszCurrentSchema != NULL && strcmp(pszSchema, pszCurrentSchema) != 0) ||
+            (pszSchemaLike != NULL && !MatchLikePattern(pszSchemaLike, pszSchema)) ||
+            (pszTableLike != NULL && !MatchLikePattern(pszTableLike, pszTable)))
+            continue;
+
+        if (nMatches++ < nOffset)
+            continue;
+
+        papszSubdatasets[2 * nSubdatasets] = CPLStrdup(
+                CPLSPrintf("SUBDATASET_%d_NAME=PG:%s schema=%s table=%s column=%s",
+                nSubdatasets + 1, pszValidConnectionString, pszSchema, pszTable,
+                pszColumn));
+
+        papszSubdatasets[2 * nSubdatasets + 1] = CPLStrdup(
+                CPLSPrintf("SUBDATASET_%d_DESC=PostGIS Raster table at %s.%s (%s)",
+                nSubdatasets + 1, pszSchema, pszTable, pszColumn));
+
+        nSubdatasets++;
+    }
+
+    CPLDebug("PostGIS_Raster", "PostGISRasterDataset::BrowseDatabase(): "
+        "%d raster tables, %d listed", nTuples, nSubdatasets);
+
+    CSLDestroy(papszCatalog);
+
+    /* A schema without raster tables is an error, as before. An empty
+     * page or filter is not */
+    if (nMatches == 0 && pszCurrentSchema != NULL && pszSchemaLike == NULL &&
+        pszTableLike == NULL) {
+        CPLError(CE_Failure, CPLE_AppDefined,
+                "Error browsing database for PostGIS Raster tables: "
+                "no raster tables in schema %s", pszCurrentSchema);
+        CPLFree(pszSchemaLike);
+        CPLFree(pszTableLike);
+        return false;
     }
 
+    CPLFree(pszSchemaLike);
+    CPLFree(pszTableLike);
+
     return true;
 }
 
@@ -371,15 +553,43 @@ GBool PostGISRasterDataset::SetRasterProperties
 	int nPreviousTileHeight = 0;
 	int nBlockXSize = 0, nBlockYSize = 0;
 
-    /* Incorporated variables from old SetRasterBand method */
-    GBool bSignedByte = false;
-    int nBitDepth = 8;
-    char* pszDataType = NULL;
-    int iBand = 0;
-    double dfNodata = 0.0;
-    GDALDataType hDataType = GDT_Byte;
-    GBool bIsOffline = false;
-    GBool bHasNoDataValue = false;
+
+	/**************************************************************************
+	 * target_srid: the tiles are reprojected by the server to a common grid
+	 **************************************************************************/
+	if (nTargetSrid > 0) {
+		if (nMode == ONE_RASTER_PER_TABLE)
+			return SetTransformedRasterProperties();
+
+		CPLError(CE_Warning, CPLE_NotSupported, "target_srid needs a coverage "
+			"(mode=2). Ignored");
+		nTargetSrid = 0;
+	}
+
+	/**************************************************************************
+	 * Regularly blocked coverages registered in raster_columns: the
+	 * georeference and the block size come from the constraints, with no
+	 * table scan
+	 **************************************************************************/
+	if (pszWhere == NULL && nMode == ONE_RASTER_PER_TABLE &&
+		GetRasterColumnsMetadata(&nBlockXSize, &nBlockYSize))
+		return SetRasterBands(nBlockXSize, nBlockYSize);
+
+	/**************************************************************************
+	 * open_mode=approx: the georeference and the block size are estimated,
+	 * with no table scan. The first read checks them
+	 **************************************************************************/
+	if (bApproxOpen) {
+		if (pszWhere == NULL && nMode == ONE_RASTER_PER_TABLE &&
+			GetApproxMetadata(&nBlockXSize, &nBlockYSize))
+			return SetRasterBands(nBlockXSize, nBlockYSize);
+
+		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
+			"Can't open %s.%s (%s) in approximate mode. Scanning it", pszSchema,
+			pszTable, pszColumn);
+
+		bApproxOpen = false;
+	}
 
 	/**************************************************************************
 	 * Get the extent and the maximum number of bands of the requested raster
@@ -411,7 +621,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 		"First query: %s", osCommand.c_str());
 
 
-	poResult = PQexec(poConn, osCommand.c_str());
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
 	
 	// Query execution error
 	if(poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK || 
@@ -421,7 +631,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 			"PostGIS Raster properties");
 
 		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
-			"%s", PQerrorMessage(poConn));
+			"%s", PostGISRasterErrorMessage(poConn));
 
 		if (poResult != NULL)
 			PQclear(poResult);
@@ -438,8 +648,9 @@ GBool PostGISRasterDataset::SetRasterProperties
 		CPLError(CE_Failure, CPLE_AppDefined,
 			"Error, the table %s.%s contains tiles with different srid. This feature "
 			"is not yet supported by the PostGIS Raster driver. Please, specify a table "
-			"that contains only tiles with the same srid or provide a 'where' constraint "
-			"to select just the tiles with the same value for srid", pszSchema, pszTable);
+			"that contains only tiles with the same srid, provide a 'where' constraint "
+			"to select just the tiles with the same value for srid, or open it as a "
+			"coverage (mode=2) with a target_srid", pszSchema, pszTable);
 
 		PQclear(poResult);
 		return false;
@@ -479,7 +690,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
 		"Query: %s", osCommand.c_str());
 
-	poResult = PQexec(poConn, osCommand.c_str());
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
 	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
 		PQntuples(poResult) <= 0) {
 
@@ -487,7 +698,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 		CPLError(CE_Failure, CPLE_AppDefined, "Error retrieving raster metadata");
 
 		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
-			"%s", PQerrorMessage(poConn));
+			"%s", PostGISRasterErrorMessage(poConn));
 
 		if (poResult != NULL)
 			PQclear(poResult);
@@ -634,141 +845,8 @@ GBool PostGISRasterDataset::SetRasterProperties
             "Raster size = (%d, %d)", nRasterXSize, nRasterYSize);
 
 
-		/****************************************************************************
-		 * Dataset parameters are set. Now, let's add the raster bands
-		 ***************************************************************************/
-	    
-		/* Create query to fetch metadata from db */
-    	if (pszWhere == NULL) {
-        	osCommand.Printf("select st_bandpixeltype(rast, band), "
-            	"st_bandnodatavalue(rast, band) is null, "
-            	"st_bandnodatavalue(rast, band) from (select %s, "
-            	"generate_series(1, st_numbands(%s)) band from (select "
-            	"rast from %s.%s limit 1) bar) foo",
-            	pszColumn, pszColumn, pszSchema, pszTable);
-    	} 
-
-		else {
-        	osCommand.Printf("select st_bandpixeltype(rast, band), "
-           		"st_bandnodatavalue(rast, band) is null, "
-            	"st_bandnodatavalue(rast, band) from (select %s, "
-            	"generate_series(1, st_numbands(%s)) band from (select "
-            	"rast from %s.%s where %s limit 1) bar) foo",
-            	pszColumn, pszColumn, pszSchema, pszTable, pszWhere);
-    	}
-
-		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
-			"Query: %s", osCommand.c_str());
-    	
-		poResult = PQexec(poConn, osCommand.c_str());
-    	nTuples = PQntuples(poResult);
-
-    	/* Error getting info from database */
-    	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
-            nTuples <= 0) {
-        	
-			CPLError(CE_Failure, CPLE_AppDefined, "Error getting band metadata "
-				"while creating raster bands");
-                
-			CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): %s", 
-                    PQerrorMessage(poConn));
-        	
-			if (poResult)
-            	PQclear(poResult);
-
-        	return false;
-    	}
-
-    	/* Create each PostGISRasterRasterBand using the band metadata */
-    	for (iBand = 0; iBand < nTuples; iBand++) {
-        	/**
-         	 * If we have more than one record here is because there are several
-         	 * rows, belonging to the same raster coverage, with different band
-         	 * metadata values. An error must be raised.
-         	 *
-         	 * TODO: Is there any way to fix this problem?
-         	 *
-         	 * TODO: Even when the difference between metadata values are only a
-         	 * few decimal numbers (for example: 3.0000000 and 3.0000001) they're
-         	 * different tuples. And in that case, they must be the same
-         	 **/
-        	/*
-        	if (nTuples > 1) {
-            	CPLError(CE_Failure, CPLE_AppDefined, "Error, the \
-                    ONE_RASTER_PER_TABLE mode can't be applied if the raster \
-                    rows don't have the same metadata for band %d",
-                    iBand + 1);
-            	PQclear(poResult);
-            	return false;
-        	}
-         	*/
-
-
-        	/* Get metadata and create raster band objects */
-        	pszDataType = CPLStrdup(PQgetvalue(poResult, iBand, 0));
-        	bHasNoDataValue = EQUALN(PQgetvalue(poResult, iBand, 1), "f", sizeof(char));
-        	dfNodata = atof(PQgetvalue(poResult, iBand, 2));
-        	/** 
-         	 * Offline rasters are not yet supported. When offline rasters are
-         	 * supported, they will also requires a fast 'getter', other than 
-         	 * the ST_BandMetaData accessor.
-         	 **/
-        	
-			/* bIsOffline = EQUALN(PQgetvalue(poResult, iBand, 3), "t", sizeof (char));        */
-
-        	if (EQUALN(pszDataType, "1BB", 3 * sizeof (char))) {
-            	hDataType = GDT_Byte;
-            	nBitDepth = 1;
-        	} else if (EQUALN(pszDataType, "2BUI", 4 * sizeof (char))) {
-            	hDataType = GDT_Byte;
-            	nBitDepth = 2;
-        	} else if (EQUALN(pszDataType, "4BUI", 4 * sizeof (char))) {
-            	hDataType = GDT_Byte;
-            	nBitDepth = 4;
-        	} else if (EQUALN(pszDataType, "8BUI", 4 * sizeof (char))) {
-            	hDataType = GDT_Byte;
-            	nBitDepth = 8;
-        	} else if (EQUALN(pszDataType, "8BSI", 4 * sizeof (char))) {
-            	hDataType = GDT_Byte;
-            	/**
-             	 * To indicate the unsigned byte values between 128 and 255
-             	 * should be interpreted as being values between -128 and -1 for
-             	 * applications that recognise the SIGNEDBYTE type.
-             	 **/
-            	bSignedByte = true;
-            	nBitDepth = 8;
-        	} else if (EQUALN(pszDataType, "16BSI", 5 * sizeof (char))) {
-            	hDataType = GDT_Int16;
-            	nBitDepth = 16;
-        	} else if (EQUALN(pszDataType, "16BUI", 5 * sizeof (char))) {
-           		hDataType = GDT_UInt16;
-            	nBitDepth = 16;
-        	} else if (EQUALN(pszDataType, "32BSI", 5 * sizeof (char))) {
-            	hDataType = GDT_Int32;
-            	nBitDepth = 32;
-        	} else if (EQUALN(pszDataType, "32BUI", 5 * sizeof (char))) {
-            	hDataType = GDT_UInt32;
-            	nBitDepth = 32;
-        	} else if (EQUALN(pszDataType, "32BF", 4 * sizeof (char))) {
-            	hDataType = GDT_Float32;
-            	nBitDepth = 32;
-        	} else if (EQUALN(pszDataType, "64BF", 4 * sizeof (char))) {
-            	hDataType = GDT_Float64;
-            	nBitDepth = 64;
-        	} else {
-            	hDataType = GDT_Byte;
-            	nBitDepth = 8;
-        	}
-
-        	/* Create raster band object */
-        	SetBand(iBand + 1, new PostGISRasterRasterBand(this, iBand + 1, hDataType,
-                bHasNoDataValue, dfNodata, bSignedByte, nBitDepth, 0, nBlockXSize, 
-				nBlockYSize, bIsOffline));
-
-        	CPLFree(pszDataType);
-    	}
-
-   		PQclear(poResult);
+		if (!SetRasterBands(nBlockXSize, nBlockYSize))
+			return false;
 	}
 
 
@@ -788,7 +866,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 			"Query: %s", osCommand.c_str());
 
 
-		poResult = PQexec(poConn, osCommand.c_str());
+		poResult = PostGISRasterExec(poConn, osCommand.c_str());
 		if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
 			PQntuples(poResult) <= 0 ) {
 
@@ -807,7 +885,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 			CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
 				"Query: %s", osCommand.c_str());
 
-			poResult = PQexec(poConn, osCommand.c_str());
+			poResult = PostGISRasterExec(poConn, osCommand.c_str());
 
 			if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
 				PQntuples(poResult) <= 0) {
@@ -852,7 +930,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 			CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
 				"Query: %s", osCommand.c_str());
 
-			poResult = PQexec(poConn, osCommand.c_str());
+			poResult = PostGISRasterExec(poConn, osCommand.c_str());
 			if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
 				PQntuples(poResult) <= 0) {
 
@@ -860,7 +938,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 						"while creating raster subdatasets");
 
 					CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
-						"%s", PQerrorMessage(poConn));
+						"%s", PostGISRasterErrorMessage(poConn));
 
 					if (poResult != NULL)
 						PQclear(poResult);
@@ -908,7 +986,7 @@ GBool PostGISRasterDataset::SetRasterProperties
             CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): "
                 "Query: %s", osCommand.c_str());
             
-            poResult = PQexec(poConn, osCommand.c_str());
+            poResult = PostGISRasterExec(poConn, osCommand.c_str());
             if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
                 PQntuples(poResult) <= 0) {
                 
@@ -916,7 +994,7 @@ GBool PostGISRasterDataset::SetRasterProperties
 						"while creating raster subdatasets");
 				
                 CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterProperties(): %s", 
-                    PQerrorMessage(poConn));
+                    PostGISRasterErrorMessage(poConn));
                 
                 
                 if (poResult != NULL)
@@ -973,129 +1051,1183 @@ GBool PostGISRasterDataset::SetRasterProperties
     return true;
 }
 
-/******************************************************************************
- * \brief Get the connection information for a filename.
- ******************************************************************************/
-static GBool
-GetConnectionInfo(const char * pszFilename, 
-    char ** ppszConnectionString, char ** ppszSchema, char ** ppszTable, 
-    char ** ppszColumn, char ** ppszWhere, char ** ppszHost, 
-    char ** ppszPort, char ** ppszUser, char ** ppszPassword, 
-    int * nMode, GBool * bBrowseDatabase)
+/**************************************************************************
+ * \brief Check if a raster table has the tile stats sidecar columns.
+ **************************************************************************/
+GBool PostGISRasterDataset::HasTileStats(PGconn * poConn, 
+	const char * pszSchema, const char * pszTable, const char * pszColumn)
 {
-    int nPos = -1, i;
-    char * pszTmp = NULL;
-    char **papszParams = ParseConnectionString(pszFilename);
-    if (papszParams == NULL) {
-        return false;
-    }
+	PGresult* poResult = NULL;
+	CPLString osCommand;
+	GBool bHasTileStats;
 
-    /**************************************************************************
-     * Get mode:
-     *  - 1. ONE_RASTER_PER_ROW: Each row is considered as a separate raster
-     *  - 2. ONE_RASTER_PER_TABLE: All the table rows are considered as a whole
-     *      raster coverage
-     **************************************************************************/
-    nPos = CSLFindName(papszParams, "mode");
-    if (nPos != -1) {
-        *nMode = atoi(CPLParseNameValue(papszParams[nPos], NULL));
+	osCommand.Printf("select count(*) from information_schema.columns where "
+		"table_schema = '%s' and table_name = '%s' and column_name in "
+		"('%s" TILE_STATS_MIN_SUFFIX "', '%s" TILE_STATS_MAX_SUFFIX "')", 
+		pszSchema, pszTable, pszColumn, pszColumn);
 
-        if (*nMode != ONE_RASTER_PER_ROW && *nMode != ONE_RASTER_PER_TABLE) {
-            /* Unrecognized mode, using default one */
-            /*
-            CPLError(CE_Warning, CPLE_AppDefined, "Undefined working mode (%d)."
-                    " Valid working modes are 1 (ONE_RASTER_PER_ROW) and 2"
-                    " (ONE_RASTER_PER_TABLE). Using ONE_RASTER_PER_TABLE"
-                    " by default", nMode);
-             */
-            *nMode = ONE_RASTER_PER_ROW;
-        }
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	bHasTileStats = (poResult != NULL && 
+		PQresultStatus(poResult) == PGRES_TUPLES_OK && 
+		PQntuples(poResult) == 1 && atoi(PQgetvalue(poResult, 0, 0)) == 2);
 
-        /* Remove the mode from connection string */
-        papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
-    }
-        /* Default mode */
-    else
-        *nMode = ONE_RASTER_PER_ROW;
+	if (poResult != NULL)
+		PQclear(poResult);
 
-    /**
-     * Case 1: There's no database name: Error, you need, at least,
-     * specify a database name (NOTE: insensitive search)
-     **/
-    nPos = CSLFindName(papszParams, "dbname");
-    if (nPos == -1) {
-        CPLError(CE_Failure, CPLE_AppDefined,
-                "You must specify at least a db name");
+	return bHasTileStats;
+}
 
-        CSLDestroy(papszParams);
+/**************************************************************************
+ * \brief Store the per-band minimum and maximum of each tile in sidecar
+ * columns of the raster table (<column>_min and <column>_max, arrays
+ * indexed by band number), creating them if needed.
+ *
+ * The stats exclude the nodata pixels. A band with only nodata pixels gets
+ * a null element, so the tile never matches a value filter on that band.
+ * A tile without stats (a null array) is never pruned.
+ *
+ * If bOnlyMissing, only the tiles without stats are updated.
+ **************************************************************************/
+GBool PostGISRasterDataset::UpdateTileStats(PGconn * poConn, 
+	const char * pszSchema, const char * pszTable, const char * pszColumn,
+	GBool bOnlyMissing)
+{
+	PGresult* poResult = NULL;
+	CPLString osCommand;
 
-        return false;
-    }
+	if (!HasTileStats(poConn, pszSchema, pszTable, pszColumn)) {
+		osCommand.Printf("alter table %s.%s add column %s" TILE_STATS_MIN_SUFFIX 
+			" double precision[], add column %s" TILE_STATS_MAX_SUFFIX 
+			" double precision[]", pszSchema, pszTable, pszColumn, pszColumn);
 
-    /**
-     * Case 2: There's database name, but no table name: activate a flag
-     * for browsing the database, fetching all the schemas that contain
-     * raster tables
-     **/
-    nPos = CSLFindName(papszParams, "table");
-    if (nPos == -1) {
-        *bBrowseDatabase = true;
+		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::UpdateTileStats(): "
+			"Query: %s", osCommand.c_str());
 
-        /* Get schema name, if exist */
-        nPos = CSLFindName(papszParams, "schema");
-        if (nPos != -1) {
-            *ppszSchema = CPLStrdup(CPLParseNameValue(papszParams[nPos], NULL));
-            /* Delete this pair from params array */
-            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
-        }
+		poResult = PostGISRasterExec(poConn, osCommand.c_str());
+		if (poResult == NULL || PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+			CPLError(CE_Warning, CPLE_AppDefined, "Error adding the tile stats "
+				"columns: %s", PostGISRasterErrorMessage(poConn));
+			if (poResult != NULL)
+				PQclear(poResult);
 
-        /**
-         * Remove the rest of the parameters, if exist (they mustn't be present
-         * if we want a valid PQ connection string)
-         **/
-        nPos = CSLFindName(papszParams, "column");
-        if (nPos != -1) {
-            /* Delete this pair from params array */
-            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
-        }
+			return false;
+		}
 
-        nPos = CSLFindName(papszParams, "where");
-        if (nPos != -1) {
-            /* Delete this pair from params array */
-            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
-        }
-    } else {
-        *ppszTable = CPLStrdup(CPLParseNameValue(papszParams[nPos], NULL));
-        /* Delete this pair from params array */
-        papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+		PQclear(poResult);
+	}
 
-        /**
-         * Case 3: There's database and table name, but no column
-         * name: Use a default column name and use the table to create the
-         * dataset
-         **/
-        nPos = CSLFindName(papszParams, "column");
-        if (nPos == -1) {
-            *ppszColumn = CPLStrdup(DEFAULT_COLUMN);
-        }
-        /**
-         * Case 4: There's database, table and column name: Use the table to
-         * create a dataset
-         **/
-        else {
-            *ppszColumn = CPLStrdup(CPLParseNameValue(papszParams[nPos], NULL));
-            /* Delete this pair from params array */
-            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
-        }
+	osCommand.Printf("update %s.%s set "
+		"%s" TILE_STATS_MIN_SUFFIX " = array(select (st_summarystats(%s, b, "
+		"true)).min from generate_series(1, st_numbands(%s)) as b order by b), "
+		"%s" TILE_STATS_MAX_SUFFIX " = array(select (st_summarystats(%s, b, "
+		"true)).max from generate_series(1, st_numbands(%s)) as b order by b) "
+		"where %s is not null%s", pszSchema, pszTable, 
+		pszColumn, pszColumn, pszColumn, pszColumn, pszColumn, pszColumn, 
+		pszColumn, (bOnlyMissing) ? 
+		CPLSPrintf(" and %s" TILE_STATS_MIN_SUFFIX " is null", pszColumn) : "");
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::UpdateTileStats(): "
+		"Query: %s", osCommand.c_str());
 
-        /* Get the rest of the parameters, if exist */
-        nPos = CSLFindName(papszParams, "schema");
-        if (nPos == -1) {
-            *ppszSchema = CPLStrdup(DEFAULT_SCHEMA);
-        } else {
-            *ppszSchema = CPLStrdup(CPLParseNameValue(papszParams[nPos], NULL));
-            /* Delete this pair from params array */
-            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+		CPLError(CE_Warning, CPLE_AppDefined, "Error computing the tile "
+			"stats: %s", PostGISRasterErrorMessage(poConn));
+		if (poResult != NULL)
+			PQclear(poResult);
+
+		return false;
+	}
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::UpdateTileStats(): "
+		"%s tiles updated", PQcmdTuples(poResult));
+
+	PQclear(poResult);
+
+	return true;
+}
+
+/**************************************************************************
+ * \brief Translate a value filter ('band1>30 and band2<=5') into a tile
+ * predicate on the value range of the tiles.
+ *
+ * A tile is read only if every condition can be true for some of its
+ * pixels. The ranges come from the tile stats sidecar columns if the table
+ * has them (see UpdateTileStats), or else they're computed by the server,
+ * which still saves the transfer of the pruned tiles. The pixels of the
+ * tiles that are read are not filtered.
+ **************************************************************************/
+GBool PostGISRasterDataset::SetValueFilter(const char * pszFilter)
+{
+	CPLString osFilter;
+	CPLString osMin, osMax;
+	CPLString osNoStats;
+	const char * pszPos = pszFilter;
+	char * pszEnd = NULL;
+	char szOperator[3];
+	GBool bHasTileStats;
+	int nFilterBand;
+	double dfValue;
+	int i;
+
+	if (nMode != ONE_RASTER_PER_TABLE) {
+		CPLError(CE_Warning, CPLE_NotSupported, "value_filter only applies to "
+			"coverages (mode=2). Ignored");
+		return true;
+	}
+
+	bHasTileStats = HasTileStats(poConn, pszSchema, pszTable, pszColumn);
+	if (!bHasTileStats)
+		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetValueFilter(): "
+			"No tile stats in %s.%s, the server will compute them", pszSchema,
+			pszTable);
+
+	while (true) {
+		while (isspace((unsigned char)*pszPos))
+			pszPos++;
+
+		if (!EQUALN(pszPos, "band", 4))
+			break;
+
+		nFilterBand = (int)strtol(pszPos + 4, &pszEnd, 10);
+		if (pszEnd == pszPos + 4 || nFilterBand < 1 || nFilterBand > nBands)
+			break;
+
+		pszPos = pszEnd;
+		while (isspace((unsigned char)*pszPos))
+			pszPos++;
+
+		for (i = 0; i < 2 && strchr("<>=!", pszPos[i]) != NULL &&
+			pszPos[i] != '\0'; i++)
+			szOperator[i] = pszPos[i];
+		szOperator[i] = '\0';
+
+		dfValue = CPLStrtod(pszPos + i, &pszEnd);
+		if (i == 0 || pszEnd == pszPos + i || !CPLIsFinite(dfValue))
+			break;
+
+		pszPos = pszEnd;
+
+		if (bHasTileStats) {
+			osMin.Printf("%s" TILE_STATS_MIN_SUFFIX "[%d]", pszColumn, nFilterBand);
+			osMax.Printf("%s" TILE_STATS_MAX_SUFFIX "[%d]", pszColumn, nFilterBand);
+			osNoStats.Printf("%s" TILE_STATS_MIN_SUFFIX " is null or ", pszColumn);
+		}
+		else {
+			osMin.Printf("(st_summarystats(%s, %d, true)).min", pszColumn, 
+				nFilterBand);
+			osMax.Printf("(st_summarystats(%s, %d, true)).max", pszColumn, 
+				nFilterBand);
+		}
+
+		if (!osFilter.empty())
+			osFilter += " and ";
+
+		if (EQUAL(szOperator, ">") || EQUAL(szOperator, ">="))
+			osFilter += CPLString().Printf("(%s%s %s %.17g)", osNoStats.c_str(),
+				osMax.c_str(), szOperator, dfValue);
+		else if (EQUAL(szOperator, "<") || EQUAL(szOperator, "<="))
+			osFilter += CPLString().Printf("(%s%s %s %.17g)", osNoStats.c_str(),
+				osMin.c_str(), szOperator, dfValue);
+		else if (EQUAL(szOperator, "=") || EQUAL(szOperator, "=="))
+			osFilter += CPLString().Printf("(%s%s <= %.17g and %s >= %.17g)", 
+				osNoStats.c_str(), osMin.c_str(), dfValue, osMax.c_str(), dfValue);
+		else if (EQUAL(szOperator, "<>") || EQUAL(szOperator, "!="))
+			osFilter += CPLString().Printf("(%snot (%s = %.17g and %s = %.17g))", 
+				osNoStats.c_str(), osMin.c_str(), dfValue, osMax.c_str(), dfValue);
+		else
+			break;
+
+		while (isspace((unsigned char)*pszPos))
+			pszPos++;
+
+		if (*pszPos == '\0') {
+			CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetValueFilter(): "
+				"Tile predicate: %s", osFilter.c_str());
+
+			pszValueFilter = CPLStrdup(osFilter);
+			return true;
+		}
+
+		if (!EQUALN(pszPos, "and", 3) || !isspace((unsigned char)pszPos[3]))
+			break;
+
+		pszPos += 3;
+	}
+
+	CPLError(CE_Failure, CPLE_IllegalArg, "Invalid value_filter '%s' near '%s'. "
+		"Expected conditions like band1>30, joined by 'and', with bands "
+		"between 1 and %d", pszFilter, pszPos, nBands);
+
+	return false;
+}
+
+/**************************************************************************
+ * \brief Get the georeference and the block size of the coverage from
+ * raster_columns.
+ *
+ * Only used if the coverage has the srid, scale, blocksize and extent
+ * constraints, and it's regularly blocked (AddRasterConstraints, as done
+ * by CreateCopy). Returns false otherwise, or if raster_columns can't be
+ * queried (PostGIS older than 2.0), and the table has to be scanned.
+ **************************************************************************/
+GBool PostGISRasterDataset::GetRasterColumnsMetadata(int * pnBlockXSize,
+	int * pnBlockYSize)
+{
+	PGresult* poResult = NULL;
+	CPLString osCommand;
+	double dfScaleX, dfScaleY;
+	double dfRows, dfBlocks;
+	int i;
+
+	osCommand.Printf("select srid, scale_x, scale_y, blocksize_x, blocksize_y, "
+		"num_bands, st_xmin(extent), st_xmax(extent), st_ymin(extent), "
+		"st_ymax(extent), (select st_skewx(%s) = 0 and st_skewy(%s) = 0 from "
+		"%s.%s limit 1), (select c.reltuples from pg_class c join "
+		"pg_namespace n on n.oid = c.relnamespace where n.nspname = '%s' and "
+		"c.relname = '%s') from raster_columns where r_table_schema = '%s' and "
+		"r_table_name = '%s' and r_raster_column = '%s' and regular_blocking",
+		pszColumn, pszColumn, pszSchema, pszTable, pszSchema, pszTable,
+		pszSchema, pszTable, pszColumn);
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetRasterColumnsMetadata(): "
+		"Query: %s", osCommand.c_str());
+
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+		PQntuples(poResult) != 1) {
+		if (poResult != NULL)
+			PQclear(poResult);
+
+		return false;
+	}
+
+	for(i = 0; i < PQnfields(poResult); i++) {
+		if (PQgetisnull(poResult, 0, i)) {
+			PQclear(poResult);
+			return false;
+		}
+	}
+
+	dfScaleX = atof(PQgetvalue(poResult, 0, 1));
+	dfScaleY = atof(PQgetvalue(poResult, 0, 2));
+	*pnBlockXSize = atoi(PQgetvalue(poResult, 0, 3));
+	*pnBlockYSize = atoi(PQgetvalue(poResult, 0, 4));
+
+	// Rotated rasters are handled (and rejected) by the full scan
+	if (dfScaleX == 0.0 || dfScaleY == 0.0 || *pnBlockXSize <= 0 || 
+		*pnBlockYSize <= 0 || !EQUAL(PQgetvalue(poResult, 0, 10), "t")) {
+		PQclear(poResult);
+		return false;
+	}
+
+	nSrid = atoi(PQgetvalue(poResult, 0, 0));
+	nBands = atoi(PQgetvalue(poResult, 0, 5));
+	xmin = atof(PQgetvalue(poResult, 0, 6));
+	xmax = atof(PQgetvalue(poResult, 0, 7));
+	ymin = atof(PQgetvalue(poResult, 0, 8));
+	ymax = atof(PQgetvalue(poResult, 0, 9));
+	dfRows = atof(PQgetvalue(poResult, 0, 11));
+
+	PQclear(poResult);
+
+	adfGeoTransform[GEOTRSFRM_TOPLEFT_X] = xmin;
+	adfGeoTransform[GEOTRSFRM_WE_RES] = dfScaleX;
+	adfGeoTransform[GEOTRSFRM_ROTATION_PARAM1] = 0.0;
+	adfGeoTransform[GEOTRSFRM_TOPLEFT_Y] = (dfScaleY >= 0.0) ? ymin : ymax;
+	adfGeoTransform[GEOTRSFRM_ROTATION_PARAM2] = 0.0;
+	adfGeoTransform[GEOTRSFRM_NS_RES] = dfScaleY;
+
+	nRasterXSize = (int) fabs(rint((xmax - xmin) / dfScaleX));
+	nRasterYSize = (int) fabs(rint((ymax - ymin) / dfScaleY));
+	if (nRasterXSize <= 0 || nRasterYSize <= 0)
+		return false;
+
+	/**
+	 * Regularly blocked tiles don't overlap, so there are at most as many
+	 * as blocks. reltuples is 0 (or -1) until the table is analyzed: the
+	 * coverage is then taken as full
+	 **/
+	dfBlocks = (double) ((nRasterXSize + *pnBlockXSize - 1) / *pnBlockXSize) *
+		((nRasterYSize + *pnBlockYSize - 1) / *pnBlockYSize);
+	nTiles = (int) ((dfRows >= 1.0) ? MIN(dfRows, dfBlocks) : dfBlocks);
+
+	bRegularBlocking = true;
+	bRegisteredInRasterColumns = true;
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetRasterColumnsMetadata(): "
+		"Raster size = (%d, %d), block size = (%d, %d), %d tiles", nRasterXSize,
+		nRasterYSize, *pnBlockXSize, *pnBlockYSize, nTiles);
+
+	return true;
+}
+
+/**************************************************************************
+ * \brief Get the georeference and the block size of the coverage from the
+ * planner statistics and a sample of tiles (open_mode=approx).
+ *
+ * The raster column itself has no spatial statistics, so the extent is
+ * the one estimated by ST_EstimatedExtent on the expression of the
+ * st_convexhull GiST index of the column (the index must have been
+ * analyzed with the table). Without such an index, it's the extent of the
+ * sampled tiles, which may be smaller than the coverage. Either one is
+ * snapped to the grid of the sampled tiles. The scale, block size and band
+ * count come from a TABLESAMPLE SYSTEM sample of APPROX_SAMPLE_SIZE tiles
+ * (the first tiles, for PostgreSQL older than 9.5). Returns false if the
+ * table can't be sampled, or if the sampled tiles don't share srid, scale
+ * and size, and the table has to be scanned.
+ *
+ * Nothing is checked against the other tiles here: the first read does it
+ * (see PostGISRasterRasterBand::IRasterIO).
+ **************************************************************************/
+GBool PostGISRasterDataset::GetApproxMetadata(int * pnBlockXSize,
+	int * pnBlockYSize)
+{
+	PGresult* poResult = NULL;
+	CPLString osCommand;
+	CPLString osSample;
+	double dfRows, dfPercent;
+	double dfScaleX, dfScaleY;
+	double dfUpperLeftX, dfUpperLeftY;
+	double dfTileMinX, dfTileMaxX, dfTileMinY, dfTileMaxY;
+	GBool bIndexExtent = false;
+	int i, nTuples;
+
+	/**
+	 * The statistics of an expression index are kept under the index, with
+	 * the name of its column (st_convexhull)
+	 **/
+	osCommand.Printf("select st_xmin(e), st_xmax(e), st_ymin(e), st_ymax(e), "
+		"reltuples from (select c.reltuples, (select "
+		"st_estimatedextent(n.nspname, i.relname, a.attname) from pg_index x "
+		"join pg_class i on i.oid = x.indexrelid join pg_am m on "
+		"i.relam = m.oid join pg_attribute a on a.attrelid = i.oid and "
+		"a.attnum = 1 where x.indrelid = c.oid and x.indexprs is not null and "
+		"m.amname = 'gist' and pg_get_indexdef(x.indexrelid) ilike "
+		"'%%st_convexhull(' || quote_ident('%s') || ')%%' limit 1) e "
+		"from pg_class c join pg_namespace n on c.relnamespace = n.oid "
+		"where n.nspname = '%s' and c.relname = '%s') foo", pszColumn,
+		pszSchema, pszTable);
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetApproxMetadata(): "
+		"Query: %s", osCommand.c_str());
+
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+		PQntuples(poResult) != 1) {
+		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetApproxMetadata(): "
+			"Couldn't get the statistics of %s.%s: %s", pszSchema, pszTable,
+			PostGISRasterErrorMessage(poConn));
+
+		if (poResult != NULL)
+			PQclear(poResult);
+
+		return false;
+	}
+
+	if (!PQgetisnull(poResult, 0, 0)) {
+		xmin = atof(PQgetvalue(poResult, 0, 0));
+		xmax = atof(PQgetvalue(poResult, 0, 1));
+		ymin = atof(PQgetvalue(poResult, 0, 2));
+		ymax = atof(PQgetvalue(poResult, 0, 3));
+		bIndexExtent = true;
+	}
+	else {
+		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetApproxMetadata(): "
+			"No index statistics for %s.%s (%s), using the extent of the "
+			"sampled tiles", pszSchema, pszTable, pszColumn);
+	}
+
+	dfRows = atof(PQgetvalue(poResult, 0, 4));
+
+	PQclear(poResult);
+
+	/**
+	 * Sample twice the tiles needed: SYSTEM sampling picks whole pages, so
+	 * the number of tiles it returns varies
+	 **/
+	dfPercent = (dfRows > 2 * APPROX_SAMPLE_SIZE) ? 
+		100.0 * 2 * APPROX_SAMPLE_SIZE / dfRows : 100.0;
+
+	osSample.Printf("select st_srid(%s), st_scalex(%s), st_scaley(%s), "
+		"st_skewx(%s), st_skewy(%s), st_width(%s), st_height(%s), "
+		"st_numbands(%s), st_upperleftx(%s), st_upperlefty(%s) from %s.%s",
+		pszColumn, pszColumn, pszColumn, pszColumn, pszColumn, pszColumn,
+		pszColumn, pszColumn, pszColumn, pszColumn, pszSchema, pszTable);
+
+	osCommand.Printf("%s tablesample system (%.6f) limit %d", osSample.c_str(),
+		dfPercent, APPROX_SAMPLE_SIZE);
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetApproxMetadata(): "
+		"Query: %s", osCommand.c_str());
+
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+		PQntuples(poResult) <= 0) {
+		if (poResult != NULL)
+			PQclear(poResult);
+
+		osCommand.Printf("%s limit %d", osSample.c_str(), APPROX_SAMPLE_SIZE);
+
+		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetApproxMetadata(): "
+			"Query: %s", osCommand.c_str());
+
+		poResult = PostGISRasterExec(poConn, osCommand.c_str());
+		if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+			PQntuples(poResult) <= 0) {
+			if (poResult != NULL)
+				PQclear(poResult);
+
+			return false;
+		}
+	}
+
+	nTuples = PQntuples(poResult);
+
+	nSrid = atoi(PQgetvalue(poResult, 0, 0));
+	dfScaleX = atof(PQgetvalue(poResult, 0, 1));
+	dfScaleY = atof(PQgetvalue(poResult, 0, 2));
+	*pnBlockXSize = atoi(PQgetvalue(poResult, 0, 5));
+	*pnBlockYSize = atoi(PQgetvalue(poResult, 0, 6));
+	dfUpperLeftX = atof(PQgetvalue(poResult, 0, 8));
+	dfUpperLeftY = atof(PQgetvalue(poResult, 0, 9));
+	nBands = 0;
+
+	dfTileMinX = dfTileMinY = HUGE_VAL;
+	dfTileMaxX = dfTileMaxY = -HUGE_VAL;
+
+	// Rotated or irregular coverages are handled by the full scan
+	for(i = 0; i < nTuples; i++) {
+		if (atoi(PQgetvalue(poResult, i, 0)) != nSrid ||
+			!CPLIsEqual(atof(PQgetvalue(poResult, i, 1)), dfScaleX) ||
+			!CPLIsEqual(atof(PQgetvalue(poResult, i, 2)), dfScaleY) ||
+			!CPLIsEqual(atof(PQgetvalue(poResult, i, 3)), 0.0) ||
+			!CPLIsEqual(atof(PQgetvalue(poResult, i, 4)), 0.0) ||
+			atoi(PQgetvalue(poResult, i, 5)) != *pnBlockXSize ||
+			atoi(PQgetvalue(poResult, i, 6)) != *pnBlockYSize) {
+
+			CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetApproxMetadata(): "
+				"The sampled tiles of %s.%s (%s) are not regularly blocked",
+				pszSchema, pszTable, pszColumn);
+
+			PQclear(poResult);
+			return false;
+		}
+
+		nBands = MAX(nBands, atoi(PQgetvalue(poResult, i, 7)));
+
+		double dfX1 = atof(PQgetvalue(poResult, i, 8));
+		double dfY1 = atof(PQgetvalue(poResult, i, 9));
+		double dfX2 = dfX1 + *pnBlockXSize * dfScaleX;
+		double dfY2 = dfY1 + *pnBlockYSize * dfScaleY;
+
+		dfTileMinX = MIN(dfTileMinX, MIN(dfX1, dfX2));
+		dfTileMaxX = MAX(dfTileMaxX, MAX(dfX1, dfX2));
+		dfTileMinY = MIN(dfTileMinY, MIN(dfY1, dfY2));
+		dfTileMaxY = MAX(dfTileMaxY, MAX(dfY1, dfY2));
+	}
+
+	PQclear(poResult);
+
+	if (!bIndexExtent) {
+		xmin = dfTileMinX;
+		xmax = dfTileMaxX;
+		ymin = dfTileMinY;
+		ymax = dfTileMaxY;
+	}
+
+	if (dfScaleX == 0.0 || dfScaleY == 0.0 || *pnBlockXSize <= 0 ||
+		*pnBlockYSize <= 0 || nBands <= 0)
+		return false;
+
+	/**
+	 * Snap the extent outwards to the grid of the sampled tiles,
+	 * so the tiles are composited at whole pixel offsets
+	 **/
+	xmin = dfUpperLeftX + floor((xmin - dfUpperLeftX) / fabs(dfScaleX)) * 
+		fabs(dfScaleX);
+	xmax = dfUpperLeftX + ceil((xmax - dfUpperLeftX) / fabs(dfScaleX)) * 
+		fabs(dfScaleX);
+	ymin = dfUpperLeftY + floor((ymin - dfUpperLeftY) / fabs(dfScaleY)) * 
+		fabs(dfScaleY);
+	ymax = dfUpperLeftY + ceil((ymax - dfUpperLeftY) / fabs(dfScaleY)) * 
+		fabs(dfScaleY);
+
+	adfGeoTransform[GEOTRSFRM_TOPLEFT_X] = xmin;
+	adfGeoTransform[GEOTRSFRM_WE_RES] = dfScaleX;
+	adfGeoTransform[GEOTRSFRM_ROTATION_PARAM1] = 0.0;
+	adfGeoTransform[GEOTRSFRM_TOPLEFT_Y] = (dfScaleY >= 0.0) ? ymin : ymax;
+	adfGeoTransform[GEOTRSFRM_ROTATION_PARAM2] = 0.0;
+	adfGeoTransform[GEOTRSFRM_NS_RES] = dfScaleY;
+
+	nRasterXSize = (int) fabs(rint((xmax - xmin) / dfScaleX));
+	nRasterYSize = (int) fabs(rint((ymax - ymin) / dfScaleY));
+	if (nRasterXSize <= 0 || nRasterYSize <= 0)
+		return false;
+
+	// reltuples is 0 (or -1) until the table is analyzed
+	nTiles = MAX((int) dfRows, nTuples);
+	bRegularBlocking = true;
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::GetApproxMetadata(): "
+		"Raster size = (%d, %d), block size = (%d, %d), %d tiles sampled",
+		nRasterXSize, nRasterYSize, *pnBlockXSize, *pnBlockYSize, nTuples);
+
+	return true;
+}
+
+/**************************************************************************
+ * \brief Get the georeference of a coverage whose tiles are reprojected to
+ * target_srid, and create its bands.
+ *
+ * The tiles may have different srids. Their envelopes are transformed to
+ * the target srid to get the extent, and the pixel size in it, averaged
+ * (or the highest or lowest one, following the resolution strategy). The
+ * reads get the tiles warped by the server to that grid (see
+ * GetRasterExpression), so the blocking is not regular. The distinct srids
+ * of the tiles are kept, to select them by srid (see GetIntersectingRows).
+ **************************************************************************/
+GBool PostGISRasterDataset::SetTransformedRasterProperties()
+{
+	PGresult* poResult = NULL;
+	CPLString osCommand;
+	const char * pszAggregate;
+	char ** papszSrids;
+	double dfScaleX, dfScaleY;
+	int i;
+
+	if (resolutionStrategy == HIGHEST_RESOLUTION)
+		pszAggregate = "min";
+	else if (resolutionStrategy == LOWEST_RESOLUTION)
+		pszAggregate = "max";
+	else
+		pszAggregate = "avg";
+
+	osCommand.Printf("select nbband, st_xmin(e), st_xmax(e), st_ymin(e), "
+		"st_ymax(e), sx, sy, n, s from (select st_extent(g) e, %s((st_xmax(g) - "
+		"st_xmin(g)) / st_width(r)) sx, %s((st_ymax(g) - st_ymin(g)) / "
+		"st_height(r)) sy, max(st_numbands(r)) nbband, count(*) n, "
+		"array_to_string(array_agg(distinct st_srid(r)), ',') s from "
+		"(select %s r, st_transform(st_envelope(%s), %d) g from %s.%s%s%s) "
+		"foo) bar", pszAggregate, pszAggregate, pszColumn, pszColumn,
+		nTargetSrid, pszSchema, pszTable, (pszWhere) ? " where " : "",
+		(pszWhere) ? pszWhere : "");
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetTransformedRasterProperties(): "
+		"Query: %s", osCommand.c_str());
+
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+		PQntuples(poResult) != 1) {
+
+		CPLError(CE_Failure, CPLE_AppDefined, "Error getting the extent of "
+			"%s.%s in srid %d: %s", pszSchema, pszTable, nTargetSrid,
+			PostGISRasterErrorMessage(poConn));
+
+		if (poResult != NULL)
+			PQclear(poResult);
+
+		return false;
+	}
+
+	for(i = 0; i < PQnfields(poResult); i++) {
+		if (PQgetisnull(poResult, 0, i)) {
+			CPLError(CE_Failure, CPLE_AppDefined, "Error getting the extent of "
+				"%s.%s in srid %d: no tiles", pszSchema, pszTable, nTargetSrid);
+			PQclear(poResult);
+			return false;
+		}
+	}
+
+	nBands = atoi(PQgetvalue(poResult, 0, 0));
+	xmin = atof(PQgetvalue(poResult, 0, 1));
+	xmax = atof(PQgetvalue(poResult, 0, 2));
+	ymin = atof(PQgetvalue(poResult, 0, 3));
+	ymax = atof(PQgetvalue(poResult, 0, 4));
+	dfScaleX = atof(PQgetvalue(poResult, 0, 5));
+	dfScaleY = atof(PQgetvalue(poResult, 0, 6));
+	nTiles = atoi(PQgetvalue(poResult, 0, 7));
+
+	papszSrids = CSLTokenizeString2(PQgetvalue(poResult, 0, 8), ",", 0);
+	nTileSrids = CSLCount(papszSrids);
+	CPLFree(panTileSrids);
+	panTileSrids = (int *) CPLMalloc(sizeof (int) * MAX(nTileSrids, 1));
+	for(i = 0; i < nTileSrids; i++)
+		panTileSrids[i] = atoi(papszSrids[i]);
+	CSLDestroy(papszSrids);
+
+	PQclear(poResult);
+
+	if (dfScaleX <= 0.0 || dfScaleY <= 0.0) {
+		CPLError(CE_Failure, CPLE_AppDefined, "Computed PostGIS Raster pixel "
+			"size in srid %d is invalid", nTargetSrid);
+		return false;
+	}
+
+	/* North up grid, from the upper left corner of the extent */
+	nRasterXSize = (int) ceil((xmax - xmin) / dfScaleX - 1e-6);
+	nRasterYSize = (int) ceil((ymax - ymin) / dfScaleY - 1e-6);
+	if (nRasterXSize <= 0 || nRasterYSize <= 0) {
+		CPLError(CE_Failure, CPLE_AppDefined, "Computed PostGIS Raster "
+			"dimension in srid %d is invalid", nTargetSrid);
+		return false;
+	}
+
+	xmax = xmin + nRasterXSize * dfScaleX;
+	ymin = ymax - nRasterYSize * dfScaleY;
+
+	adfGeoTransform[GEOTRSFRM_TOPLEFT_X] = xmin;
+	adfGeoTransform[GEOTRSFRM_WE_RES] = dfScaleX;
+	adfGeoTransform[GEOTRSFRM_ROTATION_PARAM1] = 0.0;
+	adfGeoTransform[GEOTRSFRM_TOPLEFT_Y] = ymax;
+	adfGeoTransform[GEOTRSFRM_ROTATION_PARAM2] = 0.0;
+	adfGeoTransform[GEOTRSFRM_NS_RES] = -dfScaleY;
+
+	nSrid = nTargetSrid;
+	bRegularBlocking = false;
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetTransformedRasterProperties(): "
+		"Raster size = (%d, %d), pixel size = (%f, %f) in srid %d", nRasterXSize,
+		nRasterYSize, dfScaleX, dfScaleY, nTargetSrid);
+
+	return SetRasterBands(0, 0);
+}
+
+/**************************************************************************
+ * \brief Get the SQL expression of the raster read from each row: the
+ * raster column, or its tile warped to the grid of the dataset if the
+ * tiles are reprojected (target_srid).
+ **************************************************************************/
+CPLString PostGISRasterDataset::GetRasterExpression()
+{
+	if (nTargetSrid <= 0)
+		return pszColumn;
+
+	return CPLString().Printf("st_transform(%s, st_makeemptyraster(1, 1, "
+		"%.17g, %.17g, %.17g, %.17g, 0, 0, %d))", pszColumn,
+		adfGeoTransform[GEOTRSFRM_TOPLEFT_X], adfGeoTransform[GEOTRSFRM_TOPLEFT_Y],
+		adfGeoTransform[GEOTRSFRM_WE_RES], adfGeoTransform[GEOTRSFRM_NS_RES],
+		nTargetSrid);
+}
+
+/**************************************************************************
+ * \brief Get the rows whose tiles intersect a window (a geometry in the
+ * srid of the dataset), when the tiles are reprojected (target_srid), as a
+ * subquery. There's a branch per srid of the tiles, selecting them with
+ * the window transformed to that srid, so the spatial index of the raster
+ * column is used. The window is segmentized first: a straight edge in the
+ * srid of the dataset is curved in the srid of the tiles, and transforming
+ * its corners only would miss the tiles along it. pszFilter is empty or
+ * ends with "AND ".
+ **************************************************************************/
+CPLString PostGISRasterDataset::GetIntersectingRows(const char * pszFilter,
+	const char * pszWindow)
+{
+	CPLString osRows;
+	CPLString osSegmentized;
+	int i;
+
+	osSegmentized.Printf("st_segmentize(%s, %.17g)", pszWindow,
+		WINDOW_SEGMENT_PIXELS * MIN(fabs(adfGeoTransform[GEOTRSFRM_WE_RES]),
+		fabs(adfGeoTransform[GEOTRSFRM_NS_RES])));
+	pszWindow = osSegmentized.c_str();
+
+	/* No srids known: transform the window row by row */
+	if (nTileSrids == 0)
+		return CPLString().Printf("(SELECT * FROM %s.%s WHERE %sst_intersects("
+			"%s, st_transform(%s, st_srid(%s)))) t", pszSchema, pszTable, 
+			pszFilter, pszColumn, pszWindow, pszColumn);
+
+	for(i = 0; i < nTileSrids; i++) {
+		if (i > 0)
+			osRows += " UNION ALL ";
+		osRows += CPLString().Printf("SELECT * FROM %s.%s WHERE %sst_srid(%s) "
+			"= %d AND st_intersects(%s, st_transform(%s, %d))", pszSchema, 
+			pszTable, pszFilter, pszColumn, panTileSrids[i], pszColumn, 
+			pszWindow, panTileSrids[i]);
+	}
+
+	return CPLString().Printf("(%s) t", osRows.c_str());
+}
+
+/**************************************************************************
+ * \brief Create the raster bands of a single raster coverage.
+ *
+ * The band metadata (pixel type and nodata value) is read from one of
+ * the tiles. The georeference of the dataset must be already set.
+ **************************************************************************/
+GBool PostGISRasterDataset::SetRasterBands(int nBlockXSize, int nBlockYSize)
+{
+    PGresult* poResult = NULL;
+    CPLString osCommand;
+    int nTuples = 0;
+    GBool bSignedByte = false;
+    int nBitDepth = 8;
+    char* pszDataType = NULL;
+    int iBand = 0;
+    double dfNodata = 0.0;
+    GDALDataType hDataType = GDT_Byte;
+    GBool bIsOffline = false;
+    GBool bHasNoDataValue = false;
+
+	/* Create query to fetch metadata from db */
+	if (pszWhere == NULL) {
+    	osCommand.Printf("select st_bandpixeltype(rast, band), "
+        	"st_bandnodatavalue(rast, band) is null, "
+        	"st_bandnodatavalue(rast, band) from (select %s, "
+        	"generate_series(1, st_numbands(%s)) band from (select "
+        	"rast from %s.%s limit 1) bar) foo",
+        	pszColumn, pszColumn, pszSchema, pszTable);
+	} 
+
+	else {
+    	osCommand.Printf("select st_bandpixeltype(rast, band), "
+       		"st_bandnodatavalue(rast, band) is null, "
+        	"st_bandnodatavalue(rast, band) from (select %s, "
+        	"generate_series(1, st_numbands(%s)) band from (select "
+        	"rast from %s.%s where %s limit 1) bar) foo",
+        	pszColumn, pszColumn, pszSchema, pszTable, pszWhere);
+	}
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterBands(): "
+		"Query: %s", osCommand.c_str());
+	
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	nTuples = PQntuples(poResult);
+
+	/* Error getting info from database */
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+        nTuples <= 0) {
+    	
+		CPLError(CE_Failure, CPLE_AppDefined, "Error getting band metadata "
+			"while creating raster bands");
+            
+		CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetRasterBands(): %s", 
+                PostGISRasterErrorMessage(poConn));
+    	
+		if (poResult)
+        	PQclear(poResult);
+
+    	return false;
+	}
+
+	/* Create each PostGISRasterRasterBand using the band metadata */
+	for (iBand = 0; iBand < nTuples; iBand++) {
+    	/**
+     	 * If we have more than one record here is because there are several
+     	 * rows, belonging to the same raster coverage, with different band
+     	 * metadata values. An error must be raised.
+     	 *
+     	 * TODO: Is there any way to fix this problem?
+     	 *
+     	 * TODO: Even when the difference between metadata values are only a
+     	 * few decimal numbers (for example: 3.0000000 and 3.0000001) they're
+     	 * different tuples. And in that case, they must be the same
+     	 **/
+    	/*
+    	if (nTuples > 1) {
+        	CPLError(CE_Failure, CPLE_AppDefined, "Error, the \
+                ONE_RASTER_PER_TABLE mode can't be applied if the raster \
+                rows don't have the same metadata for band %d",
+                iBand + 1);
+        	PQclear(poResult);
+        	return false;
+    	}
+     	*/
+
+
+    	/* Get metadata and create raster band objects */
+    	pszDataType = CPLStrdup(PQgetvalue(poResult, iBand, 0));
+    	bHasNoDataValue = EQUALN(PQgetvalue(poResult, iBand, 1), "f", sizeof(char));
+    	dfNodata = atof(PQgetvalue(poResult, iBand, 2));
+    	/** 
+     	 * Offline rasters are not yet supported. When offline rasters are
+     	 * supported, they will also requires a fast 'getter', other than 
+     	 * the ST_BandMetaData accessor.
+     	 **/
+    	
+		/* bIsOffline = EQUALN(PQgetvalue(poResult, iBand, 3), "t", sizeof (char));        */
+
+    	if (EQUALN(pszDataType, "1BB", 3 * sizeof (char))) {
+        	hDataType = GDT_Byte;
+        	nBitDepth = 1;
+    	} else if (EQUALN(pszDataType, "2BUI", 4 * sizeof (char))) {
+        	hDataType = GDT_Byte;
+        	nBitDepth = 2;
+    	} else if (EQUALN(pszDataType, "4BUI", 4 * sizeof (char))) {
+        	hDataType = GDT_Byte;
+        	nBitDepth = 4;
+    	} else if (EQUALN(pszDataType, "8BUI", 4 * sizeof (char))) {
+        	hDataType = GDT_Byte;
+        	nBitDepth = 8;
+    	} else if (EQUALN(pszDataType, "8BSI", 4 * sizeof (char))) {
+        	hDataType = GDT_Byte;
+        	/**
+         	 * To indicate the unsigned byte values between 128 and 255
+         	 * should be interpreted as being values between -128 and -1 for
+         	 * applications that recognise the SIGNEDBYTE type.
+         	 **/
+        	bSignedByte = true;
+        	nBitDepth = 8;
+    	} else if (EQUALN(pszDataType, "16BSI", 5 * sizeof (char))) {
+        	hDataType = GDT_Int16;
+        	nBitDepth = 16;
+    	} else if (EQUALN(pszDataType, "16BUI", 5 * sizeof (char))) {
+       		hDataType = GDT_UInt16;
+        	nBitDepth = 16;
+    	} else if (EQUALN(pszDataType, "32BSI", 5 * sizeof (char))) {
+        	hDataType = GDT_Int32;
+        	nBitDepth = 32;
+    	} else if (EQUALN(pszDataType, "32BUI", 5 * sizeof (char))) {
+        	hDataType = GDT_UInt32;
+        	nBitDepth = 32;
+    	} else if (EQUALN(pszDataType, "32BF", 4 * sizeof (char))) {
+        	hDataType = GDT_Float32;
+        	nBitDepth = 32;
+    	} else if (EQUALN(pszDataType, "64BF", 4 * sizeof (char))) {
+        	hDataType = GDT_Float64;
+        	nBitDepth = 64;
+    	} else {
+        	hDataType = GDT_Byte;
+        	nBitDepth = 8;
+    	}
+
+    	/* Create raster band object */
+    	SetBand(iBand + 1, new PostGISRasterRasterBand(this, iBand + 1, hDataType,
+            bHasNoDataValue, dfNodata, bSignedByte, nBitDepth, 0, nBlockXSize, 
+			nBlockYSize, bIsOffline));
+
+    	CPLFree(pszDataType);
+	}
+
+   		PQclear(poResult);
+
+    return true;
+}
+
+/**************************************************************************
+ * \brief Get the overview factors of the raster column from
+ * raster_overviews.
+ *
+ * They're the same for all the bands, so they're fetched once, by the
+ * first band created. No overviews if they can't be fetched.
+ **************************************************************************/
+GBool PostGISRasterDataset::SetOverviewCount()
+{
+    CPLString osCommand;
+    PGresult * poResult = NULL;
+    int i;
+
+    nOverviewCount = 0;
+
+    osCommand.Printf("select overview_factor from raster_overviews where "
+        "r_table_schema = '%s' and r_table_name = '%s' and r_raster_column = "
+        "'%s'", pszSchema, pszTable, pszColumn);
+
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
+    if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+        PQntuples(poResult) <= 0) {
+        if (poResult != NULL)
+            PQclear(poResult);
+
+        return false;
+    }
+
+    nOverviewCount = PQntuples(poResult);
+    panOverviewFactors = (int *) CPLMalloc(sizeof (int) * nOverviewCount);
+    for (i = 0; i < nOverviewCount; i++)
+        panOverviewFactors[i] = atoi(PQgetvalue(poResult, i, 0));
+
+    PQclear(poResult);
+
+    return true;
+}
+
+/**************************************************************************
+ * \brief Describe the opened coverage: georeference, bands and overviews.
+ *
+ * The returned descriptor must be deleted (or given to the driver).
+ **************************************************************************/
+PostGISRasterDescriptor* PostGISRasterDataset::GetDescriptor()
+{
+    PostGISRasterDescriptor * poDescriptor = new PostGISRasterDescriptor();
+    PostGISRasterRasterBand * poBand;
+    const char * pszNBits;
+    const char * pszPixelType;
+    int i;
+
+    poDescriptor->pszSchema = CPLStrdup(pszSchema);
+    poDescriptor->pszTable = CPLStrdup(pszTable);
+    memcpy(poDescriptor->adfGeoTransform, adfGeoTransform, sizeof (double) * 6);
+    poDescriptor->xmin = xmin;
+    poDescriptor->ymin = ymin;
+    poDescriptor->xmax = xmax;
+    poDescriptor->ymax = ymax;
+    poDescriptor->nRasterXSize = nRasterXSize;
+    poDescriptor->nRasterYSize = nRasterYSize;
+    poDescriptor->nSrid = nSrid;
+    poDescriptor->nTiles = nTiles;
+    poDescriptor->bRegularBlocking = bRegularBlocking;
+    poDescriptor->bRegisteredInRasterColumns = bRegisteredInRasterColumns;
+    poDescriptor->bApproxOpen = bApproxOpen;
+
+    poDescriptor->nBands = nBands;
+    if (nBands > 0) {
+        poDescriptor->pasBands = (PostGISRasterBandSpec *) CPLMalloc(
+            sizeof (PostGISRasterBandSpec) * nBands);
+        GetRasterBand(1)->GetBlockSize(&poDescriptor->nBlockXSize,
+            &poDescriptor->nBlockYSize);
+    }
+
+    for (i = 0; i < nBands; i++) {
+        poBand = (PostGISRasterRasterBand *) GetRasterBand(i + 1);
+        pszNBits = poBand->GetMetadataItem("NBITS", "IMAGE_STRUCTURE");
+        pszPixelType = poBand->GetMetadataItem("PIXELTYPE", "IMAGE_STRUCTURE");
+
+        poDescriptor->pasBands[i].eDataType = poBand->eDataType;
+        poDescriptor->pasBands[i].bHasNoDataValue = poBand->bHasNoDataValue;
+        poDescriptor->pasBands[i].dfNoDataValue = poBand->dfNoDataValue;
+        poDescriptor->pasBands[i].bSignedByte = (pszPixelType != NULL && 
+            EQUAL(pszPixelType, "SIGNEDBYTE"));
+        poDescriptor->pasBands[i].nBitDepth = (pszNBits != NULL) ? 
+            atoi(pszNBits) : GDALGetDataTypeSize(poBand->eDataType);
+    }
+
+    poDescriptor->nOverviewCount = MAX(nOverviewCount, 0);
+    if (nOverviewCount > 0) {
+        poDescriptor->panOverviewFactors = (int *) CPLMalloc(
+            sizeof (int) * nOverviewCount);
+        memcpy(poDescriptor->panOverviewFactors, panOverviewFactors,
+            sizeof (int) * nOverviewCount);
+    }
+
+    poDescriptor->nTileSrids = nTileSrids;
+    if (nTileSrids > 0) {
+        poDescriptor->panTileSrids = (int *) CPLMalloc(sizeof (int) * nTileSrids);
+        memcpy(poDescriptor->panTileSrids, panTileSrids, sizeof (int) * nTileSrids);
+    }
+
+    return poDescriptor;
+}
+
+/**************************************************************************
+ * \brief Set the georeference, the bands and the overviews of the
+ * coverage from a descriptor, with no queries.
+ **************************************************************************/
+GBool PostGISRasterDataset::SetFromDescriptor(
+    PostGISRasterDescriptor * poDescriptor)
+{
+    PostGISRasterBandSpec * psBand;
+    int i;
+
+    memcpy(adfGeoTransform, poDescriptor->adfGeoTransform, sizeof (double) * 6);
+    xmin = poDescriptor->xmin;
+    ymin = poDescriptor->ymin;
+    xmax = poDescriptor->xmax;
+    ymax = poDescriptor->ymax;
+    nRasterXSize = poDescriptor->nRasterXSize;
+    nRasterYSize = poDescriptor->nRasterYSize;
+    nSrid = poDescriptor->nSrid;
+    nTiles = poDescriptor->nTiles;
+    bRegularBlocking = poDescriptor->bRegularBlocking;
+    bRegisteredInRasterColumns = poDescriptor->bRegisteredInRasterColumns;
+    bApproxOpen = poDescriptor->bApproxOpen;
+
+    /* Before creating the bands, so they don't query them */
+    nOverviewCount = poDescriptor->nOverviewCount;
+    if (nOverviewCount > 0) {
+        panOverviewFactors = (int *) CPLMalloc(sizeof (int) * nOverviewCount);
+        memcpy(panOverviewFactors, poDescriptor->panOverviewFactors,
+            sizeof (int) * nOverviewCount);
+    }
+
+    nTileSrids = poDescriptor->nTileSrids;
+    if (nTileSrids > 0) {
+        panTileSrids = (int *) CPLMalloc(sizeof (int) * nTileSrids);
+        memcpy(panTileSrids, poDescriptor->panTileSrids, sizeof (int) * nTileSrids);
+    }
+
+    for (i = 0; i < poDescriptor->nBands; i++) {
+        psBand = poDescriptor->pasBands + i;
+
+        SetBand(i + 1, new PostGISRasterRasterBand(this, i + 1, 
+            psBand->eDataType, psBand->bHasNoDataValue, psBand->dfNoDataValue,
+            psBand->bSignedByte, psBand->nBitDepth, 0, 
+            poDescriptor->nBlockXSize, poDescriptor->nBlockYSize));
+    }
+
+    CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SetFromDescriptor(): "
+        "%s.%s (%s) opened from its descriptor", pszSchema, pszTable, pszColumn);
+
+    return nBands > 0;
+}
+
+/******************************************************************************
+ * \brief Get the key of the descriptor of a coverage: the connection string,
+ * with its parameters sorted, the raster and the open options.
+ ******************************************************************************/
+static int CompareStrings(const void * pA, const void * pB)
+{
+    return strcmp(*(const char * const *) pA, *(const char * const *) pB);
+}
+
+static CPLString
+GetDescriptorKey(const char * pszConnectionString, const char * pszSchema,
+    const char * pszTable, const char * pszColumn, const char * pszWhere,
+    int nMode, GBool bApproxOpen, int nTargetSrid)
+{
+    char ** papszParams = CSLTokenizeString2(pszConnectionString, " ",
+        CSLT_HONOURSTRINGS);
+    CPLString osKey;
+    int i;
+
+    if (papszParams != NULL)
+        qsort(papszParams, CSLCount(papszParams), sizeof (char *),
+            CompareStrings);
+
+    for (i = 0; papszParams != NULL && papszParams[i] != NULL; i++)
+        osKey += CPLString().Printf("%s ", papszParams[i]);
+
+    CSLDestroy(papszParams);
+
+    osKey += CPLString().Printf("schema=%s table=%s column=%s where=%s "
+        "mode=%d open_mode=%s target_srid=%d", pszSchema, pszTable, 
+        pszColumn, (pszWhere != NULL) ? pszWhere : "", nMode, 
+        (bApproxOpen) ? "approx" : "exact", nTargetSrid);
+
+    return osKey;
+}
+
+/******************************************************************************
+ * \brief Get the connection information for a filename.
+ ******************************************************************************/
+static GBool
+GetConnectionInfo(const char * pszFilename, 
+    char ** ppszConnectionString, char ** ppszSchema, char ** ppszTable, 
+    char ** ppszColumn, char ** ppszWhere, char ** ppszHost, 
+    char ** ppszPort, char ** ppszUser, char ** ppszPassword, 
+    int * nMode, GBool * bBrowseDatabase)
+{
+    int nPos = -1, i;
+    char * pszTmp = NULL;
+    char **papszParams = ParseConnectionString(pszFilename);
+    if (papszParams == NULL) {
+        return false;
+    }
+
+    /**************************************************************************
+     * Get mode:
+     *  - 1. ONE_RASTER_PER_ROW: Each row is considered as a separate raster
+     *  - 2. ONE_RASTER_PER_TABLE: All the table rows are considered as a whole
+     *      raster coverage
+     **************************************************************************/
+    nPos = CSLFindName(papszParams, "mode");
+    if (nPos != -1) {
+        *nMode = atoi(CPLParseNameValue(papszParams[nPos], NULL));
+
+        if (*nMode != ONE_RASTER_PER_ROW && *nMode != ONE_RASTER_PER_TABLE) {
+            /* Unrecognized mode, using default one */
+            /*
+            CPLError(CE_Warning, CPLE_AppDefined, "Undefined working mode (%d)."
+                    " Valid working modes are 1 (ONE_RASTER_PER_ROW) and 2"
+                    " (ONE_RASTER_PER_TABLE). Using ONE_RASTER_PER_TABLE"
+                    " by default", nMode);
+             */
+            *nMode = ONE_RASTER_PER_ROW;
+        }
+
+        /* Remove the mode from connection string */
+        papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+    }
+        /* Default mode */
+    else
+        *nMode = ONE_RASTER_PER_ROW;
+
+    /* The driver options are read when opening, and never passed to libpq */
+    for (i = 0; apszDriverOptions[i] != NULL; i++) {
+        nPos = CSLFindName(papszParams, apszDriverOptions[i]);
+        if (nPos != -1)
+            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+    }
+
+    /**
+     * Case 1: There's no database name: Error, you need, at least,
+     * specify a database name (NOTE: insensitive search)
+     **/
+    nPos = CSLFindName(papszParams, "dbname");
+    if (nPos == -1) {
+        CPLError(CE_Failure, CPLE_AppDefined,
+                "You must specify at least a db name");
+
+        CSLDestroy(papszParams);
+
+        return false;
+    }
+
+    /**
+     * Case 2: There's database name, but no table name: activate a flag
+     * for browsing the database, fetching all the schemas that contain
+     * raster tables
+     **/
+    nPos = CSLFindName(papszParams, "table");
+    if (nPos == -1) {
+        *bBrowseDatabase = true;
+
+        /* Get schema name, if exist */
+        nPos = CSLFindName(papszParams, "schema");
+        if (nPos != -1) {
+            *ppszSchema = CPLStrdup(CPLParseNameValue(papszParams[nPos], NULL));
+            /* Delete this pair from params array */
+            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+        }
+
+        /**
+         * Remove the rest of the parameters, if exist (they mustn't be present
+         * if we want a valid PQ connection string)
+         **/
+        nPos = CSLFindName(papszParams, "column");
+        if (nPos != -1) {
+            /* Delete this pair from params array */
+            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+        }
+
+        nPos = CSLFindName(papszParams, "where");
+        if (nPos != -1) {
+            /* Delete this pair from params array */
+            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+        }
+    } else {
+        *ppszTable = CPLStrdup(CPLParseNameValue(papszParams[nPos], NULL));
+        /* Delete this pair from params array */
+        papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+
+        /**
+         * Case 3: There's database and table name, but no column
+         * name: Use a default column name and use the table to create the
+         * dataset
+         **/
+        nPos = CSLFindName(papszParams, "column");
+        if (nPos == -1) {
+            *ppszColumn = CPLStrdup(DEFAULT_COLUMN);
+        }
+        /**
+         * Case 4: There's database, table and column name: Use the table to
+         * create a dataset
+         **/
+        else {
+            *ppszColumn = CPLStrdup(CPLParseNameValue(papszParams[nPos], NULL));
+            /* Delete this pair from params array */
+            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
+        }
+
+        /* Get the rest of the parameters, if exist */
+        nPos = CSLFindName(papszParams, "schema");
+        if (nPos == -1) {
+            *ppszSchema = CPLStrdup(DEFAULT_SCHEMA);
+        } else {
+            *ppszSchema = CPLStrdup(CPLParseNameValue(papszParams[nPos], NULL));
+            /* Delete this pair from params array */
+            papszParams = CSLRemoveStrings(papszParams, nPos, 1, NULL);
         }
 
         nPos = CSLFindName(papszParams, "where");
@@ -1245,6 +2377,20 @@ GetConnection(const char * pszFilename, char ** ppszConnectionString,
  *	column = <column_name>
  *	where = <SQL where>
  *  mode = <working mode> (1 or 2)
+ *  value_filter = <band predicates>, as 'band1>30 and band2<=5'. Only the
+ *      tiles whose value range can match them are read
+ *  tile_stats = refresh (update mode): compute the missing tile stats
+ *  schema_like, table_like, limit, offset = filter and page of the raster
+ *      tables listed, if no table is given
+ *  open_mode = exact (default) or approx: the extent is estimated from the
+ *      planner statistics, and the scale and block size from a sample of
+ *      tiles, instead of scanning the table. For coverages (mode=2) with no
+ *      where clause
+ *  target_srid = <srid>: the tiles, in any srid, are reprojected by the
+ *      server to a common grid in this srid. For coverages (mode=2), read-only
+ *  quicklook = png or jpeg: the downsampled reads of 8 bits bands are
+ *      resampled by the server, and transferred as PNG (lossless) or JPEG
+ *      (lossy) images
  *
  * These pairs are used for selecting the right raster table.
  *****************************************************************************/
@@ -1260,6 +2406,11 @@ GDALDataset* PostGISRasterDataset::Open(GDALOpenInfo* poOpenInfo) {
     GBool bBrowseDatabase = false;
     CPLString osCommand;
 	char * pszTmp;
+    char * pszOption = NULL;
+    PostGISRasterDriver * poDriver = 
+        (PostGISRasterDriver *)GDALGetDriverByName("PostGISRaster");
+    PostGISRasterDescriptor * poDescriptor = NULL;
+    CPLString osKey;
 
     /**************************
      * Check input parameter
@@ -1277,6 +2428,9 @@ GDALDataset* PostGISRasterDataset::Open(GDALOpenInfo* poOpenInfo) {
         return NULL;
     }
 
+    /* The tile cache settings changed since the last open apply now */
+    PostGISRasterTileCache::GetInstance()->Reconfigure();
+
 	pszTmp = CPLStrdup(poOpenInfo->pszFilename);
     
 	poConn = GetConnection((char *)poOpenInfo->pszFilename,
@@ -1318,7 +2472,8 @@ GDALDataset* PostGISRasterDataset::Open(GDALOpenInfo* poOpenInfo) {
          * Look for raster tables at database and
          * store them as subdatasets
          **/
-        if (!poDS->BrowseDatabase(pszSchema, pszConnectionString)) {
+        if (!poDS->BrowseDatabase(pszSchema, pszConnectionString,
+                poOpenInfo->pszFilename)) {
             CPLFree(pszConnectionString);
             delete poDS;
 
@@ -1367,11 +2522,90 @@ GDALDataset* PostGISRasterDataset::Open(GDALOpenInfo* poOpenInfo) {
 		CPLDebug("PostGIS_Raster", "Open:: connection string = %s",
 			pszConnectionString);
 		
-        if (!poDS->SetRasterProperties(pszConnectionString)) {
+        pszOption = FetchDriverOption(poOpenInfo->pszFilename, "open_mode");
+        if (pszOption != NULL && EQUAL(pszOption, "approx"))
+            poDS->bApproxOpen = true;
+        else if (pszOption != NULL && !EQUAL(pszOption, "exact"))
+            CPLError(CE_Warning, CPLE_AppDefined, "Unknown open_mode '%s'. "
+                "Using exact", pszOption);
+        CPLFree(pszOption);
+
+        /* The reprojected tiles can't be written back */
+        pszOption = FetchDriverOption(poOpenInfo->pszFilename, "target_srid");
+        if (pszOption != NULL && atoi(pszOption) > 0) {
+            poDS->nTargetSrid = atoi(pszOption);
+            if (poDS->eAccess == GA_Update) {
+                CPLError(CE_Warning, CPLE_NotSupported, "A raster reprojected "
+                    "to target_srid can't be updated. Opened read-only");
+                poDS->eAccess = GA_ReadOnly;
+            }
+        }
+        else if (pszOption != NULL)
+            CPLError(CE_Warning, CPLE_AppDefined, "Invalid target_srid '%s'. "
+                "Ignored", pszOption);
+        CPLFree(pszOption);
+
+        pszOption = FetchDriverOption(poOpenInfo->pszFilename, "quicklook");
+        if (pszOption != NULL && EQUAL(pszOption, "png"))
+            poDS->pszQuickLook = CPLStrdup("ST_AsPNG");
+        else if (pszOption != NULL && (EQUAL(pszOption, "jpeg") || 
+            EQUAL(pszOption, "jpg")))
+            poDS->pszQuickLook = CPLStrdup("ST_AsJPEG");
+        else if (pszOption != NULL)
+            CPLError(CE_Warning, CPLE_AppDefined, "Unknown quicklook format "
+                "'%s'. Expected png or jpeg. Ignored", pszOption);
+        CPLFree(pszOption);
+
+
+        /**
+         * A coverage opened recently is set up from its descriptor, with
+         * no queries. Otherwise, its properties are fetched from db, and
+         * its descriptor stored
+         **/
+        osKey = GetDescriptorKey(pszConnectionString, pszSchema, pszTable,
+            pszColumn, pszWhere, nMode, poDS->bApproxOpen, poDS->nTargetSrid);
+
+        poDescriptor = poDriver->GetDescriptor(osKey.c_str());
+        if (poDescriptor != NULL && poDS->SetFromDescriptor(poDescriptor)) {
+            delete poDescriptor;
+        }
+        else {
+            delete poDescriptor;
+
+            if (!poDS->SetRasterProperties(pszConnectionString)) {
+                CPLFree(pszConnectionString);
+                delete poDS;
+                return NULL;
+            }
+
+            /* Subdatasets, one per row, are not stored */
+            if (poDS->GetRasterCount() > 0)
+                poDriver->SetDescriptor(osKey.c_str(), poDS->GetDescriptor());
+        }
+
+        /**
+         * Maintenance: compute the stats of the tiles added since the last
+         * time, before they're used to prune tiles
+         **/
+        pszOption = FetchDriverOption(poOpenInfo->pszFilename, "tile_stats");
+        if (pszOption != NULL && EQUAL(pszOption, "refresh")) {
+            if (poOpenInfo->eAccess != GA_Update || nMode != ONE_RASTER_PER_TABLE)
+                CPLError(CE_Warning, CPLE_AppDefined, "tile_stats=refresh "
+                    "needs a coverage (mode=2) opened in update mode. Ignored");
+            else
+                UpdateTileStats(poConn, pszSchema, pszTable, pszColumn, true);
+        }
+        CPLFree(pszOption);
+
+        pszOption = FetchDriverOption(poOpenInfo->pszFilename, "value_filter");
+        if (pszOption != NULL && !poDS->SetValueFilter(pszOption)) {
+            CPLFree(pszOption);
             CPLFree(pszConnectionString);
+            CPLFree(pszTmp);
             delete poDS;
             return NULL;
         }
+        CPLFree(pszOption);
 
 		poDS->pszOriginalConnectionString = pszTmp;
 		
@@ -1391,8 +2625,39 @@ GDALDataset* PostGISRasterDataset::Open(GDALOpenInfo* poOpenInfo) {
  * calling ST_Metadata, for example)
  *****************************************/
 char** PostGISRasterDataset::GetMetadata(const char *pszDomain) {
+    PostGISRasterDBAccess * poAccess = PostGISRasterDBAccess::GetInstance();
+
     if (pszDomain != NULL && EQUALN(pszDomain, "SUBDATASETS", 11))
         return papszSubdatasets;
+
+    /**
+     * Performance counters: queries and bytes received by the driver (all
+     * the datasets), memory taken by this dataset's read requests, and
+     * driver tile cache hits and misses
+     **/
+    else if (pszDomain != NULL && EQUAL(pszDomain, "INSTRUMENTATION")) {
+        CSLDestroy(papszInstrumentation);
+        papszInstrumentation = NULL;
+
+        papszInstrumentation = CSLSetNameValue(papszInstrumentation,
+            "QUERY_COUNT", CPLSPrintf("%d", poAccess->GetQueryCount()));
+        papszInstrumentation = CSLSetNameValue(papszInstrumentation,
+            "BYTES_RECEIVED", CPLSPrintf(CPL_FRMT_GIB,
+            poAccess->GetBytesReceived()));
+        papszInstrumentation = CSLSetNameValue(papszInstrumentation,
+            "BYTES_IN_FLIGHT", CPLSPrintf(CPL_FRMT_GIB, nBytesInFlight));
+        papszInstrumentation = CSLSetNameValue(papszInstrumentation,
+            "PEAK_BYTES_IN_FLIGHT", CPLSPrintf(CPL_FRMT_GIB,
+            nPeakBytesInFlight));
+        papszInstrumentation = CSLSetNameValue(papszInstrumentation,
+            "TILE_CACHE_HITS", CPLSPrintf(CPL_FRMT_GIB,
+            PostGISRasterTileCache::GetInstance()->GetHits()));
+        papszInstrumentation = CSLSetNameValue(papszInstrumentation,
+            "TILE_CACHE_MISSES", CPLSPrintf(CPL_FRMT_GIB,
+            PostGISRasterTileCache::GetInstance()->GetMisses()));
+
+        return papszInstrumentation;
+    }
     else
         return GDALDataset::GetMetadata(pszDomain);
 }
@@ -1418,7 +2683,7 @@ const char* PostGISRasterDataset::GetProjectionRef() {
      ********************************************************/
     osCommand.Printf("SELECT srtext FROM spatial_ref_sys where SRID=%d",
             nSrid);
-    poResult = PQexec(this->poConn, osCommand.c_str());
+    poResult = PostGISRasterExec(this->poConn, osCommand.c_str());
     if (poResult && PQresultStatus(poResult) == PGRES_TUPLES_OK
             && PQntuples(poResult) > 0) {
         /*
@@ -1462,7 +2727,7 @@ CPLErr PostGISRasterDataset::SetProjection(const char * pszProjectionRef) {
     // First, WKT text
     osCommand.Printf("SELECT srid FROM spatial_ref_sys where srtext='%s'",
             pszProjectionRef);
-    poResult = PQexec(poConn, osCommand.c_str());
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
 
     if (poResult && PQresultStatus(poResult) == PGRES_TUPLES_OK
             && PQntuples(poResult) > 0) {
@@ -1477,16 +2742,21 @@ CPLErr PostGISRasterDataset::SetProjection(const char * pszProjectionRef) {
         osCommand.Printf("UPDATE raster_columns SET srid=%d WHERE \
                     r_table_name = '%s' AND r_column = '%s'",
                 nSrid, pszTable, pszColumn);
-        poResult = PQexec(poConn, osCommand.c_str());
+        poResult = PostGISRasterExec(poConn, osCommand.c_str());
         if (poResult == NULL || PQresultStatus(poResult) != PGRES_COMMAND_OK) {
             CPLError(CE_Failure, CPLE_AppDefined,
                     "Couldn't update raster_columns table: %s",
-                    PQerrorMessage(poConn));
+                    PostGISRasterErrorMessage(poConn));
             return CE_Failure;
         }
 
         // TODO: Update ALL blocks with the new srid...
 
+        ((PostGISRasterDriver *)GDALGetDriverByName("PostGISRaster"))->
+            InvalidateDescriptors(pszSchema, pszTable);
+        PostGISRasterTileCache::GetInstance()->InvalidateTable(pszSchema,
+            pszTable);
+
         return CE_None;
     }
         // If not, proj4 text
@@ -1494,7 +2764,7 @@ CPLErr PostGISRasterDataset::SetProjection(const char * pszProjectionRef) {
         osCommand.Printf(
                 "SELECT srid FROM spatial_ref_sys where proj4text='%s'",
                 pszProjectionRef);
-        poResult = PQexec(poConn, osCommand.c_str());
+        poResult = PostGISRasterExec(poConn, osCommand.c_str());
 
         if (poResult && PQresultStatus(poResult) == PGRES_TUPLES_OK
                 && PQntuples(poResult) > 0) {
@@ -1509,17 +2779,22 @@ CPLErr PostGISRasterDataset::SetProjection(const char * pszProjectionRef) {
                     r_table_name = '%s' AND r_column = '%s'",
                     nSrid, pszTable, pszColumn);
 
-            poResult = PQexec(poConn, osCommand.c_str());
+            poResult = PostGISRasterExec(poConn, osCommand.c_str());
             if (poResult == NULL ||
                     PQresultStatus(poResult) != PGRES_COMMAND_OK) {
                 CPLError(CE_Failure, CPLE_AppDefined,
                         "Couldn't update raster_columns table: %s",
-                        PQerrorMessage(poConn));
+                        PostGISRasterErrorMessage(poConn));
                 return CE_Failure;
             }
 
             // TODO: Update ALL blocks with the new srid...
 
+            ((PostGISRasterDriver *)GDALGetDriverByName("PostGISRaster"))->
+                InvalidateDescriptors(pszSchema, pszTable);
+            PostGISRasterTileCache::GetInstance()->InvalidateTable(pszSchema,
+                pszTable);
+
             return CE_None;
         }
         else {
@@ -1584,6 +2859,14 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
     GBool bInsertSuccess;
     PostGISRasterDataset *poSrcDS = (PostGISRasterDataset *)poGSrcDS;
     PostGISRasterDataset *poSubDS;
+    const char * pszSpatialOrder;
+    const char * pszTileSize;
+    int nTileXSize = 0, nTileYSize = 0;
+    GBool bCluster;
+    GBool bAddConstraints;
+    GBool bTileStats;
+    GBool bIncremental;
+    int nBatchSize;
 
     // Check connection string
     if (pszFilename == NULL ||
@@ -1598,6 +2881,80 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
         return NULL;
     }
 
+    /**
+     * SPATIAL_ORDER: order the tiles are inserted in, so they're laid out
+     * in the table like they're read. CLUSTER: rewrite the table in the
+     * order of its spatial index after loading it
+     **/
+    pszSpatialOrder = CSLFetchNameValue(papszOptions, "SPATIAL_ORDER");
+    if (pszSpatialOrder == NULL)
+        pszSpatialOrder = DEFAULT_SPATIAL_ORDER;
+
+    if (!EQUAL(pszSpatialOrder, "NONE") && !EQUAL(pszSpatialOrder, "ROW_MAJOR") &&
+        !EQUAL(pszSpatialOrder, "HILBERT")) {
+        CPLError(CE_Failure, CPLE_IllegalArg, "Invalid SPATIAL_ORDER value: %s. "
+            "Expected NONE, ROW_MAJOR or HILBERT", pszSpatialOrder);
+        return NULL;
+    }
+
+    /**
+     * TILE_SIZE=WxH: retile the source rasters on the server
+     **/
+    pszTileSize = CSLFetchNameValue(papszOptions, "TILE_SIZE");
+    if (pszTileSize != NULL && (sscanf(pszTileSize, "%dx%d", &nTileXSize, 
+        &nTileYSize) != 2 || nTileXSize <= 0 || nTileYSize <= 0)) {
+        CPLError(CE_Failure, CPLE_IllegalArg, "Invalid TILE_SIZE value: %s. "
+            "Expected WIDTHxHEIGHT", pszTileSize);
+        return NULL;
+    }
+
+    /**
+     * Each source tile is cut on its own, and its last row and column of
+     * tiles padded. That only gives a regularly blocked coverage if the
+     * source is one tile, or regularly blocked in multiples of TILE_SIZE
+     **/
+    if (nTileXSize > 0 && poSrcDS->nMode == ONE_RASTER_PER_TABLE && 
+        poSrcDS->nTiles != 1) {
+        int nSrcBlockXSize = 0, nSrcBlockYSize = 0;
+
+        if (poSrcDS->GetRasterCount() > 0)
+            poSrcDS->GetRasterBand(1)->GetBlockSize(&nSrcBlockXSize, 
+                &nSrcBlockYSize);
+
+        if (!poSrcDS->bRegularBlocking || nSrcBlockXSize <= 0 ||
+            nSrcBlockYSize <= 0 || nSrcBlockXSize % nTileXSize != 0 ||
+            nSrcBlockYSize % nTileYSize != 0) {
+            CPLError(CE_Failure, CPLE_NotSupported, "Can't retile %s.%s to "
+                "%dx%d tiles: the source must be a single raster, or "
+                "regularly blocked in multiples of TILE_SIZE", 
+                poSrcDS->pszSchema, poSrcDS->pszTable, nTileXSize, nTileYSize);
+            return NULL;
+        }
+    }
+
+    bCluster = CSLFetchBoolean(papszOptions, "CLUSTER", false);
+    bAddConstraints = CSLFetchBoolean(papszOptions, "ADD_CONSTRAINTS", true);
+    bTileStats = CSLFetchBoolean(papszOptions, "TILE_STATS", false);
+
+    /**
+     * INCREMENTAL: only the tiles that differ from the ones already in the
+     * table are written, in batches of INCREMENTAL_BATCH_SIZE tiles
+     **/
+    bIncremental = CSLFetchBoolean(papszOptions, "INCREMENTAL", false);
+    nBatchSize = atoi(CSLFetchNameValueDef(papszOptions, 
+        "INCREMENTAL_BATCH_SIZE", DEFAULT_INCREMENTAL_BATCH_SIZE));
+    if (nBatchSize <= 0) {
+        CPLError(CE_Failure, CPLE_IllegalArg, "Invalid INCREMENTAL_BATCH_SIZE "
+            "value: %s", CSLFetchNameValue(papszOptions, "INCREMENTAL_BATCH_SIZE"));
+        return NULL;
+    }
+
+    if (bIncremental && poSrcDS->pszTable == NULL) {
+        CPLError(CE_Failure, CPLE_NotSupported, "An incremental copy needs a "
+            "raster table as source");
+        return NULL;
+    }
+
     poConn = GetConnection(pszFilename, &pszConnectionString, &pszSchema, 
         &pszTable, &pszColumn, &pszWhere, &nMode, &bBrowseDatabase);
     if (poConn == NULL || bBrowseDatabase || pszTable == NULL) 
@@ -1612,13 +2969,45 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
         return NULL;
     }
 
+    /**
+     * The tiles are compared and written by the target server, in one
+     * statement per batch: the source must be another table of the same
+     * database
+     **/
+    if (bIncremental && !IsSameDatabase(poSrcDS->pszOriginalConnectionString,
+        pszFilename)) {
+        CPLError(CE_Failure, CPLE_NotSupported, "An incremental copy needs "
+            "the source raster %s.%s in the database of the target (same "
+            "dbname, host and port)", poSrcDS->pszSchema, poSrcDS->pszTable);
+        CPLFree(pszConnectionString);
+        CPLFree(pszSchema);
+        CPLFree(pszTable);
+        CPLFree(pszColumn);
+        CPLFree(pszWhere);
+
+        return NULL;
+    }
+
+    if (bIncremental && EQUAL(poSrcDS->pszSchema, pszSchema) && 
+        EQUAL(poSrcDS->pszTable, pszTable)) {
+        CPLError(CE_Failure, CPLE_NotSupported, "Can't copy %s.%s "
+            "incrementally to itself", pszSchema, pszTable);
+        CPLFree(pszConnectionString);
+        CPLFree(pszSchema);
+        CPLFree(pszTable);
+        CPLFree(pszColumn);
+        CPLFree(pszWhere);
+
+        return NULL;
+    }
+
     // begin transaction
-    poResult = PQexec(poConn, "begin");
+    poResult = PostGISRasterExec(poConn, "begin");
     if (poResult == NULL ||
         PQresultStatus(poResult) != PGRES_COMMAND_OK) {
         CPLError(CE_Failure, CPLE_AppDefined,
             "Error beginning database transaction: %s",
-            PQerrorMessage(poConn));
+            PostGISRasterErrorMessage(poConn));
         if (poResult != NULL)
             PQclear(poResult);
         if (pszSchema)
@@ -1644,25 +3033,25 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
     osCommand.Printf("create table if not exists %s.%s (rid serial, %s "
         "public.raster, constraint %s_pkey primary key (rid));",
         pszSchema, pszTable, pszColumn, pszTable);
-    poResult = PQexec(poConn, osCommand.c_str());
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
     if (
             poResult == NULL ||
             PQresultStatus(poResult) != PGRES_COMMAND_OK) {
 
         CPLError(CE_Failure, CPLE_AppDefined,
                 "Error creating needed tables: %s",
-                PQerrorMessage(poConn));
+                PostGISRasterErrorMessage(poConn));
         if (poResult != NULL)
             PQclear(poResult);
 
         // rollback
-        poResult = PQexec(poConn, "rollback");
+        poResult = PostGISRasterExec(poConn, "rollback");
         if (poResult == NULL ||
             PQresultStatus(poResult) != PGRES_COMMAND_OK) {
 
             CPLError(CE_Failure, CPLE_AppDefined,
                 "Error rolling back transaction: %s",
-                PQerrorMessage(poConn));
+                PostGISRasterErrorMessage(poConn));
         }
         if (poResult != NULL)
             PQclear(poResult);
@@ -1682,28 +3071,42 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
 
     PQclear(poResult);
 
-    osCommand.Printf("create index %s_%s_gist ON %s.%s USING gist "
-        "(public.st_convexhull(%s));", pszTable, pszColumn, 
-        pszSchema, pszTable, pszColumn);
-    poResult = PQexec(poConn, osCommand.c_str());
+    // the table may already exist, with its index
+    osCommand.Printf("select count(*) from pg_indexes where schemaname = '%s' "
+        "and indexname = '%s_%s_gist'", pszSchema, pszTable, pszColumn);
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
+    if (poResult != NULL && PQresultStatus(poResult) == PGRES_TUPLES_OK &&
+        PQntuples(poResult) == 1 && atoi(PQgetvalue(poResult, 0, 0)) > 0) {
+        PQclear(poResult);
+        osCommand = "select 1";
+    }
+    else {
+        if (poResult != NULL)
+            PQclear(poResult);
+        osCommand.Printf("create index %s_%s_gist ON %s.%s USING gist "
+            "(public.st_convexhull(%s));", pszTable, pszColumn, 
+            pszSchema, pszTable, pszColumn);
+    }
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
     if (
             poResult == NULL ||
-            PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+            (PQresultStatus(poResult) != PGRES_COMMAND_OK &&
+            PQresultStatus(poResult) != PGRES_TUPLES_OK)) {
 
         CPLError(CE_Failure, CPLE_AppDefined,
                 "Error creating needed index: %s",
-                PQerrorMessage(poConn));
+                PostGISRasterErrorMessage(poConn));
         if (poResult != NULL)
             PQclear(poResult);
 
         // rollback
-        poResult = PQexec(poConn, "rollback");
+        poResult = PostGISRasterExec(poConn, "rollback");
         if (poResult == NULL ||
             PQresultStatus(poResult) != PGRES_COMMAND_OK) {
 
             CPLError(CE_Failure, CPLE_AppDefined,
                 "Error rolling back transaction: %s",
-                PQerrorMessage(poConn));
+                PostGISRasterErrorMessage(poConn));
         }
         if (poResult != NULL)
             PQclear(poResult);
@@ -1721,23 +3124,45 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
         return NULL;
     }
 
-    PQclear(poResult);
-
-    if (poSrcDS->nMode == ONE_RASTER_PER_TABLE) {
-        // one raster per table
+    PQclear(poResult);
+
+    /**
+     * The raster constraints of an existing table (the extent, mostly)
+     * may reject the new tiles. They're added again after the copy
+     **/
+    if (bIncremental && bAddConstraints) {
+        osCommand.Printf("savepoint drop_constraints; select "
+            "DropRasterConstraints('%s'::name, '%s'::name, '%s'::name)", 
+            pszSchema, pszTable, pszColumn);
+        poResult = PostGISRasterExec(poConn, osCommand.c_str());
+        if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK) {
+            if (poResult != NULL)
+                PQclear(poResult);
+            poResult = PostGISRasterExec(poConn, 
+                "rollback to savepoint drop_constraints");
+        }
+        if (poResult != NULL)
+            PQclear(poResult);
+    }
+
+    if (bIncremental || poSrcDS->nMode == ONE_RASTER_PER_TABLE) {
+        // one raster per table, or the tiles that changed
 
         // insert one raster
-        bInsertSuccess = InsertRaster(poConn, poSrcDS,
-            pszSchema, pszTable, pszColumn);
+        bInsertSuccess = (bIncremental) ? 
+            SyncRaster(poConn, poSrcDS, pszSchema, pszTable, pszColumn, 
+                nTileXSize, nTileYSize, nBatchSize, pfnProgress, pProgressData) :
+            InsertRaster(poConn, poSrcDS, pszSchema, pszTable, pszColumn, 
+                pszSpatialOrder, nTileXSize, nTileYSize);
         if (!bInsertSuccess) {
             // rollback
-            poResult = PQexec(poConn, "rollback");
+            poResult = PostGISRasterExec(poConn, "rollback");
             if (poResult == NULL ||
                 PQresultStatus(poResult) != PGRES_COMMAND_OK) {
 
                 CPLError(CE_Failure, CPLE_AppDefined,
                     "Error rolling back transaction: %s",
-                    PQerrorMessage(poConn));
+                    PostGISRasterErrorMessage(poConn));
             }
             if (poResult != NULL)
                 PQclear(poResult);
@@ -1783,7 +3208,7 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
 
             // insert one raster
             bInsertSuccess = InsertRaster(poConn, poSubDS,
-                pszSchema, pszTable, pszColumn);
+                pszSchema, pszTable, pszColumn, NULL, nTileXSize, nTileYSize);
 
             if (!bInsertSuccess) {
                 CPLDebug("PostGIS_Raster", "PostGISRasterDataset::CreateCopy(): "
@@ -1798,12 +3223,12 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
     }
 
     // commit transaction
-    poResult = PQexec(poConn, "commit");
+    poResult = PostGISRasterExec(poConn, "commit");
     if (poResult == NULL ||
         PQresultStatus(poResult) != PGRES_COMMAND_OK) {
         CPLError(CE_Failure, CPLE_AppDefined,
             "Error committing database transaction: %s",
-            PQerrorMessage(poConn));
+            PostGISRasterErrorMessage(poConn));
         if (poResult != NULL)
             PQclear(poResult);
         if (pszSchema)
@@ -1822,6 +3247,83 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
 
     PQclear(poResult);
 
+    /**
+     * The table has changed: it's described again when opened, and its
+     * blocks are read again. It may be new: the databases are browsed
+     * again too
+     **/
+    ((PostGISRasterDriver *)GDALGetDriverByName("PostGISRaster"))->
+        InvalidateDescriptors(pszSchema, pszTable);
+    ((PostGISRasterDriver *)GDALGetDriverByName("PostGISRaster"))->
+        InvalidateCatalogs();
+    PostGISRasterTileCache::GetInstance()->InvalidateTable(pszSchema, pszTable);
+
+    /**
+     * Register the new table in raster_columns, so it's opened without
+     * scanning it. It's regularly blocked if it's been retiled, or if the
+     * source coverage is regularly blocked too
+     **/
+    if (bAddConstraints) {
+        osCommand.Printf("select AddRasterConstraints('%s'::name, '%s'::name, "
+            "'%s'::name, regular_blocking := %s)", pszSchema, pszTable, 
+            pszColumn, (poSrcDS->nMode == ONE_RASTER_PER_TABLE && 
+            (nTileXSize > 0 || poSrcDS->bRegularBlocking)) ? "true" : "false");
+
+        CPLDebug("PostGIS_Raster", "PostGISRasterDataset::CreateCopy(): "
+            "Query = %s", osCommand.c_str());
+
+        poResult = PostGISRasterExec(poConn, osCommand.c_str());
+        if (poResult == NULL ||
+            PQresultStatus(poResult) != PGRES_TUPLES_OK) {
+            CPLError(CE_Warning, CPLE_AppDefined,
+                "Error adding the raster constraints of the new table: %s",
+                PostGISRasterErrorMessage(poConn));
+        }
+        else if (!EQUAL(PQgetvalue(poResult, 0, 0), "t")) {
+            CPLDebug("PostGIS_Raster", "PostGISRasterDataset::CreateCopy(): "
+                "Some raster constraints couldn't be added");
+        }
+
+        if (poResult != NULL)
+            PQclear(poResult);
+    }
+
+    /**
+     * Tile stats, for value filters. Before clustering, so the table is
+     * rewritten only once
+     **/
+    if (bTileStats)
+        UpdateTileStats(poConn, pszSchema, pszTable, pszColumn, bIncremental);
+
+    /**
+     * Cluster after the commit: it rewrites the whole table, and the data
+     * is kept if it fails
+     **/
+    if (bCluster) {
+        osCommand.Printf("cluster %s.%s using %s_%s_gist", pszSchema, pszTable,
+            pszTable, pszColumn);
+
+        CPLDebug("PostGIS_Raster", "PostGISRasterDataset::CreateCopy(): "
+            "Query = %s", osCommand.c_str());
+
+        poResult = PostGISRasterExec(poConn, osCommand.c_str());
+        if (poResult == NULL ||
+            PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+            CPLError(CE_Warning, CPLE_AppDefined,
+                "Error clustering the new table: %s",
+                PostGISRasterErrorMessage(poConn));
+        }
+        else {
+            PQclear(poResult);
+
+            osCommand.Printf("analyze %s.%s", pszSchema, pszTable);
+            poResult = PostGISRasterExec(poConn, osCommand.c_str());
+        }
+
+        if (poResult != NULL)
+            PQclear(poResult);
+    }
+
     if (pszSchema)
         CPLFree(pszSchema);
     if (pszTable)
@@ -1849,39 +3351,376 @@ PostGISRasterDataset::CreateCopy( const char * pszFilename,
     return poSubDS;
 }
 
+/********************************************************
+ * \brief Get the ORDER BY expression of the tiles of a
+ * raster in Hilbert order.
+ *
+ * The position of each tile is computed by the server, from
+ * its upper left corner as a block of the raster, with the
+ * same curve as PostGISRasterHilbertIndex (in pg_temp, so
+ * it's dropped with the session). The raster must be
+ * regularly blocked.
+ ********************************************************/
+GBool
+PostGISRasterDataset::GetHilbertOrderBy(PGconn * poConn,
+    PostGISRasterDataset * poSrcDS, CPLString * posOrderBy)
+{
+    PGresult * poResult = NULL;
+    int nBlockXSize = 0, nBlockYSize = 0;
+
+    if (!poSrcDS->bRegularBlocking || poSrcDS->GetRasterCount() == 0)
+        return false;
+
+    poSrcDS->GetRasterBand(1)->GetBlockSize(&nBlockXSize, &nBlockYSize);
+    if (nBlockXSize <= 0 || nBlockYSize <= 0)
+        return false;
+
+    poResult = PostGISRasterExec(poConn, "create or replace function "
+        "pg_temp.pgr_hilbert(x integer, y integer) returns bigint as $$ "
+        "declare s integer := 32768; rx integer; ry integer; t integer; "
+        "d bigint := 0; begin x := x & 65535; y := y & 65535; "
+        "while s > 0 loop "
+        "rx := case when (x & s) <> 0 then 1 else 0 end; "
+        "ry := case when (y & s) <> 0 then 1 else 0 end; "
+        "d := d + s::bigint * s * ((3 * rx) # ry); "
+        "if ry = 0 then if rx = 1 then x := 65535 - x; y := 65535 - y; "
+        "end if; t := x; x := y; y := t; end if; s := s / 2; "
+        "end loop; return d; end $$ language plpgsql immutable strict");
+    if (poResult == NULL || PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+        CPLError(CE_Failure, CPLE_AppDefined, "Error creating the Hilbert "
+            "order function: %s", PostGISRasterErrorMessage(poConn));
+        if (poResult != NULL)
+            PQclear(poResult);
+
+        return false;
+    }
+    PQclear(poResult);
+
+    posOrderBy->Printf("pg_temp.pgr_hilbert(floor(0.5 + (st_upperleftx(%s) "
+        "- %.17g) / %.17g)::integer / %d, floor(0.5 + (%.17g - "
+        "st_upperlefty(%s)) / %.17g)::integer / %d)", poSrcDS->pszColumn,
+        poSrcDS->xmin, poSrcDS->adfGeoTransform[GEOTRSFRM_WE_RES], 
+        nBlockXSize, poSrcDS->ymax, poSrcDS->pszColumn,
+        fabs(poSrcDS->adfGeoTransform[GEOTRSFRM_NS_RES]), nBlockYSize);
+
+    return true;
+}
+
+/********************************************************
+ * \brief Get the query that selects the tiles of a source
+ * raster (as t), retiled if nTileXSize and nTileYSize are
+ * not 0. pszColumn may be an expression of the raster
+ * column (see GetRasterExpression)
+ ********************************************************/
+static CPLString
+GetSourceTilesQuery(const char * pszSchema, const char * pszTable,
+    const char * pszColumn, const char * pszWhere, int nTileXSize, 
+    int nTileYSize)
+{
+    CPLString osSelect;
+
+    if (nTileXSize > 0 && nTileYSize > 0)
+        osSelect.Printf("select st_tile(%s, %d, %d, true) as t from %s.%s",
+            pszColumn, nTileXSize, nTileYSize, pszSchema, pszTable);
+    else
+        osSelect.Printf("select %s as t from %s.%s", pszColumn, pszSchema, 
+            pszTable);
+
+    if (pszWhere != NULL)
+        osSelect += CPLString().Printf(" where %s", pszWhere);
+
+    return osSelect;
+}
+
 /********************************************************
  * \brief Helper method to insert a new raster.
+ *
+ * The tiles are inserted in the order given (NONE, ROW_MAJOR or HILBERT),
+ * so a new table gets them laid out in that order. HILBERT needs a
+ * regularly blocked source that isn't retiled, and falls back to
+ * ROW_MAJOR otherwise.
+ *
+ * If nTileXSize and nTileYSize are not 0, the source rasters are cut
+ * into tiles of that size by the server (ST_Tile). The tiles at the right
+ * and bottom edges are padded with nodata, so all of them have the same
+ * size and the new table is regularly blocked. CreateCopy only allows it
+ * for a single raster, or a source blocked in multiples of the tile size,
+ * as the rasters are cut one by one.
  ********************************************************/
 GBool 
 PostGISRasterDataset::InsertRaster(PGconn * poConn, 
     PostGISRasterDataset * poSrcDS, const char *pszSchema, 
-    const char * pszTable, const char * pszColumn)
+    const char * pszTable, const char * pszColumn, const char * pszSpatialOrder,
+    int nTileXSize, int nTileYSize)
 {
     CPLString osCommand;
+    CPLString osSelect;
+    CPLString osOrderBy;
     PGresult * poResult = NULL;
 
-    if (poSrcDS->pszWhere == NULL) {
-        osCommand.Printf("insert into %s.%s (%s) (select %s from %s.%s)",
-            pszSchema, pszTable, pszColumn, poSrcDS->pszColumn, 
+    if (pszSpatialOrder != NULL && EQUAL(pszSpatialOrder, "HILBERT") &&
+        (nTileXSize > 0 || 
+        !GetHilbertOrderBy(poConn, poSrcDS, &osOrderBy))) {
+        CPLError(CE_Warning, CPLE_NotSupported, "Can't insert the tiles "
+            "of %s.%s in Hilbert order, using ROW_MAJOR", 
             poSrcDS->pszSchema, poSrcDS->pszTable);
+        pszSpatialOrder = "ROW_MAJOR";
+    }
+
+    if (!osOrderBy.empty()) {
+        osCommand.Printf("insert into %s.%s (%s) (select %s from %s.%s%s%s "
+            "order by %s)", pszSchema, pszTable, pszColumn, 
+            poSrcDS->pszColumn, poSrcDS->pszSchema, poSrcDS->pszTable, 
+            (poSrcDS->pszWhere) ? " where " : "", 
+            (poSrcDS->pszWhere) ? poSrcDS->pszWhere : "", osOrderBy.c_str());
     }
     else {
-        osCommand.Printf("insert into %s.%s (%s) (select %s from %s.%s where %s)",
-            pszSchema, pszTable, pszColumn, poSrcDS->pszColumn, 
-            poSrcDS->pszSchema, poSrcDS->pszTable, poSrcDS->pszWhere);
+        osSelect = GetSourceTilesQuery(poSrcDS->pszSchema, poSrcDS->pszTable,
+            poSrcDS->GetRasterExpression().c_str(), poSrcDS->pszWhere, 
+            nTileXSize, nTileYSize);
+
+        /**
+         * Same order as the read queries: rows from the top, columns from
+         * the left. Ordered out of a subquery, to get the order of the new
+         * tiles when the rasters are retiled
+         **/
+        if (pszSpatialOrder != NULL && EQUAL(pszSpatialOrder, "ROW_MAJOR"))
+            osCommand.Printf("insert into %s.%s (%s) (select t from (%s) q "
+                "order by st_upperlefty(t) %s, st_upperleftx(t) asc)", pszSchema,
+                pszTable, pszColumn, osSelect.c_str(), 
+                (poSrcDS->nSrid == -1) ? "asc" : "desc");
+        else
+            osCommand.Printf("insert into %s.%s (%s) (%s)", pszSchema, pszTable,
+                pszColumn, osSelect.c_str());
     }
 
     CPLDebug("PostGIS_Raster", "PostGISRasterDataset::InsertRaster(): Query = %s",
         osCommand.c_str());
 
-    poResult = PQexec(poConn, osCommand.c_str());
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
     if (
             poResult == NULL ||
             PQresultStatus(poResult) != PGRES_COMMAND_OK) {
 
         CPLError(CE_Failure, CPLE_AppDefined,
                 "Error inserting raster: %s",
-                PQerrorMessage(poConn));
+                PostGISRasterErrorMessage(poConn));
+        if (poResult != NULL)
+            PQclear(poResult);
+
+        return false;
+    }
+
+    PQclear(poResult);
+
+    return true;
+}
+
+/********************************************************
+ * \brief Helper method to update a raster table with the
+ * tiles of a source raster that changed.
+ *
+ * The tiles are matched by position (their upper left
+ * corner) and compared by the md5 of their WKB, on the
+ * server. The tiles that differ are updated, the new ones
+ * inserted and the ones missing in the source deleted,
+ * nBatchSize tiles per statement, in row-major order. If
+ * several tiles share a position, they're matched in the
+ * order of their checksums.
+ *
+ * Must be called inside a transaction. The tile stats of
+ * the updated tiles, if any, are cleared (see
+ * UpdateTileStats).
+ ********************************************************/
+GBool 
+PostGISRasterDataset::SyncRaster(PGconn * poConn, 
+    PostGISRasterDataset * poSrcDS, const char *pszSchema, 
+    const char * pszTable, const char * pszColumn, int nTileXSize, 
+    int nTileYSize, int nBatchSize, GDALProgressFunc pfnProgress, 
+    void * pProgressData)
+{
+    CPLString osCommand;
+    CPLString osClearStats;
+    PGresult * poResult = NULL;
+    int nChanges, nInserts, nUpdates, nDeletes;
+    int nFirst;
+    int i;
+
+    if (pfnProgress == NULL)
+        pfnProgress = GDALDummyProgress;
+
+    osCommand.Printf("create temp table pgr_delta on commit drop as "
+        "select row_number() over (order by coalesce(s.uy, d.uy) %s, "
+        "coalesce(s.ux, d.ux) asc) as id, s.t, d.tid from "
+        "(select t, st_upperleftx(t) as ux, st_upperlefty(t) as uy, "
+        "md5(st_asbinary(t)) as h, row_number() over (partition by "
+        "st_upperleftx(t), st_upperlefty(t) order by md5(st_asbinary(t))) as n "
+        "from (%s) q) s full join "
+        "(select ctid as tid, st_upperleftx(%s) as ux, st_upperlefty(%s) as uy, "
+        "md5(st_asbinary(%s)) as h, row_number() over (partition by "
+        "st_upperleftx(%s), st_upperlefty(%s) order by md5(st_asbinary(%s))) as n "
+        "from %s.%s) d on s.ux = d.ux and s.uy = d.uy and s.n = d.n "
+        "where s.h is distinct from d.h",
+        (poSrcDS->nSrid == -1) ? "asc" : "desc",
+        GetSourceTilesQuery(poSrcDS->pszSchema, poSrcDS->pszTable,
+            poSrcDS->GetRasterExpression().c_str(), poSrcDS->pszWhere, 
+            nTileXSize, nTileYSize).c_str(),
+        pszColumn, pszColumn, pszColumn, pszColumn, pszColumn, pszColumn,
+        pszSchema, pszTable);
+
+    CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SyncRaster(): Query = %s",
+        osCommand.c_str());
+
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
+    if (poResult == NULL || PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+        CPLError(CE_Failure, CPLE_AppDefined, "Error comparing the tiles of "
+            "%s.%s and %s.%s: %s", poSrcDS->pszSchema, poSrcDS->pszTable, 
+            pszSchema, pszTable, PostGISRasterErrorMessage(poConn));
+        if (poResult != NULL)
+            PQclear(poResult);
+
+        return false;
+    }
+
+    PQclear(poResult);
+
+    poResult = PostGISRasterExec(poConn, "select count(*), "
+        "coalesce(sum(case when tid is null then 1 else 0 end), 0), "
+        "coalesce(sum(case when t is null then 1 else 0 end), 0) from pgr_delta");
+    if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+        PQntuples(poResult) != 1) {
+        CPLError(CE_Failure, CPLE_AppDefined, "Error counting the changed "
+            "tiles: %s", PostGISRasterErrorMessage(poConn));
+        if (poResult != NULL)
+            PQclear(poResult);
+
+        return false;
+    }
+
+    nChanges = atoi(PQgetvalue(poResult, 0, 0));
+    nInserts = atoi(PQgetvalue(poResult, 0, 1));
+    nDeletes = atoi(PQgetvalue(poResult, 0, 2));
+    nUpdates = nChanges - nInserts - nDeletes;
+    PQclear(poResult);
+
+    CPLDebug("PostGIS_Raster", "PostGISRasterDataset::SyncRaster(): "
+        "%d tiles to insert, %d to update and %d to delete in %s.%s", 
+        nInserts, nUpdates, nDeletes, pszSchema, pszTable);
+
+    if (HasTileStats(poConn, pszSchema, pszTable, pszColumn))
+        osClearStats.Printf(", %s" TILE_STATS_MIN_SUFFIX " = null, %s" 
+            TILE_STATS_MAX_SUFFIX " = null", pszColumn, pszColumn);
+
+    /**
+     * The tiles of the table are found by ctid. Deleted and updated rows
+     * keep their space until the end of the transaction, so the ctids of
+     * the next batches are still valid
+     **/
+    for(nFirst = 0; nFirst < nChanges; nFirst += nBatchSize) {
+        CPLString aosStatements[3];
+
+        aosStatements[0].Printf("delete from %s.%s where ctid = any(array("
+            "select tid from pgr_delta where t is null and id > %d and "
+            "id <= %d))", pszSchema, pszTable, nFirst, nFirst + nBatchSize);
+        aosStatements[1].Printf("update %s.%s r set %s = d.t%s from pgr_delta "
+            "d where r.ctid = any(array(select tid from pgr_delta where t is "
+            "not null and tid is not null and id > %d and id <= %d)) and "
+            "r.ctid = d.tid", pszSchema, pszTable, pszColumn, 
+            osClearStats.c_str(), nFirst, nFirst + nBatchSize);
+        aosStatements[2].Printf("insert into %s.%s (%s) (select t from "
+            "pgr_delta where tid is null and id > %d and id <= %d order by id)",
+            pszSchema, pszTable, pszColumn, nFirst, nFirst + nBatchSize);
+
+        for(i = 0; i < 3; i++) {
+            poResult = PostGISRasterExec(poConn, aosStatements[i].c_str());
+            if (poResult == NULL || 
+                PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+                CPLError(CE_Failure, CPLE_AppDefined, "Error writing the "
+                    "changed tiles: %s", PostGISRasterErrorMessage(poConn));
+                if (poResult != NULL)
+                    PQclear(poResult);
+
+                return false;
+            }
+
+            PQclear(poResult);
+        }
+
+        if (!pfnProgress(MIN(1.0, (double)(nFirst + nBatchSize) / nChanges),
+            NULL, pProgressData)) {
+            CPLError(CE_Failure, CPLE_UserInterrupt, "User terminated "
+                "incremental copy");
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*********************************************************
+ * \brief Get the overview tables of a raster column, from
+ * raster_overviews, as schema.table names and the raster
+ * column of each one. The lists must be freed with
+ * CSLDestroy.
+ *********************************************************/
+static void
+GetOverviewTables(PGconn * poConn, const char * pszSchema, 
+    const char * pszTable, const char * pszColumn, char *** ppapszTables,
+    char *** ppapszColumns)
+{
+    CPLString osCommand;
+    PGresult * poResult = NULL;
+    int i;
+
+    /* In a savepoint: a failure would abort the whole transaction */
+    osCommand.Printf("savepoint overviews; select o_table_schema, "
+        "o_table_name, o_raster_column from raster_overviews where "
+        "r_table_schema = '%s' and r_table_name = '%s' and "
+        "r_raster_column = '%s'", pszSchema, pszTable, pszColumn);
+
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
+    if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK) {
+        CPLDebug("PostGIS_Raster", "PostGISRasterDataset::Delete(): "
+            "Can't get the overviews of %s.%s: %s", pszSchema, pszTable,
+            PostGISRasterErrorMessage(poConn));
+        if (poResult != NULL)
+            PQclear(poResult);
+
+        poResult = PostGISRasterExec(poConn, "rollback to savepoint overviews");
+        if (poResult != NULL)
+            PQclear(poResult);
+
+        return;
+    }
+
+    for(i = 0; i < PQntuples(poResult); i++) {
+        *ppapszTables = CSLAddString(*ppapszTables, CPLSPrintf("%s.%s", 
+            PQgetvalue(poResult, i, 0), PQgetvalue(poResult, i, 1)));
+        *ppapszColumns = CSLAddString(*ppapszColumns, 
+            PQgetvalue(poResult, i, 2));
+    }
+
+    PQclear(poResult);
+}
+
+/*********************************************************
+ * \brief Run a statement that returns no rows. Returns
+ * false and reports the error, with the given message,
+ * if it fails.
+ *********************************************************/
+static GBool
+ExecCommand(PGconn * poConn, const char * pszCommand, const char * pszError)
+{
+    PGresult * poResult = NULL;
+
+    CPLDebug("PostGIS_Raster", "PostGISRasterDataset::Delete(): Query = %s",
+        pszCommand);
+
+    poResult = PostGISRasterExec(poConn, pszCommand);
+    if (poResult == NULL || PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+        CPLError(CE_Failure, CPLE_AppDefined, "%s: %s", pszError,
+            PostGISRasterErrorMessage(poConn));
         if (poResult != NULL)
             PQclear(poResult);
 
@@ -1893,6 +3732,185 @@ PostGISRasterDataset::InsertRaster(PGconn * poConn,
     return true;
 }
 
+/*********************************************************
+ * \brief Report a delete by chunks that failed: the chunks
+ * committed before stay deleted. The failed transaction is
+ * rolled back, and a new one begun to count the tiles left
+ *********************************************************/
+static void
+ReportDeleteFailure(PGconn * poConn, const char * pszSchema, 
+    const char * pszTable, const char * pszWhere, GIntBig nDeleted)
+{
+    CPLString osCommand;
+    PGresult * poResult = NULL;
+    CPLString osRemaining = "an unknown number of";
+
+    if (ExecCommand(poConn, "rollback", "Error rolling back transaction") &&
+        ExecCommand(poConn, "begin", "Error beginning database transaction")) {
+        osCommand.Printf("select count(*) from %s.%s where (%s)", pszSchema,
+            pszTable, pszWhere);
+        poResult = PostGISRasterExec(poConn, osCommand.c_str());
+        if (poResult != NULL && PQresultStatus(poResult) == PGRES_TUPLES_OK &&
+            PQntuples(poResult) == 1)
+            osRemaining = PQgetvalue(poResult, 0, 0);
+        if (poResult != NULL)
+            PQclear(poResult);
+    }
+
+    CPLError(CE_Failure, CPLE_AppDefined, "The delete from %s.%s stopped "
+        "after " CPL_FRMT_GIB " tiles, committed by chunks: %s tiles matching "
+        "the where clause remain", pszSchema, pszTable, nDeleted, 
+        osRemaining.c_str());
+}
+
+/*********************************************************
+ * \brief Delete the tiles of a raster table matching a
+ * where clause, and the tiles of its overviews left
+ * without data.
+ *
+ * If the table has an integer primary key, the tiles are
+ * deleted by chunks of POSTGIS_RASTER_DELETE_CHUNK_SIZE
+ * tiles, committing each chunk, so the dead rows of a
+ * chunk can be vacuumed while the next ones are deleted.
+ * The keys of each chunk are read from the index, after
+ * the last key of the previous one, so sparse keys don't
+ * cost empty chunks. Otherwise, the tiles are deleted at
+ * once.
+ *
+ * The overview tiles that overlap the deleted tiles, and
+ * no remaining tile, are deleted in the same transaction
+ * as the tiles. Must be called inside a transaction.
+ *
+ * If a chunk fails, the chunks committed before it stay
+ * deleted, with their overview tiles: the number of tiles
+ * deleted and left is reported, and false returned.
+ *********************************************************/
+static GBool
+DeleteRasterTiles(PGconn * poConn, const char * pszSchema, 
+    const char * pszTable, const char * pszColumn, const char * pszWhere,
+    char ** papszOvTables, char ** papszOvColumns)
+{
+    CPLString osCommand;
+    CPLString osKey;
+    CPLString osChunk;
+    CPLString osLastKey;
+    PGresult * poResult = NULL;
+    GIntBig nChunkSize;
+    GIntBig nDeleted = 0;
+    GBool bSuccess = true;
+    int nKeys = 0;
+    int i;
+
+    nChunkSize = CPLAtoGIntBig(CPLGetConfigOption(
+        "POSTGIS_RASTER_DELETE_CHUNK_SIZE", DEFAULT_DELETE_CHUNK_SIZE));
+
+    /* Integer primary key */
+    osCommand.Printf("select a.attname from pg_index i join pg_attribute a on "
+        "a.attrelid = i.indrelid and a.attnum = i.indkey[0] where i.indrelid = "
+        "'%s.%s'::regclass and i.indisprimary and i.indnatts = 1 and "
+        "a.atttypid in ('int2'::regtype, 'int4'::regtype, 'int8'::regtype)",
+        pszSchema, pszTable);
+
+    poResult = PostGISRasterExec(poConn, osCommand.c_str());
+    if (nChunkSize > 0 && poResult != NULL && 
+        PQresultStatus(poResult) == PGRES_TUPLES_OK && PQntuples(poResult) == 1)
+        osKey = PQgetvalue(poResult, 0, 0);
+    if (poResult != NULL)
+        PQclear(poResult);
+
+    while (bSuccess) {
+        if (!osKey.empty()) {
+            /* Keys of the next chunk */
+            osCommand.Printf("select %s from %s.%s where (%s)%s%s%s order by "
+                "%s limit " CPL_FRMT_GIB, osKey.c_str(), pszSchema, pszTable,
+                pszWhere, osLastKey.empty() ? "" : " and ", 
+                osLastKey.empty() ? "" : osKey.c_str(),
+                osLastKey.empty() ? "" : CPLSPrintf(" > %s", osLastKey.c_str()),
+                osKey.c_str(), nChunkSize);
+
+            poResult = PostGISRasterExec(poConn, osCommand.c_str());
+            if (poResult == NULL || 
+                PQresultStatus(poResult) != PGRES_TUPLES_OK) {
+                CPLError(CE_Failure, CPLE_AppDefined, "Couldn't find the "
+                    "records to delete from the table %s.%s: %s", pszSchema,
+                    pszTable, PostGISRasterErrorMessage(poConn));
+                if (poResult != NULL)
+                    PQclear(poResult);
+
+                bSuccess = false;
+                break;
+            }
+
+            nKeys = PQntuples(poResult);
+            if (nKeys == 0) {
+                PQclear(poResult);
+                break;
+            }
+
+            osChunk.Printf(" and %s in (", osKey.c_str());
+            for(i = 0; i < nKeys; i++) {
+                if (i > 0)
+                    osChunk += ",";
+                osChunk += PQgetvalue(poResult, i, 0);
+            }
+            osChunk += ")";
+            osLastKey = PQgetvalue(poResult, nKeys - 1, 0);
+            PQclear(poResult);
+        }
+
+        /* Footprints of the deleted tiles, for the overviews */
+        osCommand.Printf("create temp table pgr_deleted (g geometry) on commit "
+            "drop; with d as (delete from %s.%s where (%s)%s returning "
+            "st_convexhull(%s) as g) insert into pgr_deleted select g from d",
+            pszSchema, pszTable, pszWhere, osChunk.c_str(), pszColumn);
+        bSuccess = ExecCommand(poConn, osCommand.c_str(), CPLSPrintf("Couldn't "
+            "delete records from the table %s.%s", pszSchema, pszTable));
+
+        for(i = 0; bSuccess && papszOvTables != NULL && papszOvTables[i] != NULL;
+            i++) {
+            osCommand.Printf("delete from %s o where exists (select 1 from "
+                "pgr_deleted d where d.g && st_convexhull(o.%s) and "
+                "st_relate(d.g, st_convexhull(o.%s), 'T********')) and not "
+                "exists (select 1 from %s.%s r where st_convexhull(r.%s) && "
+                "st_convexhull(o.%s) and st_relate(st_convexhull(r.%s), "
+                "st_convexhull(o.%s), 'T********'))", papszOvTables[i],
+                papszOvColumns[i], papszOvColumns[i], pszSchema, pszTable,
+                pszColumn, papszOvColumns[i], pszColumn, papszOvColumns[i]);
+            bSuccess = ExecCommand(poConn, osCommand.c_str(), CPLSPrintf(
+                "Couldn't delete records from the overview table %s", 
+                papszOvTables[i]));
+        }
+
+        if (!bSuccess || osKey.empty())
+            break;
+
+        /* Next chunk in its own transaction */
+        if (!ExecCommand(poConn, "commit", "Error committing database "
+            "transaction")) {
+            bSuccess = false;
+            break;
+        }
+
+        nDeleted += nKeys;
+
+        if (!ExecCommand(poConn, "begin", "Error beginning database "
+            "transaction")) {
+            bSuccess = false;
+            break;
+        }
+
+        /* A short chunk is the last one */
+        if (nKeys < nChunkSize)
+            break;
+    }
+
+    /* Without chunks, nothing was committed */
+    if (!bSuccess && !osKey.empty())
+        ReportDeleteFailure(poConn, pszSchema, pszTable, pszWhere, nDeleted);
+
+    return bSuccess;
+}
+
 /*********************************************************
  * \brief Delete a PostGIS Raster dataset. 
  *********************************************************/
@@ -1910,6 +3928,10 @@ PostGISRasterDataset::Delete(const char* pszFilename)
     PGresult * poResult = NULL;
     CPLString osCommand;
     CPLErr nError = CE_Failure;
+    char ** papszOvTables = NULL;
+    char ** papszOvColumns = NULL;
+    GBool bTruncate = false;
+    int i;
 
     // Check connection string
     if (pszFilename == NULL ||
@@ -1938,18 +3960,43 @@ PostGISRasterDataset::Delete(const char* pszFilename)
     }
 
     // begin transaction
-    poResult = PQexec(poConn, "begin");
+    poResult = PostGISRasterExec(poConn, "begin");
     if (poResult == NULL ||
         PQresultStatus(poResult) != PGRES_COMMAND_OK) {
         CPLError(CE_Failure, CPLE_AppDefined,
             "Error beginning database transaction: %s",
-            PQerrorMessage(poConn));
+            PostGISRasterErrorMessage(poConn));
 
         // set nMode to NO_MODE to avoid any further processing
         nMode = NO_MODE;
     }
 
     PQclear(poResult);
+    poResult = NULL;
+
+    /**
+     * The overview tables go with the table, and lose the tiles of the
+     * deleted ones
+     **/
+    if (nMode == ONE_RASTER_PER_TABLE || nMode == ONE_RASTER_PER_ROW)
+        GetOverviewTables(poConn, pszSchema, pszTable, pszColumn,
+            &papszOvTables, &papszOvColumns);
+
+    /**
+     * Does the where clause select all the rows? Then the table is
+     * truncated, without scanning it again to delete them one by one
+     **/
+    if (nMode == ONE_RASTER_PER_ROW && pszWhere != NULL) {
+        osCommand.Printf("select not exists (select 1 from %s.%s where (%s) "
+            "is not true)", pszSchema, pszTable, pszWhere);
+        poResult = PostGISRasterExec(poConn, osCommand.c_str());
+        bTruncate = (poResult != NULL && 
+            PQresultStatus(poResult) == PGRES_TUPLES_OK &&
+            PQntuples(poResult) == 1 && EQUAL(PQgetvalue(poResult, 0, 0), "t"));
+        if (poResult != NULL)
+            PQclear(poResult);
+        poResult = NULL;
+    }
 
     if ( nMode == ONE_RASTER_PER_TABLE || 
         (nMode == ONE_RASTER_PER_ROW && pszWhere == NULL)) {
@@ -1958,50 +4005,69 @@ PostGISRasterDataset::Delete(const char* pszFilename)
 
         // drop table <schema>.<table>;
         osCommand.Printf("drop table %s.%s", pszSchema, pszTable);
-        poResult = PQexec(poConn, osCommand.c_str());
-        if (poResult == NULL || 
-            PQresultStatus(poResult) != PGRES_COMMAND_OK) {
-            CPLError(CE_Failure, CPLE_AppDefined,
-                    "Couldn't drop the table %s.%s: %s",
-                    pszSchema, pszTable, PQerrorMessage(poConn));
-        }
-        else {
-            PQclear(poResult);
+        for(i = 0; papszOvTables != NULL && papszOvTables[i] != NULL; i++)
+            osCommand += CPLString().Printf(", %s", papszOvTables[i]);
+
+        if (ExecCommand(poConn, osCommand.c_str(), CPLSPrintf("Couldn't drop "
+            "the table %s.%s", pszSchema, pszTable)))
+            nError = CE_None;
+    }
+    else if (nMode == ONE_RASTER_PER_ROW && bTruncate) {
+
+        // truncate <schema>.<table>, and its overviews
+        osCommand.Printf("truncate table %s.%s", pszSchema, pszTable);
+        for(i = 0; papszOvTables != NULL && papszOvTables[i] != NULL; i++)
+            osCommand += CPLString().Printf(", %s", papszOvTables[i]);
+
+        if (ExecCommand(poConn, osCommand.c_str(), CPLSPrintf("Couldn't "
+            "truncate the table %s.%s", pszSchema, pszTable)))
             nError = CE_None;
-        }
     }
     else if (nMode == ONE_RASTER_PER_ROW) {
 
-        // delete from <schema>.<table> where <where>
-        osCommand.Printf("delete from %s.%s where %s", pszSchema, 
-            pszTable, pszWhere);
-        poResult = PQexec(poConn, osCommand.c_str());
-        if (poResult == NULL || 
-            PQresultStatus(poResult) != PGRES_COMMAND_OK) {
-            CPLError(CE_Failure, CPLE_AppDefined,
-                    "Couldn't delete records from the table %s.%s: %s",
-                    pszSchema, pszTable, PQerrorMessage(poConn));
-        }
-        else {
-            PQclear(poResult);
+        // delete from <schema>.<table> where <where>, by key chunks
+        if (DeleteRasterTiles(poConn, pszSchema, pszTable, pszColumn, pszWhere,
+            papszOvTables, papszOvColumns))
             nError = CE_None;
-        }
     }
 
     // if mode == NO_MODE, the begin transaction above did not complete,
     // so no commit is necessary
     if (nMode != NO_MODE) {
-        poResult = PQexec(poConn, "commit");
+        poResult = PostGISRasterExec(poConn, "commit");
         if (poResult == NULL ||
             PQresultStatus(poResult) != PGRES_COMMAND_OK) {
             CPLError(CE_Failure, CPLE_AppDefined,
                 "Error committing database transaction: %s",
-                PQerrorMessage(poConn));
+                PostGISRasterErrorMessage(poConn));
 
             nError = CE_Failure;
         }
     }
 
+    /**
+     * Even if it failed: the deletes by key chunks commit each chunk. The
+     * overview tables may have been opened on their own too. Dropped
+     * tables leave the catalogs
+     **/
+    if (nMode != NO_MODE && pszTable != NULL) {
+        ((PostGISRasterDriver *)GDALGetDriverByName("PostGISRaster"))->
+            InvalidateDescriptors(pszSchema, pszTable);
+        ((PostGISRasterDriver *)GDALGetDriverByName("PostGISRaster"))->
+            InvalidateCatalogs();
+        PostGISRasterTileCache::GetInstance()->InvalidateTable(pszSchema,
+            pszTable);
+
+        for(i = 0; papszOvTables != NULL && papszOvTables[i] != NULL; i++) {
+            char ** papszParts = CSLTokenizeString2(papszOvTables[i], ".", 0);
+
+            if (CSLCount(papszParts) == 2)
+                PostGISRasterTileCache::GetInstance()->InvalidateTable(
+                    papszParts[0], papszParts[1]);
+            CSLDestroy(papszParts);
+        }
+    }
+
     if (poResult)
         PQclear(poResult);
     if (pszSchema)
@@ -2012,6 +4078,8 @@ PostGISRasterDataset::Delete(const char* pszFilename)
         CPLFree(pszColumn);
     if (pszWhere)
         CPLFree(pszWhere);
+    CSLDestroy(papszOvTables);
+    CSLDestroy(papszOvColumns);
 
     // clean up connection string
     CPLFree(pszConnectionString);
@@ -2032,6 +4100,30 @@ void GDALRegister_PostGISRaster() {
         poDriver->SetDescription("PostGISRaster");
         poDriver->SetMetadataItem(GDAL_DMD_LONGNAME,
                 "PostGIS Raster driver");
+        poDriver->SetMetadataItem(GDAL_DMD_CREATIONOPTIONLIST,
+"<CreationOptionList>"
+"   <Option name='SPATIAL_ORDER' type='string-select' description='Order the "
+"tiles are inserted in' default='NONE'>"
+"       <Value>NONE</Value>"
+"       <Value>ROW_MAJOR</Value>"
+"       <Value>HILBERT</Value>"
+"   </Option>"
+"   <Option name='TILE_SIZE' type='string' description='Retile the source "
+"rasters to WIDTHxHEIGHT tiles. A multi-tile source must be regularly "
+"blocked in multiples of it'/>"
+"   <Option name='CLUSTER' type='boolean' description='Cluster the table on "
+"its spatial index after loading it' default='NO'/>"
+"   <Option name='ADD_CONSTRAINTS' type='boolean' description='Add the raster "
+"constraints of the new table, to register it in raster_columns' default='YES'/>"
+"   <Option name='INCREMENTAL' type='boolean' description='Only write the "
+"tiles that differ from the ones already in the table. The source must be "
+"another raster table of the same database' default='NO'/>"
+"   <Option name='INCREMENTAL_BATCH_SIZE' type='int' description='Tiles "
+"written per statement by an incremental copy' default='" 
+DEFAULT_INCREMENTAL_BATCH_SIZE "'/>"
+"   <Option name='TILE_STATS' type='boolean' description='Store the per-band "
+"minimum and maximum of each tile, to prune tiles with value_filter' default='NO'/>"
+"</CreationOptionList>");
 
         poDriver->pfnOpen = PostGISRasterDataset::Open;
         poDriver->pfnCreateCopy = PostGISRasterDataset::CreateCopy;
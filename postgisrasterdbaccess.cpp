@@ -0,0 +1,584 @@
+/******************************************************************************
+ * File :    postgisrasterdbaccess.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Database access layer used by the PostGIS Raster driver, and a
+ *           recording/replaying implementation of it
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include "cpl_vsi.h"
+
+/* The libpq implementation, used unless somebody installs another one */
+static PostGISRasterDBAccess oLibpqAccess;
+static PostGISRasterDBAccess * poCurrentAccess = &oLibpqAccess;
+
+/**
+ * Handle returned by the replaying fake instead of a real connection. It's
+ * never passed to libpq: the fake answers all the calls made with it.
+ **/
+static int nReplayConnection = 0;
+#define REPLAY_CONNECTION ((PGconn *) &nReplayConnection)
+
+/************************
+ * \brief Constructor
+ ************************/
+PostGISRasterDBAccess::PostGISRasterDBAccess() {
+    nQueries = 0;
+    nBytesReceived = 0;
+}
+
+/************************
+ * \brief Destructor
+ ************************/
+PostGISRasterDBAccess::~PostGISRasterDBAccess() {
+}
+
+/***********************************************************************
+ * \brief Get the database access layer currently used by the driver
+ ***********************************************************************/
+PostGISRasterDBAccess * PostGISRasterDBAccess::GetInstance() {
+    return poCurrentAccess;
+}
+
+/***********************************************************************
+ * \brief Install a new database access layer.
+ *
+ * The caller keeps the ownership of the object. Passing NULL restores
+ * the libpq implementation. The previous instance is returned.
+ *
+ * NOTE: Connections cached by the driver were opened by the previous
+ * instance, so this should be done before any dataset is opened.
+ ***********************************************************************/
+PostGISRasterDBAccess *
+PostGISRasterDBAccess::SetInstance(PostGISRasterDBAccess * poAccess) {
+    PostGISRasterDBAccess * poPrevious = poCurrentAccess;
+
+    poCurrentAccess = (poAccess != NULL) ? poAccess : &oLibpqAccess;
+
+    return poPrevious;
+}
+
+/***********************************************************************
+ * \brief Update the query and payload counters with a query result
+ ***********************************************************************/
+void PostGISRasterDBAccess::AccountResult(PGresult * poResult) {
+    int i, j;
+
+    nQueries++;
+
+    if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK)
+        return;
+
+    for (i = 0; i < PQntuples(poResult); i++) {
+        for (j = 0; j < PQnfields(poResult); j++)
+            nBytesReceived += PQgetlength(poResult, i, j);
+    }
+}
+
+/***********************************************************************
+ * \brief Open a new connection to the database
+ ***********************************************************************/
+PGconn * PostGISRasterDBAccess::Connect(const char * pszConnectionString) {
+    return PQconnectdb(pszConnectionString);
+}
+
+/***********************************************************************
+ * \brief Check if a connection returned by Connect is usable
+ ***********************************************************************/
+GBool PostGISRasterDBAccess::IsConnected(PGconn * poConn) {
+    return (poConn != NULL && PQstatus(poConn) != CONNECTION_BAD);
+}
+
+/***********************************************************************
+ * \brief Close a connection returned by Connect
+ ***********************************************************************/
+void PostGISRasterDBAccess::Disconnect(PGconn * poConn) {
+    PQfinish(poConn);
+}
+
+/***********************************************************************
+ * \brief Execute a query. The result must be freed with PQclear
+ ***********************************************************************/
+PGresult * PostGISRasterDBAccess::Exec(PGconn * poConn, const char * pszQuery) {
+    PGresult * poResult = PQexec(poConn, pszQuery);
+
+    AccountResult(poResult);
+
+    return poResult;
+}
+
+/***********************************************************************
+ * \brief Get the last error message of a connection
+ ***********************************************************************/
+const char * PostGISRasterDBAccess::GetErrorMessage(PGconn * poConn) {
+    return PQerrorMessage(poConn);
+}
+
+/***********************************************************************
+ * \brief Number of queries executed since the last ResetCounters call
+ ***********************************************************************/
+int PostGISRasterDBAccess::GetQueryCount() {
+    return nQueries;
+}
+
+/***********************************************************************
+ * \brief Bytes of tuple data received since the last ResetCounters call
+ ***********************************************************************/
+GIntBig PostGISRasterDBAccess::GetBytesReceived() {
+    return nBytesReceived;
+}
+
+/***********************************************************************
+ * \brief Reset query and payload counters
+ ***********************************************************************/
+void PostGISRasterDBAccess::ResetCounters() {
+    nQueries = 0;
+    nBytesReceived = 0;
+}
+
+/***********************************************************************
+ * \brief Execute a query through the current database access layer
+ ***********************************************************************/
+PGresult * PostGISRasterExec(PGconn * poConn, const char * pszQuery) {
+    return PostGISRasterDBAccess::GetInstance()->Exec(poConn, pszQuery);
+}
+
+/***********************************************************************
+ * \brief Last error message, through the current database access layer
+ ***********************************************************************/
+const char * PostGISRasterErrorMessage(PGconn * poConn) {
+    return PostGISRasterDBAccess::GetInstance()->GetErrorMessage(poConn);
+}
+
+/***********************************************************************
+ * \brief Make a standalone copy of a query result.
+ *
+ * PQcopyResult always creates a PGRES_TUPLES_OK result, so the results
+ * of commands and failed queries are rebuilt with their own status.
+ ***********************************************************************/
+static PGresult * CloneResult(PGresult * poResult) {
+    if (poResult == NULL)
+        return PQmakeEmptyPGresult(NULL, PGRES_FATAL_ERROR);
+
+    if (PQresultStatus(poResult) != PGRES_TUPLES_OK)
+        return PQmakeEmptyPGresult(NULL, PQresultStatus(poResult));
+
+    return PQcopyResult(poResult, PG_COPYRES_ATTRS | PG_COPYRES_TUPLES);
+}
+
+/***********************************************************************
+ * \brief Constructor.
+ *
+ * With a target, queries are forwarded to it and recorded. Without it,
+ * the recorded or scripted results are replayed.
+ ***********************************************************************/
+PostGISRasterReplayDBAccess::PostGISRasterReplayDBAccess(
+    PostGISRasterDBAccess * poTarget)
+{
+    this->poTarget = poTarget;
+    papszQueries = NULL;
+    papoResults = NULL;
+    nRecords = 0;
+    nNextRecord = 0;
+    nLatencyMs = 0;
+}
+
+/************************
+ * \brief Destructor
+ ************************/
+PostGISRasterReplayDBAccess::~PostGISRasterReplayDBAccess() {
+    int i;
+
+    for (i = 0; i < nRecords; i++)
+        PQclear(papoResults[i]);
+
+    CPLFree(papoResults);
+    CSLDestroy(papszQueries);
+}
+
+/***********************************************************************
+ * \brief Append a query and its result (the object is owned from now)
+ ***********************************************************************/
+void PostGISRasterReplayDBAccess::AddRecord(const char * pszQuery,
+    PGresult * poResult)
+{
+    papszQueries = CSLAddString(papszQueries, pszQuery);
+    papoResults = (PGresult **) CPLRealloc(papoResults,
+        sizeof (PGresult *) * (nRecords + 1));
+    papoResults[nRecords] = poResult;
+    nRecords++;
+}
+
+/***********************************************************************
+ * \brief Connect. Replaying never talks to a server
+ ***********************************************************************/
+PGconn * PostGISRasterReplayDBAccess::Connect(const char * pszConnectionString) {
+    if (poTarget != NULL)
+        return poTarget->Connect(pszConnectionString);
+
+    return REPLAY_CONNECTION;
+}
+
+GBool PostGISRasterReplayDBAccess::IsConnected(PGconn * poConn) {
+    if (poConn == REPLAY_CONNECTION)
+        return true;
+
+    return (poTarget != NULL) ? poTarget->IsConnected(poConn) : false;
+}
+
+void PostGISRasterReplayDBAccess::Disconnect(PGconn * poConn) {
+    if (poConn != REPLAY_CONNECTION && poTarget != NULL)
+        poTarget->Disconnect(poConn);
+}
+
+const char * PostGISRasterReplayDBAccess::GetErrorMessage(PGconn * poConn) {
+    if (poConn == REPLAY_CONNECTION || poTarget == NULL)
+        return "replayed query failed";
+
+    return poTarget->GetErrorMessage(poConn);
+}
+
+/***********************************************************************
+ * \brief Execute a query.
+ *
+ * When recording, the query is forwarded and a copy of its result kept.
+ * When replaying, the next record for the same query is returned. A
+ * record whose query is "*" matches any query. If there's no matching
+ * record, a PGRES_FATAL_ERROR result is returned.
+ ***********************************************************************/
+PGresult * PostGISRasterReplayDBAccess::Exec(PGconn * poConn,
+    const char * pszQuery)
+{
+    PGresult * poResult = NULL;
+    int i;
+
+    if (nLatencyMs > 0)
+        CPLSleep(nLatencyMs / 1000.0);
+
+    if (poTarget != NULL) {
+        poResult = poTarget->Exec(poConn, pszQuery);
+        AddRecord(pszQuery, CloneResult(poResult));
+    }
+
+    else {
+        for (i = nNextRecord; i < nRecords; i++) {
+            if (EQUAL(papszQueries[i], "*") || EQUAL(papszQueries[i], pszQuery))
+                break;
+        }
+
+        if (i < nRecords) {
+            poResult = CloneResult(papoResults[i]);
+            nNextRecord = i + 1;
+        }
+        else {
+            CPLDebug("PostGIS_Raster", "PostGISRasterReplayDBAccess::Exec(): "
+                "No recorded result for query %s", pszQuery);
+            poResult = PQmakeEmptyPGresult(NULL, PGRES_FATAL_ERROR);
+        }
+    }
+
+    AccountResult(poResult);
+
+    return poResult;
+}
+
+/***********************************************************************
+ * \brief Delay each round trip by the given number of milliseconds
+ ***********************************************************************/
+void PostGISRasterReplayDBAccess::SetLatency(int nMilliseconds) {
+    nLatencyMs = nMilliseconds;
+}
+
+/***********************************************************************
+ * \brief Script the result of a query.
+ * Parameters:
+ *  - const char *: the query ("*" to match any query)
+ *  - int: number of fields
+ *  - const char * const *: field names
+ *  - int: number of tuples
+ *  - const char * const *: nTuples * nFields values, row by row. NULL
+ *          entries are SQL nulls
+ ***********************************************************************/
+void PostGISRasterReplayDBAccess::AddTuples(const char * pszQuery,
+    int nFields, const char * const * papszFieldNames, int nTuples,
+    const char * const * papszValues)
+{
+    PGresult * poResult = PQmakeEmptyPGresult(NULL, PGRES_TUPLES_OK);
+    PGresAttDesc * pasAttDesc = NULL;
+    const char * pszValue = NULL;
+    int i, j;
+
+    pasAttDesc = (PGresAttDesc *) CPLCalloc(MAX(nFields, 1),
+        sizeof (PGresAttDesc));
+    for (j = 0; j < nFields; j++) {
+        pasAttDesc[j].name = (char *) papszFieldNames[j];
+        pasAttDesc[j].typlen = -1;
+        pasAttDesc[j].atttypmod = -1;
+    }
+
+    PQsetResultAttrs(poResult, nFields, pasAttDesc);
+    CPLFree(pasAttDesc);
+
+    for (i = 0; i < nTuples; i++) {
+        for (j = 0; j < nFields; j++) {
+            pszValue = papszValues[i * nFields + j];
+            PQsetvalue(poResult, i, j, (char *) pszValue,
+                (pszValue != NULL) ? (int) strlen(pszValue) : -1);
+        }
+    }
+
+    AddRecord(pszQuery, poResult);
+}
+
+/***********************************************************************
+ * \brief Script the result of a command (begin, insert, drop...)
+ ***********************************************************************/
+void PostGISRasterReplayDBAccess::AddCommand(const char * pszQuery,
+    GBool bSuccess)
+{
+    AddRecord(pszQuery, PQmakeEmptyPGresult(NULL,
+        (bSuccess) ? PGRES_COMMAND_OK : PGRES_FATAL_ERROR));
+}
+
+/***********************************************************************
+ * \brief Number of recorded (or scripted) queries
+ ***********************************************************************/
+int PostGISRasterReplayDBAccess::GetRecordCount() {
+    return nRecords;
+}
+
+/***********************************************************************
+ * \brief Text of the i-th recorded query
+ ***********************************************************************/
+const char * PostGISRasterReplayDBAccess::GetRecordedQuery(int i) {
+    return (i >= 0 && i < nRecords) ? papszQueries[i] : NULL;
+}
+
+/***********************************************************************
+ * \brief Bytes of tuple data in the i-th recorded result
+ ***********************************************************************/
+int PostGISRasterReplayDBAccess::GetRecordedPayloadSize(int i) {
+    int nSize = 0;
+    int iTuple, iField;
+
+    if (i < 0 || i >= nRecords ||
+            PQresultStatus(papoResults[i]) != PGRES_TUPLES_OK)
+        return 0;
+
+    for (iTuple = 0; iTuple < PQntuples(papoResults[i]); iTuple++) {
+        for (iField = 0; iField < PQnfields(papoResults[i]); iField++)
+            nSize += PQgetlength(papoResults[i], iTuple, iField);
+    }
+
+    return nSize;
+}
+
+/***********************************************************************
+ * \brief Start replaying from the first record again
+ ***********************************************************************/
+void PostGISRasterReplayDBAccess::Rewind() {
+    nNextRecord = 0;
+}
+
+/***********************************************************************
+ * \brief Write a sized chunk of data: its length in a line, then the data
+ ***********************************************************************/
+static void WriteChunk(VSILFILE * fp, const char * pszData, int nLength) {
+    VSIFPrintfL(fp, "%d\n", nLength);
+    if (nLength > 0)
+        VSIFWriteL(pszData, 1, nLength, fp);
+    VSIFPrintfL(fp, "\n");
+}
+
+/***********************************************************************
+ * \brief Read a chunk written by WriteChunk. NULL for a null value or
+ * a read error (*pbError is set then). Free the result with CPLFree
+ ***********************************************************************/
+static char * ReadChunk(VSILFILE * fp, GBool * pbError) {
+    const char * pszLine = CPLReadLineL(fp);
+    char * pszData = NULL;
+    char szNewLine[1];
+    int nLength;
+
+    if (pszLine == NULL) {
+        *pbError = true;
+        return NULL;
+    }
+
+    nLength = atoi(pszLine);
+    if (nLength < 0)
+        return NULL;
+
+    pszData = (char *) VSIMalloc(nLength + 1);
+    if (pszData == NULL ||
+            (int) VSIFReadL(pszData, 1, nLength, fp) != nLength ||
+            VSIFReadL(szNewLine, 1, 1, fp) != 1) {
+        CPLFree(pszData);
+        *pbError = true;
+        return NULL;
+    }
+
+    pszData[nLength] = '\0';
+
+    return pszData;
+}
+
+/***********************************************************************
+ * \brief Save the records to a file, so they can be replayed later
+ * without a database server
+ ***********************************************************************/
+GBool PostGISRasterReplayDBAccess::Save(const char * pszFilename) {
+    VSILFILE * fp = VSIFOpenL(pszFilename, "wb");
+    PGresult * poResult = NULL;
+    int i, iTuple, iField;
+
+    if (fp == NULL) {
+        CPLError(CE_Failure, CPLE_OpenFailed, "Couldn't create %s",
+            pszFilename);
+        return false;
+    }
+
+    for (i = 0; i < nRecords; i++) {
+        poResult = papoResults[i];
+
+        WriteChunk(fp, papszQueries[i], strlen(papszQueries[i]));
+        VSIFPrintfL(fp, "%d %d %d\n", (int) PQresultStatus(poResult),
+            PQnfields(poResult), PQntuples(poResult));
+
+        for (iField = 0; iField < PQnfields(poResult); iField++) {
+            WriteChunk(fp, PQfname(poResult, iField),
+                strlen(PQfname(poResult, iField)));
+        }
+
+        for (iTuple = 0; iTuple < PQntuples(poResult); iTuple++) {
+            for (iField = 0; iField < PQnfields(poResult); iField++) {
+                if (PQgetisnull(poResult, iTuple, iField))
+                    VSIFPrintfL(fp, "-1\n");
+                else
+                    WriteChunk(fp, PQgetvalue(poResult, iTuple, iField),
+                        PQgetlength(poResult, iTuple, iField));
+            }
+        }
+    }
+
+    VSIFCloseL(fp);
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Load records saved with Save, appending them to the existing
+ * ones
+ ***********************************************************************/
+GBool PostGISRasterReplayDBAccess::Load(const char * pszFilename) {
+    VSILFILE * fp = VSIFOpenL(pszFilename, "rb");
+    PGresult * poResult = NULL;
+    PGresAttDesc * pasAttDesc = NULL;
+    char ** papszFieldNames = NULL;
+    char * pszQuery = NULL;
+    char * pszValue = NULL;
+    const char * pszLine = NULL;
+    GBool bError = false;
+    int nStatus, nFields, nTuples;
+    int iTuple, iField;
+
+    if (fp == NULL) {
+        CPLError(CE_Failure, CPLE_OpenFailed, "Couldn't open %s", pszFilename);
+        return false;
+    }
+
+    while (!bError) {
+        pszQuery = ReadChunk(fp, &bError);
+        if (pszQuery == NULL) {
+            /* End of file */
+            bError = false;
+            break;
+        }
+
+        pszLine = CPLReadLineL(fp);
+        if (pszLine == NULL ||
+                sscanf(pszLine, "%d %d %d", &nStatus, &nFields, &nTuples) != 3 ||
+                nFields < 0 || nTuples < 0) {
+            CPLFree(pszQuery);
+            bError = true;
+            break;
+        }
+
+        poResult = PQmakeEmptyPGresult(NULL, (ExecStatusType) nStatus);
+
+        pasAttDesc = (PGresAttDesc *) CPLCalloc(MAX(nFields, 1),
+            sizeof (PGresAttDesc));
+        for (iField = 0; iField < nFields && !bError; iField++) {
+            pszValue = ReadChunk(fp, &bError);
+            papszFieldNames = CSLAddString(papszFieldNames,
+                (pszValue != NULL) ? pszValue : "");
+            CPLFree(pszValue);
+        }
+
+        for (iField = 0; iField < nFields && !bError; iField++) {
+            pasAttDesc[iField].name = papszFieldNames[iField];
+            pasAttDesc[iField].typlen = -1;
+            pasAttDesc[iField].atttypmod = -1;
+        }
+
+        if (!bError && nFields > 0)
+            PQsetResultAttrs(poResult, nFields, pasAttDesc);
+
+        CPLFree(pasAttDesc);
+        CSLDestroy(papszFieldNames);
+        papszFieldNames = NULL;
+
+        for (iTuple = 0; iTuple < nTuples && !bError; iTuple++) {
+            for (iField = 0; iField < nFields && !bError; iField++) {
+                pszValue = ReadChunk(fp, &bError);
+                PQsetvalue(poResult, iTuple, iField, pszValue,
+                    (pszValue != NULL) ? (int) strlen(pszValue) : -1);
+                CPLFree(pszValue);
+            }
+        }
+
+        if (bError) {
+            PQclear(poResult);
+            CPLFree(pszQuery);
+            break;
+        }
+
+        AddRecord(pszQuery, poResult);
+        CPLFree(pszQuery);
+    }
+
+    VSIFCloseL(fp);
+
+    if (bError) {
+        CPLError(CE_Failure, CPLE_FileIO, "Error reading recorded queries "
+            "from %s", pszFilename);
+        return false;
+    }
+
+    return true;
+}
@@ -29,13 +29,24 @@
  ******************************************************************************/
 #include "postgisraster.h"
 #include "cpl_string.h"
+#include "cpl_multiproc.h"
 
 /************************
  * \brief Constructor
  ************************/
 PostGISRasterDriver::PostGISRasterDriver() {
     papoConnection = NULL;
+    papszConnectionKeys = NULL;
     nRefCount = 0;
+    hCatalogMutex = NULL;
+    papszCatalogKeys = NULL;
+    papapszCatalogs = NULL;
+    panCatalogTimes = NULL;
+    nCatalogs = 0;
+    hDescriptorMutex = NULL;
+    papszDescriptorKeys = NULL;
+    papoDescriptors = NULL;
+    nDescriptors = 0;
 }
 
 /************************
@@ -49,13 +60,32 @@ PostGISRasterDriver::~PostGISRasterDriver() {
          * Segmentation fault here. Tested CPLFree and delete. Same result
          */
         if (papoConnection[i]) {
-            PQfinish(papoConnection[i]);
+            PostGISRasterDBAccess::GetInstance()->Disconnect(papoConnection[i]);
         }
 
     }
 
     if (papoConnection)
         CPLFree(papoConnection);
+
+    CSLDestroy(papszConnectionKeys);
+
+    for (i = 0; i < nCatalogs; i++)
+        CSLDestroy(papapszCatalogs[i]);
+    CPLFree(papapszCatalogs);
+    CPLFree(panCatalogTimes);
+    CSLDestroy(papszCatalogKeys);
+
+    if (hCatalogMutex)
+        CPLDestroyMutex(hCatalogMutex);
+
+    for (i = 0; i < nDescriptors; i++)
+        delete papoDescriptors[i];
+    CPLFree(papoDescriptors);
+    CSLDestroy(papszDescriptorKeys);
+
+    if (hDescriptorMutex)
+        CPLDestroyMutex(hDescriptorMutex);
 }
 
 /***************************************************************************
@@ -79,6 +109,15 @@ PGconn* PostGISRasterDriver::GetConnection(const char* pszConnectionString,
         const char * pszPasswordIn) {
     int i = 0;
     PGconn * poConn = NULL;
+    PostGISRasterDBAccess * poAccess = PostGISRasterDBAccess::GetInstance();
+    CPLString osKey;
+
+    /**
+     * Connections are identified by the parameters used to open them, not
+     * by asking libpq, so the lookup works with any database access layer
+     **/
+    osKey.Printf("user=%s password=%s host=%s port=%s", pszUserIn,
+        pszPasswordIn, pszHostIn, pszPortIn);
 
     /**
      * Look for an existing connection in the list
@@ -87,10 +126,7 @@ PGconn* PostGISRasterDriver::GetConnection(const char* pszConnectionString,
         CPLDebug("PostGIS_Raster", "PostGISRasterDriver::GetConnection(): "
             "User: %s\nPassword: %s\nHost: %s\nPort: %s", pszUserIn,
             pszPasswordIn, pszHostIn, pszPortIn);
-        if (EQUAL(pszUserIn, PQuser(papoConnection[i])) &&
-                EQUAL(pszPasswordIn, PQpass(papoConnection[i])) &&
-                EQUAL(pszHostIn, PQhost(papoConnection[i])) &&
-                EQUAL(pszPortIn, PQport(papoConnection[i]))) {
+        if (EQUAL(osKey.c_str(), papszConnectionKeys[i])) {
             return papoConnection[i];
         }
 
@@ -99,12 +135,11 @@ PGconn* PostGISRasterDriver::GetConnection(const char* pszConnectionString,
     /**
      * There's no existing connection. Create a new one.
      **/
-    poConn = PQconnectdb(pszConnectionString);
-    if (poConn == NULL ||
-            PQstatus(poConn) == CONNECTION_BAD) {
+    poConn = poAccess->Connect(pszConnectionString);
+    if (!poAccess->IsConnected(poConn)) {
         CPLError(CE_Failure, CPLE_AppDefined, "PGconnectcb failed: %s\n",
-                PQerrorMessage(poConn));
-        PQfinish(poConn);
+                poAccess->GetErrorMessage(poConn));
+        poAccess->Disconnect(poConn);
         return NULL;
     }
 
@@ -116,16 +151,276 @@ PGconn* PostGISRasterDriver::GetConnection(const char* pszConnectionString,
             sizeof (PGconn*) * nRefCount);
     if (NULL != papoConnection) {
         papoConnection[nRefCount - 1] = poConn;
+        papszConnectionKeys = CSLAddString(papszConnectionKeys, osKey.c_str());
         return poConn;
     }
     else {
         CPLError(CE_Failure, CPLE_AppDefined, "Reallocation for new connection\
 						failed.\n");
-        PQfinish(poConn);
+        poAccess->Disconnect(poConn);
+        return NULL;
+    }
+
+}
+
+/***************************************************************************
+ * \brief Position of a key in a list of cache keys, -1 if not found. The
+ * keys are compared case-sensitively: database names, passwords and the
+ * literals of where clauses are
+ ***************************************************************************/
+static int FindCacheKey(char ** papszKeys, const char * pszKey) {
+    int i;
+
+    for (i = 0; papszKeys != NULL && papszKeys[i] != NULL; i++)
+        if (strcmp(papszKeys[i], pszKey) == 0)
+            return i;
+
+    return -1;
+}
+
+/***************************************************************************
+ * \brief Get the raster tables of a database, listed when browsing it, if
+ * they were listed less than POSTGIS_RASTER_CATALOG_CACHE_TTL seconds ago
+ * (0 disables the cache).
+ *
+ * The database is identified by its connection string. The list has the
+ * schema, table and column of each raster column, one after the other. The
+ * returned copy must be freed with CSLDestroy. NULL if not cached.
+ ***************************************************************************/
+char** PostGISRasterDriver::GetCatalog(const char * pszConnectionString) {
+    int nTTL = atoi(CPLGetConfigOption("POSTGIS_RASTER_CATALOG_CACHE_TTL",
+        DEFAULT_CATALOG_CACHE_TTL));
+    int nPos;
+
+    CPLMutexHolderD(&hCatalogMutex);
+
+    nPos = FindCacheKey(papszCatalogKeys, pszConnectionString);
+    if (nTTL <= 0 || nPos == -1 || 
+        difftime(time(NULL), panCatalogTimes[nPos]) >= nTTL)
         return NULL;
+
+    return CSLDuplicate(papapszCatalogs[nPos]);
+}
+
+/***************************************************************************
+ * \brief Store (a copy of) the raster tables of a database, replacing the
+ * ones stored before.
+ *
+ * If the tables of CATALOG_CACHE_SIZE databases are stored, the oldest
+ * ones are replaced. See GetCatalog().
+ ***************************************************************************/
+void PostGISRasterDriver::SetCatalog(const char * pszConnectionString, 
+    char ** papszCatalog) {
+    int nPos;
+    int i;
+
+    CPLMutexHolderD(&hCatalogMutex);
+
+    nPos = FindCacheKey(papszCatalogKeys, pszConnectionString);
+    if (nPos == -1 && nCatalogs >= CATALOG_CACHE_SIZE) {
+        nPos = 0;
+        for (i = 1; i < nCatalogs; i++)
+            if (panCatalogTimes[i] < panCatalogTimes[nPos])
+                nPos = i;
+
+        CPLFree(papszCatalogKeys[nPos]);
+        papszCatalogKeys[nPos] = CPLStrdup(pszConnectionString);
+    }
+    else if (nPos == -1) {
+        papapszCatalogs = (char ***) CPLRealloc(papapszCatalogs,
+            sizeof (char **) * (nCatalogs + 1));
+        panCatalogTimes = (time_t *) CPLRealloc(panCatalogTimes,
+            sizeof (time_t) * (nCatalogs + 1));
+        papszCatalogKeys = CSLAddString(papszCatalogKeys, pszConnectionString);
+        papapszCatalogs[nCatalogs] = NULL;
+        nPos = nCatalogs++;
     }
 
+    CSLDestroy(papapszCatalogs[nPos]);
+    papapszCatalogs[nPos] = CSLDuplicate(papszCatalog);
+    panCatalogTimes[nPos] = time(NULL);
 }
 
+/***************************************************************************
+ * \brief Forget the raster tables stored, after creating or dropping a
+ * table. The ones of all the databases are forgotten: a database may be
+ * reached by several connection strings.
+ ***************************************************************************/
+void PostGISRasterDriver::InvalidateCatalogs() {
+    int i;
+
+    CPLMutexHolderD(&hCatalogMutex);
+
+    for (i = 0; i < nCatalogs; i++)
+        CSLDestroy(papapszCatalogs[i]);
+    CPLFree(papapszCatalogs);
+    CPLFree(panCatalogTimes);
+    CSLDestroy(papszCatalogKeys);
 
+    papapszCatalogs = NULL;
+    panCatalogTimes = NULL;
+    papszCatalogKeys = NULL;
+    nCatalogs = 0;
+}
+
+/***************************************************************************
+ * \brief Get the descriptor of a coverage, stored when it was opened less
+ * than POSTGIS_RASTER_DESCRIPTOR_CACHE_TTL seconds ago (0 disables the
+ * cache).
+ *
+ * The coverage is identified by a key built from the connection string,
+ * the raster (schema, table, column and where) and the open options. The
+ * returned copy must be deleted. NULL if not stored.
+ ***************************************************************************/
+PostGISRasterDescriptor* PostGISRasterDriver::GetDescriptor(const char * pszKey) {
+    int nTTL = atoi(CPLGetConfigOption("POSTGIS_RASTER_DESCRIPTOR_CACHE_TTL",
+        DEFAULT_DESCRIPTOR_CACHE_TTL));
+    int nPos;
+
+    CPLMutexHolderD(&hDescriptorMutex);
+
+    nPos = FindCacheKey(papszDescriptorKeys, pszKey);
+    if (nTTL <= 0 || nPos == -1 || 
+        difftime(time(NULL), papoDescriptors[nPos]->nTime) >= nTTL)
+        return NULL;
 
+    return papoDescriptors[nPos]->Clone();
+}
+
+/***************************************************************************
+ * \brief Store the descriptor of a coverage, replacing the one stored
+ * before. The driver takes the ownership of the descriptor.
+ *
+ * If DESCRIPTOR_CACHE_SIZE descriptors are stored, the oldest one is
+ * replaced. See GetDescriptor().
+ ***************************************************************************/
+void PostGISRasterDriver::SetDescriptor(const char * pszKey, 
+    PostGISRasterDescriptor * poDescriptor) {
+    int nPos;
+    int i;
+
+    CPLMutexHolderD(&hDescriptorMutex);
+
+    poDescriptor->nTime = time(NULL);
+
+    nPos = FindCacheKey(papszDescriptorKeys, pszKey);
+    if (nPos == -1 && nDescriptors >= DESCRIPTOR_CACHE_SIZE) {
+        nPos = 0;
+        for (i = 1; i < nDescriptors; i++)
+            if (papoDescriptors[i]->nTime < papoDescriptors[nPos]->nTime)
+                nPos = i;
+
+        CPLFree(papszDescriptorKeys[nPos]);
+        papszDescriptorKeys[nPos] = CPLStrdup(pszKey);
+    }
+    else if (nPos == -1) {
+        papoDescriptors = (PostGISRasterDescriptor **) CPLRealloc(
+            papoDescriptors, sizeof (PostGISRasterDescriptor *) * 
+            (nDescriptors + 1));
+        papszDescriptorKeys = CSLAddString(papszDescriptorKeys, pszKey);
+        papoDescriptors[nDescriptors] = NULL;
+        nPos = nDescriptors++;
+    }
+
+    delete papoDescriptors[nPos];
+    papoDescriptors[nPos] = poDescriptor;
+}
+
+/***************************************************************************
+ * \brief Forget the descriptors of a table, after writing it (the
+ * other processes' writes are only seen when the descriptors expire).
+ ***************************************************************************/
+void PostGISRasterDriver::InvalidateDescriptors(const char * pszSchema,
+    const char * pszTable) {
+    int i;
+
+    CPLMutexHolderD(&hDescriptorMutex);
+
+    for (i = nDescriptors - 1; i >= 0; i--) {
+        if (!EQUAL(papoDescriptors[i]->pszSchema, pszSchema) ||
+            !EQUAL(papoDescriptors[i]->pszTable, pszTable))
+            continue;
+
+        delete papoDescriptors[i];
+        papszDescriptorKeys = CSLRemoveStrings(papszDescriptorKeys, i, 1, NULL);
+        memmove(papoDescriptors + i, papoDescriptors + i + 1, 
+            sizeof (PostGISRasterDescriptor *) * (nDescriptors - i - 1));
+        nDescriptors--;
+    }
+}
+
+/************************
+ * \brief Constructor
+ ************************/
+PostGISRasterDescriptor::PostGISRasterDescriptor() {
+    int i;
+
+    pszSchema = NULL;
+    pszTable = NULL;
+    nTime = 0;
+    for (i = 0; i < 6; i++)
+        adfGeoTransform[i] = 0.0;
+    xmin = ymin = xmax = ymax = 0.0;
+    nRasterXSize = 0;
+    nRasterYSize = 0;
+    nSrid = -1;
+    nTiles = 0;
+    bRegularBlocking = false;
+    bRegisteredInRasterColumns = false;
+    bApproxOpen = false;
+    nBlockXSize = 0;
+    nBlockYSize = 0;
+    nBands = 0;
+    pasBands = NULL;
+    nOverviewCount = 0;
+    panOverviewFactors = NULL;
+    nTileSrids = 0;
+    panTileSrids = NULL;
+}
+
+/************************
+ * \brief Destructor
+ ************************/
+PostGISRasterDescriptor::~PostGISRasterDescriptor() {
+    CPLFree(pszSchema);
+    CPLFree(pszTable);
+    CPLFree(pasBands);
+    CPLFree(panOverviewFactors);
+    CPLFree(panTileSrids);
+}
+
+/************************
+ * \brief Deep copy
+ ************************/
+PostGISRasterDescriptor* PostGISRasterDescriptor::Clone() {
+    PostGISRasterDescriptor * poClone = new PostGISRasterDescriptor();
+
+    *poClone = *this;
+
+    poClone->pszSchema = CPLStrdup(pszSchema);
+    poClone->pszTable = CPLStrdup(pszTable);
+
+    poClone->pasBands = NULL;
+    if (nBands > 0) {
+        poClone->pasBands = (PostGISRasterBandSpec *) CPLMalloc(
+            sizeof (PostGISRasterBandSpec) * nBands);
+        memcpy(poClone->pasBands, pasBands, 
+            sizeof (PostGISRasterBandSpec) * nBands);
+    }
+
+    poClone->panOverviewFactors = NULL;
+    if (nOverviewCount > 0) {
+        poClone->panOverviewFactors = (int *) CPLMalloc(
+            sizeof (int) * nOverviewCount);
+        memcpy(poClone->panOverviewFactors, panOverviewFactors, 
+            sizeof (int) * nOverviewCount);
+    }
+
+    poClone->panTileSrids = NULL;
+    if (nTileSrids > 0) {
+        poClone->panTileSrids = (int *) CPLMalloc(sizeof (int) * nTileSrids);
+        memcpy(poClone->panTileSrids, panTileSrids, sizeof (int) * nTileSrids);
+    }
+
+    return poClone;
+}
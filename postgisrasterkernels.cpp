@@ -0,0 +1,538 @@
+/******************************************************************************
+ * File :    postgisrasterkernels.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Copy and resampling kernels for the read requests of PostGIS
+ *           Raster bands
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+#include "cpl_string.h"
+#include <limits>
+
+/**
+ * Copy kernels: tile pixels to buffer pixels, for each (tile data type,
+ * buffer data type) pair, with a contiguous and a strided variant. They
+ * convert like GDALCopyWords (round to nearest and clamp into integer
+ * types), and keep the destination of nodata pixels with a select instead
+ * of a branch, so the contiguous loops can be vectorized.
+ **/
+
+/* Conversion between pixel types */
+template<class S, class D>
+struct PostGISRasterConvert
+{
+    static inline D Convert(S tValue)
+    {
+        double dfValue = (double) tValue;
+
+        if (!std::numeric_limits<D>::is_integer)
+            return (D) dfValue;
+
+        if (!std::numeric_limits<S>::is_integer)
+            dfValue = floor(dfValue + 0.5);
+
+        dfValue = MAX(dfValue, (double) std::numeric_limits<D>::min());
+        dfValue = MIN(dfValue, (double) std::numeric_limits<D>::max());
+
+        return (D) dfValue;
+    }
+};
+
+template<class T>
+struct PostGISRasterConvert<T, T>
+{
+    static inline T Convert(T tValue)
+    {
+        return tValue;
+    }
+};
+
+/* Is the nodata value representable in the tile type? */
+template<class S>
+static GBool GetNoDataValue(double dfNoData, S * ptNoData)
+{
+    if (std::numeric_limits<S>::is_integer &&
+            (dfNoData < (double) std::numeric_limits<S>::min() ||
+             dfNoData > (double) std::numeric_limits<S>::max()))
+        return false;
+
+    *ptNoData = (S) dfNoData;
+
+    return (double) *ptNoData == dfNoData;
+}
+
+/***********************************************************************
+ * \brief Copy nCount tile pixels into a buffer line.
+ * Parameters:
+ *  - const GByte *: the tile line
+ *  - const int *: tile column of each buffer pixel, or NULL if they're
+ *    the nCount first ones (same resolution)
+ *  - int: number of pixels
+ *  - GByte *, int: the first buffer pixel, and the buffer pixel space
+ *  - GBool, double: nodata value of the tile
+ ***********************************************************************/
+template<class S, class D, int bContiguous>
+static void CopyKernel(const GByte * pabySrc, const int * panSrcIndex,
+    int nCount, GByte * pabyDst, int nPixelSpace, GBool bHasNoData,
+    double dfNoData)
+{
+    const S * ptSrc = (const S *) pabySrc;
+    S tNoData = 0;
+    int i;
+
+    bHasNoData = bHasNoData && GetNoDataValue(dfNoData, &tNoData);
+
+    if (bContiguous) {
+        D * ptDst = (D *) pabyDst;
+
+        if (panSrcIndex == NULL && !bHasNoData) {
+            for(i = 0; i < nCount; i++)
+                ptDst[i] = PostGISRasterConvert<S, D>::Convert(ptSrc[i]);
+        }
+        else if (panSrcIndex == NULL) {
+            for(i = 0; i < nCount; i++)
+                ptDst[i] = (ptSrc[i] == tNoData) ? ptDst[i] :
+                    PostGISRasterConvert<S, D>::Convert(ptSrc[i]);
+        }
+        else {
+            for(i = 0; i < nCount; i++) {
+                S tValue = ptSrc[panSrcIndex[i]];
+
+                ptDst[i] = (bHasNoData && tValue == tNoData) ? ptDst[i] :
+                    PostGISRasterConvert<S, D>::Convert(tValue);
+            }
+        }
+    }
+    else {
+        for(i = 0; i < nCount; i++) {
+            S tValue = ptSrc[panSrcIndex ? panSrcIndex[i] : i];
+            D tOut = PostGISRasterConvert<S, D>::Convert(tValue);
+
+            if (!bHasNoData || tValue != tNoData)
+                memcpy(pabyDst + (GIntBig) i * nPixelSpace, &tOut, sizeof (D));
+        }
+    }
+}
+
+/* One row of the kernel table: all the buffer types, for one tile type */
+#define COPY_KERNELS(S, bContiguous) \
+    { NULL, \
+      CopyKernel<S, GByte, bContiguous>, \
+      CopyKernel<S, GUInt16, bContiguous>, \
+      CopyKernel<S, GInt16, bContiguous>, \
+      CopyKernel<S, GUInt32, bContiguous>, \
+      CopyKernel<S, GInt32, bContiguous>, \
+      CopyKernel<S, float, bContiguous>, \
+      CopyKernel<S, double, bContiguous> }
+
+#define COPY_KERNEL_TABLE(bContiguous) \
+    { { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL }, \
+      COPY_KERNELS(GByte, bContiguous), \
+      COPY_KERNELS(GUInt16, bContiguous), \
+      COPY_KERNELS(GInt16, bContiguous), \
+      COPY_KERNELS(GUInt32, bContiguous), \
+      COPY_KERNELS(GInt32, bContiguous), \
+      COPY_KERNELS(float, bContiguous), \
+      COPY_KERNELS(double, bContiguous) }
+
+/* Indexed by [contiguous][tile type][buffer type], GDT_Unknown to GDT_Float64 */
+static const PostGISRasterCopyFunc apfnCopyKernels[2][GDT_Float64 + 1][GDT_Float64 + 1] = {
+    COPY_KERNEL_TABLE(0),
+    COPY_KERNEL_TABLE(1)
+};
+
+/***********************************************************************
+ * \brief Get the copy kernel for a tile type and buffer type. bContiguous
+ * is only allowed if the buffer pixels are packed and aligned for their
+ * type. Returns NULL for types with no kernel (complex types), which need
+ * GDALCopyWords.
+ ***********************************************************************/
+PostGISRasterCopyFunc PostGISRasterGetCopyKernel(GDALDataType eSrcType,
+    GDALDataType eDstType, GBool bContiguous)
+{
+    if (eSrcType <= GDT_Unknown || eSrcType > GDT_Float64 ||
+            eDstType <= GDT_Unknown || eDstType > GDT_Float64)
+        return NULL;
+
+    return apfnCopyKernels[bContiguous ? 1 : 0][eSrcType][eDstType];
+}
+
+/**
+ * The tiles are placed in window coordinates (nDstXOff, nDstYOff, nDstXSize,
+ * nDstYSize, as for compositing), and each buffer pixel samples the window
+ * around its center. The kernels are scaled to the largest of the tile pixel
+ * size and the buffer pixel size, so they act as a low pass filter when
+ * downsampling:
+ *
+ *  - NEAREST: the tile pixel under the buffer pixel center. Later tiles
+ *    replace earlier ones, as when compositing.
+ *  - AVERAGE: box filter over the buffer pixel footprint.
+ *  - BILINEAR: triangle filter.
+ *  - CUBIC: Catmull-Rom (a = -0.5) filter.
+ **/
+
+/***********************************************************************
+ * \brief Kernel value at u (in kernel units), and kernel support
+ ***********************************************************************/
+static double KernelWeight(PostGISRasterResampling eResampling, double u)
+{
+    double dfAbs = fabs(u);
+
+    switch (eResampling) {
+        case RESAMPLING_BILINEAR:
+            return (dfAbs < 1.0) ? 1.0 - dfAbs : 0.0;
+
+        case RESAMPLING_CUBIC:
+            if (dfAbs < 1.0)
+                return (1.5 * dfAbs - 2.5) * dfAbs * dfAbs + 1.0;
+            if (dfAbs < 2.0)
+                return ((-0.5 * dfAbs + 2.5) * dfAbs - 4.0) * dfAbs + 2.0;
+            return 0.0;
+
+        default:
+            return (u > -0.5 && u <= 0.5) ? 1.0 : 0.0;
+    }
+}
+
+static double KernelSupport(PostGISRasterResampling eResampling)
+{
+    switch (eResampling) {
+        case RESAMPLING_BILINEAR:
+            return 1.0;
+        case RESAMPLING_CUBIC:
+            return 2.0;
+        default:
+            return 0.5;
+    }
+}
+
+/***********************************************************************
+ * \brief Accumulate the pixels of a tile into the buffer sums.
+ *
+ * The inner loop has no data dependent branch, so it can be vectorized
+ * by the compiler.
+ ***********************************************************************/
+template<class T>
+static void AccumulateTile(const T * pTile, int nTileXSize, GBool bHasNoData,
+    double dfNoData, const PostGISRasterTaps * psX,
+    const PostGISRasterTaps * psY, double * padfSum, double * padfWeight,
+    int nBufXSize, GBool bReplace)
+{
+    double dfCheckNoData = bHasNoData ? 1.0 : 0.0;
+    int iBufX, iBufY, iTapX, iTapY;
+
+    for(iBufY = psY->nBufStart; iBufY < psY->nBufEnd; iBufY++) {
+        int iY = iBufY - psY->nBufStart;
+        const double * padfWY = psY->padfWeights + iY * psY->nMaxTaps;
+
+        for(iBufX = psX->nBufStart; iBufX < psX->nBufEnd; iBufX++) {
+            int iX = iBufX - psX->nBufStart;
+            const double * padfWX = psX->padfWeights + iX * psX->nMaxTaps;
+            int nXCount = psX->panCount[iX];
+            double dfSum = 0.0, dfWeight = 0.0;
+            GIntBig iOffset = (GIntBig) iBufY * nBufXSize + iBufX;
+
+            for(iTapY = 0; iTapY < psY->panCount[iY]; iTapY++) {
+                const T * pLine = pTile + 
+                    (GIntBig) (psY->panFirst[iY] + iTapY) * nTileXSize +
+                    psX->panFirst[iX];
+                double dfLineSum = 0.0, dfLineWeight = 0.0;
+
+                for(iTapX = 0; iTapX < nXCount; iTapX++) {
+                    double dfValue = (double) pLine[iTapX];
+                    double dfValid = 1.0 - dfCheckNoData *
+                        (double) (dfValue == dfNoData);
+                    double dfW = padfWX[iTapX] * dfValid;
+
+                    dfLineSum += dfValue * dfW;
+                    dfLineWeight += dfW;
+                }
+
+                dfSum += padfWY[iTapY] * dfLineSum;
+                dfWeight += padfWY[iTapY] * dfLineWeight;
+            }
+
+            if (bReplace) {
+                if (dfWeight != 0.0) {
+                    padfSum[iOffset] = dfSum;
+                    padfWeight[iOffset] = dfWeight;
+                }
+            }
+            else {
+                padfSum[iOffset] += dfSum;
+                padfWeight[iOffset] += dfWeight;
+            }
+        }
+    }
+}
+
+/************************
+ * \brief Constructor
+ ************************/
+PostGISRasterResampler::PostGISRasterResampler()
+{
+    eResampling = RESAMPLING_NEAREST;
+    nXSize = nYSize = nBufXSize = nBufYSize = 0;
+    padfSum = padfWeight = padfRow = NULL;
+    memset(&sXTaps, 0, sizeof (sXTaps));
+    memset(&sYTaps, 0, sizeof (sYTaps));
+}
+
+/************************
+ * \brief Destructor
+ ************************/
+PostGISRasterResampler::~PostGISRasterResampler()
+{
+    CPLFree(sXTaps.panFirst);
+    CPLFree(sXTaps.panCount);
+    CPLFree(sXTaps.padfWeights);
+    CPLFree(sYTaps.panFirst);
+    CPLFree(sYTaps.panCount);
+    CPLFree(sYTaps.padfWeights);
+}
+
+/***********************************************************************
+ * \brief Get the resampling kernel, from the POSTGIS_RASTER_RESAMPLING
+ * configuration option (NEAREST, AVERAGE, BILINEAR or CUBIC).
+ ***********************************************************************/
+PostGISRasterResampling PostGISRasterResampler::GetResampling()
+{
+    const char * pszResampling = CPLGetConfigOption(
+        "POSTGIS_RASTER_RESAMPLING", DEFAULT_RESAMPLING);
+
+    if (EQUAL(pszResampling, "AVERAGE"))
+        return RESAMPLING_AVERAGE;
+    else if (EQUAL(pszResampling, "BILINEAR"))
+        return RESAMPLING_BILINEAR;
+    else if (EQUAL(pszResampling, "CUBIC"))
+        return RESAMPLING_CUBIC;
+    else if (!EQUAL(pszResampling, "NEAREST"))
+        CPLDebug("PostGIS_Raster", "PostGISRasterResampler::GetResampling(): "
+            "Unknown resampling %s, using NEAREST", pszResampling);
+
+    return RESAMPLING_NEAREST;
+}
+
+/***********************************************************************
+ * \brief Set up the resampling of a nXSize x nYSize window into a
+ * nBufXSize x nBufYSize buffer. The sums are taken from the arena.
+ ***********************************************************************/
+GBool PostGISRasterResampler::Init(PostGISRasterArena * poArena,
+    PostGISRasterResampling eResamplingIn, int nXSizeIn, int nYSizeIn,
+    int nBufXSizeIn, int nBufYSizeIn)
+{
+    size_t nPixels = (size_t) nBufXSizeIn * nBufYSizeIn;
+
+    eResampling = eResamplingIn;
+    nXSize = nXSizeIn;
+    nYSize = nYSizeIn;
+    nBufXSize = nBufXSizeIn;
+    nBufYSize = nBufYSizeIn;
+
+    padfSum = (double *) poArena->Alloc(nPixels * sizeof (double));
+    padfWeight = (double *) poArena->Alloc(nPixels * sizeof (double));
+    padfRow = (double *) poArena->Alloc(nBufXSize * sizeof (double));
+
+    if (padfSum == NULL || padfWeight == NULL || padfRow == NULL)
+        return false;
+
+    memset(padfSum, 0, nPixels * sizeof (double));
+    memset(padfWeight, 0, nPixels * sizeof (double));
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Compute the taps of the buffer pixels a tile contributes to,
+ * along one axis.
+ * Parameters:
+ *  - PostGISRasterTaps *: the taps to fill
+ *  - int, int: tile offset and size in the window, in window pixels
+ *  - int: tile size, in tile pixels
+ *  - int, int: window and buffer size
+ * Returns false on memory error
+ ***********************************************************************/
+GBool PostGISRasterResampler::ComputeTaps(PostGISRasterTaps * psTaps,
+    int nDstOff, int nDstSize, int nTileSize, int nWinSize, int nBufSize)
+{
+    double dfTileScale = (double) nDstSize / nTileSize;
+    double dfBufScale = (double) nWinSize / nBufSize;
+    double dfKernelScale = (eResampling == RESAMPLING_NEAREST) ?
+        dfTileScale : MAX(dfTileScale, dfBufScale);
+    double dfRadius = KernelSupport(eResampling) * dfKernelScale;
+    int nCount, iBuf, iTap;
+
+    psTaps->nBufStart = MAX(0, 
+        (int) floor((nDstOff - dfRadius) / dfBufScale - 0.5));
+    psTaps->nBufEnd = MIN(nBufSize,
+        (int) ceil((nDstOff + nDstSize + dfRadius) / dfBufScale + 0.5));
+    psTaps->nMaxTaps = (int) ceil(2.0 * dfRadius / dfTileScale) + 2;
+
+    nCount = psTaps->nBufEnd - psTaps->nBufStart;
+    if (nCount <= 0)
+        return true;
+
+    if (nCount > psTaps->nCapacity) {
+        int * panFirst = (int *) VSIRealloc(psTaps->panFirst,
+            nCount * sizeof (int));
+        int * panCount;
+
+        if (panFirst == NULL)
+            return false;
+        psTaps->panFirst = panFirst;
+
+        panCount = (int *) VSIRealloc(psTaps->panCount,
+            nCount * sizeof (int));
+        if (panCount == NULL)
+            return false;
+        psTaps->panCount = panCount;
+
+        psTaps->nCapacity = nCount;
+    }
+
+    if (nCount * psTaps->nMaxTaps > psTaps->nWeightCapacity) {
+        double * padfWeights = (double *) VSIRealloc(psTaps->padfWeights,
+            (size_t) nCount * psTaps->nMaxTaps * sizeof (double));
+
+        if (padfWeights == NULL)
+            return false;
+
+        psTaps->padfWeights = padfWeights;
+        psTaps->nWeightCapacity = nCount * psTaps->nMaxTaps;
+    }
+
+    for(iBuf = 0; iBuf < nCount; iBuf++) {
+        double dfCenter = (psTaps->nBufStart + iBuf + 0.5) * dfBufScale;
+        int nFirst = MAX(0, (int) floor((dfCenter - dfRadius - nDstOff) / 
+            dfTileScale - 0.5));
+        int nLast = MIN(nTileSize - 1, (int) ceil((dfCenter + dfRadius - 
+            nDstOff) / dfTileScale - 0.5));
+        double * padfWeights = psTaps->padfWeights + iBuf * psTaps->nMaxTaps;
+
+        psTaps->panFirst[iBuf] = nFirst;
+        psTaps->panCount[iBuf] = MAX(0, MIN(psTaps->nMaxTaps, nLast - nFirst + 1));
+
+        for(iTap = 0; iTap < psTaps->panCount[iBuf]; iTap++) {
+            double dfTapCenter = nDstOff + (nFirst + iTap + 0.5) * dfTileScale;
+
+            padfWeights[iTap] = KernelWeight(eResampling,
+                (dfTapCenter - dfCenter) / dfKernelScale);
+        }
+    }
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Accumulate a decoded tile, placed in the window as for
+ * compositing.
+ ***********************************************************************/
+void PostGISRasterResampler::AddTile(const GByte * pabyTile,
+    GDALDataType eTileType, int nTileXSize, int nTileYSize, GBool bHasNoData,
+    double dfNoData, int nDstXOff, int nDstYOff, int nDstXSize, int nDstYSize)
+{
+    GBool bReplace = (eResampling == RESAMPLING_NEAREST);
+
+    if (nDstXSize <= 0 || nDstYSize <= 0 || nTileXSize <= 0 || nTileYSize <= 0)
+        return;
+
+    if (!ComputeTaps(&sXTaps, nDstXOff, nDstXSize, nTileXSize, nXSize,
+            nBufXSize) ||
+        !ComputeTaps(&sYTaps, nDstYOff, nDstYSize, nTileYSize, nYSize,
+            nBufYSize)) {
+        CPLError(CE_Warning, CPLE_OutOfMemory, "Memory error while "
+            "resampling a tile, skipping. The result image may contain gaps");
+        return;
+    }
+
+    if (sXTaps.nBufStart >= sXTaps.nBufEnd || sYTaps.nBufStart >= sYTaps.nBufEnd)
+        return;
+
+    switch (eTileType) {
+        case GDT_Byte:
+            AccumulateTile((const GByte *) pabyTile, nTileXSize, bHasNoData,
+                dfNoData, &sXTaps, &sYTaps, padfSum, padfWeight, nBufXSize,
+                bReplace);
+            break;
+        case GDT_Int16:
+            AccumulateTile((const GInt16 *) pabyTile, nTileXSize, bHasNoData,
+                dfNoData, &sXTaps, &sYTaps, padfSum, padfWeight, nBufXSize,
+                bReplace);
+            break;
+        case GDT_UInt16:
+            AccumulateTile((const GUInt16 *) pabyTile, nTileXSize, bHasNoData,
+                dfNoData, &sXTaps, &sYTaps, padfSum, padfWeight, nBufXSize,
+                bReplace);
+            break;
+        case GDT_Int32:
+            AccumulateTile((const GInt32 *) pabyTile, nTileXSize, bHasNoData,
+                dfNoData, &sXTaps, &sYTaps, padfSum, padfWeight, nBufXSize,
+                bReplace);
+            break;
+        case GDT_UInt32:
+            AccumulateTile((const GUInt32 *) pabyTile, nTileXSize, bHasNoData,
+                dfNoData, &sXTaps, &sYTaps, padfSum, padfWeight, nBufXSize,
+                bReplace);
+            break;
+        case GDT_Float32:
+            AccumulateTile((const float *) pabyTile, nTileXSize, bHasNoData,
+                dfNoData, &sXTaps, &sYTaps, padfSum, padfWeight, nBufXSize,
+                bReplace);
+            break;
+        case GDT_Float64:
+            AccumulateTile((const double *) pabyTile, nTileXSize, bHasNoData,
+                dfNoData, &sXTaps, &sYTaps, padfSum, padfWeight, nBufXSize,
+                bReplace);
+            break;
+        default:
+            break;
+    }
+}
+
+/***********************************************************************
+ * \brief Write the normalized sums into the buffer. Pixels no tile
+ * contributed to get dfFill.
+ ***********************************************************************/
+void PostGISRasterResampler::Finish(GByte * pabyBuffer, GDALDataType eBufType,
+    int nPixelSpace, int nLineSpace, double dfFill)
+{
+    int iX, iY;
+
+    for(iY = 0; iY < nBufYSize; iY++) {
+        const double * padfLineSum = padfSum + (GIntBig) iY * nBufXSize;
+        const double * padfLineWeight = padfWeight + (GIntBig) iY * nBufXSize;
+
+        for(iX = 0; iX < nBufXSize; iX++)
+            padfRow[iX] = (padfLineWeight[iX] != 0.0) ?
+                padfLineSum[iX] / padfLineWeight[iX] : dfFill;
+
+        GDALCopyWords(padfRow, GDT_Float64, sizeof (double),
+            pabyBuffer + (GIntBig) iY * nLineSpace, eBufType, nPixelSpace,
+            nBufXSize);
+    }
+}
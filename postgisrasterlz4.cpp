@@ -0,0 +1,246 @@
+/******************************************************************************
+ * File :    postgisrasterlz4.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  LZ4 block format codec, used by the tile cache
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+
+/**
+ * Minimal implementation of the LZ4 block format
+ * (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), so the
+ * driver doesn't need liblz4. The compressor is the greedy single-probe
+ * one, which is what makes LZ4 fast; the decompressor checks every length
+ * and offset against the buffers, so a corrupted block can't overflow.
+ *
+ * A block is a list of sequences:
+ *
+ *  token (1) | literal length (0-n) | literals | offset (2, LE) |
+ *  match length (0-n)
+ *
+ * The token has the literal length in the high nibble and the match length
+ * minus 4 in the low nibble; 15 means more length bytes follow, each one
+ * added up until a byte lower than 255. The last sequence only has
+ * literals.
+ **/
+#define LZ4_MIN_MATCH       4
+#define LZ4_HASH_LOG        12
+#define LZ4_LAST_LITERALS   5
+#define LZ4_MF_LIMIT        12
+#define LZ4_MAX_OFFSET      65535
+
+static GUInt32 Read32(const GByte * pabyData) {
+    GUInt32 nValue;
+
+    memcpy(&nValue, pabyData, sizeof (nValue));
+
+    return nValue;
+}
+
+static int HashSequence(GUInt32 nSequence) {
+    return (int) ((nSequence * 2654435761U) >> (32 - LZ4_HASH_LOG));
+}
+
+/* Write the extra bytes of a length, after the token nibble */
+static GByte * WriteLength(GByte * pabyOut, int nLength) {
+    nLength -= 15;
+    while (nLength >= 255) {
+        *pabyOut++ = 255;
+        nLength -= 255;
+    }
+    *pabyOut++ = (GByte) nLength;
+
+    return pabyOut;
+}
+
+/* Extra bytes of a length, after the token nibble (see WriteLength) */
+static int LengthSize(int nLength) {
+    return (nLength >= 15) ? (nLength - 15) / 255 + 1 : 0;
+}
+
+/* Space taken by a sequence: token, literals, offset and match length */
+static int SequenceSize(int nLiterals, int nMatch) {
+    return 1 + LengthSize(nLiterals) + nLiterals + 2 + LengthSize(nMatch);
+}
+
+/***********************************************************************
+ * \brief Compress a buffer into an LZ4 block.
+ * Returns the size of the block, or 0 if it doesn't fit in nDstCapacity
+ * bytes (the data doesn't compress enough).
+ ***********************************************************************/
+int PostGISRasterLZ4Compress(const GByte * pabySrc, int nSrcSize,
+    GByte * pabyDst, int nDstCapacity)
+{
+    int anHash[1 << LZ4_HASH_LOG];
+    const GByte * pabyIn = pabySrc;
+    const GByte * pabyAnchor = pabySrc;
+    const GByte * pabyEnd = pabySrc + nSrcSize;
+    GByte * pabyOut = pabyDst;
+    GByte * pabyOutEnd = pabyDst + nDstCapacity;
+    int i, nLiterals;
+
+    for(i = 0; i < (1 << LZ4_HASH_LOG); i++)
+        anHash[i] = -1;
+
+    if (nSrcSize >= LZ4_MF_LIMIT) {
+        const GByte * pabyMatchStartLimit = pabyEnd - LZ4_MF_LIMIT;
+        const GByte * pabyMatchEndLimit = pabyEnd - LZ4_LAST_LITERALS;
+
+        while (pabyIn <= pabyMatchStartLimit) {
+            GUInt32 nSequence = Read32(pabyIn);
+            int nHash = HashSequence(nSequence);
+            int nRef = anHash[nHash];
+            const GByte * pabyMatch;
+            const GByte * pabyMatchEnd;
+            int nMatch, nOffset;
+            GByte * pabyToken;
+
+            anHash[nHash] = (int) (pabyIn - pabySrc);
+
+            if (nRef < 0 || (pabyIn - pabySrc) - nRef > LZ4_MAX_OFFSET ||
+                    Read32(pabySrc + nRef) != nSequence) {
+                pabyIn++;
+                continue;
+            }
+
+            /* Extend the match */
+            pabyMatch = pabySrc + nRef;
+            pabyMatchEnd = pabyIn + LZ4_MIN_MATCH;
+            while (pabyMatchEnd < pabyMatchEndLimit &&
+                    *pabyMatchEnd == pabyMatch[pabyMatchEnd - pabyIn])
+                pabyMatchEnd++;
+
+            nLiterals = (int) (pabyIn - pabyAnchor);
+            nMatch = (int) (pabyMatchEnd - pabyIn) - LZ4_MIN_MATCH;
+            nOffset = (int) (pabyIn - pabyMatch);
+
+            if (SequenceSize(nLiterals, nMatch) > pabyOutEnd - pabyOut)
+                return 0;
+
+            pabyToken = pabyOut++;
+            *pabyToken = (GByte) ((MIN(nLiterals, 15) << 4) | MIN(nMatch, 15));
+            if (nLiterals >= 15)
+                pabyOut = WriteLength(pabyOut, nLiterals);
+            memcpy(pabyOut, pabyAnchor, nLiterals);
+            pabyOut += nLiterals;
+
+            *pabyOut++ = (GByte) (nOffset & 0xFF);
+            *pabyOut++ = (GByte) (nOffset >> 8);
+            if (nMatch >= 15)
+                pabyOut = WriteLength(pabyOut, nMatch);
+
+            pabyIn = pabyAnchor = pabyMatchEnd;
+        }
+    }
+
+    /* Last literals */
+    nLiterals = (int) (pabyEnd - pabyAnchor);
+    if (1 + LengthSize(nLiterals) + nLiterals > pabyOutEnd - pabyOut)
+        return 0;
+
+    *pabyOut++ = (GByte) (MIN(nLiterals, 15) << 4);
+    if (nLiterals >= 15)
+        pabyOut = WriteLength(pabyOut, nLiterals);
+    memcpy(pabyOut, pabyAnchor, nLiterals);
+    pabyOut += nLiterals;
+
+    return (int) (pabyOut - pabyDst);
+}
+
+/* Read the extra bytes of a length. Returns -1 past the end of the block */
+static int ReadLength(const GByte ** ppabyIn, const GByte * pabyEnd,
+    int nLength)
+{
+    GByte nByte;
+
+    do {
+        if (*ppabyIn >= pabyEnd || nLength > INT_MAX - 255)
+            return -1;
+        nByte = *(*ppabyIn)++;
+        nLength += nByte;
+    } while (nByte == 255);
+
+    return nLength;
+}
+
+/***********************************************************************
+ * \brief Decompress an LZ4 block into a buffer of nDstSize bytes.
+ * Returns the decompressed size, or -1 if the block is corrupted or
+ * doesn't fit.
+ ***********************************************************************/
+int PostGISRasterLZ4Decompress(const GByte * pabySrc, int nSrcSize,
+    GByte * pabyDst, int nDstSize)
+{
+    const GByte * pabyIn = pabySrc;
+    const GByte * pabyEnd = pabySrc + nSrcSize;
+    GByte * pabyOut = pabyDst;
+    GByte * pabyOutEnd = pabyDst + nDstSize;
+
+    while (pabyIn < pabyEnd) {
+        GByte nToken = *pabyIn++;
+        int nLiterals = nToken >> 4;
+        int nMatch = nToken & 0x0F;
+        int nOffset, i;
+
+        if (nLiterals == 15 && (nLiterals = ReadLength(&pabyIn, pabyEnd, 
+                nLiterals)) < 0)
+            return -1;
+
+        if (nLiterals > pabyEnd - pabyIn || nLiterals > pabyOutEnd - pabyOut)
+            return -1;
+
+        memcpy(pabyOut, pabyIn, nLiterals);
+        pabyIn += nLiterals;
+        pabyOut += nLiterals;
+
+        /* Last sequence */
+        if (pabyIn == pabyEnd)
+            break;
+
+        if (pabyEnd - pabyIn < 2)
+            return -1;
+
+        nOffset = pabyIn[0] | (pabyIn[1] << 8);
+        pabyIn += 2;
+
+        if (nOffset == 0 || nOffset > pabyOut - pabyDst)
+            return -1;
+
+        if (nMatch == 15 && (nMatch = ReadLength(&pabyIn, pabyEnd, nMatch)) < 0)
+            return -1;
+
+        nMatch += LZ4_MIN_MATCH;
+        if (nMatch > pabyOutEnd - pabyOut)
+            return -1;
+
+        /* The match may overlap the output, copy byte by byte */
+        for(i = 0; i < nMatch; i++)
+            pabyOut[i] = pabyOut[i - nOffset];
+        pabyOut += nMatch;
+    }
+
+    return (int) (pabyOut - pabyDst);
+}
@@ -35,9 +35,6 @@
 #include "gdal.h"
 #include <string>
 #include "cpl_string.h"
-#include "gdal_vrt.h"
-#include "vrtdataset.h"
-#include "memdataset.h"
 
 
 /**
@@ -109,42 +106,32 @@ PostGISRasterRasterBand::PostGISRasterRasterBand(PostGISRasterDataset *poDS,
     nOverviewFactor = nFactor;
 
     /**********************************************************
-     * Check overviews. Query RASTER_OVERVIEWS table for
-     * existing overviews, only in case we are on level 0
+     * Check overviews, only in case we are on level 0. They're
+     * listed in RASTER_OVERVIEWS, fetched by the dataset once
+     * for all the bands (or taken from its descriptor)
      * TODO: can we do this without querying RASTER_OVERVIEWS?
      * How do we know the number of overviews? Is an inphinite
      * loop...
      **********************************************************/
     if (nOverviewFactor == 0) {    
-
-        CPLString osCommand;
-        PGresult * poResult = NULL;
         int i = 0;
-        int nFetchOvFactor = 0;
-        char * pszOvSchema = NULL;
-        char * pszOvTable = NULL;
-        char * pszOvColumn = NULL;
 
         nRasterXSize = poDS->GetRasterXSize();
         nRasterYSize = poDS->GetRasterYSize();
  
-        osCommand.Printf("select o_table_name, overview_factor, o_raster_column, "
-                "o_table_schema from raster_overviews where r_table_schema = "
-                "'%s' and r_table_name = '%s' and r_raster_column = '%s'",
-                poDS->pszSchema, poDS->pszTable, poDS->pszColumn);
-
-        poResult = PQexec(poDS->poConn, osCommand.c_str());
-        if (poResult != NULL && PQresultStatus(poResult) == PGRES_TUPLES_OK &&
-                PQntuples(poResult) > 0) {
+        if (poDS->nOverviewCount < 0)
+            poDS->SetOverviewCount();
+
+        if (poDS->nOverviewCount > 0) {
             
             /* Create overviews */
-            nOverviewCount = PQntuples(poResult);           
+            nOverviewCount = poDS->nOverviewCount;
             papoOverviews = (PostGISRasterRasterBand **)VSICalloc(nOverviewCount,
                     sizeof(PostGISRasterRasterBand *));
             if (papoOverviews == NULL) {
                 CPLError(CE_Warning, CPLE_OutOfMemory, "Couldn't create "
                         "overviews for band %d\n", nBand);              
-                PQclear(poResult);
+                nOverviewCount = 0;
                 return;
             }
                        
@@ -153,11 +140,6 @@ PostGISRasterRasterBand::PostGISRasterRasterBand(PostGISRasterDataset *poDS,
 				CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::Constructor: "
 					"Creating overview for band %d", nBand);
 
-                nFetchOvFactor = atoi(PQgetvalue(poResult, i, 1));
-                pszOvSchema = CPLStrdup(PQgetvalue(poResult, i, 3));
-                pszOvTable = CPLStrdup(PQgetvalue(poResult, i, 0));
-                pszOvColumn = CPLStrdup(PQgetvalue(poResult, i, 2));
- 
                 /**
                  * NOTE: Overview bands are not considered to be a part of a
                  * dataset, but we use the same dataset for all the overview
@@ -167,12 +149,10 @@ PostGISRasterRasterBand::PostGISRasterRasterBand(PostGISRasterDataset *poDS,
                  */
                 papoOverviews[i] = new PostGISRasterRasterBand(poDS, nBand,
                         hDataType, bHasNoDataValue, dfNodata, bSignedByte, nBitDepth,
-                        nFetchOvFactor, nBlockXSize, nBlockYSize, bIsOffline);
+                        poDS->panOverviewFactors[i], nBlockXSize, nBlockYSize, 
+                        bIsOffline);
 
             }
-
-            PQclear(poResult);
-
         }
 
         else {
@@ -181,8 +161,6 @@ PostGISRasterRasterBand::PostGISRasterRasterBand(PostGISRasterDataset *poDS,
 				"Band %d does not have overviews", nBand);
             nOverviewCount = 0;
             papoOverviews = NULL;
-            if (poResult)
-                PQclear(poResult);
         }
     }
 
@@ -259,6 +237,100 @@ GDALDataType PostGISRasterRasterBand::TranslateDataType(const char * pszDataType
 }
 
 
+/**
+ * \brief Fill a buffer with a value
+ */
+static void FillBuffer(GByte * pabyBuffer, GDALDataType eBufType, int nPixelSpace,
+	int nLineSpace, int nXSize, int nYSize, double dfValue)
+{
+	int iY;
+
+	for(iY = 0; iY < nYSize; iY++)
+		GDALCopyWords(&dfValue, GDT_Float64, 0, pabyBuffer + (GIntBig)iY * nLineSpace,
+			eBufType, nPixelSpace, nXSize);
+}
+
+/**
+ * \brief Composite the pixels of a tile into a window.
+ *
+ * The tile covers nDstXSize x nDstYSize window pixels from (nDstXOff,
+ * nDstYOff), that may be outside the window. If that's not the tile size
+ * (tiles with a different resolution), the pixels are replicated/decimated.
+ * Pixels with the tile nodata value are transparent.
+ *
+ * The lines are copied with pfnCopy, if there's a kernel for the types
+ * involved. panSrcIndex is scratch memory for nWinXSize column indexes.
+ */
+static void CompositeTile(GByte * pabyTile, GDALDataType eTileType, int nTileXSize,
+	int nTileYSize, GBool bHasNoData, double dfNoData, int nDstXOff, int nDstYOff,
+	int nDstXSize, int nDstYSize, GByte * pabyDst, GDALDataType eDstType, 
+	int nPixelSpace, int nLineSpace, int nWinXSize, int nWinYSize,
+	PostGISRasterCopyFunc pfnCopy, int * panSrcIndex)
+{
+	int nTilePixelSize = GDALGetDataTypeSize(eTileType) / 8;
+	int nXStart = MAX(0, nDstXOff);
+	int nXEnd = MIN(nWinXSize, nDstXOff + nDstXSize);
+	int nYStart = MAX(0, nDstYOff);
+	int nYEnd = MIN(nWinYSize, nDstYOff + nDstYSize);
+	GByte * pabySrcLine;
+	GByte * pabyDstLine;
+	GByte * pabySrc;
+	double dfValue;
+	int iX, iY;
+
+	if (nXStart >= nXEnd || nYStart >= nYEnd)
+		return;
+
+	if (pfnCopy != NULL) {
+		if (nDstXSize == nTileXSize)
+			panSrcIndex = NULL;
+		else
+			for(iX = nXStart; iX < nXEnd; iX++)
+				panSrcIndex[iX - nXStart] = 
+					(int)((GIntBig)(iX - nDstXOff) * nTileXSize / nDstXSize);
+
+		for(iY = nYStart; iY < nYEnd; iY++) {
+			pabySrcLine = pabyTile + (GIntBig)((GIntBig)(iY - nDstYOff) * nTileYSize / 
+				nDstYSize) * nTileXSize * nTilePixelSize;
+			if (panSrcIndex == NULL)
+				pabySrcLine += (nXStart - nDstXOff) * nTilePixelSize;
+
+			pfnCopy(pabySrcLine, panSrcIndex, nXEnd - nXStart, 
+				pabyDst + (GIntBig)iY * nLineSpace + (GIntBig)nXStart * nPixelSpace,
+				nPixelSpace, bHasNoData, dfNoData);
+		}
+
+		return;
+	}
+
+	for(iY = nYStart; iY < nYEnd; iY++) {
+		pabySrcLine = pabyTile + (GIntBig)((GIntBig)(iY - nDstYOff) * nTileYSize / 
+			nDstYSize) * nTileXSize * nTilePixelSize;
+		pabyDstLine = pabyDst + (GIntBig)iY * nLineSpace;
+
+		/* Same resolution, all pixels opaque: one copy per line */
+		if (nDstXSize == nTileXSize && !bHasNoData) {
+			GDALCopyWords(pabySrcLine + (nXStart - nDstXOff) * nTilePixelSize, 
+				eTileType, nTilePixelSize, pabyDstLine + (GIntBig)nXStart * nPixelSpace, 
+				eDstType, nPixelSpace, nXEnd - nXStart);
+			continue;
+		}
+
+		for(iX = nXStart; iX < nXEnd; iX++) {
+			pabySrc = pabySrcLine + 
+				((GIntBig)(iX - nDstXOff) * nTileXSize / nDstXSize) * nTilePixelSize;
+
+			if (bHasNoData) {
+				GDALCopyWords(pabySrc, eTileType, 0, &dfValue, GDT_Float64, 0, 1);
+				if (CPLIsEqual(dfValue, dfNoData))
+					continue;
+			}
+
+			GDALCopyWords(pabySrc, eTileType, 0, pabyDstLine + (GIntBig)iX * nPixelSpace,
+				eDstType, 0, 1);
+		}
+	}
+}
 
 /**
  * Read/write a region of image data from multiple bands.
@@ -276,9 +348,11 @@ GDALDataType PostGISRasterRasterBand::TranslateDataType(const char * pszDataType
  * (eBufType) of the buffer is different than that of the
  * PostGISRasterRasterBand.
  *
- * TODO: The method should take care of image decimation / replication if the
- * buffer size (nBufXSize x nBufYSize) is different than the size of the region
- * being accessed (nXSize x nYSize).
+ * The tiles are composited directly into the buffer. If the buffer size
+ * (nBufXSize x nBufYSize) is different than the size of the region being
+ * accessed (nXSize x nYSize), each tile is resampled into the buffer as it's
+ * decoded, with the kernel set by the POSTGIS_RASTER_RESAMPLING configuration
+ * option (NEAREST, AVERAGE, BILINEAR or CUBIC).
  *
  * The nPixelSpace, nLineSpace and nBandSpace parameters allow reading into or
  * writing from various organization of buffers.
@@ -341,57 +415,79 @@ CPLErr PostGISRasterRasterBand::IRasterIO(GDALRWFlag eRWFlag, int nXOff, int nYO
     double adfProjWin[8];
     int ulx, uly, lrx, lry;
     CPLString osCommand;
+	CPLString osWhere;
+	CPLString osWindow;
     PGresult* poResult = NULL;
 	int iTuplesIndex;
     int nTuples = 0;
     char orderByY[5];
     char orderByX[4];
-	GBool bEqualAreas = false;
     GByte* pbyData = NULL;
 	GByte* pbyBandData = NULL;
     int nWKBLength = 0;
-	int nBandDataLength;
-	int nBandDataSize;
-	int nBufDataSize;
+	const char * pszHex;
+	int nHexLength;
+	/* Room for the band flags, even after a \x prefix */
+	GByte abyPeek[RASTER_HEADER_SIZE + RASTER_BAND_HEADER_FIXED_SIZE + 1];
+	PostGISRasterWKBHeader sHeader;
+	PostGISRasterWKBBandHeader sBandHeader;
 	int nTileWidth;
 	int nTileHeight;
 	double dfTileScaleX;
 	double dfTileScaleY;
 	double dfTileUpperLeftX;
 	double dfTileUpperLeftY;
-	char * pszDataType = NULL; 
-	char * pszDataTypeName = NULL;
 	GDALDataType eTileDataType;
 	int nTileDataTypeSize;
+	GBool bTileHasNoDataValue;
 	double dfTileBandNoDataValue;
-	VRTDatasetH vrtDataset;
-	GDALDataset ** memDatasets;
-	GDALRasterBandH memRasterBand;
-	GDALRasterBandH vrtRasterBand;
-	char szMemOpenInfo[100];
-	GDALOpenInfo * oOpenInfo;
-	char ** papszOptions;
-	char szTmp[64];
-	char szTileWidth[64];
-	char szTileHeight[64];
+	int nMaxHexLength = 0;
+	int nDataOffset;
+	GByte * pabyScratch = NULL;
+	int * panSrcIndex = NULL;
+	PostGISRasterCopyFunc pfnCopy = NULL;
+	GBool bContiguous;
+	PostGISRasterResampler oResampler;
+	GBool bResample;
+	PostGISRasterTileCache * poTileCache = PostGISRasterTileCache::GetInstance();
+	CPLString osCacheKey;
+	GUInt32 nCachePosition = 0;
+	GBool bCacheable, bCacheStore, bCacheEmpty;
+	GBool bComplete = true;
+	int nBandDataSize = GDALGetDataTypeSize(eDataType) / 8;
+	int nBlockBytes = nXSize * nYSize * nBandDataSize;
+	GByte * pabyBlock = NULL;
+	int iY;
 	CPLErr err;
     PostGISRasterDataset * poPostGISRasterDS = (PostGISRasterDataset*)poDS;
-	int nSrcXOff, nSrcYOff, nDstXOff, nDstYOff;
+	int nDstXOff, nDstYOff;
 	int nDstXSize, nDstYSize;
+	GIntBig nBudget;
+	GIntBig nBytesInFlight = 0;
+	GBool bApproxMismatch = false;
+	double dfGridX, dfGridY;
 
 	/**
-     * TODO: Write support not implemented yet
-     **/
-    if (eRWFlag == GF_Write) {
-        CPLError(CE_Failure, CPLE_NotSupported,
-			"Writing through PostGIS Raster band not supported yet");
-        
-		return CE_Failure;
-    }
+	 * Writes are applied to the tiles by the server. The blocks of the GDAL
+	 * cache are flushed first (the dirty ones are written), as they're
+	 * stale after it
+	 **/
+	if (eRWFlag == GF_Write) {
+		if (nBufXSize != nXSize || nBufYSize != nYSize) {
+			CPLError(CE_Failure, CPLE_NotSupported, "Writing a buffer with a "
+				"size different from the window is not supported");
+
+			return CE_Failure;
+		}
+
+		FlushCache();
+		for(int i = 0; i < nOverviewCount; i++)
+			papoOverviews[i]->FlushCache();
+
+		return WriteRaster(nXOff, nYOff, nXSize, nYSize, pData, eBufType,
+			nPixelSpace, nLineSpace);
+	}
     
-	nBandDataSize = GDALGetDataTypeSize(eDataType) / 8;
-    nBufDataSize = GDALGetDataTypeSize( eBufType ) / 8;
-            
 
 	/**************************************************************************
 	 * Do we have overviews that would be appropriate to satisfy this request?                                                   
@@ -403,6 +499,61 @@ CPLErr PostGISRasterRasterBand::IRasterIO(GDALRWFlag eRWFlag, int nXOff, int nYO
 		return CE_None;
 	}
 
+	/**************************************************************************
+	 * Quick looks: downsampled reads rendered by the server as an image
+	 *************************************************************************/
+	if ((nBufXSize < nXSize || nBufYSize < nYSize) && 
+		QuickLookRasterIO(nXOff, nYOff, nXSize, nYSize, pData, nBufXSize, 
+			nBufYSize, eBufType, nPixelSpace, nLineSpace, &err))
+		return err;
+
+	/**************************************************************************
+	 * Keep the request under the memory budget. Bigger windows are read as
+	 * smaller sub-windows, one after the other
+	 *************************************************************************/
+	nBudget = GetMemoryBudget();
+	if (nBudget > 0 && EstimateRequestMemory(nXSize, nYSize, nBufXSize, 
+		nBufYSize) > nBudget) {
+		if (SplitRasterIO(nXOff, nYOff, nXSize, nYSize, pData, nBufXSize,
+			nBufYSize, eBufType, nPixelSpace, nLineSpace, &err))
+
+			return err;
+
+		CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): "
+			"Window (%d, %d, %d, %d) exceeds the memory budget, but can't be "
+			"split anymore", nXOff, nYOff, nXSize, nYSize);
+	}
+
+	/**************************************************************************
+	 * Whole blocks are looked up in the driver tile cache first. They're
+	 * stored in the band data type, so only those buffers can be stored
+	 *************************************************************************/
+	bResample = (nBufXSize != nXSize || nBufYSize != nYSize);
+	bCacheable = !bResample && GetTileCacheKey(nXOff, nYOff, nXSize, nYSize, 
+		&osCacheKey, &nCachePosition) && poTileCache->IsEnabled();
+	bCacheStore = bCacheable && eBufType == eDataType && 
+		nPixelSpace == nBandDataSize && nLineSpace == nBandDataSize * nXSize;
+
+	if (bCacheable) {
+		oArena.Reset();
+		pabyBlock = bCacheStore ? (GByte *)pData : (GByte *)oArena.Alloc(nBlockBytes);
+
+		if (pabyBlock != NULL && poTileCache->Get(osCacheKey, nCachePosition,
+			pabyBlock, nBlockBytes, &bCacheEmpty)) {
+			
+			if (bCacheEmpty)
+				FillBuffer((GByte *)pData, eBufType, nPixelSpace, nLineSpace, 
+					nXSize, nYSize, (bHasNoDataValue) ? dfNoDataValue : 0.0);
+			else if (pabyBlock != pData)
+				for(iY = 0; iY < nYSize; iY++)
+					GDALCopyWords(pabyBlock + (GIntBig)iY * nXSize * nBandDataSize, 
+						eDataType, nBandDataSize, (GByte *)pData + 
+						(GIntBig)iY * nLineSpace, eBufType, nPixelSpace, nXSize);
+
+			return CE_None;
+		}
+	}
+
   	/**************************************************************************
 	 * Get all the raster rows that are intersected by the window requested
 	 *************************************************************************/		
@@ -410,9 +561,8 @@ CPLErr PostGISRasterRasterBand::IRasterIO(GDALRWFlag eRWFlag, int nXOff, int nYO
 	poPostGISRasterDS->GetGeoTransform(adfTransform);
 	ulx = nXOff;
 	uly = nYOff;
-	lrx = nXOff + nXSize * nBandDataSize;
-	lry = nYOff + nYSize * nBandDataSize;
-
+	lrx = nXOff + nXSize;
+	lry = nYOff + nYSize;
 	adfProjWin[0] = adfTransform[GEOTRSFRM_TOPLEFT_X] + 
 					ulx * adfTransform[GEOTRSFRM_WE_RES] + 
 					uly * adfTransform[GEOTRSFRM_ROTATION_PARAM1];
@@ -451,39 +601,47 @@ CPLErr PostGISRasterRasterBand::IRasterIO(GDALRWFlag eRWFlag, int nXOff, int nYO
 		"Buffer size = (%d, %d), Region size = (%d, %d)",
 		nBufXSize, nBufYSize, nXSize, nYSize);
 
-	if (poPostGISRasterDS->pszWhere == NULL) {
-		osCommand.Printf("SELECT st_band(%s, %d), st_width(%s), st_height(%s), st_bandpixeltype(%s, %d), "
-			"st_bandnodatavalue(%s, %d), st_scalex(%s), st_scaley(%s), st_upperleftx(%s), st_upperlefty(%s) "
-			"FROM %s.%s WHERE st_intersects(%s, st_polygonfromtext('POLYGON((%.17f %.17f, %.17f %.17f, "
-			"%.17f %.17f, %.17f %.17f, %.17f %.17f))', %d)) ORDER BY ST_UpperLeftY(%s) %s, "
-			"ST_UpperLeftX(%s) %s", poPostGISRasterDS->pszColumn, nBand, poPostGISRasterDS->pszColumn, 
-			poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszColumn, nBand, poPostGISRasterDS->pszColumn, 
-			nBand, poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszColumn,
-			poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable, 
-			poPostGISRasterDS->pszColumn, adfProjWin[0], adfProjWin[1], adfProjWin[2], adfProjWin[3], 
-			adfProjWin[4], adfProjWin[5], adfProjWin[6], adfProjWin[7], adfProjWin[0], adfProjWin[1], 
-			poPostGISRasterDS->nSrid, poPostGISRasterDS->pszColumn, orderByY, poPostGISRasterDS->pszColumn, 
-			orderByX);
-	}
+	/**
+	 * Only the band is fetched: the tile size, pixel type, nodata value and
+	 * georeference are read from its WKB headers
+	 **/
+	if (poPostGISRasterDS->pszWhere == NULL)
+		osWhere = "";
+	else
+		osWhere.Printf("%s AND ", poPostGISRasterDS->pszWhere);
 
-	else {
-		osCommand.Printf("SELECT st_band(%s, %d), st_width(%s), st_height(%s), st_bandpixeltype(%s, %d), "
-			"st_bandnodatavalue(%s, %d), st_scalex(%s), st_scaley(%s), st_upperleftx(%s), st_upperlefty(%s) "
-			"FROM %s.%s WHERE %s AND st_intersects(%s, st_polygonfromtext('POLYGON((%.17f %.17f, %.17f %.17f, "
-			"%.17f %.17f, %.17f %.17f, %.17f %.17f))', %d)) ORDER BY ST_UpperLeftY(%s) %s, "
-			"ST_UpperLeftX(%s) %s", poPostGISRasterDS->pszColumn, nBand, poPostGISRasterDS->pszColumn, 
-			poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszColumn, nBand, poPostGISRasterDS->pszColumn, 
-			nBand, poPostGISRasterDS->pszColumn,poPostGISRasterDS->pszColumn,poPostGISRasterDS->pszColumn,
-			poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable, 
-			poPostGISRasterDS->pszWhere, poPostGISRasterDS->pszColumn, adfProjWin[0], adfProjWin[1], 
-			adfProjWin[2], adfProjWin[3], adfProjWin[4], adfProjWin[5], adfProjWin[6], adfProjWin[7], 
-			adfProjWin[0], adfProjWin[1], poPostGISRasterDS->nSrid, poPostGISRasterDS->pszColumn, orderByY, 
-			poPostGISRasterDS->pszColumn, orderByX);
-	}
+	/* Tiles whose value range can't match the value filter are not read */
+	if (poPostGISRasterDS->pszValueFilter != NULL)
+		osWhere += CPLString().Printf("%s AND ", poPostGISRasterDS->pszValueFilter);
+
+	osWindow.Printf("st_polygonfromtext('POLYGON((%.17f %.17f, %.17f %.17f, "
+		"%.17f %.17f, %.17f %.17f, %.17f %.17f))', %d)", adfProjWin[0], 
+		adfProjWin[1], adfProjWin[2], adfProjWin[3], adfProjWin[4], adfProjWin[5],
+		adfProjWin[6], adfProjWin[7], adfProjWin[0], adfProjWin[1], 
+		poPostGISRasterDS->nSrid);
+
+	/**
+	 * Reprojected tiles (target_srid): they're selected by srid, with the
+	 * window transformed to it, and warped by the server to the grid of the
+	 * dataset. They're ordered by their warped corners, all in its srid
+	 **/
+	if (poPostGISRasterDS->nTargetSrid > 0)
+		osCommand.Printf("SELECT st_band(r, %d) FROM (SELECT %s r FROM %s) w "
+			"ORDER BY ST_UpperLeftY(r) %s, ST_UpperLeftX(r) %s", nBand,
+			poPostGISRasterDS->GetRasterExpression().c_str(),
+			poPostGISRasterDS->GetIntersectingRows(osWhere, osWindow).c_str(),
+			orderByY, orderByX);
+	else
+		osCommand.Printf("SELECT st_band(%s, %d) FROM %s.%s WHERE %sst_intersects(%s, "
+			"%s) ORDER BY ST_UpperLeftY(%s) %s, ST_UpperLeftX(%s) %s", 
+			poPostGISRasterDS->pszColumn, nBand, 
+			poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable, osWhere.c_str(),
+			poPostGISRasterDS->pszColumn, osWindow.c_str(), 
+			poPostGISRasterDS->pszColumn, orderByY, poPostGISRasterDS->pszColumn, orderByX);
 
 	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): Query = %s", osCommand.c_str());
 
-	poResult = PQexec(poPostGISRasterDS->poConn, osCommand.c_str());
+	poResult = PostGISRasterExec(poPostGISRasterDS->poConn, osCommand.c_str());
 	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK || 
 		PQntuples(poResult) < 0) {
 		
@@ -493,7 +651,7 @@ CPLErr PostGISRasterRasterBand::IRasterIO(GDALRWFlag eRWFlag, int nXOff, int nYO
 		CPLError(CE_Failure, CPLE_AppDefined, "Error retrieving raster data from database");
 
 		CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): %s", 
-			PQerrorMessage(poPostGISRasterDS->poConn));
+			PostGISRasterErrorMessage(poPostGISRasterDS->poConn));
         
 		return CE_Failure;	
 	}
@@ -506,208 +664,872 @@ CPLErr PostGISRasterRasterBand::IRasterIO(GDALRWFlag eRWFlag, int nXOff, int nYO
 		
 		CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): Null block");
 
+		if (bCacheable)
+			poTileCache->InsertEmpty(osCacheKey, nCachePosition);
+
+		FillBuffer((GByte *)pData, eBufType, nPixelSpace, nLineSpace, nBufXSize,
+			nBufYSize, (bHasNoDataValue) ? dfNoDataValue : 0.0);
+
 		return CE_None;	
 	}
 	
 
 	nTuples = PQntuples(poResult);
 
-	/**************************************************************************
-	 * Allocate memory for MEM dataset
-	 * TODO: In case of memory error, provide a different alternative
-	 *************************************************************************/
-	memDatasets = (GDALDataset **)CPLCalloc(nTuples, sizeof(GDALDataset *));
-	if (!memDatasets) {
-		PQclear(poResult);	
-		CPLError(CE_Failure, CPLE_AppDefined, "Memory error while trying to read band data "
-			"from database");
-
-		return CE_Failure;
+	for(iTuplesIndex = 0; iTuplesIndex < nTuples; iTuplesIndex++) {
+		nBytesInFlight += PQgetlength(poResult, iTuplesIndex, 0);
+		nMaxHexLength = MAX(nMaxHexLength, PQgetlength(poResult, iTuplesIndex, 0));
 	}
-	
 
 	/**************************************************************************
-	 * Create an empty in-memory VRT dataset
-	 * TODO: In case of memory error, provide a different alternative
+	 * Set up the scratch memory, taken from the band arena: one tile buffer,
+	 * reused for all the tiles, and the resampling sums if the buffer size
+	 * is not the window size.
+	 *
+	 * If the buffer has the size of the window, the tiles are composited
+	 * straight into it. Otherwise, they're resampled into it one by one.
 	 *************************************************************************/
-	vrtDataset = VRTCreate(nXSize, nYSize);
-	if (!vrtDataset) {
-		PQclear(poResult);
-		CPLFree(memDatasets);
+	oArena.Reset();
 
-		CPLError(CE_Failure, CPLE_AppDefined, "Memory error while trying to read band data "
-			"from database");
+	pabyScratch = (GByte *)oArena.Alloc(nMaxHexLength / 2 + ARENA_ALIGNMENT);
+
+	if (!bResample)
+		panSrcIndex = (int *)oArena.Alloc(nXSize * sizeof(int));
+
+	if (pabyScratch == NULL || (!bResample && panSrcIndex == NULL) || 
+		(bResample && !oResampler.Init(&oArena, 
+		PostGISRasterResampler::GetResampling(), nXSize, nYSize, nBufXSize, 
+		nBufYSize))) {
+		PQclear(poResult);
+		CPLError(CE_Failure, CPLE_OutOfMemory, "Memory error while trying to read "
+			"band data from database");
 
 		return CE_Failure;
 	}
-	
-	GDALSetDescription(vrtDataset, "postgis_raster.vrt");
-	GDALSetProjection(vrtDataset, GDALGetProjectionRef((GDALDatasetH)this->poDS));
-	GDALSetGeoTransform(vrtDataset, adfTransform);
 
+	nBytesInFlight += oArena.GetUsedBytes();
+	poPostGISRasterDS->AddBytesInFlight(nBytesInFlight);
+
+	if (!bResample)
+		FillBuffer((GByte *)pData, eBufType, nPixelSpace, nLineSpace, nXSize,
+			nYSize, (bHasNoDataValue) ? dfNoDataValue : 0.0);
 
 	/**
-	 * Create one VRT Raster Band. It will contain the same band of all tiles
-	 * as Simple Sources
+	 * Select the copy kernel once: the tiles normally have the band type
 	 **/
-	VRTAddBand(vrtDataset, eDataType, NULL);
-	vrtRasterBand = GDALGetRasterBand(vrtDataset, 1);
-	
-	
+	bContiguous = (nPixelSpace == GDALGetDataTypeSize(eBufType) / 8 && 
+		(size_t)pData % nPixelSpace == 0 && nLineSpace % nPixelSpace == 0);
+	pfnCopy = PostGISRasterGetCopyKernel(eDataType, eBufType, bContiguous);
+
 	/**************************************************************************
-	 * Now, for each block, create a MEM dataset
+	 * Now, composite each tile into the window, in the query order (the last
+	 * tiles are drawn over the first ones)
 	 * TODO: What if whe have a really BIG amount of data fetched from db? CURSORS
 	 *************************************************************************/
 	for(iTuplesIndex = 0; iTuplesIndex < nTuples; iTuplesIndex++) {
 	
+		pszHex = PQgetvalue(poResult, iTuplesIndex, 0);
+		nHexLength = PQgetlength(poResult, iTuplesIndex, 0);
+
 		/**
-		 * Fetch data from result
-		 **/
-		pbyData = CPLHexToBinary(PQgetvalue(poResult, iTuplesIndex, 0), &nWKBLength);
-		nTileWidth = atoi(PQgetvalue(poResult, iTuplesIndex, 1));
-		nTileHeight = atoi(PQgetvalue(poResult, iTuplesIndex, 2));
-		pszDataType = CPLStrdup(PQgetvalue(poResult, iTuplesIndex, 3));
-		dfTileBandNoDataValue = atof(PQgetvalue(poResult, iTuplesIndex, 4));
-		dfTileScaleX = atof(PQgetvalue(poResult, iTuplesIndex, 5));
-		dfTileScaleY = atof(PQgetvalue(poResult, iTuplesIndex, 6));
-		dfTileUpperLeftX = atof(PQgetvalue(poResult, iTuplesIndex, 7));
-		dfTileUpperLeftY = atof(PQgetvalue(poResult, iTuplesIndex, 8));
-			
-		/**
-		 * Calculate some useful parameters
+		 * Peek the pixel type of the band, to decode the tile so its pixels
+		 * start at an aligned address
 		 **/
-		eTileDataType = TranslateDataType(pszDataType);
-		nTileDataTypeSize = GDALGetDataTypeSize(eTileDataType) / 8;
+		nTileDataTypeSize = 0;
+		if (PostGISRasterHexToBinary(pszHex, MIN(nHexLength, 
+				(int)(2 * sizeof(abyPeek))), abyPeek) > RASTER_HEADER_SIZE)
+			PostGISRasterPixelTypeToGDAL(abyPeek[RASTER_HEADER_SIZE] & 
+				BAND_PIXTYPE_MASK, &nTileDataTypeSize);
 		
-		nBandDataLength = nTileWidth * nTileHeight * nTileDataTypeSize;
+		nDataOffset = RASTER_HEADER_SIZE + RASTER_BAND_HEADER_FIXED_SIZE + 
+			nTileDataTypeSize;
+		pbyData = pabyScratch + 
+			(ARENA_ALIGNMENT - nDataOffset % ARENA_ALIGNMENT) % ARENA_ALIGNMENT;
+		nWKBLength = PostGISRasterHexToBinary(pszHex, nHexLength, pbyData);
 
 		/**
-		 * Get the pointer to the band pixels
-		 **/ 
-		pbyBandData = GET_BAND_DATA(pbyData, 1, nTileDataTypeSize, nBandDataLength);
-		
-		/**
-		 * Create new MEM dataset, based on in-memory array, to hold the pixels.
-		 * The dataset will have only 1 band
+		 * Get the tile properties from the raster and band headers
 		 **/
-		memset(szTmp, 0, sizeof(szTmp));
-		CPLPrintPointer(szTmp, pbyBandData, sizeof(szTmp));
-
-		memset(szTileWidth, 0, sizeof(szTileWidth));
-		CPLPrintInt32(szTileWidth, (GInt32)nTileWidth, sizeof(nTileWidth));
-		memset(szTileHeight, 0, sizeof(szTileHeight));
-		CPLPrintInt32(szTileHeight, (GInt32)nTileHeight, sizeof(nTileHeight));
-		
-		memset(szMemOpenInfo, 0, sizeof(szMemOpenInfo));
-		sprintf(szMemOpenInfo, "MEM:::DATAPOINTER=%s,PIXELS=%d,LINES=%d,DATATYPE=%s",
-			szTmp, nTileWidth, nTileHeight, GDALGetDataTypeName(eTileDataType));
-		
-		CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO: MEMDataset "
-			"open info = %s", szMemOpenInfo);
-
-		oOpenInfo = new GDALOpenInfo(szMemOpenInfo, GA_ReadOnly, NULL);
-		if (!oOpenInfo) {
-			CPLError(CE_Warning, CPLE_AppDefined, "Could not allocate memory for "
-				"MEMDataset, skipping. The result image may contain gaps");
+		if (!PostGISRasterParseWKBHeader(pbyData, nWKBLength, &sHeader) ||
+			!PostGISRasterGetWKBBand(pbyData, nWKBLength, &sHeader, 0, 
+				&sBandHeader)) {
+			CPLError(CE_Warning, CPLE_AppDefined, "Invalid raster data, skipping. "
+				"The result image may contain gaps");
+			bComplete = false;
 			continue;
 		}
-		
-		memDatasets[iTuplesIndex] = MEMDataset::Open(oOpenInfo);
-		if (!memDatasets[iTuplesIndex]) {
-			delete oOpenInfo;
-			CPLError(CE_Warning, CPLE_AppDefined, "Could not create MEMDataset, "
-				"skipping. The result image may contain gaps");
+
+		if (sBandHeader.bIsOffline) {
+			CPLError(CE_Warning, CPLE_NotSupported, "Out-db band found, skipping. "
+				"The result image may contain gaps");
+			bComplete = false;
 			continue;
 		}
-		
-		GDALSetDescription(memDatasets[iTuplesIndex], szMemOpenInfo);
 
-		/** 
-		 * Get MEM raster band, to add it as simple source.
+		nTileWidth = sHeader.nWidth;
+		nTileHeight = sHeader.nHeight;
+		eTileDataType = sBandHeader.eDataType;
+		nTileDataTypeSize = sBandHeader.nPixelSize;
+		bTileHasNoDataValue = sBandHeader.bHasNoDataValue;
+		dfTileBandNoDataValue = sBandHeader.dfNoDataValue;
+		dfTileScaleX = sHeader.dfScaleX;
+		dfTileScaleY = sHeader.dfScaleY;
+		dfTileUpperLeftX = sHeader.dfUpperLeftX;
+		dfTileUpperLeftY = sHeader.dfUpperLeftY;
+
+		/**
+		 * open_mode=approx: the tiles of the first read are checked against
+		 * the estimated georeference. They must have its scale and block
+		 * size, snap to its grid and lie within its extent
 		 **/
-		memRasterBand = (GDALRasterBandH)memDatasets[iTuplesIndex]->GetRasterBand(1);
-		if (!memRasterBand) {
-			CPLError(CE_Warning, CPLE_AppDefined, "Could not get MEMRasterBand , "
-				"skipping. The result image may contain gaps");
-			continue;
-		} 
-		((MEMRasterBand *)memRasterBand)->SetNoDataValue(dfTileBandNoDataValue);
+		if (poPostGISRasterDS->bApproxOpen && 
+			!poPostGISRasterDS->bApproxValidated && !bApproxMismatch) {
+			dfGridX = (dfTileUpperLeftX - poPostGISRasterDS->xmin) / 
+				adfTransform[GEOTRSFRM_WE_RES];
+			dfGridY = (poPostGISRasterDS->ymax - dfTileUpperLeftY) / 
+				fabs(adfTransform[GEOTRSFRM_NS_RES]);
+
+			bApproxMismatch = 
+				!CPLIsEqual(dfTileScaleX, adfTransform[GEOTRSFRM_WE_RES]) ||
+				!CPLIsEqual(dfTileScaleY, adfTransform[GEOTRSFRM_NS_RES]) ||
+				nTileWidth != nBlockXSize || nTileHeight != nBlockYSize ||
+				fabs(dfGridX - floor(dfGridX + 0.5)) > 0.01 ||
+				fabs(dfGridY - floor(dfGridY + 0.5)) > 0.01 ||
+				dfGridX < -0.01 || dfGridY < -0.01 || 
+				dfGridX + nTileWidth > poPostGISRasterDS->nRasterXSize + 0.01 ||
+				dfGridY + nTileHeight > poPostGISRasterDS->nRasterYSize + 0.01;
+		}
 
-		CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO: Adding "
-			"VRT Simple Source");
+		/**
+		 * Get the pointer to the band pixels, in the machine byte order
+		 **/ 
+		pbyBandData = pbyData + sBandHeader.nDataOffset;
+		if (nTileDataTypeSize > 1 && PostGISRasterWKBNeedsSwap(&sHeader))
+			GDALSwapWords(pbyBandData, nTileDataTypeSize, 
+				nTileWidth * nTileHeight, nTileDataTypeSize);
 		
 		/**
-		 * Get source and destination windows for the simple source
+		 * Get the destination window of the tile, relative to the requested one
 		 **/ 
-		if (dfTileUpperLeftX < poPostGISRasterDS->xmin) {
-			nSrcXOff = (int)((poPostGISRasterDS->xmin - dfTileUpperLeftX) / 
-				dfTileScaleX + 0.5);
-        	nDstXOff = 0;
-		}
+		nDstXOff = (int)floor(0.5 + (dfTileUpperLeftX - poPostGISRasterDS->xmin) / 
+			adfTransform[GEOTRSFRM_WE_RES]) - nXOff;
+		nDstYOff = (int)floor(0.5 + (poPostGISRasterDS->ymax - dfTileUpperLeftY) / 
+			fabs(adfTransform[GEOTRSFRM_NS_RES])) - nYOff;
+		nDstXSize = (int)(0.5 + nTileWidth * dfTileScaleX / adfTransform[GEOTRSFRM_WE_RES]);
+		nDstYSize = (int)(0.5 + nTileHeight * fabs(dfTileScaleY) / 
+			fabs(adfTransform[GEOTRSFRM_NS_RES]));
+
+		if (bResample)
+			oResampler.AddTile(pbyBandData, eTileDataType, nTileWidth, 
+				nTileHeight, bTileHasNoDataValue, dfTileBandNoDataValue, 
+				nDstXOff, nDstYOff, nDstXSize, nDstYSize);
+		else
+			CompositeTile(pbyBandData, eTileDataType, nTileWidth, nTileHeight, 
+				bTileHasNoDataValue, dfTileBandNoDataValue, nDstXOff, nDstYOff, 
+				nDstXSize, nDstYSize, (GByte *)pData, eBufType, nPixelSpace, 
+				nLineSpace, nXSize, nYSize, (eTileDataType == eDataType) ? 
+				pfnCopy : PostGISRasterGetCopyKernel(eTileDataType, eBufType, 
+				bContiguous), panSrcIndex);
+	}
+ 
+	PQclear(poResult);
 
-		else {
-			nSrcXOff = 0;
-			nDstXOff = (int)(0.5 + (dfTileUpperLeftX - poPostGISRasterDS->xmin) / 	
-				adfTransform[1]);
-    	}
-
-		if (poPostGISRasterDS->ymax < dfTileUpperLeftY) {
-        	nSrcYOff = (int)((dfTileUpperLeftY - poPostGISRasterDS->ymax) / 
-				fabs(dfTileScaleY) + 0.5);
-			nDstYOff = 0;
-    	}
-
-		else {
-			nSrcYOff = 0;
-			nDstYOff = (int)(0.5 + (poPostGISRasterDS->ymax - dfTileUpperLeftY) / 
-				fabs(adfTransform[5]));
-		}
+	if (poPostGISRasterDS->bApproxOpen && !poPostGISRasterDS->bApproxValidated) {
+		if (bApproxMismatch)
+			CPLError(CE_Warning, CPLE_AppDefined, "%s.%s (%s) doesn't match the "
+				"georeference estimated by open_mode=approx. The image may be "
+				"misplaced or clipped. Analyze the table or open it without "
+				"open_mode=approx", poPostGISRasterDS->pszSchema, 
+				poPostGISRasterDS->pszTable, poPostGISRasterDS->pszColumn);
 
-		nDstXSize = (int)(0.5 + nTileWidth * dfTileScaleX / adfTransform[1]);
-		nDstYSize = (int)(0.5 + nTileHeight * fabs(dfTileScaleY) / fabs(adfTransform[5]));
-     
+		poPostGISRasterDS->bApproxValidated = true;
+	}
 
-		/**
-		 * Add the mem raster band as new simple source band
-		 **/
-		VRTAddSimpleSource(vrtRasterBand, memRasterBand, nSrcXOff, nSrcYOff, nTileWidth, nTileHeight,
-			nDstXOff, nDstYOff, nDstXSize, nDstYSize, NULL, dfTileBandNoDataValue);
+	if (bResample)
+		oResampler.Finish((GByte *)pData, eBufType, nPixelSpace, nLineSpace, 
+			(bHasNoDataValue) ? dfNoDataValue : 0.0);
+
+	if (bCacheStore && bComplete)
+		poTileCache->Insert(osCacheKey, nCachePosition, (GByte *)pData, 
+			nBlockBytes);
 
-		delete oOpenInfo;
+	poPostGISRasterDS->AddBytesInFlight(-nBytesInFlight);
 
-		CPLFree(pbyData);
-		CPLFree(pszDataType);
+	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): Data read");
+
+	return CE_None;
+}
+
+/**
+ * \brief Get the tile cache key of a window, and its position (the Hilbert
+ * index of the block). Only whole blocks (clipped at the raster edges) are
+ * cached. Returns false for other windows. Keys start with schema.table,
+ * so the blocks of a table can be dropped when it's rewritten.
+ */
+GBool PostGISRasterRasterBand::GetTileCacheKey(int nXOff, int nYOff, int nXSize,
+	int nYSize, CPLString * posKey, GUInt32 * pnPosition)
+{
+	PostGISRasterDataset * poPostGISRasterDS = (PostGISRasterDataset*)poDS;
+
+	if (poPostGISRasterDS->pszOriginalConnectionString == NULL ||
+		poPostGISRasterDS->pszSchema == NULL ||
+		poPostGISRasterDS->pszTable == NULL ||
+		nXOff % nBlockXSize != 0 || nYOff % nBlockYSize != 0 ||
+		nXSize != MIN(nBlockXSize, nRasterXSize - nXOff) ||
+		nYSize != MIN(nBlockYSize, nRasterYSize - nYOff))
+		return false;
+
+	posKey->Printf("%s.%s|%s|%d|%d|%d|%d", poPostGISRasterDS->pszSchema,
+		poPostGISRasterDS->pszTable, poPostGISRasterDS->pszOriginalConnectionString,
+		nBand, nOverviewFactor, nXOff / nBlockXSize, nYOff / nBlockYSize);
+	*pnPosition = PostGISRasterHilbertIndex(nXOff / nBlockXSize, 
+		nYOff / nBlockYSize);
+
+	return true;
+}
 
+/**
+ * \brief Append a pixel value to an array literal, in the shortest form
+ * that keeps the band data type precision
+ */
+static void AppendPixelValue(CPLString * posValues, double dfValue, 
+	GDALDataType eDataType)
+{
+	if (CPLIsNan(dfValue))
+		*posValues += "NaN";
+	else if (CPLIsInf(dfValue))
+		*posValues += (dfValue > 0) ? "Infinity" : "-Infinity";
+	else if (eDataType == GDT_Float32)
+		*posValues += CPLSPrintf("%.9g", dfValue);
+	else if (eDataType == GDT_Float64)
+		*posValues += CPLSPrintf("%.17g", dfValue);
+	else
+		*posValues += CPLSPrintf("%.0f", dfValue);
+}
+
+/**
+ * \brief Run a statement of a write (begin, commit, rollback)
+ */
+static CPLErr RunWriteCommand(PGconn * poConn, const char * pszCommand)
+{
+	PGresult* poResult = NULL;
+	CPLErr eErr = CE_None;
+
+	poResult = PostGISRasterExec(poConn, pszCommand);
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+		CPLError(CE_Failure, CPLE_AppDefined, "Error writing the band data "
+			"(%s): %s", pszCommand, PostGISRasterErrorMessage(poConn));
+		eErr = CE_Failure;
 	}
- 
+	if (poResult != NULL)
+		PQclear(poResult);
+
+	return eErr;
+}
+
+/**
+ * \brief Send the tile updates of a write, in one statement, and empty the
+ * batch. Fails unless every tile of the batch has been updated.
+ */
+static CPLErr SendWriteBatch(PGconn * poConn, const CPLString & osUpdate,
+	CPLString * posValues, int * pnTiles)
+{
+	PGresult* poResult = NULL;
+	CPLErr eErr = CE_None;
+	CPLString osCommand;
+
+	osCommand = osUpdate + *posValues + ") v(tid, x, y, a) where w.ctid = v.tid";
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::WriteRaster(): "
+		"Sending %d bytes of updates", (int)osCommand.size());
+
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_COMMAND_OK) {
+		CPLError(CE_Failure, CPLE_AppDefined, "Error writing the band data: %s",
+			PostGISRasterErrorMessage(poConn));
+		eErr = CE_Failure;
+	}
+	else if (atoi(PQcmdTuples(poResult)) != *pnTiles) {
+		CPLError(CE_Failure, CPLE_AppDefined, "Error writing the band data: "
+			"%s of %d tiles updated", PQcmdTuples(poResult), *pnTiles);
+		eErr = CE_Failure;
+	}
+	if (poResult != NULL)
+		PQclear(poResult);
+
+	*posValues = "";
+	*pnTiles = 0;
+
+	return eErr;
+}
+
+/**
+ * \brief Write a window of the band.
+ *
+ * Only the pixels of the window are sent: for each tile it intersects, the
+ * part of the window it covers goes as an array to ST_SetValues. The tiles
+ * are updated by batches of up to WRITE_BATCH_SIZE bytes, one statement
+ * each. So the bytes sent scale with the window size, not with the tile
+ * size. The tile stats (see PostGISRasterDataset::UpdateTileStats) of the
+ * tiles written are cleared.
+ *
+ * The tiles are locked when they're looked for, and the whole write is one
+ * transaction: it fails, and nothing is written, if a tile can't be updated,
+ * or if no tile intersects the window.
+ *
+ * The overview tables of the coverage (listed in raster_overviews) aren't
+ * rebuilt, so writing a coverage that has some is rejected.
+ *
+ * The server needs PostGIS 2.1 (ST_SetValues).
+ */
+CPLErr PostGISRasterRasterBand::WriteRaster(int nXOff, int nYOff, int nXSize,
+	int nYSize, void * pData, GDALDataType eBufType, int nPixelSpace, 
+	int nLineSpace)
+{
+	PostGISRasterDataset * poPostGISRasterDS = (PostGISRasterDataset*)poDS;
+	PGconn * poConn = poPostGISRasterDS->poConn;
+	double adfTransform[6];
+	CPLString osCommand;
+	CPLString osWhere;
+	CPLString osClearStats;
+	CPLString osUpdate;
+	CPLString osValues;
+	PGresult* poResult = NULL;
+	double * padfLine = NULL;
+	int nTuples;
+	int nBatchTiles = 0;
+	int iTuple, iY, iX;
+	int nTileXOff, nTileYOff, nTileXSize, nTileYSize;
+	int nWriteXOff, nWriteYOff, nWriteXEnd, nWriteYEnd;
+	CPLErr eErr = CE_None;
+
+	if (eAccess != GA_Update) {
+		CPLError(CE_Failure, CPLE_NoWriteAccess, "The dataset was opened in "
+			"read-only mode");
+
+		return CE_Failure;
+	}
+
+	if (nOverviewFactor > 0 || bIsOffline) {
+		CPLError(CE_Failure, CPLE_NotSupported, "Writing %s is not supported",
+			(bIsOffline) ? "out-db bands" : "overviews");
+
+		return CE_Failure;
+	}
+
+	if (nOverviewCount > 0) {
+		CPLError(CE_Failure, CPLE_NotSupported, "%s.%s has %d overview "
+			"tables, which wouldn't be updated. Writing it is not supported",
+			poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable, 
+			nOverviewCount);
+
+		return CE_Failure;
+	}
+
+	if (poPostGISRasterDS->nHasTileStats < 0)
+		poPostGISRasterDS->nHasTileStats = 
+			PostGISRasterDataset::HasTileStats(poConn,
+			poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable,
+			poPostGISRasterDS->pszColumn);
+
+	if (poPostGISRasterDS->nHasTileStats)
+		osClearStats.Printf(", %s" TILE_STATS_MIN_SUFFIX " = null, %s" 
+			TILE_STATS_MAX_SUFFIX " = null", poPostGISRasterDS->pszColumn,
+			poPostGISRasterDS->pszColumn);
+
+	/* The tiles of a batch follow, as (ctid, column, row, values) */
+	osUpdate.Printf("update %s.%s w set %s = st_setvalues(w.%s, %d, v.x, v.y, "
+		"v.a)%s from (values ",
+		poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable, 
+		poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszColumn, nBand,
+		osClearStats.c_str());
+
+	/**
+	 * The tiles the window intersects, and where they are
+	 **/
+	poPostGISRasterDS->GetGeoTransform(adfTransform);
+
+	if (poPostGISRasterDS->pszWhere == NULL)
+		osWhere = "";
+	else
+		osWhere.Printf("%s AND ", poPostGISRasterDS->pszWhere);
+
+	osCommand.Printf("SELECT ctid, st_upperleftx(%s), st_upperlefty(%s), "
+		"st_width(%s), st_height(%s) FROM %s.%s WHERE %sst_intersects(%s, "
+		"st_makeenvelope(%.17f, %.17f, %.17f, %.17f, %d)) FOR UPDATE", 
+		poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszColumn,
+		poPostGISRasterDS->pszColumn, poPostGISRasterDS->pszColumn,
+		poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable, 
+		osWhere.c_str(), poPostGISRasterDS->pszColumn,
+		adfTransform[GEOTRSFRM_TOPLEFT_X] + nXOff * adfTransform[GEOTRSFRM_WE_RES],
+		MIN(adfTransform[GEOTRSFRM_TOPLEFT_Y] + nYOff * adfTransform[GEOTRSFRM_NS_RES],
+		adfTransform[GEOTRSFRM_TOPLEFT_Y] + (nYOff + nYSize) * 
+		adfTransform[GEOTRSFRM_NS_RES]),
+		adfTransform[GEOTRSFRM_TOPLEFT_X] + (nXOff + nXSize) * 
+		adfTransform[GEOTRSFRM_WE_RES],
+		MAX(adfTransform[GEOTRSFRM_TOPLEFT_Y] + nYOff * adfTransform[GEOTRSFRM_NS_RES],
+		adfTransform[GEOTRSFRM_TOPLEFT_Y] + (nYOff + nYSize) * 
+		adfTransform[GEOTRSFRM_NS_RES]),
+		poPostGISRasterDS->nSrid);
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::WriteRaster(): "
+		"Query = %s", osCommand.c_str());
+
+	if (RunWriteCommand(poConn, "begin") != CE_None)
+		return CE_Failure;
+
+	poResult = PostGISRasterExec(poConn, osCommand.c_str());
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK) {
+		CPLError(CE_Failure, CPLE_AppDefined, "Error getting the tiles to "
+			"write: %s", PostGISRasterErrorMessage(poConn));
+		if (poResult != NULL)
+			PQclear(poResult);
+		RunWriteCommand(poConn, "rollback");
+
+		return CE_Failure;
+	}
+
+	nTuples = PQntuples(poResult);
+	if (nTuples == 0) {
+		PQclear(poResult);
+		RunWriteCommand(poConn, "rollback");
+		CPLError(CE_Failure, CPLE_AppDefined, "No tile covers the window "
+			"(%d, %d, %d, %d), nothing written", nXOff, nYOff, nXSize, nYSize);
+
+		return CE_Failure;
+	}
+
+	padfLine = (double *) VSIMalloc2(nXSize, sizeof(double));
+	if (padfLine == NULL) {
+		PQclear(poResult);
+		RunWriteCommand(poConn, "rollback");
+		CPLError(CE_Failure, CPLE_OutOfMemory, "Can't allocate the line "
+			"buffer to write");
+
+		return CE_Failure;
+	}
+
+	/**
+	 * One row of values per tile, with the part of the window it covers
+	 **/
+	for(iTuple = 0; iTuple < nTuples && eErr == CE_None; iTuple++) {
+		nTileXOff = (int) floor(0.5 + (CPLAtof(PQgetvalue(poResult, iTuple, 1)) - 
+			adfTransform[GEOTRSFRM_TOPLEFT_X]) / adfTransform[GEOTRSFRM_WE_RES]);
+		nTileYOff = (int) floor(0.5 + (CPLAtof(PQgetvalue(poResult, iTuple, 2)) - 
+			adfTransform[GEOTRSFRM_TOPLEFT_Y]) / adfTransform[GEOTRSFRM_NS_RES]);
+		nTileXSize = atoi(PQgetvalue(poResult, iTuple, 3));
+		nTileYSize = atoi(PQgetvalue(poResult, iTuple, 4));
+
+		nWriteXOff = MAX(nXOff, nTileXOff);
+		nWriteYOff = MAX(nYOff, nTileYOff);
+		nWriteXEnd = MIN(nXOff + nXSize, nTileXOff + nTileXSize);
+		nWriteYEnd = MIN(nYOff + nYSize, nTileYOff + nTileYSize);
+
+		/* Only touches the window */
+		if (nWriteXEnd <= nWriteXOff || nWriteYEnd <= nWriteYOff)
+			continue;
+
+		osCommand.Printf("%s('%s'::tid, %d, %d, '{", (nBatchTiles > 0) ? "," : "",
+			PQgetvalue(poResult, iTuple, 0), nWriteXOff - nTileXOff + 1, 
+			nWriteYOff - nTileYOff + 1);
+
+		for(iY = nWriteYOff; iY < nWriteYEnd; iY++) {
+			GDALCopyWords((GByte *)pData + (GIntBig)(iY - nYOff) * nLineSpace +
+				(GIntBig)(nWriteXOff - nXOff) * nPixelSpace, eBufType, 
+				nPixelSpace, padfLine, GDT_Float64, sizeof(double), 
+				nWriteXEnd - nWriteXOff);
+
+			osCommand += (iY > nWriteYOff) ? ",{" : "{";
+			for(iX = 0; iX < nWriteXEnd - nWriteXOff; iX++) {
+				if (iX > 0)
+					osCommand += ",";
+				AppendPixelValue(&osCommand, padfLine[iX], eDataType);
+			}
+			osCommand += "}";
+		}
+
+		osCommand += "}'::double precision[])";
+
+		osValues += osCommand;
+		nBatchTiles++;
+
+		if (osValues.size() >= WRITE_BATCH_SIZE)
+			eErr = SendWriteBatch(poConn, osUpdate, &osValues, &nBatchTiles);
+	}
+
 	PQclear(poResult);
-	
-	// Just for testing (writes VRT file, with name = dataset description, to disk)
-	VRTFlushCache(vrtDataset);
 
-	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): VRT file created");
+	if (eErr == CE_None && nBatchTiles > 0)
+		eErr = SendWriteBatch(poConn, osUpdate, &osValues, &nBatchTiles);
 
-	// Execute VRT RasterIO over the band
-	err = ((VRTRasterBand *)vrtRasterBand)->RasterIO(eRWFlag, nXOff, nYOff, nXSize, 
-		nYSize, pData, nBufXSize, nBufYSize, eBufType, nPixelSpace, nLineSpace);
+	if (eErr == CE_None)
+		eErr = RunWriteCommand(poConn, "commit");
+	else
+		RunWriteCommand(poConn, "rollback");
 
-	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): Data read");
+	CPLFree(padfLine);
 
-	GDALClose(vrtDataset);
-	
-	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): VRTDataset released");
-	
-	// Free resources
-	for(iTuplesIndex = 0; iTuplesIndex < nTuples; iTuplesIndex++) {
-		delete memDatasets[iTuplesIndex];
-		//GDALClose(memDatasets[iTuplesIndex]);
+	/**
+	 * The cached blocks of the table are dropped, whatever the outcome, as
+	 * a failed commit leaves the tiles unknown. The keys have the connection
+	 * string, so the blocks read by other datasets of the table (other
+	 * options, or the overview bands) can only be found by the table
+	 **/
+	PostGISRasterTileCache::GetInstance()->InvalidateTable(
+		poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable);
+
+	return eErr;
+}
+
+/**
+ * \brief Get the memory budget for a single read request, in bytes.
+ * It's set with the POSTGIS_RASTER_MEMORY_BUDGET configuration option, in
+ * megabytes. 0 means no limit.
+ */
+GIntBig PostGISRasterRasterBand::GetMemoryBudget()
+{
+	GIntBig nBudgetMB = CPLAtoGIntBig(CPLGetConfigOption(
+		"POSTGIS_RASTER_MEMORY_BUDGET", DEFAULT_MEMORY_BUDGET));
+
+	return (nBudgetMB > 0) ? nBudgetMB * 1024 * 1024 : 0;
+}
+
+/**
+ * \brief Estimate the memory needed to read a window of this band.
+ * The tiles intersecting the window may stick out of it up to one block
+ * per side, and all of them are held as hex text. Add the resampling sums
+ * (two doubles per buffer pixel) when the buffer size is not the window
+ * size.
+ */
+GIntBig PostGISRasterRasterBand::EstimateRequestMemory(int nXSize, int nYSize,
+	int nBufXSize, int nBufYSize)
+{
+	GIntBig nPixels = (GIntBig)(nXSize + nBlockXSize) * (nYSize + nBlockYSize);
+	int nDataSize = GDALGetDataTypeSize(eDataType) / 8;
+	GIntBig nEstimate = nPixels * nDataSize * 2;
+
+	if (nBufXSize != nXSize || nBufYSize != nYSize)
+		nEstimate += (GIntBig)nBufXSize * nBufYSize * 2 * sizeof(double);
+
+	return nEstimate;
+}
+
+/**
+ * \brief Find where to split a window along one axis, so each half maps
+ * onto whole buffer pixels with the scale of the whole window: the halves
+ * are resampled exactly as the whole window would be, with no seam. That's
+ * a multiple of nSize / gcd(nSize, nBufSize) window pixels. Without
+ * resampling, any split works, and it's moved to a block boundary when
+ * possible. Returns false if the axis can't be split.
+ */
+static GBool GetExactSplit(int nOff, int nSize, int nBufSize, int nBlockSize,
+	int * pnSplit, int * pnBufSplit)
+{
+	int nGCD = nSize, nRemainder = nBufSize, nTmp;
+
+	if (nSize <= nBlockSize || nBufSize < 2)
+		return false;
+
+	if (nBufSize == nSize) {
+		*pnSplit = nSize / 2;
+		if (*pnSplit > nBlockSize)
+			*pnSplit -= (nOff + *pnSplit) % nBlockSize;
+		*pnBufSplit = *pnSplit;
+
+		return true;
 	}
-	CPLFree(memDatasets);
-	
-	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::IRasterIO(): MEMDatasets released");
 
-	return err;
-		
+	while (nRemainder != 0) {
+		nTmp = nGCD % nRemainder;
+		nGCD = nRemainder;
+		nRemainder = nTmp;
+	}
+
+	if (nGCD < 2)
+		return false;
+
+	*pnSplit = (nGCD / 2) * (nSize / nGCD);
+	*pnBufSplit = (nGCD / 2) * (nBufSize / nGCD);
+
+	return true;
+}
+
+/**
+ * \brief Read a window as two halves, one after the other.
+ *
+ * The window is split across its longer side (in blocks), or across the
+ * other one if the longer one can't be split exactly (see GetExactSplit).
+ * The halves are read in the order of the Hilbert index of their center
+ * blocks, so the sub-windows of a big request are fetched along a Hilbert
+ * curve, like the tiles of a spatially clustered table are laid out. Each
+ * half goes through IRasterIO again, so it's split further if still over
+ * the budget. Returns false if the window can't be split: it's not bigger
+ * than a block, its scale to the buffer has no exact split, or it's
+ * resampled with a kernel (BILINEAR, CUBIC) that reads the tiles of the
+ * other half near the seam.
+ */
+GBool PostGISRasterRasterBand::SplitRasterIO(int nXOff, int nYOff, int nXSize,
+	int nYSize, void * pData, int nBufXSize, int nBufYSize, GDALDataType eBufType,
+	int nPixelSpace, int nLineSpace, CPLErr * peErr)
+{
+	GByte * pabyData = (GByte *)pData;
+	PostGISRasterResampling eResampling;
+	GBool bSplitRows, bCanSplitRows, bCanSplitColumns;
+	int anXOff[2], anYOff[2], anXSize[2], anYSize[2];
+	int anBufXSize[2], anBufYSize[2];
+	GIntBig anBufOffset[2];
+	int nRowSplit = 0, nBufRowSplit = 0, nColumnSplit = 0, nBufColumnSplit = 0;
+	int iFirst, i;
+
+	if (nBufXSize != nXSize || nBufYSize != nYSize) {
+		eResampling = PostGISRasterResampler::GetResampling();
+		if (eResampling == RESAMPLING_BILINEAR || eResampling == RESAMPLING_CUBIC)
+			return false;
+	}
+
+	bCanSplitRows = GetExactSplit(nYOff, nYSize, nBufYSize, nBlockYSize,
+		&nRowSplit, &nBufRowSplit);
+	bCanSplitColumns = GetExactSplit(nXOff, nXSize, nBufXSize, nBlockXSize,
+		&nColumnSplit, &nBufColumnSplit);
+
+	if (bCanSplitRows && bCanSplitColumns)
+		bSplitRows = (nYSize / nBlockYSize >= nXSize / nBlockXSize);
+	else if (bCanSplitRows || bCanSplitColumns)
+		bSplitRows = bCanSplitRows;
+	else
+		return false;
+
+	for(i = 0; i < 2; i++) {
+		anXOff[i] = nXOff;
+		anYOff[i] = nYOff;
+		anXSize[i] = nXSize;
+		anYSize[i] = nYSize;
+		anBufXSize[i] = nBufXSize;
+		anBufYSize[i] = nBufYSize;
+		anBufOffset[i] = 0;
+	}
+
+	if (bSplitRows) {
+		anYSize[0] = nRowSplit;
+		anBufYSize[0] = nBufRowSplit;
+		anYOff[1] = nYOff + nRowSplit;
+		anYSize[1] = nYSize - nRowSplit;
+		anBufYSize[1] = nBufYSize - nBufRowSplit;
+		anBufOffset[1] = (GIntBig)nBufRowSplit * nLineSpace;
+	}
+	else {
+		anXSize[0] = nColumnSplit;
+		anBufXSize[0] = nBufColumnSplit;
+		anXOff[1] = nXOff + nColumnSplit;
+		anXSize[1] = nXSize - nColumnSplit;
+		anBufXSize[1] = nBufXSize - nBufColumnSplit;
+		anBufOffset[1] = (GIntBig)nBufColumnSplit * nPixelSpace;
+	}
+
+	iFirst = (PostGISRasterHilbertIndex(
+		(anXOff[1] + anXSize[1] / 2) / nBlockXSize,
+		(anYOff[1] + anYSize[1] / 2) / nBlockYSize) <
+		PostGISRasterHilbertIndex(
+		(anXOff[0] + anXSize[0] / 2) / nBlockXSize,
+		(anYOff[0] + anYSize[0] / 2) / nBlockYSize)) ? 1 : 0;
+
+	*peErr = CE_None;
+	for(i = iFirst; i < iFirst + 2 && *peErr == CE_None; i++)
+		*peErr = IRasterIO(GF_Read, anXOff[i % 2], anYOff[i % 2], anXSize[i % 2],
+			anYSize[i % 2], pabyData + anBufOffset[i % 2], anBufXSize[i % 2],
+			anBufYSize[i % 2], eBufType, nPixelSpace, nLineSpace);
+
+	return true;
+}
+
+/**
+ * \brief Read a downsampled window as an image rendered by the server
+ * (quicklook open option).
+ *
+ * The tiles of the window are clipped to it, resampled to the grid of the
+ * buffer and merged by the server, then sent as a PNG or JPEG image, that
+ * is decoded here through /vsimem/. Only 8 bits unsigned bands can be
+ * encoded. The image covers the part of the window with tiles, the rest
+ * of the buffer is filled with nodata. Returns false if the band has no
+ * quick looks, or the server couldn't render one or it couldn't be
+ * decoded (the window is read as usual then).
+ */
+GBool PostGISRasterRasterBand::QuickLookRasterIO(int nXOff, int nYOff,
+	int nXSize, int nYSize, void * pData, int nBufXSize, int nBufYSize,
+	GDALDataType eBufType, int nPixelSpace, int nLineSpace, CPLErr * peErr)
+{
+	PostGISRasterDataset * poPostGISRasterDS = (PostGISRasterDataset*)poDS;
+	double adfTransform[6];
+	double dfULX, dfULY, dfBufScaleX, dfBufScaleY;
+	double dfImageULX, dfImageULY;
+	int nImageXSize, nImageYSize;
+	int nDstXOff, nDstYOff, nSrcXOff, nSrcYOff, nCopyXSize, nCopyYSize;
+	CPLString osCommand;
+	CPLString osWhere;
+	CPLString osWindow;
+	CPLString osRows;
+	CPLString osFilename;
+	const char * pszAlgorithm;
+	PGresult * poResult = NULL;
+	GByte * pabyImage = NULL;
+	int nImageLength;
+	GDALDatasetH hImageDS;
+
+	if (poPostGISRasterDS->pszQuickLook == NULL || nOverviewFactor != 0 ||
+		eDataType != GDT_Byte ||
+		GetMetadataItem("NBITS", "IMAGE_STRUCTURE") != NULL ||
+		GetMetadataItem("PIXELTYPE", "IMAGE_STRUCTURE") != NULL)
+		return false;
+
+	/**
+	 * The window, and the grid of the buffer over it
+	 **/
+	poPostGISRasterDS->GetGeoTransform(adfTransform);
+	dfULX = adfTransform[GEOTRSFRM_TOPLEFT_X] + nXOff * adfTransform[GEOTRSFRM_WE_RES];
+	dfULY = adfTransform[GEOTRSFRM_TOPLEFT_Y] + nYOff * adfTransform[GEOTRSFRM_NS_RES];
+	dfBufScaleX = adfTransform[GEOTRSFRM_WE_RES] * nXSize / nBufXSize;
+	dfBufScaleY = adfTransform[GEOTRSFRM_NS_RES] * nYSize / nBufYSize;
+
+	osWindow.Printf("st_makeenvelope(%.17g, %.17g, %.17g, %.17g, %d)", dfULX,
+		dfULY + nYSize * adfTransform[GEOTRSFRM_NS_RES], 
+		dfULX + nXSize * adfTransform[GEOTRSFRM_WE_RES], dfULY, 
+		poPostGISRasterDS->nSrid);
+
+	if (poPostGISRasterDS->pszWhere != NULL)
+		osWhere.Printf("%s AND ", poPostGISRasterDS->pszWhere);
+
+	if (poPostGISRasterDS->pszValueFilter != NULL)
+		osWhere += CPLString().Printf("%s AND ", poPostGISRasterDS->pszValueFilter);
+
+	/* Reprojected tiles (target_srid) are selected by srid */
+	if (poPostGISRasterDS->nTargetSrid > 0)
+		osRows = poPostGISRasterDS->GetIntersectingRows(osWhere, osWindow);
+	else
+		osRows.Printf("%s.%s WHERE %sst_intersects(%s, %s)", 
+			poPostGISRasterDS->pszSchema, poPostGISRasterDS->pszTable, 
+			osWhere.c_str(), poPostGISRasterDS->pszColumn, osWindow.c_str());
+
+	/* The server resamples with GDAL: the closest to the driver kernel */
+	switch (PostGISRasterResampler::GetResampling()) {
+		case RESAMPLING_AVERAGE:
+		case RESAMPLING_BILINEAR:
+			pszAlgorithm = "Bilinear";
+			break;
+		case RESAMPLING_CUBIC:
+			pszAlgorithm = "Cubic";
+			break;
+		default:
+			pszAlgorithm = "NearestNeighbor";
+			break;
+	}
+
+	osCommand.Printf("SELECT %s(u), st_upperleftx(u), st_upperlefty(u), "
+		"st_width(u), st_height(u) FROM (SELECT st_union(st_resample(st_clip("
+		"st_band(%s, %d), %s), st_makeemptyraster(%d, %d, %.17g, %.17g, %.17g, "
+		"%.17g, 0, 0, %d), '%s')) u FROM %s) foo",
+		poPostGISRasterDS->pszQuickLook, 
+		poPostGISRasterDS->GetRasterExpression().c_str(), nBand, 
+		osWindow.c_str(), nBufXSize, nBufYSize, dfULX, dfULY, dfBufScaleX, 
+		dfBufScaleY, poPostGISRasterDS->nSrid, pszAlgorithm, osRows.c_str());
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::QuickLookRasterIO(): "
+		"Query = %s", osCommand.c_str());
+
+	poResult = PostGISRasterExec(poPostGISRasterDS->poConn, osCommand.c_str());
+	if (poResult == NULL || PQresultStatus(poResult) != PGRES_TUPLES_OK ||
+		PQntuples(poResult) != 1) {
+		CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::QuickLookRasterIO(): "
+			"%s", PostGISRasterErrorMessage(poPostGISRasterDS->poConn));
+
+		if (poResult != NULL)
+			PQclear(poResult);
+
+		return false;
+	}
+
+	*peErr = CE_None;
+
+	FillBuffer((GByte *)pData, eBufType, nPixelSpace, nLineSpace, nBufXSize,
+		nBufYSize, (bHasNoDataValue) ? dfNoDataValue : 0.0);
+
+	/* No tiles in the window */
+	if (PQgetisnull(poResult, 0, 0)) {
+		PQclear(poResult);
+		return true;
+	}
+
+	dfImageULX = atof(PQgetvalue(poResult, 0, 1));
+	dfImageULY = atof(PQgetvalue(poResult, 0, 2));
+	nImageXSize = atoi(PQgetvalue(poResult, 0, 3));
+	nImageYSize = atoi(PQgetvalue(poResult, 0, 4));
+
+	pabyImage = (GByte *) VSIMalloc(PQgetlength(poResult, 0, 0) / 2 + 1);
+	if (pabyImage == NULL) {
+		PQclear(poResult);
+		return false;
+	}
+
+	nImageLength = PostGISRasterHexToBinary(PQgetvalue(poResult, 0, 0),
+		PQgetlength(poResult, 0, 0), pabyImage);
+
+	PQclear(poResult);
+
+	/**
+	 * Place the image in the buffer: it's on the grid of the buffer, but
+	 * only covers the tiles
+	 **/
+	nDstXOff = (int)floor(0.5 + (dfImageULX - dfULX) / dfBufScaleX);
+	nDstYOff = (int)floor(0.5 + (dfImageULY - dfULY) / dfBufScaleY);
+	nSrcXOff = MAX(-nDstXOff, 0);
+	nSrcYOff = MAX(-nDstYOff, 0);
+	nDstXOff = MAX(nDstXOff, 0);
+	nDstYOff = MAX(nDstYOff, 0);
+	nCopyXSize = MIN(nImageXSize - nSrcXOff, nBufXSize - nDstXOff);
+	nCopyYSize = MIN(nImageYSize - nSrcYOff, nBufYSize - nDstYOff);
+
+	if (nCopyXSize <= 0 || nCopyYSize <= 0) {
+		VSIFree(pabyImage);
+		return true;
+	}
+
+	/**
+	 * Decode it from memory
+	 **/
+	osFilename.Printf("/vsimem/postgisraster_quicklook_%p_%p", this, pData);
+	VSIFCloseL(VSIFileFromMemBuffer(osFilename.c_str(), pabyImage, 
+		nImageLength, false));
+
+	// A failed decode isn't an error for the caller, that reads the tiles
+	CPLPushErrorHandler(CPLQuietErrorHandler);
+	hImageDS = GDALOpen(osFilename.c_str(), GA_ReadOnly);
+	CPLPopErrorHandler();
+	if (hImageDS == NULL || GDALGetRasterCount(hImageDS) < 1 ||
+		GDALGetRasterXSize(hImageDS) != nImageXSize ||
+		GDALGetRasterYSize(hImageDS) != nImageYSize) {
+		CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::QuickLookRasterIO(): "
+			"Couldn't decode the quick look of band %d", nBand);
+		*peErr = CE_Failure;
+	}
+	else
+		*peErr = GDALRasterIO(GDALGetRasterBand(hImageDS, 1), GF_Read, 
+			nSrcXOff, nSrcYOff, nCopyXSize, nCopyYSize, (GByte *)pData + 
+			(GIntBig)nDstYOff * nLineSpace + (GIntBig)nDstXOff * nPixelSpace,
+			nCopyXSize, nCopyYSize, eBufType, nPixelSpace, nLineSpace);
+
+	if (hImageDS != NULL)
+		GDALClose(hImageDS);
+
+	VSIUnlink(osFilename.c_str());
+	VSIFree(pabyImage);
+
+	/* The window is read from the tiles then, overwriting the buffer */
+	if (*peErr != CE_None)
+		return false;
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::QuickLookRasterIO(): "
+		"%d bytes image, %dx%d pixels", nImageLength, nImageXSize, nImageYSize);
+
+	return true;
 }
 
 /**
@@ -837,4 +1659,167 @@ CPLErr PostGISRasterRasterBand::IReadBlock(int nBlockXOff, int nBlockYOff, void*
                       nPixelSize, nPixelSize * nBlockXSize );
 }
 
+/**
+ * \brief Write a dirty block of the GDAL cache. Blocks at the right and
+ * bottom edges are clipped to the raster.
+ */
+CPLErr PostGISRasterRasterBand::IWriteBlock(int nBlockXOff, int nBlockYOff,
+        void * pImage)
+{
+    int nPixelSize = GDALGetDataTypeSize(eDataType)/8;
+
+    return WriteRaster(nBlockXOff * nBlockXSize, nBlockYOff * nBlockYSize,
+                       MIN(nBlockXSize, GetXSize() - nBlockXOff * nBlockXSize),
+                       MIN(nBlockYSize, GetYSize() - nBlockYOff * nBlockYSize),
+                       pImage, eDataType, nPixelSize, nPixelSize * nBlockXSize);
+}
+
+
+
+#if GDAL_VERSION_NUM >= 1110000
+
+/**
+ * \brief Fill a page of a virtual memory mapping of the band.
+ * The pages of GetVirtualMemAuto cover whole tile rows, and those lines
+ * are read straight into them. A page that isn't line aligned has the
+ * lines it overlaps read into a temporary buffer, and copied out of it. A
+ * page that can't be read is zeroed, as there's no way to report the
+ * error from here.
+ */
+static void PostGISRasterFillVirtualMemPage(CPLVirtualMem * /* ctxt */,
+	size_t nOffset, void * pPageToFill, size_t nToFill, void * pUserData)
+{
+	PostGISRasterRasterBand * poBand = (PostGISRasterRasterBand *)pUserData;
+	GDALDataType eDataType = poBand->GetRasterDataType();
+	int nPixelSize = GDALGetDataTypeSize(eDataType) / 8;
+	int nXSize = poBand->GetXSize();
+	int nYSize = poBand->GetYSize();
+	size_t nLineSpace = (size_t)nXSize * nPixelSize;
+	int nFirstLine = (int)(nOffset / nLineSpace);
+	int nLastLine = (int)((nOffset + nToFill + nLineSpace - 1) / nLineSpace);
+	GByte * pabyLines;
+	CPLErr eErr;
+
+	if (nLastLine > nYSize)
+		nLastLine = nYSize;
+
+	if (nFirstLine >= nLastLine) {
+		memset(pPageToFill, 0, nToFill);
+		return;
+	}
+
+	if (nOffset % nLineSpace == 0 &&
+		nToFill >= (size_t)(nLastLine - nFirstLine) * nLineSpace) {
+		eErr = poBand->RasterIO(GF_Read, 0, nFirstLine, nXSize,
+			nLastLine - nFirstLine, pPageToFill, nXSize, nLastLine - nFirstLine,
+			eDataType, nPixelSize, (int)nLineSpace);
+		if (eErr != CE_None)
+			memset(pPageToFill, 0, nToFill);
+		else if (nToFill > (size_t)(nLastLine - nFirstLine) * nLineSpace)
+			memset((GByte *)pPageToFill + (nLastLine - nFirstLine) * nLineSpace,
+				0, nToFill - (nLastLine - nFirstLine) * nLineSpace);
+		return;
+	}
+
+	pabyLines = (GByte *)VSIMalloc((nLastLine - nFirstLine) * nLineSpace);
+	if (pabyLines == NULL) {
+		memset(pPageToFill, 0, nToFill);
+		return;
+	}
+
+	eErr = poBand->RasterIO(GF_Read, 0, nFirstLine, nXSize,
+		nLastLine - nFirstLine, pabyLines, nXSize, nLastLine - nFirstLine,
+		eDataType, nPixelSize, (int)nLineSpace);
+
+	memset(pPageToFill, 0, nToFill);
+	if (eErr == CE_None) {
+		size_t nSkip = nOffset - (size_t)nFirstLine * nLineSpace;
+		size_t nAvailable = (nLastLine - nFirstLine) * nLineSpace - nSkip;
+
+		memcpy(pPageToFill, pabyLines + nSkip, MIN(nToFill, nAvailable));
+	}
+
+	VSIFree(pabyLines);
+}
+
+/**
+ * \brief Map the band into memory, fetching its tiles on page faults.
+ *
+ * The band is laid out as a native-typed array of nYSize lines of nXSize
+ * pixels. A page is the least common multiple of a tile row and of the
+ * system page, so every page starts on a tile row: a fault fetches whole
+ * tile rows, one query per page, and only the rows that are actually
+ * touched ever get read. If that's more than MAX_VIRTUALMEM_PAGE_TILE_ROWS
+ * tile rows, GDALRasterBand maps the band instead. Decoded pages are kept
+ * up to the CACHE_SIZE option (bytes, a quarter of the GDAL block cache by
+ * default) and read again if they get evicted.
+ *
+ * Only read-only mappings are served this way. Anything else is left to
+ * GDALRasterBand.
+ */
+CPLVirtualMem * PostGISRasterRasterBand::GetVirtualMemAuto(GDALRWFlag eRWFlag,
+	int * pnPixelSpace, GIntBig * pnLineSpace, char ** papszOptions)
+{
+	int nPixelSize = GDALGetDataTypeSize(eDataType) / 8;
+	GIntBig nLineSpace = (GIntBig)nRasterXSize * nPixelSize;
+	GIntBig nSize = nLineSpace * nRasterYSize;
+	size_t nSystemPageSize = CPLGetPageSize();
+	size_t nTileRowSize, nGCD, nRemainder, nTileRows;
+	size_t nPageSize, nCacheSize;
+	const char * pszCacheSize;
+	CPLVirtualMem * psVirtualMem;
+
+	if (eRWFlag != GF_Read || nBlockYSize <= 0 || nSystemPageSize == 0 ||
+		nSize != (GIntBig)(size_t)nSize || nLineSpace > INT_MAX)
+		return GDALRasterBand::GetVirtualMemAuto(eRWFlag, pnPixelSpace,
+			pnLineSpace, papszOptions);
+
+	nTileRowSize = (size_t)nLineSpace * nBlockYSize;
+	nGCD = nTileRowSize;
+	nRemainder = nSystemPageSize;
+	while (nRemainder != 0) {
+		size_t nTmp = nGCD % nRemainder;
+		nGCD = nRemainder;
+		nRemainder = nTmp;
+	}
+
+	nTileRows = nSystemPageSize / nGCD;
+	if (nTileRows > MAX_VIRTUALMEM_PAGE_TILE_ROWS)
+		return GDALRasterBand::GetVirtualMemAuto(eRWFlag, pnPixelSpace,
+			pnLineSpace, papszOptions);
+
+	nPageSize = nTileRowSize * nTileRows;
+
+	pszCacheSize = CSLFetchNameValue(papszOptions, "CACHE_SIZE");
+	if (pszCacheSize != NULL)
+		nCacheSize = (size_t)CPLAtoGIntBig(pszCacheSize);
+	else
+		nCacheSize = (size_t)(GDALGetCacheMax64() / 4);
+
+	if (nCacheSize > (size_t)nSize)
+		nCacheSize = (size_t)nSize;
+	if (nCacheSize < nPageSize)
+		nCacheSize = nPageSize;
+
+	psVirtualMem = CPLVirtualMemNew((size_t)nSize, nCacheSize, nPageSize,
+		CSLFetchBoolean(papszOptions, "SINGLE_THREAD", false),
+		VIRTUALMEM_READONLY, PostGISRasterFillVirtualMemPage, NULL, NULL,
+		this);
+
+	if (psVirtualMem == NULL)
+		return GDALRasterBand::GetVirtualMemAuto(eRWFlag, pnPixelSpace,
+			pnLineSpace, papszOptions);
+
+	CPLDebug("PostGIS_Raster", "PostGISRasterRasterBand::GetVirtualMemAuto(): "
+		"mapped " CPL_FRMT_GIB " bytes, pages of %d bytes, cache of "
+		CPL_FRMT_GIB " bytes", nSize, (int)nPageSize, (GIntBig)nCacheSize);
+
+	if (pnPixelSpace != NULL)
+		*pnPixelSpace = nPixelSize;
+	if (pnLineSpace != NULL)
+		*pnLineSpace = nLineSpace;
+
+	return psVirtualMem;
+}
 
+#endif
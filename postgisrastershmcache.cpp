@@ -0,0 +1,575 @@
+/******************************************************************************
+ * File :    postgisrastershmcache.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tile cache segment shared by the processes of a host
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+#include <time.h>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define SHM_CAS(p, o, n)        __sync_bool_compare_and_swap(p, o, n)
+#define SHM_FETCH_ADD(p, n)     __sync_fetch_and_add(p, n)
+#define SHM_BARRIER()           __sync_synchronize()
+#else
+#include <windows.h>
+
+#define SHM_CAS(p, o, n)        (InterlockedCompareExchange((volatile LONG *) \
+                                    (p), (LONG) (n), (LONG) (o)) == (LONG) (o))
+#define SHM_FETCH_ADD(p, n)     InterlockedExchangeAdd((volatile LONG *) (p), \
+                                    (LONG) (n))
+#define SHM_BARRIER()           MemoryBarrier()
+#endif
+
+/**
+ * Segment layout:
+ *
+ *  PostGISRasterShmHeader | nSlots x (PostGISRasterShmSlot + payload)
+ *
+ * Slot i of set s is slot s * TILE_CACHE_SHM_WAYS + i. The creator of the
+ * file sizes and initializes it, and publishes the header magic last, so
+ * the other processes wait for it before using the segment. The slot
+ * count and size are read from the header, so all the processes agree on
+ * them whatever their configuration. A segment left by another version of
+ * the driver, or whose header doesn't match its size, is removed and
+ * created again.
+ *
+ * A process dying while it holds a slot leaves the slot locked: it's never
+ * chosen again, until the file is removed.
+ **/
+
+/* Maximum time to wait for another process to initialize the segment */
+#define SHM_INIT_WAIT_US    1000000
+#define SHM_INIT_STEP_US    1000
+
+/* Attempts to open the segment, the first one finding a stale segment */
+#define SHM_ATTACH_TRIES    2
+
+/* Attempts to lock a slot being read, to invalidate it */
+#define SHM_INVALIDATE_TRIES 100000
+
+/************************
+ * \brief Constructor
+ ************************/
+PostGISRasterSharedTileCache::PostGISRasterSharedTileCache() {
+    bAttached = false;
+    bFailed = false;
+    pszPath = NULL;
+    pabyBase = NULL;
+    nMapSize = 0;
+    psHeader = NULL;
+    nTTL = 0;
+    papabyRetired = NULL;
+    panRetiredSizes = NULL;
+    nRetired = 0;
+}
+
+/************************
+ * \brief Destructor
+ ************************/
+PostGISRasterSharedTileCache::~PostGISRasterSharedTileCache() {
+    Detach();
+#ifndef _WIN32
+    for(int i = 0; i < nRetired; i++)
+        munmap(papabyRetired[i], panRetiredSizes[i]);
+#endif
+    CPLFree(papabyRetired);
+    CPLFree(panRetiredSizes);
+    CPLFree(pszPath);
+}
+
+/***********************************************************************
+ * \brief Stop using the segment. Readers of the tile cache don't take
+ * any lock, so other threads may still be in it: it stays mapped until
+ * the destructor.
+ ***********************************************************************/
+void PostGISRasterSharedTileCache::Detach() {
+    bAttached = false;
+    psHeader = NULL;
+
+    if (pabyBase != NULL) {
+        papabyRetired = (GByte **) CPLRealloc(papabyRetired,
+            sizeof (GByte *) * (nRetired + 1));
+        panRetiredSizes = (size_t *) CPLRealloc(panRetiredSizes,
+            sizeof (size_t) * (nRetired + 1));
+        papabyRetired[nRetired] = pabyBase;
+        panRetiredSizes[nRetired] = nMapSize;
+        nRetired++;
+    }
+
+    pabyBase = NULL;
+    nMapSize = 0;
+}
+
+#ifndef _WIN32
+
+/* Is the header of a segment of nSize bytes the one this driver writes? */
+static GBool IsValidSegment(PostGISRasterShmHeader * psHeader, size_t nSize) {
+    return psHeader->nVersion == TILE_CACHE_SHM_VERSION &&
+        psHeader->nSlots >= TILE_CACHE_SHM_WAYS &&
+        psHeader->nSlots % TILE_CACHE_SHM_WAYS == 0 &&
+        psHeader->nSlotStride % ARENA_ALIGNMENT == 0 &&
+        psHeader->nSlotStride >= sizeof (PostGISRasterShmSlot) + 
+            (size_t) psHeader->nSlotSize &&
+        nSize == sizeof (PostGISRasterShmHeader) + 
+            (size_t) psHeader->nSlots * psHeader->nSlotStride;
+}
+
+/***********************************************************************
+ * \brief Map the segment file, creating it if needed. Its size is set
+ * by POSTGIS_RASTER_SHARED_TILE_CACHE_SIZE (MB), and the size of a slot
+ * by POSTGIS_RASTER_SHARED_TILE_CACHE_SLOT_SIZE (KB). A stale segment
+ * (see IsValidSegment) is unlinked and created again, once. The segment
+ * is only published in psHeader once it's ready.
+ ***********************************************************************/
+GBool PostGISRasterSharedTileCache::Attach(const char * pszFilename) {
+    int fd;
+    GBool bCreator = false;
+    struct stat sStat, sPathStat;
+    int nWaited = 0;
+    int nTry;
+    void * pMap;
+    PostGISRasterShmHeader * psMapHeader = NULL;
+    size_t nSize = 0;
+    GIntBig nSizeMB, nSlotKB, nSlots;
+    GUInt32 nSlotSize, nSlotStride;
+
+    for(nTry = 0; nTry < SHM_ATTACH_TRIES; nTry++) {
+        fd = open(pszFilename, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0)
+            bCreator = true;
+        else if (errno == EEXIST)
+            fd = open(pszFilename, O_RDWR);
+
+        if (fd < 0) {
+            CPLError(CE_Warning, CPLE_OpenFailed, "Can't open the shared tile "
+                "cache %s: %s", pszFilename, strerror(errno));
+            return false;
+        }
+
+        if (bCreator)
+            break;
+
+        /* Wait for the creator to size and initialize the segment */
+        memset(&sStat, 0, sizeof (sStat));
+        nWaited = 0;
+        for(;;) {
+            if (fstat(fd, &sStat) == 0 && 
+                    sStat.st_size >= (off_t) sizeof (PostGISRasterShmHeader)) {
+                pMap = mmap(NULL, sStat.st_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+                if (pMap == MAP_FAILED)
+                    break;
+
+                psMapHeader = (PostGISRasterShmHeader *) pMap;
+                if (psMapHeader->nMagic == TILE_CACHE_SHM_MAGIC) {
+                    SHM_BARRIER();
+                    nSize = sStat.st_size;
+                    break;
+                }
+
+                munmap(pMap, sStat.st_size);
+                psMapHeader = NULL;
+            }
+
+            if (nWaited >= SHM_INIT_WAIT_US)
+                break;
+            usleep(SHM_INIT_STEP_US);
+            nWaited += SHM_INIT_STEP_US;
+        }
+
+        close(fd);
+
+        if (psMapHeader != NULL && IsValidSegment(psMapHeader, nSize)) {
+            pabyBase = (GByte *) psMapHeader;
+            nMapSize = nSize;
+            psHeader = psMapHeader;
+
+            return true;
+        }
+
+        if (psMapHeader != NULL)
+            munmap(psMapHeader, nSize);
+        psMapHeader = NULL;
+
+        /**
+         * Stale, or its creator died before initializing it. Only unlinked
+         * if it's still the file that was checked: another process may
+         * already have replaced it
+         **/
+        CPLDebug("PostGIS_Raster", "PostGISRasterSharedTileCache::Attach(): "
+            "Replacing the stale shared tile cache %s", pszFilename);
+        if (stat(pszFilename, &sPathStat) == 0 && 
+                sPathStat.st_dev == sStat.st_dev &&
+                sPathStat.st_ino == sStat.st_ino)
+            unlink(pszFilename);
+    }
+
+    if (!bCreator) {
+        CPLError(CE_Warning, CPLE_AppDefined, "Invalid shared tile cache %s",
+            pszFilename);
+        return false;
+    }
+
+    nSizeMB = CPLAtoGIntBig(CPLGetConfigOption(
+        "POSTGIS_RASTER_SHARED_TILE_CACHE_SIZE", DEFAULT_SHARED_TILE_CACHE_SIZE));
+    nSlotKB = CPLAtoGIntBig(CPLGetConfigOption(
+        "POSTGIS_RASTER_SHARED_TILE_CACHE_SLOT_SIZE",
+        DEFAULT_SHARED_TILE_CACHE_SLOT_SIZE));
+    nSlotSize = (GUInt32) MAX(1, nSlotKB) * 1024;
+    nSlotStride = sizeof (PostGISRasterShmSlot) + nSlotSize;
+
+    nSlotStride += (ARENA_ALIGNMENT - nSlotStride % ARENA_ALIGNMENT) % 
+        ARENA_ALIGNMENT;
+    nSlots = MAX(1, nSizeMB) * 1024 * 1024 / nSlotStride;
+    nSlots -= nSlots % TILE_CACHE_SHM_WAYS;
+    if (nSlots < TILE_CACHE_SHM_WAYS)
+        nSlots = TILE_CACHE_SHM_WAYS;
+
+    nSize = sizeof (PostGISRasterShmHeader) + (size_t) nSlots * nSlotStride;
+
+    if (ftruncate(fd, nSize) != 0) {
+        CPLError(CE_Warning, CPLE_FileIO, "Can't size the shared tile "
+            "cache %s: %s", pszFilename, strerror(errno));
+        close(fd);
+        unlink(pszFilename);
+        return false;
+    }
+
+    pMap = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pMap == MAP_FAILED) {
+        unlink(pszFilename);
+        return false;
+    }
+
+    /* The file is zero filled: all the slots are free */
+    psMapHeader = (PostGISRasterShmHeader *) pMap;
+    psMapHeader->nVersion = TILE_CACHE_SHM_VERSION;
+    psMapHeader->nSlots = (GUInt32) nSlots;
+    psMapHeader->nSlotSize = nSlotSize;
+    psMapHeader->nSlotStride = nSlotStride;
+    psMapHeader->nClockHand = 0;
+    psMapHeader->nGeneration = 0;
+    SHM_BARRIER();
+    psMapHeader->nMagic = TILE_CACHE_SHM_MAGIC;
+    psMapHeader->nMagic = TILE_CACHE_SHM_MAGIC;
+
+    pabyBase = (GByte *) psMapHeader;
+    nMapSize = nSize;
+    psHeader = psMapHeader;
+
+    return true;
+}
+
+/* Try to take a reference on a slot. Fails if it's being written */
+GBool PostGISRasterSharedTileCache::AcquireSlot(PostGISRasterShmSlot * psSlot) {
+    GInt32 nRefCount;
+
+    do {
+        nRefCount = psSlot->nRefCount;
+        if (nRefCount < 0)
+            return false;
+    } while (!SHM_CAS(&psSlot->nRefCount, nRefCount, 
+        nRefCount + 1));
+
+    return true;
+}
+
+void PostGISRasterSharedTileCache::ReleaseSlot(PostGISRasterShmSlot * psSlot) {
+    SHM_FETCH_ADD(&psSlot->nRefCount, -1);
+}
+
+#else /* _WIN32: not implemented, the cache is disabled */
+
+GBool PostGISRasterSharedTileCache::Attach(const char * pszFilename) {
+    CPLError(CE_Warning, CPLE_NotSupported, "The shared tile cache is not "
+        "supported on this platform");
+    return false;
+}
+
+GBool PostGISRasterSharedTileCache::AcquireSlot(PostGISRasterShmSlot * psSlot) {
+    return false;
+}
+
+void PostGISRasterSharedTileCache::ReleaseSlot(PostGISRasterShmSlot * psSlot) {
+}
+
+#endif
+
+/***********************************************************************
+ * \brief Read the settings. The shared cache is enabled if the
+ * POSTGIS_RASTER_SHARED_TILE_CACHE configuration option is set to the
+ * path of the segment file, which is mapped then.
+ * The slot lifetime is read from POSTGIS_RASTER_SHARED_TILE_CACHE_TTL.
+ * Must be called with the tile cache mutex held.
+ ***********************************************************************/
+GBool PostGISRasterSharedTileCache::Configure() {
+    const char * pszFilename = CPLGetConfigOption(
+        "POSTGIS_RASTER_SHARED_TILE_CACHE", NULL);
+
+    nTTL = (GUInt32) MAX(0, atoi(CPLGetConfigOption(
+        "POSTGIS_RASTER_SHARED_TILE_CACHE_TTL", DEFAULT_SHARED_TILE_CACHE_TTL)));
+
+    if (pszFilename == NULL || pszFilename[0] == '\0') {
+        if (bAttached)
+            Detach();
+        return false;
+    }
+
+    /* Switched to another segment? */
+    if (pszPath != NULL && strcmp(pszPath, pszFilename) != 0) {
+        Detach();
+        CPLFree(pszPath);
+        pszPath = NULL;
+        bFailed = false;
+    }
+
+    if (!bAttached && !bFailed) {
+        CPLFree(pszPath);
+        pszPath = CPLStrdup(pszFilename);
+        bAttached = Attach(pszFilename);
+        bFailed = !bAttached;
+    }
+
+    return bAttached;
+}
+
+/***********************************************************************
+ * \brief Is the shared cache enabled, by the last Configure()? The
+ * methods below read psHeader once: it may be reset by Configure(), but
+ * the segment it pointed to stays mapped.
+ ***********************************************************************/
+GBool PostGISRasterSharedTileCache::IsEnabled() {
+    return bAttached;
+}
+
+/* Slot nIndex of a segment */
+PostGISRasterShmSlot * PostGISRasterSharedTileCache::GetSlot(
+    PostGISRasterShmHeader * psSegment, GUInt32 nIndex)
+{
+    return (PostGISRasterShmSlot *) ((GByte *) psSegment + 
+        sizeof (PostGISRasterShmHeader) + 
+        (size_t) nIndex * psSegment->nSlotStride);
+}
+
+/**
+ * Was a slot stored in the current generation, and less than nTTL
+ * seconds ago? Without the slot held, the answer may be stale.
+ **/
+GBool PostGISRasterSharedTileCache::IsFresh(
+    PostGISRasterShmHeader * psSegment, PostGISRasterShmSlot * psSlot,
+    GUInt32 nNow)
+{
+    if (psSlot->nGeneration != psSegment->nGeneration)
+        return false;
+
+    return nTTL == 0 || nNow - psSlot->nStoreTime < nTTL;
+}
+
+/***********************************************************************
+ * \brief Look for a block, by the two hashes of its key. Same contract
+ * as PostGISRasterTileCache::Get(). Expired slots are misses.
+ ***********************************************************************/
+GBool PostGISRasterSharedTileCache::Get(GUInt32 nHash1, GUInt32 nHash2,
+    GByte * pabyOut, int nSize, GBool * pbEmpty)
+{
+    PostGISRasterShmHeader * psSegment = psHeader;
+    GUInt32 nNow = (GUInt32) time(NULL);
+    GUInt32 nSet;
+    int i;
+
+    if (psSegment == NULL)
+        return false;
+    nSet = nHash1 % (psSegment->nSlots / TILE_CACHE_SHM_WAYS);
+
+    for(i = 0; i < TILE_CACHE_SHM_WAYS; i++) {
+        PostGISRasterShmSlot * psSlot = GetSlot(psSegment,
+            nSet * TILE_CACHE_SHM_WAYS + i);
+
+        if (psSlot->nHash1 != nHash1 || psSlot->nHash2 != nHash2 ||
+                !AcquireSlot(psSlot))
+            continue;
+
+        /* Check again, now that the slot can't change */
+        if (psSlot->nHash1 == nHash1 && psSlot->nHash2 == nHash2 &&
+                IsFresh(psSegment, psSlot, nNow) &&
+                (psSlot->bEmpty || psSlot->nSize == nSize)) {
+            *pbEmpty = psSlot->bEmpty;
+            if (!psSlot->bEmpty)
+                memcpy(pabyOut, (GByte *) (psSlot + 1), nSize);
+            psSlot->bReferenced = 1;
+            ReleaseSlot(psSlot);
+
+            return true;
+        }
+
+        ReleaseSlot(psSlot);
+    }
+
+    return false;
+}
+
+/***********************************************************************
+ * \brief Store a block, replacing a slot of its set chosen by the clock
+ * algorithm. Blocks bigger than a slot aren't stored. Gives up if all
+ * the candidate slots are in use. An expired copy of the block is
+ * overwritten first.
+ ***********************************************************************/
+void PostGISRasterSharedTileCache::Put(GUInt32 nHash1, GUInt32 nHash2,
+    const GByte * pabyData, int nSize, GBool bEmpty)
+{
+    PostGISRasterShmHeader * psSegment = psHeader;
+    GUInt32 nNow = (GUInt32) time(NULL);
+    GUInt32 nSet, nGeneration, nHand;
+    int i;
+
+    if (psSegment == NULL)
+        return;
+    nSet = nHash1 % (psSegment->nSlots / TILE_CACHE_SHM_WAYS);
+    nGeneration = psSegment->nGeneration;
+
+    if (!bEmpty && (GUInt32) nSize > psSegment->nSlotSize)
+        return;
+
+    /* Already there? */
+    for(i = 0; i < TILE_CACHE_SHM_WAYS; i++) {
+        PostGISRasterShmSlot * psSlot = GetSlot(psSegment,
+            nSet * TILE_CACHE_SHM_WAYS + i);
+
+        if (psSlot->nHash1 != nHash1 || psSlot->nHash2 != nHash2)
+            continue;
+
+        if (IsFresh(psSegment, psSlot, nNow))
+            return;
+
+        Invalidate(nHash1, nHash2);
+        break;
+    }
+
+    /**
+     * Two turns of the clock: the first one may only clear the
+     * referenced bits
+     **/
+    nHand = (GUInt32) SHM_FETCH_ADD(&psSegment->nClockHand, 1);
+    for(i = 0; i < 2 * TILE_CACHE_SHM_WAYS; i++) {
+        PostGISRasterShmSlot * psSlot = GetSlot(psSegment,
+            nSet * TILE_CACHE_SHM_WAYS + (nHand + i) % TILE_CACHE_SHM_WAYS);
+
+        if (psSlot->bReferenced) {
+            psSlot->bReferenced = 0;
+            continue;
+        }
+
+        if (!SHM_CAS(&psSlot->nRefCount, 0, -1))
+            continue;
+
+        /* Invalidate the old key before overwriting the payload */
+        psSlot->nHash1 = 0;
+        psSlot->nHash2 = 0;
+        SHM_BARRIER();
+
+        if (!bEmpty)
+            memcpy((GByte *) (psSlot + 1), pabyData, nSize);
+        psSlot->nSize = nSize;
+        psSlot->bEmpty = bEmpty;
+        psSlot->nGeneration = nGeneration;
+        psSlot->nStoreTime = nNow;
+        psSlot->nHash1 = nHash1;
+        psSlot->nHash2 = nHash2;
+        psSlot->bReferenced = 1;
+        SHM_BARRIER();
+
+        psSlot->nRefCount = 0;
+
+        return;
+    }
+}
+
+/***********************************************************************
+ * \brief Remove a block, by the two hashes of its key. Waits for the
+ * readers copying it out, and gives up if the slot stays in use (a
+ * process died while holding it).
+ ***********************************************************************/
+void PostGISRasterSharedTileCache::Invalidate(GUInt32 nHash1, GUInt32 nHash2)
+{
+    PostGISRasterShmHeader * psSegment = psHeader;
+    GUInt32 nSet;
+    int i, nTries;
+
+    if (psSegment == NULL)
+        return;
+    nSet = nHash1 % (psSegment->nSlots / TILE_CACHE_SHM_WAYS);
+
+    for(i = 0; i < TILE_CACHE_SHM_WAYS; i++) {
+        PostGISRasterShmSlot * psSlot = GetSlot(psSegment,
+            nSet * TILE_CACHE_SHM_WAYS + i);
+
+        for(nTries = 0; psSlot->nHash1 == nHash1 && psSlot->nHash2 == nHash2 &&
+                nTries < SHM_INVALIDATE_TRIES; nTries++) {
+            if (!SHM_CAS(&psSlot->nRefCount, 0, -1))
+                continue;
+
+            if (psSlot->nHash1 == nHash1 && psSlot->nHash2 == nHash2) {
+                psSlot->nHash1 = 0;
+                psSlot->nHash2 = 0;
+                psSlot->bReferenced = 0;
+            }
+            SHM_BARRIER();
+
+            psSlot->nRefCount = 0;
+        }
+
+        if (psSlot->nHash1 == nHash1 && psSlot->nHash2 == nHash2)
+            CPLDebug("PostGIS_Raster", "PostGISRasterSharedTileCache::"
+                "Invalidate(): Slot still in use, not invalidated");
+    }
+}
+
+/***********************************************************************
+ * \brief Drop all the slots, in every process sharing the segment, by
+ * starting a new generation. Used when a table is rewritten or dropped,
+ * as only hashes of the keys are stored.
+ ***********************************************************************/
+void PostGISRasterSharedTileCache::InvalidateAll()
+{
+    PostGISRasterShmHeader * psSegment = psHeader;
+
+    if (psSegment == NULL)
+        return;
+
+    SHM_FETCH_ADD(&psSegment->nGeneration, 1);
+    SHM_BARRIER();
+}
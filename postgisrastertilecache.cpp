@@ -0,0 +1,797 @@
+/******************************************************************************
+ * File :    postgisrastertilecache.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Process wide cache of decoded PostGIS Raster blocks
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+#include "cpl_vsi.h"
+#include "cpl_string.h"
+#include "cpl_multiproc.h"
+
+static PostGISRasterTileCache oTileCache;
+
+/* FNV-1a hash of a key */
+static GUInt32 HashKey(const char * pszKey) {
+    GUInt32 nHash = 2166136261U;
+
+    while (*pszKey) {
+        nHash ^= (GByte) *pszKey++;
+        nHash *= 16777619U;
+    }
+
+    return nHash;
+}
+
+/**
+ * Second, independent hash of a key (djb2 xor variant). The shared cache
+ * only stores hashes, so it identifies keys by both of them.
+ */
+static GUInt32 HashKey2(const char * pszKey) {
+    GUInt32 nHash = 5381;
+
+    while (*pszKey)
+        nHash = (nHash * 33) ^ (GByte) *pszKey++;
+
+    return nHash;
+}
+
+/***********************************************************************
+ * \brief Get the index of a block along a Hilbert curve covering a
+ * 65536 x 65536 block grid. Blocks close on the curve are close in the
+ * raster, so the index is used as a one dimension block position.
+ ***********************************************************************/
+GUInt32 PostGISRasterHilbertIndex(int nX, int nY) {
+    GUInt32 nCurX = (GUInt32) nX & 0xFFFF;
+    GUInt32 nCurY = (GUInt32) nY & 0xFFFF;
+    GUInt32 nIndex = 0;
+    GUInt32 nSide, nRX, nRY, nTmp;
+
+    for(nSide = 1 << 15; nSide > 0; nSide >>= 1) {
+        nRX = (nCurX & nSide) ? 1 : 0;
+        nRY = (nCurY & nSide) ? 1 : 0;
+        nIndex += nSide * nSide * ((3 * nRX) ^ nRY);
+
+        /* Rotate the quadrant, so the curve continues from the last one */
+        if (nRY == 0) {
+            if (nRX == 1) {
+                nCurX = 0xFFFF - nCurX;
+                nCurY = 0xFFFF - nCurY;
+            }
+            nTmp = nCurX;
+            nCurX = nCurY;
+            nCurY = nTmp;
+        }
+    }
+
+    return nIndex;
+}
+
+/* Get the block of a Hilbert index, back from PostGISRasterHilbertIndex() */
+static void HilbertIndexToBlock(GUInt32 nIndex, int * pnX, int * pnY) {
+    GUInt32 nCurX = 0;
+    GUInt32 nCurY = 0;
+    GUInt32 nSide, nRX, nRY, nTmp;
+
+    for(nSide = 1; nSide < 65536; nSide <<= 1) {
+        nRX = 1 & (nIndex / 2);
+        nRY = 1 & (nIndex ^ nRX);
+
+        if (nRY == 0) {
+            if (nRX == 1) {
+                nCurX = nSide - 1 - nCurX;
+                nCurY = nSide - 1 - nCurY;
+            }
+            nTmp = nCurX;
+            nCurX = nCurY;
+            nCurY = nTmp;
+        }
+
+        nCurX += nSide * nRX;
+        nCurY += nSide * nRY;
+        nIndex /= 4;
+    }
+
+    *pnX = (int) nCurX;
+    *pnY = (int) nCurY;
+}
+
+/* Squared distance from the block of an entry to a centroid */
+static double CentroidDistance(const PostGISRasterTileCacheEntry * psEntry,
+    double dfCentroidX, double dfCentroidY)
+{
+    return (psEntry->nBlockX - dfCentroidX) * (psEntry->nBlockX - dfCentroidX) +
+        (psEntry->nBlockY - dfCentroidY) * (psEntry->nBlockY - dfCentroidY);
+}
+
+/************************
+ * \brief Constructor
+ ************************/
+PostGISRasterTileCacheShard::PostGISRasterTileCacheShard() {
+    hMutex = NULL;
+    papsBuckets = NULL;
+    nBuckets = 0;
+    nEntries = 0;
+    psHotHead = psHotTail = NULL;
+    psColdHead = psColdTail = NULL;
+    nHotBytes = nColdBytes = 0;
+    nMaxBytes = 0;
+    bCompress = false;
+    dfCentroidX = dfCentroidY = 0.0;
+    nHits = nSharedHits = nMisses = 0;
+}
+
+/************************
+ * \brief Destructor
+ ************************/
+PostGISRasterTileCacheShard::~PostGISRasterTileCacheShard() {
+    RemoveAll();
+    CPLFree(papsBuckets);
+
+    if (hMutex)
+        CPLDestroyMutex(hMutex);
+}
+
+/* Find an entry in the index. Must be called with the mutex held */
+PostGISRasterTileCacheEntry * PostGISRasterTileCacheShard::Find(
+    const char * pszKey, GUInt32 nHash)
+{
+    PostGISRasterTileCacheEntry * psEntry;
+
+    if (papsBuckets == NULL)
+        return NULL;
+
+    for(psEntry = papsBuckets[nHash & (nBuckets - 1)]; psEntry != NULL;
+            psEntry = psEntry->psNextInBucket) {
+        if (psEntry->nHash == nHash && strcmp(psEntry->pszKey, pszKey) == 0)
+            return psEntry;
+    }
+
+    return NULL;
+}
+
+/* Take an entry out of its tier list */
+void PostGISRasterTileCacheShard::Unlink(PostGISRasterTileCacheEntry * psEntry) {
+    PostGISRasterTileCacheEntry ** ppsHead = psEntry->bHot ? &psHotHead : &psColdHead;
+    PostGISRasterTileCacheEntry ** ppsTail = psEntry->bHot ? &psHotTail : &psColdTail;
+
+    if (psEntry->psPrev)
+        psEntry->psPrev->psNext = psEntry->psNext;
+    else
+        *ppsHead = psEntry->psNext;
+
+    if (psEntry->psNext)
+        psEntry->psNext->psPrev = psEntry->psPrev;
+    else
+        *ppsTail = psEntry->psPrev;
+
+    psEntry->psPrev = psEntry->psNext = NULL;
+
+    if (psEntry->bHot)
+        nHotBytes -= psEntry->nStoredSize;
+    else
+        nColdBytes -= psEntry->nStoredSize;
+}
+
+/* Put an entry at the head (newest end) of a tier list */
+void PostGISRasterTileCacheShard::PushFront(PostGISRasterTileCacheEntry * psEntry,
+    GBool bHot)
+{
+    PostGISRasterTileCacheEntry ** ppsHead = bHot ? &psHotHead : &psColdHead;
+    PostGISRasterTileCacheEntry ** ppsTail = bHot ? &psHotTail : &psColdTail;
+
+    psEntry->bHot = bHot;
+    psEntry->psPrev = NULL;
+    psEntry->psNext = *ppsHead;
+    if (*ppsHead)
+        (*ppsHead)->psPrev = psEntry;
+    *ppsHead = psEntry;
+    if (*ppsTail == NULL)
+        *ppsTail = psEntry;
+
+    if (bHot)
+        nHotBytes += psEntry->nStoredSize;
+    else
+        nColdBytes += psEntry->nStoredSize;
+}
+
+/* Remove an entry from the shard, and free it */
+void PostGISRasterTileCacheShard::Remove(PostGISRasterTileCacheEntry * psEntry) {
+    PostGISRasterTileCacheEntry ** ppsLink = 
+        &papsBuckets[psEntry->nHash & (nBuckets - 1)];
+
+    while (*ppsLink != psEntry)
+        ppsLink = &(*ppsLink)->psNextInBucket;
+    *ppsLink = psEntry->psNextInBucket;
+
+    Unlink(psEntry);
+    nEntries--;
+
+    CPLFree(psEntry->pszKey);
+    CPLFree(psEntry->pabyData);
+    CPLFree(psEntry);
+}
+
+/* Double the index when it gets too loaded */
+GBool PostGISRasterTileCacheShard::Grow() {
+    int nNewBuckets = MAX(TILE_CACHE_MIN_BUCKETS, nBuckets * 2);
+    PostGISRasterTileCacheEntry ** papsNewBuckets;
+    PostGISRasterTileCacheEntry * psEntry;
+    PostGISRasterTileCacheEntry * psNext;
+    int i;
+
+    papsNewBuckets = (PostGISRasterTileCacheEntry **) VSICalloc(nNewBuckets,
+        sizeof (PostGISRasterTileCacheEntry *));
+    if (papsNewBuckets == NULL)
+        return false;
+
+    for(i = 0; i < nBuckets; i++) {
+        for(psEntry = papsBuckets[i]; psEntry != NULL; psEntry = psNext) {
+            psNext = psEntry->psNextInBucket;
+            psEntry->psNextInBucket = 
+                papsNewBuckets[psEntry->nHash & (nNewBuckets - 1)];
+            papsNewBuckets[psEntry->nHash & (nNewBuckets - 1)] = psEntry;
+        }
+    }
+
+    CPLFree(papsBuckets);
+    papsBuckets = papsNewBuckets;
+    nBuckets = nNewBuckets;
+
+    return true;
+}
+
+/* Move a hot entry to the cold tier, compressed */
+void PostGISRasterTileCacheShard::Demote(PostGISRasterTileCacheEntry * psEntry) {
+    GByte * pabyCompressed;
+    int nCompressed = 0;
+
+    Unlink(psEntry);
+
+    if (!psEntry->bEmpty && !psEntry->bCompressed) {
+        /* Only worth it if it saves at least 1/8 of the block */
+        pabyCompressed = (GByte *) VSIMalloc(psEntry->nSize);
+        if (pabyCompressed != NULL)
+            nCompressed = PostGISRasterLZ4Compress(psEntry->pabyData, 
+                psEntry->nSize, pabyCompressed, psEntry->nSize - psEntry->nSize / 8);
+
+        if (nCompressed > 0) {
+            GByte * pabyShrunk = (GByte *) VSIRealloc(pabyCompressed, nCompressed);
+
+            CPLFree(psEntry->pabyData);
+            psEntry->pabyData = pabyShrunk ? pabyShrunk : pabyCompressed;
+            psEntry->nStoredSize = nCompressed;
+            psEntry->bCompressed = true;
+        }
+        else
+            CPLFree(pabyCompressed);
+    }
+
+    PushFront(psEntry, false);
+}
+
+/* Move the access centroid toward a block. Must be called with the mutex held */
+void PostGISRasterTileCacheShard::MoveCentroid(GUInt32 nPosition) {
+    int nX, nY;
+
+    HilbertIndexToBlock(nPosition, &nX, &nY);
+    dfCentroidX += (nX - dfCentroidX) / TILE_CACHE_CENTROID_WEIGHT;
+    dfCentroidY += (nY - dfCentroidY) / TILE_CACHE_CENTROID_WEIGHT;
+}
+
+/***********************************************************************
+ * \brief Advance the CLOCK hand over the hot tier, and return the entry
+ * to evict. Referenced entries at the tail get their bit cleared and go
+ * back to the head, so the hand stops after one turn at most. Then the
+ * unreferenced entries at the tail (but the head) are candidates, and the
+ * one farthest from the access centroid is chosen.
+ * Must be called with the mutex held, and two hot entries at least.
+ ***********************************************************************/
+PostGISRasterTileCacheEntry * PostGISRasterTileCacheShard::ClockHand() {
+    PostGISRasterTileCacheEntry * psEntry;
+    PostGISRasterTileCacheEntry * psVictim;
+    int nCandidates = 1;
+
+    while ((psEntry = psHotTail) != psHotHead && psEntry->bReferenced) {
+        psEntry->bReferenced = false;
+        Unlink(psEntry);
+        PushFront(psEntry, true);
+    }
+
+    psVictim = psHotTail;
+    for(psEntry = psHotTail->psPrev; psEntry != NULL && psEntry != psHotHead &&
+            nCandidates < TILE_CACHE_EVICTION_CANDIDATES; 
+            psEntry = psEntry->psPrev) {
+        if (psEntry->bReferenced)
+            continue;
+
+        nCandidates++;
+        if (CentroidDistance(psEntry, dfCentroidX, dfCentroidY) >
+                CentroidDistance(psVictim, dfCentroidX, dfCentroidY))
+            psVictim = psEntry;
+    }
+
+    return psVictim;
+}
+
+/***********************************************************************
+ * \brief Keep the hot tier and the whole shard under the limits given
+ * by SetLimits(). Must be called with the mutex held.
+ ***********************************************************************/
+void PostGISRasterTileCacheShard::Trim() {
+    GIntBig nMaxHotBytes = bCompress ? 
+        nMaxBytes / TILE_CACHE_HOT_FRACTION : nMaxBytes;
+
+    while (psHotTail != NULL && psHotTail != psHotHead && 
+            nHotBytes > nMaxHotBytes) {
+        if (bCompress)
+            Demote(ClockHand());
+        else
+            Remove(ClockHand());
+    }
+
+    while (psColdTail != NULL && nHotBytes + nColdBytes > nMaxBytes)
+        Remove(psColdTail);
+
+    while (psHotTail != NULL && nHotBytes + nColdBytes > nMaxBytes)
+        Remove(psHotTail != psHotHead ? ClockHand() : psHotTail);
+}
+
+/***********************************************************************
+ * \brief Look for a block in the shard. Same contract as
+ * PostGISRasterTileCache::Get(). A hit on a hot entry only marks it.
+ ***********************************************************************/
+GBool PostGISRasterTileCacheShard::Get(const char * pszKey, GUInt32 nHash,
+    GUInt32 nPosition, GByte * pabyOut, int nSize, GBool * pbEmpty)
+{
+    CPLMutexHolderD(&hMutex);
+    PostGISRasterTileCacheEntry * psEntry = Find(pszKey, nHash);
+
+    MoveCentroid(nPosition);
+
+    if (psEntry == NULL || (!psEntry->bEmpty && psEntry->nSize != nSize))
+        return false;
+
+    *pbEmpty = psEntry->bEmpty;
+
+    if (psEntry->bCompressed) {
+        GByte * pabyData = (GByte *) VSIMalloc(nSize);
+
+        if (pabyData == NULL || PostGISRasterLZ4Decompress(psEntry->pabyData, 
+                psEntry->nStoredSize, pabyData, nSize) != nSize) {
+            CPLDebug("PostGIS_Raster", "PostGISRasterTileCacheShard::Get(): "
+                "Can't decompress entry %s", pszKey);
+            CPLFree(pabyData);
+            Remove(psEntry);
+            return false;
+        }
+
+        /* Back to the hot tier, uncompressed */
+        Unlink(psEntry);
+        CPLFree(psEntry->pabyData);
+        psEntry->pabyData = pabyData;
+        psEntry->nStoredSize = nSize;
+        psEntry->bCompressed = false;
+        PushFront(psEntry, true);
+        Trim();
+    }
+    else if (!psEntry->bHot) {
+        /* Empty entry in the cold tier */
+        Unlink(psEntry);
+        PushFront(psEntry, true);
+    }
+    else
+        psEntry->bReferenced = true;
+
+    if (!psEntry->bEmpty)
+        memcpy(pabyOut, psEntry->pabyData, nSize);
+
+    nHits++;
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Add or replace an entry, then trim the shard
+ ***********************************************************************/
+void PostGISRasterTileCacheShard::Put(const char * pszKey, GUInt32 nHash,
+    GUInt32 nPosition, const GByte * pabyData, int nSize, GBool bEmpty)
+{
+    CPLMutexHolderD(&hMutex);
+    PostGISRasterTileCacheEntry * psEntry = Find(pszKey, nHash);
+    int nStoredSize = bEmpty ? 0 : nSize;
+
+    MoveCentroid(nPosition);
+
+    if (psEntry != NULL)
+        Remove(psEntry);
+
+    if (nMaxBytes == 0 || nStoredSize > nMaxBytes) {
+        Trim();
+        return;
+    }
+
+    if (nEntries >= nBuckets && !Grow() && papsBuckets == NULL)
+        return;
+
+    psEntry = (PostGISRasterTileCacheEntry *) VSICalloc(1, 
+        sizeof (PostGISRasterTileCacheEntry));
+    if (psEntry == NULL)
+        return;
+
+    psEntry->pszKey = CPLStrdup(pszKey);
+    psEntry->nHash = nHash;
+    HilbertIndexToBlock(nPosition, &psEntry->nBlockX, &psEntry->nBlockY);
+    psEntry->nSize = nSize;
+    psEntry->nStoredSize = nStoredSize;
+    psEntry->bEmpty = bEmpty;
+
+    if (!bEmpty) {
+        psEntry->pabyData = (GByte *) VSIMalloc(nSize);
+        if (psEntry->pabyData == NULL) {
+            CPLFree(psEntry->pszKey);
+            CPLFree(psEntry);
+            return;
+        }
+        memcpy(psEntry->pabyData, pabyData, nSize);
+    }
+
+    psEntry->psNextInBucket = papsBuckets[nHash & (nBuckets - 1)];
+    papsBuckets[nHash & (nBuckets - 1)] = psEntry;
+    nEntries++;
+
+    PushFront(psEntry, true);
+    Trim();
+}
+
+/***********************************************************************
+ * \brief Set the size of the shard (0 empties it) and whether the
+ * entries falling out of the hot tier are compressed, then trim it
+ ***********************************************************************/
+void PostGISRasterTileCacheShard::SetLimits(GIntBig nNewMaxBytes,
+    GBool bNewCompress)
+{
+    CPLMutexHolderD(&hMutex);
+
+    nMaxBytes = nNewMaxBytes;
+    bCompress = bNewCompress;
+
+    if (nMaxBytes == 0)
+        RemoveAll();
+    else
+        Trim();
+}
+
+/***********************************************************************
+ * \brief Remove an entry, if present
+ ***********************************************************************/
+void PostGISRasterTileCacheShard::Invalidate(const char * pszKey, GUInt32 nHash)
+{
+    CPLMutexHolderD(&hMutex);
+    PostGISRasterTileCacheEntry * psEntry = Find(pszKey, nHash);
+
+    if (psEntry != NULL)
+        Remove(psEntry);
+}
+
+/***********************************************************************
+ * \brief Remove the entries whose key starts with a prefix (case
+ * insensitive, as the table names are compared)
+ ***********************************************************************/
+void PostGISRasterTileCacheShard::InvalidatePrefix(const char * pszPrefix)
+{
+    CPLMutexHolderD(&hMutex);
+    PostGISRasterTileCacheEntry * psEntry;
+    PostGISRasterTileCacheEntry * psNext;
+    int nLen = strlen(pszPrefix);
+
+    for(psEntry = psHotHead; psEntry != NULL; psEntry = psNext) {
+        psNext = psEntry->psNext;
+        if (EQUALN(psEntry->pszKey, pszPrefix, nLen))
+            Remove(psEntry);
+    }
+
+    for(psEntry = psColdHead; psEntry != NULL; psEntry = psNext) {
+        psNext = psEntry->psNext;
+        if (EQUALN(psEntry->pszKey, pszPrefix, nLen))
+            Remove(psEntry);
+    }
+}
+
+/* Remove all the entries. Must be called with the mutex held */
+void PostGISRasterTileCacheShard::RemoveAll() {
+    while (psHotHead != NULL)
+        Remove(psHotHead);
+    while (psColdHead != NULL)
+        Remove(psColdHead);
+}
+
+/***********************************************************************
+ * \brief Remove all the entries of the shard
+ ***********************************************************************/
+void PostGISRasterTileCacheShard::Clear() {
+    CPLMutexHolderD(&hMutex);
+
+    RemoveAll();
+}
+
+/* A miss of the shard was found in the shared tier */
+void PostGISRasterTileCacheShard::AddSharedHit() {
+    CPLMutexHolderD(&hMutex);
+
+    nSharedHits++;
+}
+
+/* A miss of the shard, and of the shared tier */
+void PostGISRasterTileCacheShard::AddMiss() {
+    CPLMutexHolderD(&hMutex);
+
+    nMisses++;
+}
+
+GIntBig PostGISRasterTileCacheShard::GetHits() {
+    CPLMutexHolderD(&hMutex);
+
+    return nHits + nSharedHits;
+}
+
+GIntBig PostGISRasterTileCacheShard::GetMisses() {
+    CPLMutexHolderD(&hMutex);
+
+    return nMisses;
+}
+
+/************************
+ * \brief Constructor
+ ************************/
+PostGISRasterTileCache::PostGISRasterTileCache() {
+    hMutex = NULL;
+    nShards = 1;
+    bConfigured = false;
+    bEnabled = false;
+    nMaxBytes = 0;
+    bCompress = false;
+}
+
+/************************
+ * \brief Destructor
+ ************************/
+PostGISRasterTileCache::~PostGISRasterTileCache() {
+    if (hMutex)
+        CPLDestroyMutex(hMutex);
+}
+
+/***********************************************************************
+ * \brief Get the cache shared by all the datasets
+ ***********************************************************************/
+PostGISRasterTileCache * PostGISRasterTileCache::GetInstance() {
+    return &oTileCache;
+}
+
+/***********************************************************************
+ * \brief Read the cache settings: POSTGIS_RASTER_TILE_CACHE_SIZE (in MB,
+ * 0 disables the cache) and POSTGIS_RASTER_TILE_CACHE_COMPRESS (YES/NO),
+ * and the shared tier ones.
+ *
+ * It's called on first use, and each time a dataset is opened, never on
+ * the read path. The shards are emptied if the size changes the number of
+ * them, as the keys would be looked for in other shards. A Put() racing
+ * with it may still store an entry in the shard given by the previous
+ * count: the shards past the new count are given no room, and
+ * Invalidate() looks in all of them, so such an entry can't be read stale.
+ ***********************************************************************/
+void PostGISRasterTileCache::Reconfigure() {
+    CPLMutexHolderD(&hMutex);
+    GIntBig nSizeMB = CPLAtoGIntBig(CPLGetConfigOption(
+        "POSTGIS_RASTER_TILE_CACHE_SIZE", DEFAULT_TILE_CACHE_SIZE));
+    int nNewShards;
+    int i;
+
+    nMaxBytes = (nSizeMB > 0) ? nSizeMB * 1024 * 1024 : 0;
+    bCompress = CSLTestBoolean((char *) CPLGetConfigOption(
+        "POSTGIS_RASTER_TILE_CACHE_COMPRESS", DEFAULT_TILE_CACHE_COMPRESS));
+
+    nNewShards = (int) MIN(MAX(nMaxBytes / TILE_CACHE_MIN_SHARD_SIZE, 1),
+        TILE_CACHE_MAX_SHARDS);
+
+    if (nNewShards != nShards) {
+        nShards = nNewShards;
+        for(i = 0; i < TILE_CACHE_MAX_SHARDS; i++)
+            aoShards[i].Clear();
+    }
+
+    for(i = 0; i < TILE_CACHE_MAX_SHARDS; i++)
+        aoShards[i].SetLimits(i < nNewShards ? nMaxBytes / nNewShards : 0,
+            bCompress);
+
+    bEnabled = oShared.Configure() || nMaxBytes > 0;
+    bConfigured = true;
+}
+
+/***********************************************************************
+ * \brief Get the shard of a key hash. The bucket index takes the low bits
+ * of the hash, so the shard takes the high ones.
+ * nShards is read once, without the mutex: a stale value only costs a
+ * miss, or an entry in a shard Reconfigure() has emptied.
+ ***********************************************************************/
+PostGISRasterTileCacheShard * PostGISRasterTileCache::GetShard(GUInt32 nHash) {
+    int nCurShards = nShards;
+
+    return &aoShards[(nHash >> 16) % nCurShards];
+}
+
+/***********************************************************************
+ * \brief Is the cache enabled, by the settings read by the last
+ * Reconfigure()?
+ ***********************************************************************/
+GBool PostGISRasterTileCache::IsEnabled() {
+    if (!bConfigured)
+        Reconfigure();
+
+    return bEnabled;
+}
+
+/***********************************************************************
+ * \brief Look for a block.
+ * Parameters:
+ *  - const char *: the block key
+ *  - GUInt32: the block position (see PostGISRasterHilbertIndex())
+ *  - GByte *, int: buffer to copy the block to, and its size
+ *  - GBool *: set to true if the block is empty (has no tiles). The
+ *    buffer isn't touched then.
+ * Returns:
+ *  - false on miss
+ *
+ * Only the lock of the shard of the key is taken. On a miss, the shared
+ * tier is looked up, without lock.
+ ***********************************************************************/
+GBool PostGISRasterTileCache::Get(const char * pszKey, GUInt32 nPosition,
+    GByte * pabyOut, int nSize, GBool * pbEmpty)
+{
+    GUInt32 nHash = HashKey(pszKey);
+    PostGISRasterTileCacheShard * poShard;
+
+    if (!bConfigured)
+        Reconfigure();
+
+    poShard = GetShard(nHash);
+    if (poShard->Get(pszKey, nHash, nPosition, pabyOut, nSize, pbEmpty))
+        return true;
+
+    /* Another process may have fetched it */
+    if (!oShared.IsEnabled() || !oShared.Get(nHash, HashKey2(pszKey),
+            pabyOut, nSize, pbEmpty)) {
+        poShard->AddMiss();
+        return false;
+    }
+
+    poShard->AddSharedHit();
+    poShard->Put(pszKey, nHash, nPosition, pabyOut, nSize, *pbEmpty);
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Add a decoded block, nSize bytes
+ ***********************************************************************/
+void PostGISRasterTileCache::Insert(const char * pszKey, GUInt32 nPosition,
+    const GByte * pabyData, int nSize)
+{
+    GUInt32 nHash = HashKey(pszKey);
+
+    if (!bConfigured)
+        Reconfigure();
+
+    GetShard(nHash)->Put(pszKey, nHash, nPosition, pabyData, nSize, false);
+
+    if (oShared.IsEnabled())
+        oShared.Put(nHash, HashKey2(pszKey), pabyData, nSize, false);
+}
+
+/***********************************************************************
+ * \brief Add an empty block (no tile intersects it)
+ ***********************************************************************/
+void PostGISRasterTileCache::InsertEmpty(const char * pszKey, GUInt32 nPosition)
+{
+    GUInt32 nHash = HashKey(pszKey);
+
+    if (!bConfigured)
+        Reconfigure();
+
+    GetShard(nHash)->Put(pszKey, nHash, nPosition, NULL, 0, true);
+
+    if (oShared.IsEnabled())
+        oShared.Put(nHash, HashKey2(pszKey), NULL, 0, true);
+}
+
+/***********************************************************************
+ * \brief Remove a block that has been written, from both tiers. Other
+ * processes sharing the segment may still have it in their own cache.
+ * All the shards are looked at (see Reconfigure()).
+ ***********************************************************************/
+void PostGISRasterTileCache::Invalidate(const char * pszKey)
+{
+    GUInt32 nHash = HashKey(pszKey);
+    int i;
+
+    for(i = 0; i < TILE_CACHE_MAX_SHARDS; i++)
+        aoShards[i].Invalidate(pszKey, nHash);
+
+    if (oShared.IsEnabled())
+        oShared.Invalidate(nHash, HashKey2(pszKey));
+}
+
+/***********************************************************************
+ * \brief Remove the blocks of a table, after it's been rewritten or
+ * dropped. The keys start with schema.table (see
+ * PostGISRasterRasterBand::GetTileCacheKey()). The shared tier only has
+ * hashes of the keys, so all its slots are dropped.
+ ***********************************************************************/
+void PostGISRasterTileCache::InvalidateTable(const char * pszSchema,
+    const char * pszTable)
+{
+    CPLString osPrefix;
+    int i;
+
+    osPrefix.Printf("%s.%s|", pszSchema, pszTable);
+
+    for(i = 0; i < TILE_CACHE_MAX_SHARDS; i++)
+        aoShards[i].InvalidatePrefix(osPrefix);
+
+    if (oShared.IsEnabled())
+        oShared.InvalidateAll();
+}
+
+/***********************************************************************
+ * \brief Remove all the entries
+ ***********************************************************************/
+void PostGISRasterTileCache::Clear() {
+    int i;
+
+    for(i = 0; i < TILE_CACHE_MAX_SHARDS; i++)
+        aoShards[i].Clear();
+}
+
+GIntBig PostGISRasterTileCache::GetHits() {
+    GIntBig nHits = 0;
+    int i;
+
+    for(i = 0; i < TILE_CACHE_MAX_SHARDS; i++)
+        nHits += aoShards[i].GetHits();
+
+    return nHits;
+}
+
+GIntBig PostGISRasterTileCache::GetMisses() {
+    GIntBig nMisses = 0;
+    int i;
+
+    for(i = 0; i < TILE_CACHE_MAX_SHARDS; i++)
+        nMisses += aoShards[i].GetMisses();
+
+    return nMisses;
+}
@@ -0,0 +1,585 @@
+/******************************************************************************
+ * File :    postgisrasterwkb.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Client side parsing of the PostGIS Raster WKB format
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAVE_SSE2_HEX_DECODER
+#endif
+
+/**
+ * WKB raster layout (see raster/doc/RFC2-WellKnownBinaryFormat in PostGIS):
+ *
+ *  endianness (1) | version (2) | nBands (2) | scaleX (8) | scaleY (8) |
+ *  ipX (8) | ipY (8) | skewX (8) | skewY (8) | srid (4) | width (2) |
+ *  height (2)
+ *
+ * followed by nBands bands. In-db bands are:
+ *
+ *  flags + pixel type (1) | nodata value (pixel size) | pixels
+ *
+ * and out-db bands (BAND_FLAG_OFFLINE set) are:
+ *
+ *  flags + pixel type (1) | nodata value (pixel size) | band number (1) |
+ *  path (null terminated)
+ *
+ * Nothing here allocates memory: parsing returns views into the caller
+ * buffer, and writing fills a caller buffer. All the offsets are checked
+ * against the buffer length before reading or writing.
+ **/
+
+/***********************************************************************
+ * \brief Does the WKB byte order differ from the machine one?
+ ***********************************************************************/
+GBool PostGISRasterWKBNeedsSwap(const PostGISRasterWKBHeader * psHeader) {
+#ifdef CPL_LSB
+    return psHeader->nEndianness == 0;
+#else
+    return psHeader->nEndianness == 1;
+#endif
+}
+
+static GUInt16 ReadUInt16(const GByte * pabyData, GBool bSwap) {
+    GUInt16 nValue;
+
+    memcpy(&nValue, pabyData, sizeof (nValue));
+    if (bSwap)
+        CPL_SWAP16PTR(&nValue);
+
+    return nValue;
+}
+
+static GInt32 ReadInt32(const GByte * pabyData, GBool bSwap) {
+    GInt32 nValue;
+
+    memcpy(&nValue, pabyData, sizeof (nValue));
+    if (bSwap)
+        CPL_SWAP32PTR(&nValue);
+
+    return nValue;
+}
+
+static double ReadFloat64(const GByte * pabyData, GBool bSwap) {
+    double dfValue;
+
+    memcpy(&dfValue, pabyData, sizeof (dfValue));
+    if (bSwap)
+        CPL_SWAP64PTR(&dfValue);
+
+    return dfValue;
+}
+
+static void WriteUInt16(GByte * pabyData, GUInt16 nValue, GBool bSwap) {
+    if (bSwap)
+        CPL_SWAP16PTR(&nValue);
+    memcpy(pabyData, &nValue, sizeof (nValue));
+}
+
+static void WriteInt32(GByte * pabyData, GInt32 nValue, GBool bSwap) {
+    if (bSwap)
+        CPL_SWAP32PTR(&nValue);
+    memcpy(pabyData, &nValue, sizeof (nValue));
+}
+
+static void WriteFloat64(GByte * pabyData, double dfValue, GBool bSwap) {
+    if (bSwap)
+        CPL_SWAP64PTR(&dfValue);
+    memcpy(pabyData, &dfValue, sizeof (dfValue));
+}
+
+/***********************************************************************
+ * \brief Decode an hex string into a caller provided buffer.
+ *
+ * A leading "\x" (bytea hex output) is skipped. Characters that aren't
+ * hex digits decode to garbage, they aren't checked. Returns the number
+ * of bytes written.
+ ***********************************************************************/
+int PostGISRasterHexToBinary(const char * pszHex, int nHexLength,
+    GByte * pabyOut)
+{
+    static const GByte abyHexValues[256] = {
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,1,2,3,4,5,6,7,8,9,0,0,0,0,0,0,
+        0,10,11,12,13,14,15,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+        0,10,11,12,13,14,15,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0
+    };
+    const GByte * pabyHex = (const GByte *) pszHex;
+    int i = 0, nLength;
+
+    if (nHexLength >= 2 && pszHex[0] == '\\' && pszHex[1] == 'x') {
+        pabyHex += 2;
+        nHexLength -= 2;
+    }
+
+    nLength = nHexLength / 2;
+
+#ifdef HAVE_SSE2_HEX_DECODER
+    /**
+     * 32 hex digits -> 16 bytes at a time. Each digit becomes a nibble with
+     * (c & 0x0F) + (c > '9' ? 9 : 0), then the 16-bit lanes (high nibble
+     * in the low byte) are folded into one byte.
+     **/
+    {
+        const __m128i nLowMask = _mm_set1_epi8(0x0F);
+        const __m128i nDigitMax = _mm_set1_epi8('9');
+        const __m128i nLetterFix = _mm_set1_epi8(9);
+        const __m128i nByteMask = _mm_set1_epi16(0x00FF);
+
+        for(; i + 16 <= nLength; i += 16) {
+            __m128i anHex[2];
+            int j;
+
+            anHex[0] = _mm_loadu_si128((const __m128i *) (pabyHex + 2 * i));
+            anHex[1] = _mm_loadu_si128((const __m128i *) (pabyHex + 2 * i + 16));
+
+            for(j = 0; j < 2; j++) {
+                __m128i nNibbles = _mm_add_epi8(
+                    _mm_and_si128(anHex[j], nLowMask),
+                    _mm_and_si128(_mm_cmpgt_epi8(anHex[j], nDigitMax), nLetterFix));
+
+                anHex[j] = _mm_and_si128(_mm_or_si128(
+                    _mm_slli_epi16(nNibbles, 4), _mm_srli_epi16(nNibbles, 8)),
+                    nByteMask);
+            }
+
+            _mm_storeu_si128((__m128i *) (pabyOut + i),
+                _mm_packus_epi16(anHex[0], anHex[1]));
+        }
+    }
+#endif
+
+    for(; i < nLength; i++)
+        pabyOut[i] = (GByte) ((abyHexValues[pabyHex[2 * i]] << 4) |
+            abyHexValues[pabyHex[2 * i + 1]]);
+
+    return nLength;
+}
+
+/***********************************************************************
+ * \brief Translate a WKB pixel type into a GDAL data type.
+ *
+ * Sub-byte types are stored one pixel per byte, so they're GDT_Byte.
+ * The pixel (and nodata value) size is returned in *pnPixelSize.
+ * Unknown pixel types return GDT_Unknown.
+ ***********************************************************************/
+GDALDataType PostGISRasterPixelTypeToGDAL(int nPixelType, int * pnPixelSize) {
+    GDALDataType eDataType = GDT_Unknown;
+
+    switch (nPixelType) {
+        case 0:     /* 1BB */
+        case 1:     /* 2BUI */
+        case 2:     /* 4BUI */
+        case 3:     /* 8BSI */
+        case 4:     /* 8BUI */
+            eDataType = GDT_Byte;
+            break;
+        case 5:     /* 16BSI */
+            eDataType = GDT_Int16;
+            break;
+        case 6:     /* 16BUI */
+            eDataType = GDT_UInt16;
+            break;
+        case 7:     /* 32BSI */
+            eDataType = GDT_Int32;
+            break;
+        case 8:     /* 32BUI */
+            eDataType = GDT_UInt32;
+            break;
+        case 10:    /* 32BF */
+            eDataType = GDT_Float32;
+            break;
+        case 11:    /* 64BF */
+            eDataType = GDT_Float64;
+            break;
+        default:
+            break;
+    }
+
+    if (pnPixelSize != NULL)
+        *pnPixelSize = GDALGetDataTypeSize(eDataType) / 8;
+
+    return eDataType;
+}
+
+/***********************************************************************
+ * \brief Parse and validate the header of a WKB raster.
+ * Parameters:
+ *  - const GByte *: the raster, as binary WKB
+ *  - int: the length of the raster
+ *  - PostGISRasterWKBHeader *: the header to fill
+ * Returns:
+ *  - false if the buffer isn't a valid raster header
+ ***********************************************************************/
+GBool PostGISRasterParseWKBHeader(const GByte * pabyWKB, int nLength,
+    PostGISRasterWKBHeader * psHeader)
+{
+    GBool bSwap;
+
+    if (pabyWKB == NULL || nLength < RASTER_HEADER_SIZE ||
+            pabyWKB[0] > 1) {
+        CPLDebug("PostGIS_Raster", "PostGISRasterParseWKBHeader(): "
+            "Invalid raster header");
+        return false;
+    }
+
+    psHeader->nEndianness = pabyWKB[0];
+    bSwap = PostGISRasterWKBNeedsSwap(psHeader);
+
+    psHeader->nVersion = ReadUInt16(pabyWKB + 1, bSwap);
+    psHeader->nBands = ReadUInt16(pabyWKB + 3, bSwap);
+    psHeader->dfScaleX = ReadFloat64(pabyWKB + 5, bSwap);
+    psHeader->dfScaleY = ReadFloat64(pabyWKB + 13, bSwap);
+    psHeader->dfUpperLeftX = ReadFloat64(pabyWKB + 21, bSwap);
+    psHeader->dfUpperLeftY = ReadFloat64(pabyWKB + 29, bSwap);
+    psHeader->dfSkewX = ReadFloat64(pabyWKB + 37, bSwap);
+    psHeader->dfSkewY = ReadFloat64(pabyWKB + 45, bSwap);
+    psHeader->nSrid = ReadInt32(pabyWKB + 53, bSwap);
+    psHeader->nWidth = ReadUInt16(pabyWKB + 57, bSwap);
+    psHeader->nHeight = ReadUInt16(pabyWKB + 59, bSwap);
+
+    if (psHeader->nVersion != POSTGIS_RASTER_VERSION) {
+        CPLDebug("PostGIS_Raster", "PostGISRasterParseWKBHeader(): "
+            "Unsupported raster version %d", psHeader->nVersion);
+        return false;
+    }
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Parse and validate the band starting at nBandOffset
+ * (RASTER_HEADER_SIZE for the first band).
+ *
+ * Checks that the in-db pixels, or the out-db band number and path, fit
+ * in the buffer. The offset of the next band is returned in
+ * psBand->nNextBandOffset.
+ ***********************************************************************/
+GBool PostGISRasterParseWKBBandHeader(const GByte * pabyWKB, int nLength,
+    int nBandOffset, const PostGISRasterWKBHeader * psHeader,
+    PostGISRasterWKBBandHeader * psBand)
+{
+    GBool bSwap = PostGISRasterWKBNeedsSwap(psHeader);
+    const GByte * pabyNoData = NULL;
+    const GByte * pabyEnd = NULL;
+    GByte byFlags;
+    GIntBig nDataLength;
+
+    if (nBandOffset < RASTER_HEADER_SIZE ||
+            nBandOffset >= nLength) {
+        CPLDebug("PostGIS_Raster", "PostGISRasterParseWKBBandHeader(): "
+            "Band header out of the raster");
+        return false;
+    }
+
+    byFlags = pabyWKB[nBandOffset];
+    psBand->nPixelType = byFlags & BAND_PIXTYPE_MASK;
+    psBand->bIsOffline = (byFlags & BAND_FLAG_OFFLINE) != 0;
+    psBand->bHasNoDataValue = (byFlags & BAND_FLAG_HAS_NODATA) != 0;
+    psBand->bIsNoData = (byFlags & BAND_FLAG_IS_NODATA) != 0;
+    psBand->eDataType = PostGISRasterPixelTypeToGDAL(psBand->nPixelType,
+        &psBand->nPixelSize);
+    psBand->nBandOffset = nBandOffset;
+    psBand->nDataLength = 0;
+    psBand->nOutDbBandNumber = -1;
+    psBand->pszOutDbPath = NULL;
+
+    if (psBand->eDataType == GDT_Unknown) {
+        CPLDebug("PostGIS_Raster", "PostGISRasterParseWKBBandHeader(): "
+            "Unknown pixel type %d", psBand->nPixelType);
+        return false;
+    }
+
+    psBand->nDataOffset = nBandOffset + RASTER_BAND_HEADER_FIXED_SIZE +
+        psBand->nPixelSize;
+
+    if (psBand->nDataOffset > nLength) {
+        CPLDebug("PostGIS_Raster", "PostGISRasterParseWKBBandHeader(): "
+            "Truncated band header");
+        return false;
+    }
+
+    /* Nodata value, in the pixel type */
+    pabyNoData = pabyWKB + nBandOffset + RASTER_BAND_HEADER_FIXED_SIZE;
+    switch (psBand->eDataType) {
+        case GDT_Byte:
+            psBand->dfNoDataValue = (psBand->nPixelType == 3) ?
+                (double) (signed char) pabyNoData[0] : (double) pabyNoData[0];
+            break;
+        case GDT_Int16:
+            psBand->dfNoDataValue = (GInt16) ReadUInt16(pabyNoData, bSwap);
+            break;
+        case GDT_UInt16:
+            psBand->dfNoDataValue = ReadUInt16(pabyNoData, bSwap);
+            break;
+        case GDT_Int32:
+            psBand->dfNoDataValue = ReadInt32(pabyNoData, bSwap);
+            break;
+        case GDT_UInt32:
+            psBand->dfNoDataValue = (GUInt32) ReadInt32(pabyNoData, bSwap);
+            break;
+        case GDT_Float32: {
+            GInt32 nBits = ReadInt32(pabyNoData, bSwap);
+            float fValue;
+
+            memcpy(&fValue, &nBits, sizeof (fValue));
+            psBand->dfNoDataValue = fValue;
+            break;
+        }
+        default:
+            psBand->dfNoDataValue = ReadFloat64(pabyNoData, bSwap);
+            break;
+    }
+
+    /* Out-db bands: band number and null terminated path */
+    if (psBand->bIsOffline) {
+        if (psBand->nDataOffset + 2 > nLength) {
+            CPLDebug("PostGIS_Raster", "PostGISRasterParseWKBBandHeader(): "
+                "Truncated out-db band");
+            return false;
+        }
+
+        psBand->nOutDbBandNumber = pabyWKB[psBand->nDataOffset];
+        psBand->pszOutDbPath = (const char *) 
+            (pabyWKB + psBand->nDataOffset + 1);
+        pabyEnd = (const GByte *) memchr(psBand->pszOutDbPath, '\0',
+            nLength - psBand->nDataOffset - 1);
+
+        if (pabyEnd == NULL) {
+            CPLDebug("PostGIS_Raster", "PostGISRasterParseWKBBandHeader(): "
+                "Unterminated out-db band path");
+            return false;
+        }
+
+        psBand->nNextBandOffset = (int) (pabyEnd - pabyWKB) + 1;
+
+        return true;
+    }
+
+    nDataLength = (GIntBig) psHeader->nWidth * psHeader->nHeight *
+        psBand->nPixelSize;
+    if (psBand->nDataOffset + nDataLength > nLength) {
+        CPLDebug("PostGIS_Raster", "PostGISRasterParseWKBBandHeader(): "
+            "Truncated band data");
+        return false;
+    }
+
+    psBand->nDataLength = (int) nDataLength;
+    psBand->nNextBandOffset = psBand->nDataOffset + psBand->nDataLength;
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Parse band iBand (0-based) of a WKB raster, walking the bands
+ * before it.
+ ***********************************************************************/
+GBool PostGISRasterGetWKBBand(const GByte * pabyWKB, int nLength,
+    const PostGISRasterWKBHeader * psHeader, int iBand,
+    PostGISRasterWKBBandHeader * psBand)
+{
+    int nBandOffset = RASTER_HEADER_SIZE;
+    int i;
+
+    if (iBand < 0 || iBand >= psHeader->nBands) {
+        CPLDebug("PostGIS_Raster", "PostGISRasterGetWKBBand(): "
+            "Band %d out of range", iBand);
+        return false;
+    }
+
+    for(i = 0; i <= iBand; i++) {
+        if (!PostGISRasterParseWKBBandHeader(pabyWKB, nLength, nBandOffset,
+                psHeader, psBand))
+            return false;
+
+        nBandOffset = psBand->nNextBandOffset;
+    }
+
+    return true;
+}
+
+/***********************************************************************
+ * \brief Get the serialized size of a band, or -1 for unknown pixel
+ * types. psBand->nPixelType (and pszOutDbPath, for out-db bands) must be
+ * set. In GIntBig: 65535 x 65535 Float64 pixels don't fit in an int.
+ ***********************************************************************/
+GIntBig PostGISRasterGetWKBBandSize(const PostGISRasterWKBHeader * psHeader,
+    const PostGISRasterWKBBandHeader * psBand)
+{
+    int nPixelSize;
+
+    if (PostGISRasterPixelTypeToGDAL(psBand->nPixelType, &nPixelSize) ==
+            GDT_Unknown)
+        return -1;
+
+    if (psBand->bIsOffline)
+        return RASTER_BAND_HEADER_FIXED_SIZE + nPixelSize + 1 +
+            (psBand->pszOutDbPath ? (GIntBig) strlen(psBand->pszOutDbPath) :
+            0) + 1;
+
+    return RASTER_BAND_HEADER_FIXED_SIZE + nPixelSize +
+        (GIntBig) psHeader->nWidth * psHeader->nHeight * nPixelSize;
+}
+
+/***********************************************************************
+ * \brief Write a raster header, in the byte order of psHeader.
+ * Returns the number of bytes written, or -1 if the buffer is too small.
+ ***********************************************************************/
+int PostGISRasterWriteWKBHeader(GByte * pabyWKB, int nLength,
+    const PostGISRasterWKBHeader * psHeader)
+{
+    GBool bSwap = PostGISRasterWKBNeedsSwap(psHeader);
+
+    if (pabyWKB == NULL || nLength < RASTER_HEADER_SIZE ||
+            psHeader->nEndianness > 1)
+        return -1;
+
+    pabyWKB[0] = psHeader->nEndianness;
+    WriteUInt16(pabyWKB + 1, psHeader->nVersion, bSwap);
+    WriteUInt16(pabyWKB + 3, psHeader->nBands, bSwap);
+    WriteFloat64(pabyWKB + 5, psHeader->dfScaleX, bSwap);
+    WriteFloat64(pabyWKB + 13, psHeader->dfScaleY, bSwap);
+    WriteFloat64(pabyWKB + 21, psHeader->dfUpperLeftX, bSwap);
+    WriteFloat64(pabyWKB + 29, psHeader->dfUpperLeftY, bSwap);
+    WriteFloat64(pabyWKB + 37, psHeader->dfSkewX, bSwap);
+    WriteFloat64(pabyWKB + 45, psHeader->dfSkewY, bSwap);
+    WriteInt32(pabyWKB + 53, psHeader->nSrid, bSwap);
+    WriteUInt16(pabyWKB + 57, psHeader->nWidth, bSwap);
+    WriteUInt16(pabyWKB + 59, psHeader->nHeight, bSwap);
+
+    return RASTER_HEADER_SIZE;
+}
+
+/***********************************************************************
+ * \brief Write a band at nBandOffset, in the byte order of psHeader.
+ * Parameters:
+ *  - GByte *, int: the raster buffer and its length
+ *  - int: offset of the band in the buffer
+ *  - const PostGISRasterWKBHeader *: header of the raster
+ *  - const PostGISRasterWKBBandHeader *: band to write (the pixel type,
+ *    flags, nodata value and out-db properties are used)
+ *  - const void *: width x height pixels of the band, in the machine byte
+ *    order. Not used for out-db bands.
+ * Returns:
+ *  - the offset of the next band, or -1 if the band doesn't fit in the
+ *    buffer or can't be written
+ ***********************************************************************/
+int PostGISRasterWriteWKBBand(GByte * pabyWKB, int nLength, int nBandOffset,
+    const PostGISRasterWKBHeader * psHeader,
+    const PostGISRasterWKBBandHeader * psBand, const void * pPixels)
+{
+    GBool bSwap = PostGISRasterWKBNeedsSwap(psHeader);
+    GIntBig nBandSize = PostGISRasterGetWKBBandSize(psHeader, psBand);
+    int nPixelSize;
+    GByte * pabyNoData;
+    GByte * pabyData;
+    double dfNoData = psBand->dfNoDataValue;
+    GByte byFlags;
+
+    if (pabyWKB == NULL || nBandSize < 0 ||
+            nBandOffset < RASTER_HEADER_SIZE || nBandOffset > nLength ||
+            nBandSize > nLength - nBandOffset)
+        return -1;
+
+    if (psBand->bIsOffline) {
+        if (psBand->nOutDbBandNumber < 0 || psBand->nOutDbBandNumber > 255)
+            return -1;
+    }
+    else if (pPixels == NULL)
+        return -1;
+
+    PostGISRasterPixelTypeToGDAL(psBand->nPixelType, &nPixelSize);
+
+    byFlags = (GByte) (psBand->nPixelType & BAND_PIXTYPE_MASK);
+    if (psBand->bIsOffline)
+        byFlags |= BAND_FLAG_OFFLINE;
+    if (psBand->bHasNoDataValue)
+        byFlags |= BAND_FLAG_HAS_NODATA;
+    if (psBand->bIsNoData)
+        byFlags |= BAND_FLAG_IS_NODATA;
+
+    pabyWKB[nBandOffset] = byFlags;
+
+    /* Nodata value, in the pixel type */
+    pabyNoData = pabyWKB + nBandOffset + RASTER_BAND_HEADER_FIXED_SIZE;
+    switch (psBand->nPixelType) {
+        case 3:
+            pabyNoData[0] = (GByte) (signed char) dfNoData;
+            break;
+        case 0:
+        case 1:
+        case 2:
+        case 4:
+            pabyNoData[0] = (GByte) dfNoData;
+            break;
+        case 5:
+            WriteUInt16(pabyNoData, (GUInt16) (GInt16) dfNoData, bSwap);
+            break;
+        case 6:
+            WriteUInt16(pabyNoData, (GUInt16) dfNoData, bSwap);
+            break;
+        case 7:
+            WriteInt32(pabyNoData, (GInt32) dfNoData, bSwap);
+            break;
+        case 8:
+            WriteInt32(pabyNoData, (GInt32) (GUInt32) dfNoData, bSwap);
+            break;
+        case 10: {
+            float fValue = (float) dfNoData;
+            GInt32 nBits;
+
+            memcpy(&nBits, &fValue, sizeof (nBits));
+            WriteInt32(pabyNoData, nBits, bSwap);
+            break;
+        }
+        default:
+            WriteFloat64(pabyNoData, dfNoData, bSwap);
+            break;
+    }
+
+    pabyData = pabyNoData + nPixelSize;
+
+    if (psBand->bIsOffline) {
+        pabyData[0] = (GByte) psBand->nOutDbBandNumber;
+        if (psBand->pszOutDbPath != NULL)
+            strcpy((char *) pabyData + 1, psBand->pszOutDbPath);
+        else
+            pabyData[1] = '\0';
+    }
+    else {
+        int nPixels = psHeader->nWidth * psHeader->nHeight;
+
+        memcpy(pabyData, pPixels, (size_t) nPixels * nPixelSize);
+        if (bSwap && nPixelSize > 1)
+            GDALSwapWords(pabyData, nPixelSize, nPixels, nPixelSize);
+    }
+
+    return (int) (nBandOffset + nBandSize);
+}
@@ -0,0 +1,124 @@
+/******************************************************************************
+ * File :    bench_tilecache.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Contention benchmark of the driver tile cache: threads reading
+ *           cached blocks, as IRasterIO() does on hits
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+#include "cpl_multiproc.h"
+#include "cpl_atomic_ops.h"
+#include <sys/time.h>
+
+#define BENCH_BLOCKS        256
+#define BENCH_BLOCK_SIZE    (256 * 256)
+#define BENCH_ITERATIONS    200000
+#define BENCH_MAX_THREADS   16
+
+static CPLString aosKeys[BENCH_BLOCKS];
+static volatile int nFinished = 0;
+
+typedef struct
+{
+    int nThread;
+    int nHits;
+} BenchThread;
+
+static double GetTime() {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* What IRasterIO() does for a cached block */
+static void ReadBlocks(void * pData) {
+    BenchThread * psThread = (BenchThread *) pData;
+    PostGISRasterTileCache * poTileCache = PostGISRasterTileCache::GetInstance();
+    GByte * pabyBlock = (GByte *) CPLMalloc(BENCH_BLOCK_SIZE);
+    GBool bEmpty;
+    int i, iBlock;
+
+    for(i = 0; i < BENCH_ITERATIONS; i++) {
+        iBlock = (i * 7 + psThread->nThread * 31) % BENCH_BLOCKS;
+        if (poTileCache->IsEnabled() && poTileCache->Get(aosKeys[iBlock],
+                PostGISRasterHilbertIndex(iBlock % 16, iBlock / 16), pabyBlock,
+                BENCH_BLOCK_SIZE, &bEmpty))
+            psThread->nHits++;
+    }
+
+    CPLFree(pabyBlock);
+    CPLAtomicInc(&nFinished);
+}
+
+int main(int argc, char ** argv) {
+    PostGISRasterTileCache * poTileCache = PostGISRasterTileCache::GetInstance();
+    BenchThread asThreads[BENCH_MAX_THREADS];
+    GByte * pabyBlock;
+    double dfStart, dfElapsed;
+    int nThreads, i;
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "64");
+    poTileCache->Reconfigure();
+
+    pabyBlock = (GByte *) CPLCalloc(1, BENCH_BLOCK_SIZE);
+    for(i = 0; i < BENCH_BLOCKS; i++) {
+        aosKeys[i].Printf("public.bench|PG:dbname=bench|1|1|%d|%d", i % 16,
+            i / 16);
+        pabyBlock[0] = (GByte) i;
+        poTileCache->Insert(aosKeys[i], PostGISRasterHilbertIndex(i % 16,
+            i / 16), pabyBlock, BENCH_BLOCK_SIZE);
+    }
+    CPLFree(pabyBlock);
+
+    printf("threads  reads/s      hits\n");
+
+    for(nThreads = 1; nThreads <= BENCH_MAX_THREADS; nThreads *= 2) {
+        nFinished = 0;
+        dfStart = GetTime();
+
+        for(i = 0; i < nThreads; i++) {
+            asThreads[i].nThread = i;
+            asThreads[i].nHits = 0;
+            CPLCreateThread(ReadBlocks, asThreads + i);
+        }
+
+        while (nFinished < nThreads)
+            CPLSleep(0.001);
+
+        dfElapsed = GetTime() - dfStart;
+
+        for(i = 1; i < nThreads; i++)
+            asThreads[0].nHits += asThreads[i].nHits;
+
+        printf("%7d  %10.0f  %8d\n", nThreads,
+            (double) nThreads * BENCH_ITERATIONS / dfElapsed, asThreads[0].nHits);
+    }
+
+    return 0;
+}
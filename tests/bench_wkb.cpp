@@ -0,0 +1,139 @@
+/******************************************************************************
+ * File :    bench_wkb.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Throughput benchmark of the tile decoding: hex text to a
+ *           parsed WKB raster band, as IRasterIO() does for each tile
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+#include <sys/time.h>
+
+#define BENCH_TILE_SIZE     256
+#define BENCH_BANDS         3
+#define BENCH_SECONDS       2.0
+
+static double GetTime() {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Little endian Float32 tile, as hex text, like the query results */
+static char * BuildHexTile(int * pnHexLength)
+{
+    static const char szHexDigits[] = "0123456789abcdef";
+    int nPixels = BENCH_TILE_SIZE * BENCH_TILE_SIZE;
+    int nLength = RASTER_HEADER_SIZE + BENCH_BANDS * 
+        (RASTER_BAND_HEADER_FIXED_SIZE + 4 + nPixels * 4);
+    GByte * pabyWKB = (GByte *) CPLCalloc(1, nLength);
+    char * pszHex = (char *) CPLMalloc(2 * nLength + 1);
+    GUInt16 nValue;
+    double dfScale = 1.0;
+    float fPixel;
+    int nOffset = RASTER_HEADER_SIZE;
+    int i, iBand;
+
+    pabyWKB[0] = 1;
+    nValue = BENCH_BANDS;
+    memcpy(pabyWKB + 3, &nValue, 2);
+    memcpy(pabyWKB + 5, &dfScale, 8);
+    dfScale = -1.0;
+    memcpy(pabyWKB + 13, &dfScale, 8);
+    nValue = BENCH_TILE_SIZE;
+    memcpy(pabyWKB + 57, &nValue, 2);
+    memcpy(pabyWKB + 59, &nValue, 2);
+#ifndef CPL_LSB
+    for(i = 5; i < 53; i += 8)
+        CPL_SWAP64PTR(pabyWKB + i);
+    CPL_SWAP16PTR(pabyWKB + 3);
+    CPL_SWAP16PTR(pabyWKB + 57);
+    CPL_SWAP16PTR(pabyWKB + 59);
+#endif
+
+    for(iBand = 0; iBand < BENCH_BANDS; iBand++) {
+        pabyWKB[nOffset] = 10;
+        nOffset += RASTER_BAND_HEADER_FIXED_SIZE + 4;
+        for(i = 0; i < nPixels; i++, nOffset += 4) {
+            fPixel = (float) (i % 1000) / 7.0f;
+            memcpy(pabyWKB + nOffset, &fPixel, 4);
+#ifndef CPL_LSB
+            CPL_SWAP32PTR(pabyWKB + nOffset);
+#endif
+        }
+    }
+
+    for(i = 0; i < nLength; i++) {
+        pszHex[2 * i] = szHexDigits[pabyWKB[i] >> 4];
+        pszHex[2 * i + 1] = szHexDigits[pabyWKB[i] & 0x0F];
+    }
+    pszHex[2 * nLength] = '\0';
+
+    CPLFree(pabyWKB);
+    *pnHexLength = 2 * nLength;
+
+    return pszHex;
+}
+
+int main(int argc, char ** argv)
+{
+    PostGISRasterWKBHeader sHeader;
+    PostGISRasterWKBBandHeader sBand;
+    GByte * pabyWKB;
+    char * pszHex;
+    int nHexLength, nLength;
+    int nTiles = 0;
+    volatile int nSum = 0;
+    double dfStart, dfElapsed;
+
+    pszHex = BuildHexTile(&nHexLength);
+    pabyWKB = (GByte *) CPLMalloc(nHexLength / 2);
+
+    dfStart = GetTime();
+    do {
+        nLength = PostGISRasterHexToBinary(pszHex, nHexLength, pabyWKB);
+        if (!PostGISRasterParseWKBHeader(pabyWKB, nLength, &sHeader) ||
+            !PostGISRasterGetWKBBand(pabyWKB, nLength, &sHeader, 
+                BENCH_BANDS - 1, &sBand)) {
+            fprintf(stderr, "Invalid benchmark tile\n");
+            return 1;
+        }
+        nSum += pabyWKB[sBand.nDataOffset];
+        nTiles++;
+    } while ((dfElapsed = GetTime() - dfStart) < BENCH_SECONDS);
+
+    printf("%d tiles of %dx%d x %d Float32 bands in %.2f s\n", nTiles, 
+        BENCH_TILE_SIZE, BENCH_TILE_SIZE, BENCH_BANDS, dfElapsed);
+    printf("%.1f tiles/s, %.1f MB/s of hex text\n", nTiles / dfElapsed,
+        (double) nTiles * nHexLength / dfElapsed / (1024 * 1024));
+
+    CPLFree(pabyWKB);
+    CPLFree(pszHex);
+
+    return 0;
+}
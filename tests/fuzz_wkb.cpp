@@ -0,0 +1,321 @@
+/******************************************************************************
+ * File :    fuzz_wkb.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Fuzz target of the WKB raster parser and the hex decoder
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "postgisraster.h"
+#include "cpl_conv.h"
+
+/**
+ * Built with libFuzzer (make fuzz_wkb FUZZ_FLAGS=-fsanitize=fuzzer,address
+ * with clang), the input is a WKB raster. Built without it
+ * (-DFUZZ_STANDALONE), the files given as arguments are run, or random
+ * mutations of a small valid raster if there are none.
+ *
+ * Everything the parser returns is read back, so a view out of the buffer
+ * is caught by the address sanitizer. Each raster that parses is written
+ * back, in an exactly sized buffer, and parsed again: any difference
+ * aborts.
+ **/
+
+/* Read every byte a parsed band points to */
+static int TouchBand(const GByte * pabyWKB, 
+    const PostGISRasterWKBBandHeader * psBand)
+{
+    int nSum = 0;
+    int i;
+
+    if (psBand->bIsOffline)
+        return (int) strlen(psBand->pszOutDbPath) + psBand->nOutDbBandNumber;
+
+    for(i = 0; i < psBand->nDataLength; i++)
+        nSum += pabyWKB[psBand->nDataOffset + i];
+
+    return nSum;
+}
+
+#define ROUND_TRIP_CHECK(x) do { if (!(x)) { \
+    fprintf(stderr, "Round trip mismatch: %s\n", #x); abort(); } } while(0)
+
+/* Write a parsed raster, parse it again and compare */
+static void RoundTrip(const GByte * pabyWKB, int nLength,
+    const PostGISRasterWKBHeader * psHeader)
+{
+    PostGISRasterWKBBandHeader * pasBands;
+    PostGISRasterWKBHeader sHeader;
+    PostGISRasterWKBBandHeader sBand;
+    GByte * pabyOut;
+    GByte * pabyPixels;
+    GIntBig nOutLength = RASTER_HEADER_SIZE;
+    int nOffset = RASTER_HEADER_SIZE;
+    int i;
+
+    pasBands = (PostGISRasterWKBBandHeader *) 
+        CPLMalloc(sizeof (PostGISRasterWKBBandHeader) * 
+        MAX(psHeader->nBands, 1));
+
+    for(i = 0; i < psHeader->nBands; i++) {
+        if (!PostGISRasterParseWKBBandHeader(pabyWKB, nLength, nOffset,
+                psHeader, pasBands + i)) {
+            CPLFree(pasBands);
+            return;
+        }
+        nOffset = pasBands[i].nNextBandOffset;
+        nOutLength += PostGISRasterGetWKBBandSize(psHeader, pasBands + i);
+    }
+
+    /* The written raster can't be longer than the parsed one */
+    ROUND_TRIP_CHECK(nOutLength <= nLength);
+
+    pabyOut = (GByte *) CPLMalloc((size_t) nOutLength);
+    ROUND_TRIP_CHECK(PostGISRasterWriteWKBHeader(pabyOut, (int) nOutLength,
+        psHeader) == RASTER_HEADER_SIZE);
+    ROUND_TRIP_CHECK(PostGISRasterWriteWKBHeader(pabyOut,
+        RASTER_HEADER_SIZE - 1, psHeader) == -1);
+
+    nOffset = RASTER_HEADER_SIZE;
+    for(i = 0; i < psHeader->nBands; i++) {
+        const PostGISRasterWKBBandHeader * psBand = pasBands + i;
+        int nNextOffset;
+
+        /* The writer takes the pixels in the machine byte order */
+        pabyPixels = (GByte *) CPLMalloc(MAX(psBand->nDataLength, 1));
+        memcpy(pabyPixels, pabyWKB + psBand->nDataOffset, 
+            psBand->nDataLength);
+        if (PostGISRasterWKBNeedsSwap(psHeader) && psBand->nPixelSize > 1)
+            GDALSwapWords(pabyPixels, psBand->nPixelSize, 
+                psBand->nDataLength / psBand->nPixelSize, 
+                psBand->nPixelSize);
+
+        /* One byte short doesn't fit */
+        ROUND_TRIP_CHECK(PostGISRasterWriteWKBBand(pabyOut, 
+            (int) (nOffset + PostGISRasterGetWKBBandSize(psHeader, psBand)) 
+            - 1, nOffset, psHeader, psBand, pabyPixels) == -1);
+
+        nNextOffset = PostGISRasterWriteWKBBand(pabyOut, (int) nOutLength,
+            nOffset, psHeader, psBand, pabyPixels);
+        ROUND_TRIP_CHECK(nNextOffset > nOffset);
+        nOffset = nNextOffset;
+
+        CPLFree(pabyPixels);
+    }
+    ROUND_TRIP_CHECK(nOffset == nOutLength);
+
+    ROUND_TRIP_CHECK(PostGISRasterParseWKBHeader(pabyOut, (int) nOutLength,
+        &sHeader));
+    ROUND_TRIP_CHECK(memcmp(pabyOut, pabyWKB, RASTER_HEADER_SIZE) == 0);
+
+    nOffset = RASTER_HEADER_SIZE;
+    for(i = 0; i < psHeader->nBands; i++) {
+        const PostGISRasterWKBBandHeader * psBand = pasBands + i;
+
+        ROUND_TRIP_CHECK(PostGISRasterParseWKBBandHeader(pabyOut, 
+            (int) nOutLength, nOffset, &sHeader, &sBand));
+        ROUND_TRIP_CHECK(sBand.nPixelType == psBand->nPixelType);
+        ROUND_TRIP_CHECK(sBand.bIsOffline == psBand->bIsOffline);
+        ROUND_TRIP_CHECK(sBand.bHasNoDataValue == psBand->bHasNoDataValue);
+        ROUND_TRIP_CHECK(sBand.bIsNoData == psBand->bIsNoData);
+        /* Bitwise: NaN nodata values must survive too */
+        ROUND_TRIP_CHECK(memcmp(&sBand.dfNoDataValue, 
+            &psBand->dfNoDataValue, sizeof (double)) == 0);
+        ROUND_TRIP_CHECK(sBand.nDataLength == psBand->nDataLength);
+        ROUND_TRIP_CHECK(memcmp(pabyOut + sBand.nDataOffset, 
+            pabyWKB + psBand->nDataOffset, sBand.nDataLength) == 0);
+        if (psBand->bIsOffline) {
+            ROUND_TRIP_CHECK(sBand.nOutDbBandNumber == 
+                psBand->nOutDbBandNumber);
+            ROUND_TRIP_CHECK(strcmp(sBand.pszOutDbPath, 
+                psBand->pszOutDbPath) == 0);
+        }
+        nOffset = sBand.nNextBandOffset;
+    }
+
+    CPLFree(pabyOut);
+    CPLFree(pasBands);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const GByte * pabyData, size_t nSize)
+{
+    PostGISRasterWKBHeader sHeader;
+    PostGISRasterWKBBandHeader sBand;
+    GByte * pabyWKB;
+    GByte * pabyDecoded;
+    volatile int nSum = 0;
+    int nLength, nOffset, i;
+
+    if (nSize > 16 * 1024 * 1024)
+        return 0;
+    nLength = (int) nSize;
+
+    /* Own copy, exactly sized, so reads past the end are caught */
+    pabyWKB = (GByte *) CPLMalloc(MAX(nLength, 1));
+    memcpy(pabyWKB, pabyData, nSize);
+
+    /* All the bands, one after the other, then each one by its index */
+    if (PostGISRasterParseWKBHeader(pabyWKB, nLength, &sHeader)) {
+        nOffset = RASTER_HEADER_SIZE;
+        for(i = 0; i < sHeader.nBands; i++) {
+            if (!PostGISRasterParseWKBBandHeader(pabyWKB, nLength, nOffset,
+                    &sHeader, &sBand))
+                break;
+            nSum += TouchBand(pabyWKB, &sBand);
+            nOffset = sBand.nNextBandOffset;
+        }
+
+        RoundTrip(pabyWKB, nLength, &sHeader);
+
+        for(i = 0; i < MIN(sHeader.nBands, 8); i++) {
+            if (PostGISRasterGetWKBBand(pabyWKB, nLength, &sHeader, i, &sBand))
+                nSum += TouchBand(pabyWKB, &sBand);
+        }
+    }
+
+    /* The same bytes as hex text */
+    pabyDecoded = (GByte *) CPLMalloc(MAX(nLength / 2, 1));
+    nSum += PostGISRasterHexToBinary((const char *) pabyWKB, nLength, 
+        pabyDecoded);
+
+    CPLFree(pabyDecoded);
+    CPLFree(pabyWKB);
+
+    return 0;
+}
+
+#ifdef FUZZ_STANDALONE
+
+#define FUZZ_ITERATIONS 200000
+
+/* 3x2 raster with an Int16 band, an out-db band and a Byte band, in
+ * either byte order */
+static int BuildSeed(GByte * pabyWKB, int bBigEndian)
+{
+    static const int anFieldSizes[] = { 2, 2, 8, 8, 8, 8, 8, 8, 4, 2, 2 };
+    static const GByte abyHeader[RASTER_HEADER_SIZE] = {
+        1, 0, 0, 3, 0,
+        0, 0, 0, 0, 0, 0, 240, 63,  0, 0, 0, 0, 0, 0, 240, 191,
+        0, 0, 0, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0,     0, 0, 0, 0, 0, 0, 0, 0,
+        230, 16, 0, 0, 3, 0, 2, 0
+    };
+    int nLength = 0;
+    int i;
+
+    memcpy(pabyWKB, abyHeader, RASTER_HEADER_SIZE);
+    nLength = RASTER_HEADER_SIZE;
+
+    if (bBigEndian) {
+        int nOffset = 1;
+
+        pabyWKB[0] = 0;
+        for(i = 0; i < (int) (sizeof (anFieldSizes) / sizeof (int)); i++) {
+            GByte * pabyField = pabyWKB + nOffset;
+            int j;
+
+            for(j = 0; j < anFieldSizes[i] / 2; j++) {
+                GByte byTmp = pabyField[j];
+
+                pabyField[j] = pabyField[anFieldSizes[i] - 1 - j];
+                pabyField[anFieldSizes[i] - 1 - j] = byTmp;
+            }
+            nOffset += anFieldSizes[i];
+        }
+    }
+
+    /* Nodata 1, in the byte order of the raster */
+    pabyWKB[nLength++] = 5 | BAND_FLAG_HAS_NODATA;
+    pabyWKB[nLength++] = bBigEndian ? 0 : 1;
+    pabyWKB[nLength++] = bBigEndian ? 1 : 0;
+    for(i = 0; i < 6 * 2; i++)
+        pabyWKB[nLength++] = (GByte) i;
+
+    pabyWKB[nLength++] = 4 | BAND_FLAG_OFFLINE;
+    pabyWKB[nLength++] = 0;
+    pabyWKB[nLength++] = 1;
+    memcpy(pabyWKB + nLength, "/tmp/a.tif", 11);
+    nLength += 11;
+
+    pabyWKB[nLength++] = 4;
+    pabyWKB[nLength++] = 0;
+    for(i = 0; i < 6; i++)
+        pabyWKB[nLength++] = (GByte) (i * 40);
+
+    return nLength;
+}
+
+int main(int argc, char ** argv)
+{
+    GByte aabySeeds[2][256];
+    GByte abyInput[256];
+    int anSeedLengths[2];
+    int nSeedLength, nLength;
+    int i, j;
+
+    for(i = 1; i < argc; i++) {
+        VSILFILE * fp = VSIFOpenL(argv[i], "rb");
+        GByte * pabyData;
+        int nSize;
+
+        if (fp == NULL)
+            continue;
+        VSIFSeekL(fp, 0, SEEK_END);
+        nSize = (int) VSIFTellL(fp);
+        VSIFSeekL(fp, 0, SEEK_SET);
+        pabyData = (GByte *) CPLMalloc(MAX(nSize, 1));
+        nSize = (int) VSIFReadL(pabyData, 1, nSize, fp);
+        VSIFCloseL(fp);
+
+        LLVMFuzzerTestOneInput(pabyData, nSize);
+        CPLFree(pabyData);
+    }
+
+    if (argc > 1)
+        return 0;
+
+    anSeedLengths[0] = BuildSeed(aabySeeds[0], false);
+    anSeedLengths[1] = BuildSeed(aabySeeds[1], true);
+    srand(1);
+
+    for(i = 0; i < FUZZ_ITERATIONS; i++) {
+        nSeedLength = anSeedLengths[i % 2];
+        memcpy(abyInput, aabySeeds[i % 2], nSeedLength);
+        nLength = nSeedLength;
+
+        /* A few random bytes, then maybe a truncation */
+        for(j = rand() % 4; j >= 0; j--)
+            abyInput[rand() % nSeedLength] = (GByte) rand();
+        if (rand() % 4 == 0)
+            nLength = rand() % (nSeedLength + 1);
+
+        LLVMFuzzerTestOneInput(abyInput, nLength);
+    }
+
+    printf("%d inputs run\n", FUZZ_ITERATIONS);
+
+    return 0;
+}
+
+#endif
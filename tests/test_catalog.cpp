@@ -0,0 +1,151 @@
+/******************************************************************************
+ * File :    test_catalog.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the raster tables kept to browse a database again
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+/************************************************************************
+ * Catalog: the raster tables of a database are listed once, and again
+ * after a table is dropped
+ ************************************************************************/
+static void TestCatalogReuse() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszFields[] = { "schema", "table", "column" };
+    static const char * const apszTables[] = { "public", "cat_a", "rast",
+        "public", "cat_b", "rast" };
+    GDALDatasetH hDS;
+
+    oAccess.AddTuples("*", 3, apszFields, 2, apszTables);
+
+    hDS = GDALOpen("PG:dbname=catalog host=localhost port=5432 user=gdal",
+        GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 1);
+    if (hDS != NULL) {
+        TEST_CHECK(CSLCount(GDALGetMetadata(hDS, "SUBDATASETS")) == 4);
+        GDALClose(hDS);
+    }
+
+    /* Listed from the catalog */
+    oAccess.ResetCounters();
+    hDS = GDALOpen("PG:dbname=catalog host=localhost port=5432 user=gdal",
+        GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 0);
+    if (hDS != NULL)
+        GDALClose(hDS);
+
+    /* Not the catalog of another database */
+    oAccess.AddTuples("*", 3, apszFields, 1, apszTables);
+    oAccess.ResetCounters();
+    hDS = GDALOpen("PG:dbname=CATALOG host=localhost port=5432 user=gdal",
+        GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 1);
+    if (hDS != NULL) {
+        TEST_CHECK(CSLCount(GDALGetMetadata(hDS, "SUBDATASETS")) == 2);
+        GDALClose(hDS);
+    }
+
+    /* Dropped: listed again */
+    oAccess.AddCommand("begin", true);
+    oAccess.AddTuples("*", 3, apszFields, 0, NULL);
+    oAccess.AddCommand("drop table public.cat_b", true);
+    oAccess.AddCommand("commit", true);
+    TEST_CHECK(PostGISRasterDataset::Delete("PG:dbname=catalog "
+        "host=localhost port=5432 user=gdal table=cat_b mode=2") == CE_None);
+
+    oAccess.AddTuples("*", 3, apszFields, 1, apszTables);
+    oAccess.ResetCounters();
+    hDS = GDALOpen("PG:dbname=catalog host=localhost port=5432 user=gdal",
+        GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 1);
+    if (hDS != NULL) {
+        TEST_CHECK(CSLCount(GDALGetMetadata(hDS, "SUBDATASETS")) == 2);
+        GDALClose(hDS);
+    }
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+/************************************************************************
+ * Catalog: the lists of CATALOG_CACHE_SIZE databases are kept, the
+ * oldest replaced by the next one
+ ************************************************************************/
+static void TestCatalogSize() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszFields[] = { "schema", "table", "column" };
+    static const char * const apszTables[] = { "public", "cat", "rast" };
+    PostGISRasterDriver * poDriver = 
+        (PostGISRasterDriver *) GDALGetDriverByName("PostGISRaster");
+    GDALDatasetH hDS;
+    int i;
+
+    poDriver->InvalidateCatalogs();
+
+    for (i = 0; i <= CATALOG_CACHE_SIZE; i++) {
+        oAccess.AddTuples("*", 3, apszFields, 1, apszTables);
+        hDS = GDALOpen(CPLSPrintf("PG:dbname=size%d host=localhost port=5432 "
+            "user=gdal", i), GA_ReadOnly);
+        TEST_CHECK(hDS != NULL);
+        if (hDS != NULL)
+            GDALClose(hDS);
+    }
+
+    /* The last one is kept, the first one was replaced */
+    oAccess.ResetCounters();
+    hDS = GDALOpen(CPLSPrintf("PG:dbname=size%d host=localhost port=5432 "
+        "user=gdal", CATALOG_CACHE_SIZE), GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 0);
+    if (hDS != NULL)
+        GDALClose(hDS);
+
+    oAccess.AddTuples("*", 3, apszFields, 1, apszTables);
+    oAccess.ResetCounters();
+    hDS = GDALOpen("PG:dbname=size0 host=localhost port=5432 user=gdal",
+        GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 1);
+    if (hDS != NULL)
+        GDALClose(hDS);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestCatalogReuse();
+    TestCatalogSize();
+
+    return TestReport("test_catalog");
+}
@@ -0,0 +1,142 @@
+/******************************************************************************
+ * File :    test_delete.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the deletes of raster tiles by chunks
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+/************************************************************************
+ * Delete with a where clause: the tiles are deleted by chunks of keys,
+ * read after the last key of the previous chunk, with the overview tiles
+ ************************************************************************/
+static void TestDeleteChunks() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszOverviewFields[] = { "o_table_schema",
+        "o_table_name", "o_raster_column" };
+    static const char * const apszOverview[] = { "public", "o_2_del", "rast" };
+    static const char * const apszKeyFields[] = { "rid" };
+    static const char * const apszKeys[] = { "3", "7" };
+    static const char * const apszLastKeys[] = { "9" };
+    int i;
+
+    CPLSetConfigOption("POSTGIS_RASTER_DELETE_CHUNK_SIZE", "2");
+
+    oAccess.AddCommand("begin", true);
+    oAccess.AddTuples("*", 3, apszOverviewFields, 1, apszOverview);
+    AddValue(&oAccess, "f");                    /* not all the rows */
+    AddValue(&oAccess, "rid");                  /* integer primary key */
+    oAccess.AddTuples("*", 1, apszKeyFields, 2, apszKeys);
+    for (i = 0; i < 2; i++) {
+        if (i == 1)
+            oAccess.AddTuples("*", 1, apszKeyFields, 1, apszLastKeys);
+        oAccess.AddCommand("*", true);          /* tiles */
+        oAccess.AddCommand("*", true);          /* overview tiles */
+        oAccess.AddCommand("commit", true);
+        oAccess.AddCommand("begin", true);
+    }
+    oAccess.AddCommand("commit", true);
+
+    TEST_CHECK(PostGISRasterDataset::Delete(TEST_CONNECTION 
+        " table=del mode=1 where='rid<10'") == CE_None);
+
+    TEST_CHECK(CSLCount(oAccess.papszSent) == 15);
+    TEST_CHECK(EQUAL(oAccess.GetSent(4), "select rid from public.del where "
+        "(rid<10) order by rid limit 2"));
+    TEST_CHECK(strstr(oAccess.GetSent(5), "delete from public.del where "
+        "(rid<10) and rid in (3,7) returning") != NULL);
+    TEST_CHECK(strstr(oAccess.GetSent(6), "delete from public.o_2_del o "
+        "where exists") != NULL);
+    TEST_CHECK(EQUAL(oAccess.GetSent(9), "select rid from public.del where "
+        "(rid<10) and rid > 7 order by rid limit 2"));
+    TEST_CHECK(strstr(oAccess.GetSent(10), "rid in (9)") != NULL);
+    TEST_CHECK(oAccess.CountSent("truncate") == 0);
+    TEST_CHECK(oAccess.CountSent("drop table") == 0);
+
+    CPLSetConfigOption("POSTGIS_RASTER_DELETE_CHUNK_SIZE", NULL);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+
+/************************************************************************
+ * Delete with a where clause, failing at the second chunk: the first one
+ * stays deleted, and the tiles left are counted
+ ************************************************************************/
+static void TestDeleteChunkFailure() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszOverviewFields[] = { "o_table_schema",
+        "o_table_name", "o_raster_column" };
+    static const char * const apszKeyFields[] = { "rid" };
+    static const char * const apszKeys[] = { "3", "7" };
+    static const char * const apszNextKeys[] = { "9", "11" };
+
+    CPLSetConfigOption("POSTGIS_RASTER_DELETE_CHUNK_SIZE", "2");
+
+    oAccess.AddCommand("begin", true);
+    oAccess.AddTuples("*", 3, apszOverviewFields, 0, NULL);
+    AddValue(&oAccess, "f");                    /* not all the rows */
+    AddValue(&oAccess, "rid");                  /* integer primary key */
+    oAccess.AddTuples("*", 1, apszKeyFields, 2, apszKeys);
+    oAccess.AddCommand("*", true);              /* tiles */
+    oAccess.AddCommand("commit", true);
+    oAccess.AddCommand("begin", true);
+    oAccess.AddTuples("*", 1, apszKeyFields, 2, apszNextKeys);
+    oAccess.AddCommand("*", false);             /* tiles, failing */
+    oAccess.AddCommand("rollback", true);
+    oAccess.AddCommand("begin", true);
+    AddValue(&oAccess, "4");                    /* tiles left */
+    oAccess.AddCommand("commit", true);
+
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    TEST_CHECK(PostGISRasterDataset::Delete(TEST_CONNECTION 
+        " table=del_fail mode=1 where='rid<20'") == CE_Failure);
+    CPLPopErrorHandler();
+
+    TEST_CHECK(strstr(CPLGetLastErrorMsg(), "stopped after 2 tiles") != NULL);
+    TEST_CHECK(strstr(CPLGetLastErrorMsg(), "4 tiles matching the where "
+        "clause remain") != NULL);
+    TEST_CHECK(CSLCount(oAccess.papszSent) == 14);
+    TEST_CHECK(strstr(oAccess.GetSent(9), "rid in (9,11)") != NULL);
+    TEST_CHECK(EQUAL(oAccess.GetSent(10), "rollback"));
+    TEST_CHECK(EQUAL(oAccess.GetSent(12), "select count(*) from "
+        "public.del_fail where (rid<20)"));
+
+    CPLSetConfigOption("POSTGIS_RASTER_DELETE_CHUNK_SIZE", NULL);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestDeleteChunks();
+    TestDeleteChunkFailure();
+
+    return TestReport("test_delete");
+}
@@ -0,0 +1,127 @@
+/******************************************************************************
+ * File :    test_descriptors.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the descriptors kept to open a coverage again
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+/************************************************************************
+ * Descriptors: a coverage opened again is set up with no queries, until
+ * its table is rewritten
+ ************************************************************************/
+static void TestDescriptorReuse() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszOverviewFields[] = { "o_table_schema",
+        "o_table_name", "o_raster_column" };
+    GDALDatasetH hDS;
+    double adfGeoTransform[6];
+
+    AddCoverage(&oAccess, 3);
+
+    oAccess.ResetCounters();
+    hDS = GDALOpen(TEST_CONNECTION " table=reuse mode=2", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 3);
+    if (hDS != NULL)
+        GDALClose(hDS);
+
+    oAccess.ResetCounters();
+    hDS = GDALOpen(TEST_CONNECTION " table=reuse mode=2", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 0);
+    if (hDS != NULL) {
+        TEST_CHECK(GDALGetRasterXSize(hDS) == 100 && 
+            GDALGetRasterYSize(hDS) == 100 && GDALGetRasterCount(hDS) == 3);
+        TEST_CHECK(GDALGetGeoTransform(hDS, adfGeoTransform) == CE_None &&
+            adfGeoTransform[0] == 0.0 && adfGeoTransform[3] == 100.0 &&
+            adfGeoTransform[5] == -1.0);
+        GDALClose(hDS);
+    }
+
+    /* Dropped and created again: described again */
+    oAccess.AddCommand("begin", true);
+    oAccess.AddTuples("*", 3, apszOverviewFields, 0, NULL);
+    oAccess.AddCommand("drop table public.reuse", true);
+    oAccess.AddCommand("commit", true);
+    TEST_CHECK(PostGISRasterDataset::Delete(TEST_CONNECTION 
+        " table=reuse mode=2") == CE_None);
+
+    AddCoverage(&oAccess, 1);
+
+    oAccess.ResetCounters();
+    hDS = GDALOpen(TEST_CONNECTION " table=reuse mode=2", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 3);
+    if (hDS != NULL) {
+        TEST_CHECK(GDALGetRasterCount(hDS) == 1);
+        GDALClose(hDS);
+    }
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+
+/************************************************************************
+ * Descriptors: the same table in databases whose names differ only in
+ * case isn't the same coverage
+ ************************************************************************/
+static void TestDescriptorKeyCase() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    GDALDatasetH hDS;
+
+    AddCoverage(&oAccess, 1);
+    AddCoverage(&oAccess, 2);
+
+    hDS = GDALOpen("PG:dbname=cased host=localhost port=5432 user=gdal "
+        "schema=public column=rast table=key_case mode=2", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    if (hDS != NULL)
+        GDALClose(hDS);
+
+    oAccess.ResetCounters();
+    hDS = GDALOpen("PG:dbname=CASED host=localhost port=5432 user=gdal "
+        "schema=public column=rast table=key_case mode=2", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 3);
+    if (hDS != NULL) {
+        TEST_CHECK(GDALGetRasterCount(hDS) == 2);
+        GDALClose(hDS);
+    }
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestDescriptorReuse();
+    TestDescriptorKeyCase();
+
+    return TestReport("test_descriptors");
+}
@@ -0,0 +1,180 @@
+/******************************************************************************
+ * File :    test_kernels.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the copy kernels compositing tiles into buffers
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+static const GDALDataType aeTypes[] = { GDT_Byte, GDT_UInt16, GDT_Int16,
+    GDT_UInt32, GDT_Int32, GDT_Float32, GDT_Float64 };
+
+/* Copy a Float64 source line of nCount pixels with the kernel of a pair */
+static void Copy(const double * padfSrc, GDALDataType eSrcType,
+    const int * panIndex, int nCount, GByte * pabyDst, GDALDataType eDstType,
+    int nPixelSpace, GBool bHasNoData, double dfNoData) {
+    GByte abySrc[16 * 8];
+    PostGISRasterCopyFunc pfnCopy = PostGISRasterGetCopyKernel(eSrcType,
+        eDstType, nPixelSpace == GDALGetDataTypeSize(eDstType) / 8);
+
+    TEST_CHECK(pfnCopy != NULL);
+    if (pfnCopy == NULL)
+        return;
+
+    GDALCopyWords((void *) padfSrc, GDT_Float64, sizeof (double), abySrc,
+        eSrcType, GDALGetDataTypeSize(eSrcType) / 8, nCount);
+    pfnCopy(abySrc, panIndex, nCount, pabyDst, nPixelSpace, bHasNoData,
+        dfNoData);
+}
+
+/* Get pixel i of a buffer, as a double */
+static double GetPixel(const GByte * pabyDst, GDALDataType eDstType,
+    int nPixelSpace, int i) {
+    double dfValue;
+
+    GDALCopyWords((void *) (pabyDst + i * nPixelSpace), eDstType, 0, &dfValue,
+        GDT_Float64, 0, 1);
+
+    return dfValue;
+}
+
+/************************************************************************
+ * Values are rounded to nearest and clamped into integer types
+ ************************************************************************/
+static void TestConversions() {
+    static const double adfSrc[] = { 2.5, -1.0, 300.0, 1.4, 70000.0, -2.6 };
+    GByte abyDst[6];
+    GInt16 anDst[6];
+    float afDst[6];
+
+    Copy(adfSrc, GDT_Float64, NULL, 6, abyDst, GDT_Byte, 1, false, 0.0);
+    TEST_CHECK(abyDst[0] == 3 && abyDst[1] == 0 && abyDst[2] == 255);
+    TEST_CHECK(abyDst[3] == 1 && abyDst[4] == 255 && abyDst[5] == 0);
+
+    Copy(adfSrc, GDT_Float32, NULL, 6, (GByte *) anDst, GDT_Int16, 2, false,
+        0.0);
+    TEST_CHECK(anDst[0] == 3 && anDst[1] == -1 && anDst[2] == 300);
+    TEST_CHECK(anDst[3] == 1 && anDst[4] == 32767 && anDst[5] == -3);
+
+    Copy(adfSrc, GDT_Int32, NULL, 6, (GByte *) afDst, GDT_Float32, 4, false,
+        0.0);
+    TEST_CHECK(afDst[1] == -1.0f && afDst[4] == 70000.0f);
+
+    Copy(adfSrc, GDT_UInt32, NULL, 6, (GByte *) anDst, GDT_Int16, 2, false,
+        0.0);
+    TEST_CHECK(anDst[1] == 0 && anDst[4] == 32767);
+}
+
+/************************************************************************
+ * Nodata pixels keep the destination, unless the nodata value can't be
+ * a pixel of the tile type
+ ************************************************************************/
+static void TestNoData() {
+    static const double adfSrc[] = { 7.0, 0.0, 9.0, 0.0 };
+    GByte abyDst[4];
+
+    memset(abyDst, 42, sizeof (abyDst));
+    Copy(adfSrc, GDT_Byte, NULL, 4, abyDst, GDT_Byte, 1, true, 0.0);
+    TEST_CHECK(abyDst[0] == 7 && abyDst[1] == 42);
+    TEST_CHECK(abyDst[2] == 9 && abyDst[3] == 42);
+
+    memset(abyDst, 42, sizeof (abyDst));
+    Copy(adfSrc, GDT_Byte, NULL, 4, abyDst, GDT_Byte, 1, true, 0.5);
+    TEST_CHECK(abyDst[1] == 0 && abyDst[3] == 0);
+
+    memset(abyDst, 42, sizeof (abyDst));
+    Copy(adfSrc, GDT_Byte, NULL, 4, abyDst, GDT_Byte, 1, true, -1.0);
+    TEST_CHECK(abyDst[1] == 0 && abyDst[3] == 0);
+}
+
+/************************************************************************
+ * For every pair of types, the contiguous, strided and indexed variants
+ * give the same pixels, and the strided one leaves the gaps alone
+ ************************************************************************/
+static void TestVariants() {
+    static const double adfSrc[] = { 0.0, 1.0, 127.4, 128.5, 255.0, 3.0,
+        40000.0, -7.5, 1e10, -1e10, 65535.0, 65536.0, 2.0, 3.0, 5.0, 8.0 };
+    static const int anIndex[] = { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4,
+        3, 2, 1, 0 };
+    GByte abyContiguous[16 * 8], abyStrided[16 * 8 * 2], abyIndexed[16 * 8];
+    int iSrc, iDst, i;
+
+    for(iSrc = 0; iSrc < 7; iSrc++) {
+        for(iDst = 0; iDst < 7; iDst++) {
+            int nSize = GDALGetDataTypeSize(aeTypes[iDst]) / 8;
+            GBool bGaps = true;
+
+            memset(abyContiguous, 0, sizeof (abyContiguous));
+            memset(abyStrided, 0xA5, sizeof (abyStrided));
+            memset(abyIndexed, 0, sizeof (abyIndexed));
+
+            Copy(adfSrc, aeTypes[iSrc], NULL, 16, abyContiguous, aeTypes[iDst],
+                nSize, true, 3.0);
+            Copy(adfSrc, aeTypes[iSrc], NULL, 16, abyStrided, aeTypes[iDst],
+                2 * nSize, true, 3.0);
+            Copy(adfSrc, aeTypes[iSrc], anIndex, 16, abyIndexed, aeTypes[iDst],
+                nSize, true, 3.0);
+
+            /* The source pixels 5 and 13 are nodata */
+            for(i = 0; i < 16; i++) {
+                double dfValue = GetPixel(abyContiguous, aeTypes[iDst], nSize, i);
+
+                if (i == 5 || i == 13)
+                    TEST_CHECK(dfValue == 0.0 && 
+                        abyStrided[2 * i * nSize] == 0xA5);
+                else
+                    TEST_CHECK(GetPixel(abyStrided, aeTypes[iDst], 2 * nSize,
+                        i) == dfValue);
+                TEST_CHECK(GetPixel(abyIndexed, aeTypes[iDst], nSize, 15 - i) ==
+                    dfValue);
+                if (abyStrided[(2 * i + 1) * nSize] != 0xA5)
+                    bGaps = false;
+            }
+            TEST_CHECK(bGaps);
+        }
+    }
+}
+
+/************************************************************************
+ * Complex types have no kernel
+ ************************************************************************/
+static void TestComplexTypes() {
+    TEST_CHECK(PostGISRasterGetCopyKernel(GDT_CInt16, GDT_Byte, true) == NULL);
+    TEST_CHECK(PostGISRasterGetCopyKernel(GDT_Byte, GDT_CFloat64, false) ==
+        NULL);
+    TEST_CHECK(PostGISRasterGetCopyKernel(GDT_Unknown, GDT_Byte, true) == NULL);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestConversions();
+    TestNoData();
+    TestVariants();
+    TestComplexTypes();
+
+    return TestReport("test_kernels");
+}
@@ -0,0 +1,219 @@
+/******************************************************************************
+ * File :    test_lz4.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the LZ4 block compression, and of the compressed tier
+ *           of the tile cache
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+#define TEST_MAX_SIZE   (200 * 1024)
+
+/* Compress and decompress a buffer: 1 if it gets back, 0 if it doesn't
+ * compress into nCapacity bytes, -1 on error */
+static int RoundTrip(const GByte * pabyData, int nSize, int nCapacity) {
+    GByte * pabyCompressed = (GByte *) CPLMalloc(MAX(nCapacity, 1));
+    GByte * pabyOut = (GByte *) CPLMalloc(MAX(nSize, 1));
+    int nCompressed, nResult = -1;
+
+    nCompressed = PostGISRasterLZ4Compress(pabyData, nSize, pabyCompressed,
+        nCapacity);
+    if (nCompressed == 0)
+        nResult = 0;
+    else if (nCompressed <= nCapacity &&
+            PostGISRasterLZ4Decompress(pabyCompressed, nCompressed, pabyOut,
+            nSize) == nSize && memcmp(pabyOut, pabyData, nSize) == 0)
+        nResult = 1;
+
+    CPLFree(pabyCompressed);
+    CPLFree(pabyOut);
+
+    return nResult;
+}
+
+/************************************************************************
+ * Buffers get back as they were: short ones, runs whose lengths take
+ * extra bytes, matches at the largest offset and past it, and noise
+ ************************************************************************/
+static void TestRoundTrips() {
+    GByte * pabyData = (GByte *) CPLMalloc(TEST_MAX_SIZE);
+    GUInt32 nSeed = 12345;
+    int i;
+
+    TEST_CHECK(RoundTrip(pabyData, 0, 1) == 1);
+
+    for(i = 0; i < 20; i++)
+        pabyData[i] = (GByte) ('a' + i % 3);
+    for(i = 0; i <= 20; i++)
+        TEST_CHECK(RoundTrip(pabyData, i, i + 1) == 1);
+    TEST_CHECK(RoundTrip(pabyData, 11, 11) == 0);
+
+    memset(pabyData, 7, TEST_MAX_SIZE);
+    TEST_CHECK(RoundTrip(pabyData, 1000, 64) == 1);
+    TEST_CHECK(RoundTrip(pabyData, TEST_MAX_SIZE, 2048) == 1);
+
+    /* Noise, then the same noise 65535 bytes and 70000 bytes later */
+    for(i = 0; i < 4096; i++) {
+        nSeed = nSeed * 1103515245 + 12345;
+        pabyData[i] = (GByte) (nSeed >> 16);
+    }
+    memset(pabyData + 4096, 0, TEST_MAX_SIZE - 4096);
+    memcpy(pabyData + 65535, pabyData, 4096);
+    memcpy(pabyData + 70000, pabyData, 4096);
+    TEST_CHECK(RoundTrip(pabyData, 80000, 80000) == 1);
+
+    /* Noise doesn't compress */
+    for(i = 0; i < TEST_MAX_SIZE; i++) {
+        nSeed = nSeed * 1103515245 + 12345;
+        pabyData[i] = (GByte) (nSeed >> 16);
+    }
+    TEST_CHECK(RoundTrip(pabyData, 10000, 9000) == 0);
+    TEST_CHECK(RoundTrip(pabyData, 10000, 10100) == 1);
+
+    /* Literals, runs, and literals again */
+    memset(pabyData + 300, 9, 600);
+    TEST_CHECK(RoundTrip(pabyData, 1200, 1200) == 1);
+
+    CPLFree(pabyData);
+}
+
+/************************************************************************
+ * The block is written only if it fits: the exact size is enough, one
+ * byte less isn't
+ ************************************************************************/
+static void TestCapacity() {
+    GByte abyData[4096], abyCompressed[4096];
+    int i, nCompressed;
+
+    for(i = 0; i < 4096; i++)
+        abyData[i] = (GByte) ((i / 100) * 31 + (i % 7));
+
+    nCompressed = PostGISRasterLZ4Compress(abyData, 4096, abyCompressed,
+        4096);
+    TEST_CHECK(nCompressed > 0 && nCompressed < 4096);
+    TEST_CHECK(RoundTrip(abyData, 4096, nCompressed) == 1);
+    TEST_CHECK(RoundTrip(abyData, 4096, nCompressed - 1) == 0);
+}
+
+/************************************************************************
+ * A block written by another LZ4 encoder is read, and corrupted or
+ * truncated blocks are rejected without reading or writing past the
+ * buffers
+ ************************************************************************/
+static void TestDecompress() {
+    /* "a", a match of 29 bytes at offset 1, then "aaaaa" */
+    static const GByte abyBlock[] = { 0x1F, 'a', 0x01, 0x00, 0x0A, 0x50, 'a',
+        'a', 'a', 'a', 'a' };
+    static const GByte abyBadOffset[] = { 0x10, 'a', 0x02, 0x00, 0x00 };
+    GByte abyData[2048], abyCompressed[2048], abyOut[64];
+    int i, nCompressed;
+
+    TEST_CHECK(PostGISRasterLZ4Decompress(abyBlock, sizeof (abyBlock), abyOut,
+        sizeof (abyOut)) == 35);
+    for(i = 0; i < 35; i++)
+        TEST_CHECK(abyOut[i] == 'a');
+
+    /* Doesn't fit */
+    TEST_CHECK(PostGISRasterLZ4Decompress(abyBlock, sizeof (abyBlock), abyOut,
+        34) == -1);
+
+    /* Offset before the start of the output */
+    TEST_CHECK(PostGISRasterLZ4Decompress(abyBadOffset, sizeof (abyBadOffset),
+        abyOut, sizeof (abyOut)) == -1);
+
+    for(i = 0; i < 2048; i++)
+        abyData[i] = (GByte) ((i / 64) ^ (i % 5));
+    nCompressed = PostGISRasterLZ4Compress(abyData, 2048, abyCompressed, 2048);
+    TEST_CHECK(nCompressed > 0);
+
+    for(i = 0; i < nCompressed; i++) {
+        GByte * pabyOut = (GByte *) CPLMalloc(2048);
+
+        TEST_CHECK(PostGISRasterLZ4Decompress(abyCompressed, i, pabyOut,
+            2048) < 2048);
+        CPLFree(pabyOut);
+    }
+}
+
+/************************************************************************
+ * Blocks falling out of the hot tier of a compressed tile cache are read
+ * back as they were stored
+ ************************************************************************/
+static void TestCompressedCache() {
+    PostGISRasterTileCache * poTileCache = PostGISRasterTileCache::GetInstance();
+    GByte * pabyBlock = (GByte *) CPLMalloc(64 * 1024);
+    GIntBig nHits;
+    GBool bEmpty;
+    int iBlock, i, nWrong = 0;
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "4");
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_COMPRESS", "YES");
+    poTileCache->Reconfigure();
+    poTileCache->Clear();
+
+    /* 3 MB of blocks, for a hot tier of 1 MB */
+    for(iBlock = 0; iBlock < 48; iBlock++) {
+        for(i = 0; i < 64 * 1024; i++)
+            pabyBlock[i] = (GByte) (iBlock + (i / 256) % 3);
+        poTileCache->Insert(CPLString().Printf("public.lz4|PG:dbname=db|1|1|%d|0",
+            iBlock), PostGISRasterHilbertIndex(iBlock, 0), pabyBlock, 64 * 1024);
+    }
+
+    nHits = poTileCache->GetHits();
+    for(iBlock = 0; iBlock < 48; iBlock++) {
+        bEmpty = false;
+        memset(pabyBlock, 0, 64 * 1024);
+        if (!poTileCache->Get(CPLString().Printf("public.lz4|PG:dbname=db|1|1|"
+                "%d|0", iBlock), PostGISRasterHilbertIndex(iBlock, 0), pabyBlock,
+                64 * 1024, &bEmpty) || bEmpty) {
+            nWrong++;
+            continue;
+        }
+        for(i = 0; i < 64 * 1024; i++)
+            if (pabyBlock[i] != (GByte) (iBlock + (i / 256) % 3))
+                break;
+        if (i < 64 * 1024)
+            nWrong++;
+    }
+    TEST_CHECK(nWrong == 0);
+    TEST_CHECK(poTileCache->GetHits() == nHits + 48);
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", NULL);
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_COMPRESS", NULL);
+    poTileCache->Reconfigure();
+    CPLFree(pabyBlock);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestRoundTrips();
+    TestCapacity();
+    TestDecompress();
+    TestCompressedCache();
+
+    return TestReport("test_lz4");
+}
@@ -0,0 +1,126 @@
+/******************************************************************************
+ * File :    test_quicklook.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the downsampled reads rendered by the server as images
+ *           (quicklook open option)
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+static GByte GetSeven(int nX, int nY) {
+    return 7;
+}
+
+/************************************************************************
+ * Downsampled read of a 10x10 coverage of one tile, opened with
+ * quicklook=png, whose quick look query gets pszImage (NULL for a
+ * failed query) as the image. Returns the read error, and the queries
+ ************************************************************************/
+static CPLErr ReadQuickLook(const char * pszTable, const char * pszImage,
+    GBool bNullImage, GByte * pabyBuffer, int * pnQueries) {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszImageFields[] = { "st_aspng",
+        "st_upperleftx", "st_upperlefty", "st_width", "st_height" };
+    static const char * const apszTileFields[] = { "st_band" };
+    const char * apszImage[] = { pszImage, "0", "10", "5", "5" };
+    CPLString osTile = GetTileHex(10, 10, 0, 0, GetSeven);
+    const char * apszTiles[] = { osTile.c_str() };
+    CPLString osFilename;
+    GDALDatasetH hDS;
+    CPLErr eErr = CE_Failure;
+
+    AddCoverageGrid(&oAccess, 1, 10, 10, 10);
+    osFilename.Printf(TEST_CONNECTION " table=%s mode=2 quicklook=png", pszTable);
+    hDS = GDALOpen(osFilename, GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+
+    if (hDS != NULL) {
+        if (pszImage != NULL || bNullImage)
+            oAccess.AddTuples("*", 5, apszImageFields, 1, apszImage);
+        else
+            oAccess.AddCommand("*", false);
+        oAccess.AddTuples("*", 1, apszTileFields, 1, apszTiles);
+
+        memset(pabyBuffer, 0, 25);
+        oAccess.ResetCounters();
+        CPLErrorReset();
+        eErr = GDALRasterIO(GDALGetRasterBand(hDS, 1), GF_Read, 0, 0, 10, 10,
+            pabyBuffer, 5, 5, GDT_Byte, 0, 0);
+        *pnQueries = oAccess.GetQueryCount();
+        GDALClose(hDS);
+    }
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+
+    return eErr;
+}
+
+/************************************************************************
+ * The window is read from the tiles when the server can't render the
+ * quick look, or when it can't be decoded, without reporting an error
+ ************************************************************************/
+static void TestQuickLookFallback() {
+    GByte abyBuffer[25];
+    int nQueries = 0, i;
+
+    TEST_CHECK(ReadQuickLook("quicklook_failed", NULL, false, abyBuffer,
+        &nQueries) == CE_None);
+    TEST_CHECK(nQueries == 2);
+    for(i = 0; i < 25; i++)
+        TEST_CHECK(abyBuffer[i] == 7);
+
+    TEST_CHECK(ReadQuickLook("quicklook_corrupted", "89504E470D0A1A0A0000",
+        false, abyBuffer, &nQueries) == CE_None);
+    TEST_CHECK(nQueries == 2);
+    TEST_CHECK(CPLGetLastErrorType() == CE_None);
+    for(i = 0; i < 25; i++)
+        TEST_CHECK(abyBuffer[i] == 7);
+}
+
+/************************************************************************
+ * A window with no tiles gets no image: it's filled with nodata, and
+ * the tiles aren't read
+ ************************************************************************/
+static void TestQuickLookNoTiles() {
+    GByte abyBuffer[25];
+    int nQueries = 0, i;
+
+    TEST_CHECK(ReadQuickLook("quicklook_empty", NULL, true, abyBuffer,
+        &nQueries) == CE_None);
+    TEST_CHECK(nQueries == 1);
+    for(i = 0; i < 25; i++)
+        TEST_CHECK(abyBuffer[i] == 5);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestQuickLookFallback();
+    TestQuickLookNoTiles();
+
+    return TestReport("test_quicklook");
+}
@@ -0,0 +1,246 @@
+/******************************************************************************
+ * File :    test_replay.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the recording/replaying database access layer, and
+ *           of the round trips of the driver through it
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+#include "cpl_vsi.h"
+
+/************************************************************************
+ * Scripted results: replayed in order, "*" matching any query, a failure
+ * for a query with no result left, and counted as they're received
+ ************************************************************************/
+static void TestScriptedResults() {
+    PostGISRasterReplayDBAccess oAccess;
+    static const char * const apszFields[] = { "a", "b" };
+    static const char * const apszValues[] = { "1", "22", "333", NULL };
+    PGconn * poConn = oAccess.Connect("dbname=db");
+    PGresult * poResult = NULL;
+
+    TEST_CHECK(oAccess.IsConnected(poConn));
+
+    oAccess.AddCommand("begin", true);
+    oAccess.AddTuples("select a, b from t", 2, apszFields, 2, apszValues);
+    oAccess.AddCommand("*", false);
+
+    TEST_CHECK(oAccess.GetRecordCount() == 3);
+    TEST_CHECK(oAccess.GetRecordedPayloadSize(0) == 0);
+    TEST_CHECK(oAccess.GetRecordedPayloadSize(1) == 6);
+
+    /* The records before the matching one are skipped */
+    poResult = oAccess.Exec(poConn, "select a, b from t");
+    TEST_CHECK(PQresultStatus(poResult) == PGRES_TUPLES_OK);
+    TEST_CHECK(PQntuples(poResult) == 2 && PQnfields(poResult) == 2);
+    TEST_CHECK(EQUAL(PQfname(poResult, 1), "b"));
+    TEST_CHECK(EQUAL(PQgetvalue(poResult, 1, 0), "333"));
+    TEST_CHECK(PQgetisnull(poResult, 1, 1));
+    PQclear(poResult);
+
+    poResult = oAccess.Exec(poConn, "commit");
+    TEST_CHECK(PQresultStatus(poResult) == PGRES_FATAL_ERROR);
+    PQclear(poResult);
+
+    poResult = oAccess.Exec(poConn, "begin");
+    TEST_CHECK(PQresultStatus(poResult) == PGRES_FATAL_ERROR);
+    PQclear(poResult);
+
+    TEST_CHECK(oAccess.GetQueryCount() == 3);
+    TEST_CHECK(oAccess.GetBytesReceived() == 6);
+
+    oAccess.ResetCounters();
+    oAccess.Rewind();
+
+    poResult = oAccess.Exec(poConn, "begin");
+    TEST_CHECK(PQresultStatus(poResult) == PGRES_COMMAND_OK);
+    PQclear(poResult);
+
+    TEST_CHECK(oAccess.GetQueryCount() == 1);
+    TEST_CHECK(oAccess.GetBytesReceived() == 0);
+
+    oAccess.Disconnect(poConn);
+}
+
+/************************************************************************
+ * Recording: the queries forwarded to the target are kept, saved and
+ * replayed by another instance, with the same results
+ ************************************************************************/
+static void TestRecordAndLoad() {
+    PostGISRasterReplayDBAccess oServer;
+    PostGISRasterReplayDBAccess oRecorder(&oServer);
+    PostGISRasterReplayDBAccess oReplay;
+    static const char * const apszFields[] = { "rid", "rast" };
+    static const char * const apszValues[] = { "1", "0100", "2", NULL };
+    const char * pszFilename = "/vsimem/test_replay.rec";
+    PGconn * poConn = oRecorder.Connect("dbname=db");
+    PGresult * poResult = NULL;
+
+    oServer.AddTuples("*", 2, apszFields, 2, apszValues);
+    oServer.AddCommand("*", true);
+
+    PQclear(oRecorder.Exec(poConn, "select rid, rast from t"));
+    PQclear(oRecorder.Exec(poConn, "analyze t"));
+    PQclear(oRecorder.Exec(poConn, "select 1"));
+
+    TEST_CHECK(oRecorder.GetRecordCount() == 3);
+    TEST_CHECK(EQUAL(oRecorder.GetRecordedQuery(1), "analyze t"));
+    TEST_CHECK(oRecorder.GetRecordedPayloadSize(0) == 6);
+    TEST_CHECK(oRecorder.GetQueryCount() == 3);
+    TEST_CHECK(oServer.GetQueryCount() == 3);
+
+    TEST_CHECK(oRecorder.Save(pszFilename));
+    TEST_CHECK(oReplay.Load(pszFilename));
+    VSIUnlink(pszFilename);
+
+    TEST_CHECK(oReplay.GetRecordCount() == 3);
+
+    poResult = oReplay.Exec(poConn, "select rid, rast from t");
+    TEST_CHECK(PQresultStatus(poResult) == PGRES_TUPLES_OK &&
+        PQntuples(poResult) == 2);
+    TEST_CHECK(EQUAL(PQfname(poResult, 1), "rast"));
+    TEST_CHECK(EQUAL(PQgetvalue(poResult, 0, 1), "0100"));
+    TEST_CHECK(PQgetisnull(poResult, 1, 1));
+    PQclear(poResult);
+
+    poResult = oReplay.Exec(poConn, "analyze t");
+    TEST_CHECK(PQresultStatus(poResult) == PGRES_COMMAND_OK);
+    PQclear(poResult);
+
+    poResult = oReplay.Exec(poConn, "select 1");
+    TEST_CHECK(PQresultStatus(poResult) == PGRES_FATAL_ERROR);
+    PQclear(poResult);
+
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    TEST_CHECK(!oReplay.Load("/vsimem/test_replay_missing.rec"));
+    CPLPopErrorHandler();
+}
+
+/************************************************************************
+ * Latency: each round trip is delayed
+ ************************************************************************/
+static void TestLatency() {
+    PostGISRasterReplayDBAccess oAccess;
+    PGconn * poConn = oAccess.Connect("dbname=db");
+    time_t nStart;
+
+    oAccess.AddCommand("*", true);
+    oAccess.AddCommand("*", true);
+    oAccess.SetLatency(600);
+
+    nStart = time(NULL);
+    PQclear(oAccess.Exec(poConn, "begin"));
+    PQclear(oAccess.Exec(poConn, "commit"));
+
+    /* 1.2 seconds always cross a second boundary */
+    TEST_CHECK(time(NULL) - nStart >= 1);
+}
+
+/************************************************************************
+ * Round trips of the driver: opening a coverage, and reading a block
+ ************************************************************************/
+static void TestDriverRoundTrips() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszTileFields[] = { "st_band" };
+    GDALDatasetH hDS;
+    GByte abyBuffer[100];
+
+    AddCoverage(&oAccess, 4);
+    oAccess.AddTuples("*", 1, apszTileFields, 0, NULL);
+
+    oAccess.ResetCounters();
+    hDS = GDALOpen(TEST_CONNECTION " table=round_trips mode=2", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 3);
+    TEST_CHECK(oAccess.GetBytesReceived() > 0);
+
+    if (hDS != NULL) {
+        oAccess.ResetCounters();
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hDS, 3), GF_Read, 0, 0, 10,
+            10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(oAccess.GetQueryCount() == 1);
+        TEST_CHECK(abyBuffer[0] == 5 && abyBuffer[99] == 5);
+        GDALClose(hDS);
+    }
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+/************************************************************************
+ * Reprojected tiles (target_srid): the window is segmentized before it's
+ * transformed to the srid of each branch of the tiles
+ ************************************************************************/
+static void TestReprojectedWindow() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszExtentFields[] = { "nbband", "xmin", "xmax",
+        "ymin", "ymax", "sx", "sy", "n", "s" };
+    static const char * const apszExtent[] = { "1", "0", "100", "0", "100",
+        "1", "1", "4", "4326,4269" };
+    static const char * const apszBandFields[] = { "pixeltype", "isnull",
+        "nodata" };
+    static const char * const apszBand[] = { "8BUI", "f", "5" };
+    static const char * const apszOverviewFields[] = { "overview_factor" };
+    static const char * const apszTileFields[] = { "st_band" };
+    GDALDatasetH hDS;
+    GByte abyBuffer[100];
+
+    oAccess.AddTuples("*", 9, apszExtentFields, 1, apszExtent);
+    oAccess.AddTuples("*", 3, apszBandFields, 1, apszBand);
+    oAccess.AddTuples("*", 1, apszOverviewFields, 0, NULL);
+    oAccess.AddTuples("*", 1, apszTileFields, 0, NULL);
+
+    hDS = GDALOpen(TEST_CONNECTION " table=reprojected mode=2 "
+        "target_srid=3857", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+
+    if (hDS != NULL) {
+        oAccess.ResetCounters();
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hDS, 1), GF_Read, 0, 0, 10,
+            10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(oAccess.GetQueryCount() == 1);
+        TEST_CHECK(oAccess.CountSent("st_transform(st_segmentize("
+            "st_polygonfromtext(") == 1);
+        TEST_CHECK(oAccess.CountSent("', 3857), 64), 4326)) UNION ALL") == 1);
+        TEST_CHECK(oAccess.CountSent("', 3857), 64), 4269))) t") == 1);
+        GDALClose(hDS);
+    }
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestScriptedResults();
+    TestRecordAndLoad();
+    TestLatency();
+    TestDriverRoundTrips();
+    TestReprojectedWindow();
+
+    return TestReport("test_replay");
+}
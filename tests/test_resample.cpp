@@ -0,0 +1,184 @@
+/******************************************************************************
+ * File :    test_resample.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the resampling of tiles into buffers of another size
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+/* Resample one nXSize x nYSize Float64 tile covering the whole window */
+static void ResampleTile(PostGISRasterResampling eResampling,
+    const double * padfTile, int nXSize, int nYSize, GBool bHasNoData,
+    double dfNoData, double * padfBuffer, int nBufXSize, int nBufYSize) {
+    PostGISRasterArena oArena;
+    PostGISRasterResampler oResampler;
+
+    TEST_CHECK(oResampler.Init(&oArena, eResampling, nXSize, nYSize,
+        nBufXSize, nBufYSize));
+    oResampler.AddTile((const GByte *) padfTile, GDT_Float64, nXSize, nYSize,
+        bHasNoData, dfNoData, 0, 0, nXSize, nYSize);
+    oResampler.Finish((GByte *) padfBuffer, GDT_Float64, sizeof (double),
+        nBufXSize * sizeof (double), -1.0);
+}
+
+/************************************************************************
+ * NEAREST picks the tile pixel under the center of each buffer pixel,
+ * AVERAGE the mean of its footprint
+ ************************************************************************/
+static void TestDownsample() {
+    double adfTile[16], adfBuffer[4];
+    int i;
+
+    for(i = 0; i < 16; i++)
+        adfTile[i] = i;
+
+    ResampleTile(RESAMPLING_NEAREST, adfTile, 4, 4, false, 0.0, adfBuffer, 2, 2);
+    TEST_CHECK(adfBuffer[0] == 5 && adfBuffer[1] == 7);
+    TEST_CHECK(adfBuffer[2] == 13 && adfBuffer[3] == 15);
+
+    ResampleTile(RESAMPLING_AVERAGE, adfTile, 4, 4, false, 0.0, adfBuffer, 2, 2);
+    TEST_CHECK(adfBuffer[0] == (0 + 1 + 4 + 5) / 4.0);
+    TEST_CHECK(adfBuffer[3] == (10 + 11 + 14 + 15) / 4.0);
+}
+
+/************************************************************************
+ * Nodata pixels get no weight, and buffer pixels with no valid pixel
+ * under them get the fill value
+ ************************************************************************/
+static void TestNoData() {
+    double adfTile[16], adfBuffer[4];
+    int i;
+
+    for(i = 0; i < 16; i++)
+        adfTile[i] = 8.0;
+    adfTile[0] = adfTile[1] = adfTile[4] = 99.0;
+    adfTile[10] = adfTile[11] = adfTile[14] = adfTile[15] = 99.0;
+
+    ResampleTile(RESAMPLING_AVERAGE, adfTile, 4, 4, true, 99.0, adfBuffer, 2, 2);
+    TEST_CHECK(adfBuffer[0] == 8.0 && adfBuffer[1] == 8.0);
+    TEST_CHECK(adfBuffer[2] == 8.0 && adfBuffer[3] == -1.0);
+}
+
+/************************************************************************
+ * The interpolating kernels give the tile back at the same resolution,
+ * and all the kernels keep a constant tile constant
+ ************************************************************************/
+static void TestKernelWeights() {
+    static const PostGISRasterResampling aeResamplings[] = {
+        RESAMPLING_NEAREST, RESAMPLING_AVERAGE, RESAMPLING_BILINEAR,
+        RESAMPLING_CUBIC };
+    double adfTile[64], adfBuffer[64];
+    int i, j;
+
+    for(i = 0; i < 4; i++) {
+        for(j = 0; j < 64; j++)
+            adfTile[j] = (j * 37) % 11;
+
+        ResampleTile(aeResamplings[i], adfTile, 8, 8, false, 0.0, adfBuffer,
+            8, 8);
+        for(j = 0; j < 64; j++)
+            TEST_CHECK(fabs(adfBuffer[j] - adfTile[j]) < 1e-9);
+
+        for(j = 0; j < 64; j++)
+            adfTile[j] = 3.0;
+
+        ResampleTile(aeResamplings[i], adfTile, 8, 8, false, 0.0, adfBuffer,
+            3, 5);
+        for(j = 0; j < 15; j++)
+            TEST_CHECK(fabs(adfBuffer[j] - 3.0) < 1e-9);
+    }
+}
+
+/************************************************************************
+ * A window cut in tiles is resampled as if it were one tile, whatever
+ * the kernel
+ ************************************************************************/
+static void TestTileSeams() {
+    static const PostGISRasterResampling aeResamplings[] = {
+        RESAMPLING_AVERAGE, RESAMPLING_BILINEAR, RESAMPLING_CUBIC };
+    double adfWindow[12 * 8], adfLeft[6 * 8], adfRight[6 * 8];
+    double adfWhole[5 * 3], adfTiled[5 * 3];
+    int i, x, y;
+
+    for(y = 0; y < 8; y++) {
+        for(x = 0; x < 12; x++) {
+            adfWindow[y * 12 + x] = x * x + 3 * y;
+            if (x < 6)
+                adfLeft[y * 6 + x] = adfWindow[y * 12 + x];
+            else
+                adfRight[y * 6 + x - 6] = adfWindow[y * 12 + x];
+        }
+    }
+
+    for(i = 0; i < 3; i++) {
+        PostGISRasterArena oArena;
+        PostGISRasterResampler oResampler;
+
+        ResampleTile(aeResamplings[i], adfWindow, 12, 8, false, 0.0, adfWhole,
+            5, 3);
+
+        TEST_CHECK(oResampler.Init(&oArena, aeResamplings[i], 12, 8, 5, 3));
+        oResampler.AddTile((const GByte *) adfLeft, GDT_Float64, 6, 8, false,
+            0.0, 0, 0, 6, 8);
+        oResampler.AddTile((const GByte *) adfRight, GDT_Float64, 6, 8, false,
+            0.0, 6, 0, 6, 8);
+        oResampler.Finish((GByte *) adfTiled, GDT_Float64, sizeof (double),
+            5 * sizeof (double), -1.0);
+
+        for(x = 0; x < 15; x++)
+            TEST_CHECK(fabs(adfWhole[x] - adfTiled[x]) < 1e-9);
+    }
+}
+
+/************************************************************************
+ * The sums are written to integer buffers rounded and clamped
+ ************************************************************************/
+static void TestIntegerBuffer() {
+    PostGISRasterArena oArena;
+    PostGISRasterResampler oResampler;
+    GInt16 anTile[4] = { -300, 2, 3, 1000 };
+    GByte abyBuffer[4];
+
+    TEST_CHECK(oResampler.Init(&oArena, RESAMPLING_NEAREST, 2, 2, 2, 2));
+    oResampler.AddTile((const GByte *) anTile, GDT_Int16, 2, 2, false, 0.0,
+        0, 0, 2, 2);
+    oResampler.Finish(abyBuffer, GDT_Byte, 1, 2, 0.0);
+
+    TEST_CHECK(abyBuffer[0] == 0 && abyBuffer[1] == 2);
+    TEST_CHECK(abyBuffer[2] == 3 && abyBuffer[3] == 255);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestDownsample();
+    TestNoData();
+    TestKernelWeights();
+    TestTileSeams();
+    TestIntegerBuffer();
+
+    return TestReport("test_resample");
+}
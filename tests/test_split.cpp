@@ -0,0 +1,115 @@
+/******************************************************************************
+ * File :    test_split.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the reads over the memory budget, split in halves
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+static GByte GetGradient(int x, int y) {
+    return (GByte) ((x * 7 + y * 13) % 251);
+}
+
+/**
+ * Read the 990x990 window of a 1000x1000 coverage of 100x100 tiles into a
+ * nBufSize x nBufSize buffer, whole, then under a memory budget that
+ * splits it. The results must be the same
+ **/
+static void CheckSplitRead(const char * pszTable, int nBufSize,
+    const char * pszResampling, GBool bSplit) {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    GByte * pabyWhole = (GByte *) CPLCalloc(nBufSize, nBufSize);
+    GByte * pabySplit = (GByte *) CPLCalloc(nBufSize, nBufSize);
+    GDALDatasetH hDS;
+    GDALRasterBandH hBand;
+    int i;
+
+    CPLSetConfigOption("POSTGIS_RASTER_RESAMPLING", pszResampling);
+
+    AddCoverageGrid(&oAccess, 1, 1000, 1000, 100);
+    for (i = 0; i < 32; i++)
+        AddTiles(&oAccess, 1000, 1000, 100, GetGradient);
+
+    hDS = GDALOpen(CPLSPrintf(TEST_CONNECTION " table=%s mode=2", pszTable),
+        GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    if (hDS != NULL) {
+        hBand = GDALGetRasterBand(hDS, 1);
+
+        oAccess.ResetCounters();
+        TEST_CHECK(GDALRasterIO(hBand, GF_Read, 0, 0, 990, 990, pabyWhole,
+            nBufSize, nBufSize, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(oAccess.GetQueryCount() == 1);
+
+        CPLSetConfigOption("POSTGIS_RASTER_MEMORY_BUDGET", "1");
+        oAccess.ResetCounters();
+        TEST_CHECK(GDALRasterIO(hBand, GF_Read, 0, 0, 990, 990, pabySplit,
+            nBufSize, nBufSize, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(bSplit ? oAccess.GetQueryCount() > 1 : 
+            oAccess.GetQueryCount() == 1);
+        CPLSetConfigOption("POSTGIS_RASTER_MEMORY_BUDGET", NULL);
+
+        TEST_CHECK(memcmp(pabyWhole, pabySplit, nBufSize * nBufSize) == 0);
+        if (nBufSize == 990)
+            TEST_CHECK(pabyWhole[989 * 990 + 989] == GetGradient(989, 989));
+
+        GDALClose(hDS);
+    }
+
+    CPLSetConfigOption("POSTGIS_RASTER_RESAMPLING", NULL);
+    CPLFree(pabyWhole);
+    CPLFree(pabySplit);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+/************************************************************************
+ * Windows over the memory budget: read in halves with no seam, at full
+ * resolution or resampled, or read whole if they can't be split exactly
+ ************************************************************************/
+static void TestSplitRead() {
+    /* Full resolution: split at block boundaries */
+    CheckSplitRead("split_full", 990, "NEAREST", true);
+
+    /* 990 / 350 = 99 / 35: split every 99 lines, 35 buffer lines */
+    CheckSplitRead("split_nearest", 350, "NEAREST", true);
+    CheckSplitRead("split_average", 350, "AVERAGE", true);
+
+    /* 990 / 347: no exact split */
+    CheckSplitRead("split_prime", 347, "NEAREST", false);
+
+    /* The kernel reads the tiles of the other half */
+    CheckSplitRead("split_bilinear", 350, "BILINEAR", false);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestSplitRead();
+
+    return TestReport("test_split");
+}
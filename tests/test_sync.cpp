@@ -0,0 +1,265 @@
+/******************************************************************************
+ * File :    test_sync.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the incremental copy of a raster table
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+/************************************************************************
+ * INCREMENTAL copy: only the changed tiles are written, in batches, and
+ * the table isn't copied again
+ ************************************************************************/
+static void TestIncrementalCopy() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszCountFields[] = { "count", "inserts",
+        "deletes" };
+    static const char * const apszCounts[] = { "3", "1", "1" };
+    GDALDatasetH hSrcDS;
+    GDALDataset * poDstDS;
+    char ** papszOptions = NULL;
+    int i;
+
+    AddCoverage(&oAccess, 1);
+    hSrcDS = GDALOpen(TEST_CONNECTION " table=sync_src mode=2", GA_ReadOnly);
+    TEST_CHECK(hSrcDS != NULL);
+    if (hSrcDS == NULL) {
+        PostGISRasterDBAccess::SetInstance(poPrevious);
+        return;
+    }
+
+    oAccess.AddCommand("begin", true);
+    oAccess.AddCommand("*", true);              /* create table if not exists */
+    AddValue(&oAccess, "1");                    /* the index exists */
+    oAccess.AddCommand("select 1", true);
+    oAccess.AddCommand("*", true);              /* pgr_delta */
+    oAccess.AddTuples("*", 3, apszCountFields, 1, apszCounts);
+    AddValue(&oAccess, "0");                    /* no tile stats */
+    for (i = 0; i < 6; i++)
+        oAccess.AddCommand("*", true);          /* 2 batches of 3 statements */
+    oAccess.AddCommand("commit", true);
+    AddCoverage(&oAccess, 1);                   /* the copy is opened */
+
+    papszOptions = CSLSetNameValue(papszOptions, "INCREMENTAL", "YES");
+    papszOptions = CSLSetNameValue(papszOptions, "INCREMENTAL_BATCH_SIZE", "2");
+    papszOptions = CSLSetNameValue(papszOptions, "ADD_CONSTRAINTS", "NO");
+
+    poDstDS = PostGISRasterDataset::CreateCopy(TEST_CONNECTION 
+        " table=sync_dst mode=2", (GDALDataset *) hSrcDS, false, papszOptions,
+        NULL, NULL);
+    TEST_CHECK(poDstDS != NULL);
+
+    TEST_CHECK(CSLCount(oAccess.papszSent) == 3 + 14 + 3);
+    TEST_CHECK(oAccess.CountSent("create temp table pgr_delta") == 1);
+    TEST_CHECK(oAccess.CountSent("from public.sync_dst) d on s.ux = d.ux") == 1);
+    TEST_CHECK(oAccess.CountSent("delete from public.sync_dst where ctid") == 2);
+    TEST_CHECK(oAccess.CountSent("update public.sync_dst r set rast = d.t from") == 2);
+    TEST_CHECK(oAccess.CountSent("insert into public.sync_dst (rast) (select t "
+        "from pgr_delta") == 2);
+    TEST_CHECK(oAccess.CountSent("id > 0 and id <= 2") == 3);
+    TEST_CHECK(oAccess.CountSent("id > 2 and id <= 4") == 3);
+    TEST_CHECK(oAccess.CountSent("DropRasterConstraints") == 0);
+
+    if (poDstDS != NULL)
+        GDALClose((GDALDatasetH) poDstDS);
+    GDALClose(hSrcDS);
+    CSLDestroy(papszOptions);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+
+/************************************************************************
+ * INCREMENTAL copy from another database, or to the source table: the
+ * copy fails before any query
+ ************************************************************************/
+static void TestIncrementalSources() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    GDALDatasetH hSrcDS;
+    GDALDataset * poDstDS;
+    char ** papszOptions = NULL;
+
+    AddCoverage(&oAccess, 1);
+    hSrcDS = GDALOpen(TEST_CONNECTION " table=sync_self mode=2", GA_ReadOnly);
+    TEST_CHECK(hSrcDS != NULL);
+    if (hSrcDS == NULL) {
+        PostGISRasterDBAccess::SetInstance(poPrevious);
+        return;
+    }
+
+    papszOptions = CSLSetNameValue(papszOptions, "INCREMENTAL", "YES");
+
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    poDstDS = PostGISRasterDataset::CreateCopy("PG:dbname=other "
+        "host=localhost port=5432 user=gdal schema=public column=rast "
+        "table=sync_dst mode=2", (GDALDataset *) hSrcDS, false, papszOptions,
+        NULL, NULL);
+    TEST_CHECK(poDstDS == NULL);
+
+    poDstDS = PostGISRasterDataset::CreateCopy("PG:dbname=db "
+        "host=localhost port=5433 user=gdal schema=public column=rast "
+        "table=sync_dst mode=2", (GDALDataset *) hSrcDS, false, papszOptions,
+        NULL, NULL);
+    TEST_CHECK(poDstDS == NULL);
+
+    poDstDS = PostGISRasterDataset::CreateCopy(TEST_CONNECTION 
+        " table=sync_self mode=2", (GDALDataset *) hSrcDS, false, 
+        papszOptions, NULL, NULL);
+    TEST_CHECK(poDstDS == NULL);
+    CPLPopErrorHandler();
+
+    /* Only the queries of the open */
+    TEST_CHECK(CSLCount(oAccess.papszSent) == 3);
+
+    GDALClose(hSrcDS);
+    CSLDestroy(papszOptions);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+/************************************************************************
+ * SPATIAL_ORDER=HILBERT: the tiles are ordered by the server, from their
+ * upper left corners, without fetching them first
+ ************************************************************************/
+static void TestHilbertCopy() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    GDALDatasetH hSrcDS;
+    GDALDataset * poDstDS;
+    char ** papszOptions = NULL;
+
+    AddCoverage(&oAccess, 1);
+    hSrcDS = GDALOpen(TEST_CONNECTION " table=hilbert_src mode=2", GA_ReadOnly);
+    TEST_CHECK(hSrcDS != NULL);
+    if (hSrcDS == NULL) {
+        PostGISRasterDBAccess::SetInstance(poPrevious);
+        return;
+    }
+
+    oAccess.AddCommand("begin", true);
+    oAccess.AddCommand("*", true);              /* create table if not exists */
+    AddValue(&oAccess, "1");                    /* the index exists */
+    oAccess.AddCommand("select 1", true);
+    oAccess.AddCommand("*", true);              /* pg_temp.pgr_hilbert */
+    oAccess.AddCommand("*", true);              /* insert */
+    oAccess.AddCommand("commit", true);
+    AddCoverage(&oAccess, 1);                   /* the copy is opened */
+
+    papszOptions = CSLSetNameValue(papszOptions, "SPATIAL_ORDER", "HILBERT");
+    papszOptions = CSLSetNameValue(papszOptions, "ADD_CONSTRAINTS", "NO");
+
+    oAccess.ResetCounters();
+    poDstDS = PostGISRasterDataset::CreateCopy(TEST_CONNECTION
+        " table=hilbert_dst mode=2", (GDALDataset *) hSrcDS, false,
+        papszOptions, NULL, NULL);
+    TEST_CHECK(poDstDS != NULL);
+
+    TEST_CHECK(oAccess.GetQueryCount() == 7 + 3);
+    TEST_CHECK(oAccess.CountSent("create or replace function "
+        "pg_temp.pgr_hilbert(") == 1);
+    TEST_CHECK(oAccess.CountSent("insert into public.hilbert_dst (rast) "
+        "(select rast from public.hilbert_src order by pg_temp.pgr_hilbert("
+        "floor(0.5 + (st_upperleftx(rast) - 0) / 1)::integer / 10, "
+        "floor(0.5 + (100 - st_upperlefty(rast)) / 1)::integer / 10))") == 1);
+    TEST_CHECK(oAccess.CountSent("ctid") == 0);
+
+    if (poDstDS != NULL)
+        GDALClose((GDALDatasetH) poDstDS);
+    GDALClose(hSrcDS);
+    CSLDestroy(papszOptions);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+/************************************************************************
+ * TILE_SIZE: a coverage opened from raster_columns knows its tile count,
+ * so a single tile is retiled, and a coverage of tiles that aren't
+ * multiples of TILE_SIZE is refused before any query
+ ************************************************************************/
+static void TestRetileCheck() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    GDALDatasetH hSrcDS, hSingleDS;
+    GDALDataset * poDstDS;
+    char ** papszOptions = NULL;
+
+    AddCoverage(&oAccess, 1);
+    hSrcDS = GDALOpen(TEST_CONNECTION " table=retile_src mode=2", GA_ReadOnly);
+    AddCoverageGrid(&oAccess, 1, 10, 10, 10);
+    hSingleDS = GDALOpen(TEST_CONNECTION " table=retile_single mode=2",
+        GA_ReadOnly);
+    TEST_CHECK(hSrcDS != NULL && hSingleDS != NULL);
+    if (hSrcDS == NULL || hSingleDS == NULL) {
+        if (hSrcDS != NULL)
+            GDALClose(hSrcDS);
+        if (hSingleDS != NULL)
+            GDALClose(hSingleDS);
+        PostGISRasterDBAccess::SetInstance(poPrevious);
+        return;
+    }
+
+    papszOptions = CSLSetNameValue(papszOptions, "TILE_SIZE", "3x3");
+
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    oAccess.ResetCounters();
+    poDstDS = PostGISRasterDataset::CreateCopy(TEST_CONNECTION
+        " table=retile_dst mode=2", (GDALDataset *) hSrcDS, false,
+        papszOptions, NULL, NULL);
+    TEST_CHECK(poDstDS == NULL);
+    TEST_CHECK(strstr(CPLGetLastErrorMsg(), "Can't retile") != NULL);
+    TEST_CHECK(oAccess.GetQueryCount() == 0);
+
+    /* Nothing is scripted for the copy itself, which fails on a query */
+    CPLErrorReset();
+    oAccess.ResetCounters();
+    poDstDS = PostGISRasterDataset::CreateCopy(TEST_CONNECTION
+        " table=retile_dst mode=2", (GDALDataset *) hSingleDS, false,
+        papszOptions, NULL, NULL);
+    TEST_CHECK(strstr(CPLGetLastErrorMsg(), "Can't retile") == NULL);
+    TEST_CHECK(oAccess.GetQueryCount() > 0);
+    CPLPopErrorHandler();
+
+    if (poDstDS != NULL)
+        GDALClose((GDALDatasetH) poDstDS);
+    GDALClose(hSingleDS);
+    GDALClose(hSrcDS);
+    CSLDestroy(papszOptions);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestIncrementalCopy();
+    TestIncrementalSources();
+    TestHilbertCopy();
+    TestRetileCheck();
+
+    return TestReport("test_sync");
+}
@@ -0,0 +1,261 @@
+/******************************************************************************
+ * File :    test_tilecache.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the driver tile cache: settings, counters, and
+ *           reconfigurations racing with readers
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+#include "cpl_multiproc.h"
+#include "cpl_atomic_ops.h"
+#include "cpl_vsi.h"
+
+#define TEST_BLOCK_SIZE     1024
+#define TEST_BLOCKS         64
+#define TEST_THREADS        4
+#define TEST_ITERATIONS     20000
+
+static CPLString osKey(int iBlock) {
+    CPLString osBlockKey;
+
+    osBlockKey.Printf("public.cached|PG:dbname=db|1|1|%d|%d", iBlock % 8,
+        iBlock / 8);
+
+    return osBlockKey;
+}
+
+static void Store(PostGISRasterTileCache * poTileCache, int iBlock) {
+    GByte abyBlock[TEST_BLOCK_SIZE];
+
+    memset(abyBlock, iBlock, TEST_BLOCK_SIZE);
+    poTileCache->Insert(osKey(iBlock), PostGISRasterHilbertIndex(iBlock % 8,
+        iBlock / 8), abyBlock, TEST_BLOCK_SIZE);
+}
+
+/* 1 on hit with the expected content, 0 on miss, -1 on a wrong hit */
+static int Lookup(PostGISRasterTileCache * poTileCache, int iBlock) {
+    GByte abyBlock[TEST_BLOCK_SIZE];
+    GBool bEmpty = false;
+    int i;
+
+    if (!poTileCache->Get(osKey(iBlock), PostGISRasterHilbertIndex(iBlock % 8,
+            iBlock / 8), abyBlock, TEST_BLOCK_SIZE, &bEmpty))
+        return 0;
+
+    for(i = 0; i < TEST_BLOCK_SIZE; i++)
+        if (bEmpty || abyBlock[i] != (GByte) iBlock)
+            return -1;
+
+    return 1;
+}
+
+/************************************************************************
+ * Hits and misses are counted by the shards, and the settings are only
+ * read again by Reconfigure()
+ ************************************************************************/
+static void TestSettings() {
+    PostGISRasterTileCache * poTileCache = PostGISRasterTileCache::GetInstance();
+    GIntBig nHits, nMisses;
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "8");
+    poTileCache->Reconfigure();
+    poTileCache->Clear();
+    TEST_CHECK(poTileCache->IsEnabled());
+
+    nHits = poTileCache->GetHits();
+    nMisses = poTileCache->GetMisses();
+
+    TEST_CHECK(Lookup(poTileCache, 1) == 0);
+    Store(poTileCache, 1);
+    TEST_CHECK(Lookup(poTileCache, 1) == 1);
+    TEST_CHECK(Lookup(poTileCache, 1) == 1);
+    TEST_CHECK(poTileCache->GetHits() == nHits + 2);
+    TEST_CHECK(poTileCache->GetMisses() == nMisses + 1);
+
+    /* Not seen until the next Reconfigure() */
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "0");
+    TEST_CHECK(poTileCache->IsEnabled());
+    TEST_CHECK(Lookup(poTileCache, 1) == 1);
+
+    poTileCache->Reconfigure();
+    TEST_CHECK(!poTileCache->IsEnabled());
+    TEST_CHECK(Lookup(poTileCache, 1) == 0);
+    Store(poTileCache, 1);
+    TEST_CHECK(Lookup(poTileCache, 1) == 0);
+
+    /* Another number of shards empties them */
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "64");
+    poTileCache->Reconfigure();
+    Store(poTileCache, 2);
+    TEST_CHECK(Lookup(poTileCache, 2) == 1);
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "8");
+    poTileCache->Reconfigure();
+    TEST_CHECK(Lookup(poTileCache, 2) == 0);
+
+    /* Written blocks are gone */
+    Store(poTileCache, 3);
+    poTileCache->Invalidate(osKey(3));
+    TEST_CHECK(Lookup(poTileCache, 3) == 0);
+}
+
+#ifndef _WIN32
+/************************************************************************
+ * A shared segment left by another version of the driver is replaced
+ * by a new one, which is used
+ ************************************************************************/
+static void TestStaleSharedSegment() {
+    PostGISRasterTileCache * poTileCache = PostGISRasterTileCache::GetInstance();
+    CPLString osFilename = CPLGenerateTempFilename("test_tilecache_shm");
+    PostGISRasterShmHeader sHeader;
+    VSILFILE * fp;
+
+    memset(&sHeader, 0, sizeof (sHeader));
+    sHeader.nMagic = TILE_CACHE_SHM_MAGIC;
+    sHeader.nVersion = TILE_CACHE_SHM_VERSION - 1;
+    sHeader.nSlots = 1 << 20;
+    sHeader.nSlotSize = 1 << 20;
+    sHeader.nSlotStride = 1 << 20;
+
+    fp = VSIFOpenL(osFilename, "wb");
+    TEST_CHECK(fp != NULL);
+    if (fp == NULL)
+        return;
+    VSIFWriteL(&sHeader, sizeof (sHeader), 1, fp);
+    VSIFCloseL(fp);
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "0");
+    CPLSetConfigOption("POSTGIS_RASTER_SHARED_TILE_CACHE", osFilename);
+    CPLSetConfigOption("POSTGIS_RASTER_SHARED_TILE_CACHE_SIZE", "1");
+    CPLSetConfigOption("POSTGIS_RASTER_SHARED_TILE_CACHE_SLOT_SIZE", "4");
+    poTileCache->Reconfigure();
+    TEST_CHECK(poTileCache->IsEnabled());
+
+    /* Only in the shared cache */
+    Store(poTileCache, 5);
+    TEST_CHECK(Lookup(poTileCache, 5) == 1);
+
+    fp = VSIFOpenL(osFilename, "rb");
+    TEST_CHECK(fp != NULL);
+    if (fp != NULL) {
+        TEST_CHECK(VSIFReadL(&sHeader, sizeof (sHeader), 1, fp) == 1);
+        TEST_CHECK(sHeader.nVersion == TILE_CACHE_SHM_VERSION);
+        TEST_CHECK(sHeader.nSlotSize == 4 * 1024);
+        VSIFCloseL(fp);
+    }
+
+    CPLSetConfigOption("POSTGIS_RASTER_SHARED_TILE_CACHE", NULL);
+    CPLSetConfigOption("POSTGIS_RASTER_SHARED_TILE_CACHE_SIZE", NULL);
+    CPLSetConfigOption("POSTGIS_RASTER_SHARED_TILE_CACHE_SLOT_SIZE", NULL);
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", NULL);
+    poTileCache->Reconfigure();
+    TEST_CHECK(!poTileCache->IsEnabled());
+    VSIUnlink(osFilename);
+}
+#endif
+
+typedef struct
+{
+    int nThread;
+    int nLookups;
+    int nWrongHits;
+} TestThread;
+
+static volatile int nFinished = 0;
+
+/* Read and store blocks, as IRasterIO() does */
+static void ReadBlocks(void * pData) {
+    TestThread * psThread = (TestThread *) pData;
+    PostGISRasterTileCache * poTileCache = PostGISRasterTileCache::GetInstance();
+    int i, iBlock, nResult;
+
+    for(i = 0; i < TEST_ITERATIONS; i++) {
+        iBlock = (i * 7 + psThread->nThread * 13) % TEST_BLOCKS;
+        nResult = Lookup(poTileCache, iBlock);
+        psThread->nLookups++;
+        if (nResult < 0)
+            psThread->nWrongHits++;
+        else if (nResult == 0)
+            Store(poTileCache, iBlock);
+    }
+
+    CPLAtomicInc(&nFinished);
+}
+
+/************************************************************************
+ * Readers racing with reconfigurations changing the number of shards:
+ * every hit has the right content, and every lookup is counted
+ ************************************************************************/
+static void TestConcurrentReconfigure() {
+    PostGISRasterTileCache * poTileCache = PostGISRasterTileCache::GetInstance();
+    TestThread asThreads[TEST_THREADS];
+    GIntBig nLookups;
+    int nWrongHits = 0;
+    int i;
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "4");
+    poTileCache->Reconfigure();
+    nLookups = poTileCache->GetHits() + poTileCache->GetMisses();
+
+    nFinished = 0;
+    for(i = 0; i < TEST_THREADS; i++) {
+        asThreads[i].nThread = i;
+        asThreads[i].nLookups = 0;
+        asThreads[i].nWrongHits = 0;
+        CPLCreateThread(ReadBlocks, asThreads + i);
+    }
+
+    for(i = 0; CPLAtomicAdd(&nFinished, 0) < TEST_THREADS; i++) {
+        CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE",
+            (i % 2) ? "64" : "4");
+        poTileCache->Reconfigure();
+        CPLSleep(0.001);
+    }
+
+    for(i = 0; i < TEST_THREADS; i++) {
+        nLookups += asThreads[i].nLookups;
+        nWrongHits += asThreads[i].nWrongHits;
+    }
+
+    TEST_CHECK(nWrongHits == 0);
+    TEST_CHECK(poTileCache->GetHits() + poTileCache->GetMisses() == nLookups);
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", NULL);
+    poTileCache->Reconfigure();
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestSettings();
+    TestConcurrentReconfigure();
+#ifndef _WIN32
+    TestStaleSharedSegment();
+#endif
+
+    return TestReport("test_tilecache");
+}
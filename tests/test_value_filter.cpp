@@ -0,0 +1,100 @@
+/******************************************************************************
+ * File :    test_value_filter.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the tiles pruned by the value_filter option
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+/************************************************************************
+ * value_filter: the tiles are pruned by the range of their values, from
+ * the tile stats columns, or computed by the server without them
+ ************************************************************************/
+static void TestValueFilter() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszTileFields[] = { "st_band" };
+    GDALDatasetH hDS;
+    GByte abyBuffer[100];
+
+    /* With tile stats */
+    AddCoverage(&oAccess, 1);
+    AddValue(&oAccess, "2");
+    oAccess.AddTuples("*", 1, apszTileFields, 0, NULL);
+
+    hDS = GDALOpen(TEST_CONNECTION " table=vf_stats mode=2 "
+        "value_filter=band1>30", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    if (hDS != NULL) {
+        memset(abyBuffer, 0, sizeof (abyBuffer));
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hDS, 1), GF_Read, 0, 0, 10,
+            10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(abyBuffer[0] == 5 && abyBuffer[99] == 5);
+        TEST_CHECK(strstr(oAccess.GetSent(4), "FROM public.vf_stats WHERE "
+            "(rast_min is null or rast_max[1] > 30) AND st_intersects(") != NULL);
+        GDALClose(hDS);
+    }
+
+    /* Without them, two conditions */
+    AddCoverage(&oAccess, 2);
+    AddValue(&oAccess, "0");
+    oAccess.AddTuples("*", 1, apszTileFields, 0, NULL);
+
+    hDS = GDALOpen(TEST_CONNECTION " table=vf_nostats mode=2 "
+        "value_filter='band1>30 and band2<=5'", GA_ReadOnly);
+    TEST_CHECK(hDS != NULL);
+    if (hDS != NULL) {
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hDS, 2), GF_Read, 0, 0, 10,
+            10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(strstr(oAccess.GetSent(9), "WHERE ((st_summarystats(rast, "
+            "1, true)).max > 30) and ((st_summarystats(rast, 2, true)).min "
+            "<= 5) AND st_intersects(") != NULL);
+        GDALClose(hDS);
+    }
+
+    /* A band the coverage doesn't have (described by the last open) */
+    AddValue(&oAccess, "0");
+
+    CPLPushErrorHandler(CPLQuietErrorHandler);
+    hDS = GDALOpen(TEST_CONNECTION " table=vf_nostats mode=2 "
+        "value_filter=band3>0", GA_ReadOnly);
+    CPLPopErrorHandler();
+    TEST_CHECK(hDS == NULL);
+    if (hDS != NULL)
+        GDALClose(hDS);
+
+    TEST_CHECK(CSLCount(oAccess.papszSent) == 11);
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestValueFilter();
+
+    return TestReport("test_value_filter");
+}
@@ -0,0 +1,186 @@
+/******************************************************************************
+ * File :    test_write.cpp
+ * Project:  PostGIS Raster driver
+ * Purpose:  Tests of the writes of band windows
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#include "testreplay.h"
+
+#include "cpl_vsi.h"
+
+static GByte GetOne(int nX, int nY) {
+    return 1;
+}
+
+/* Results of the queries of a write, up to the tiles it covers */
+static void AddWriteStart(TestReplayDBAccess * poAccess, int nTiles,
+    const char * const * papszTiles) {
+    static const char * const apszTileFields[] = { "ctid", "st_upperleftx",
+        "st_upperlefty", "st_width", "st_height" };
+
+    AddValue(poAccess, "0");
+    poAccess->AddCommand("begin", true);
+    poAccess->AddTuples("*", 5, apszTileFields, nTiles, papszTiles);
+}
+
+/************************************************************************
+ * A window that no tile covers is a failure
+ ************************************************************************/
+static void TestWriteNoTile() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    GByte abyBuffer[100];
+    GDALDatasetH hDS;
+
+    AddCoverage(&oAccess, 1);
+    hDS = GDALOpen(TEST_CONNECTION " table=write_no_tile mode=2", GA_Update);
+    TEST_CHECK(hDS != NULL);
+
+    if (hDS != NULL) {
+        AddWriteStart(&oAccess, 0, NULL);
+        oAccess.AddCommand("rollback", true);
+
+        memset(abyBuffer, 1, sizeof (abyBuffer));
+        CPLPushErrorHandler(CPLQuietErrorHandler);
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hDS, 1), GF_Write, 0, 0, 10,
+            10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_Failure);
+        CPLPopErrorHandler();
+        TEST_CHECK(oAccess.CountSent("rollback") == 1);
+        TEST_CHECK(oAccess.CountSent("update") == 0);
+        GDALClose(hDS);
+    }
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+/************************************************************************
+ * The overview tables wouldn't be updated: writing a coverage that has
+ * some is rejected, without a query
+ ************************************************************************/
+static void TestWriteOverviews() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    GByte abyBuffer[100];
+    GDALDatasetH hDS;
+
+    AddCoverageGrid(&oAccess, 1, 100, 100, 10, "2");
+    hDS = GDALOpen(TEST_CONNECTION " table=write_overviews mode=2", 
+        GA_Update);
+    TEST_CHECK(hDS != NULL);
+
+    if (hDS != NULL) {
+        TEST_CHECK(GDALGetOverviewCount(GDALGetRasterBand(hDS, 1)) == 1);
+
+        oAccess.ResetCounters();
+        memset(abyBuffer, 1, sizeof (abyBuffer));
+        CPLPushErrorHandler(CPLQuietErrorHandler);
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hDS, 1), GF_Write, 0, 0, 10,
+            10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_Failure);
+        CPLPopErrorHandler();
+        TEST_CHECK(oAccess.GetQueryCount() == 0);
+        GDALClose(hDS);
+    }
+
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+/************************************************************************
+ * A write drops the cached blocks of the table, including those read
+ * through another connection string
+ ************************************************************************/
+static void TestWriteInvalidatesTable() {
+    TestReplayDBAccess oAccess;
+    PostGISRasterDBAccess * poPrevious = PostGISRasterDBAccess::SetInstance(&oAccess);
+    static const char * const apszTileFields[] = { "st_band" };
+    static const char * const apszTile[] = { "(0,1)", "0", "100", "10", "10" };
+    CPLString osTile = GetTileHex(100, 10, 0, 0, GetOne);
+    const char * apszTiles[] = { osTile.c_str() };
+    GByte abyBuffer[100];
+    GDALDatasetH hReadDS, hWriteDS;
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", "8");
+
+    AddCoverage(&oAccess, 1);
+    hReadDS = GDALOpen(TEST_CONNECTION " table=write_cached mode=2", 
+        GA_ReadOnly);
+    TEST_CHECK(hReadDS != NULL);
+
+    /* Set up from the descriptor of the first one, without queries */
+    hWriteDS = GDALOpen("PG:dbname=db host=localhost port=5432 user=gdal "
+        "column=rast table=write_cached schema=public mode=2", GA_Update);
+    TEST_CHECK(hWriteDS != NULL);
+
+    if (hReadDS != NULL && hWriteDS != NULL) {
+        /* Cached by the first read */
+        oAccess.AddTuples("*", 1, apszTileFields, 1, apszTiles);
+        oAccess.ResetCounters();
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hReadDS, 1), GF_Read, 0, 0,
+            10, 10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hReadDS, 1), GF_Read, 0, 0,
+            10, 10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(oAccess.GetQueryCount() == 1);
+
+        /**
+         * The replayed update reports no updated tile, so the write is
+         * rolled back. The blocks are dropped anyway
+         **/
+        AddWriteStart(&oAccess, 1, apszTile);
+        oAccess.AddCommand("*", true);
+        oAccess.AddCommand("rollback", true);
+
+        memset(abyBuffer, 2, sizeof (abyBuffer));
+        CPLPushErrorHandler(CPLQuietErrorHandler);
+        GDALRasterIO(GDALGetRasterBand(hWriteDS, 1), GF_Write, 0, 0, 10, 10,
+            abyBuffer, 10, 10, GDT_Byte, 0, 0);
+        CPLPopErrorHandler();
+        TEST_CHECK(oAccess.CountSent("st_setvalues") == 1);
+
+        oAccess.AddTuples("*", 1, apszTileFields, 1, apszTiles);
+        oAccess.ResetCounters();
+        TEST_CHECK(GDALRasterIO(GDALGetRasterBand(hReadDS, 1), GF_Read, 0, 0,
+            10, 10, abyBuffer, 10, 10, GDT_Byte, 0, 0) == CE_None);
+        TEST_CHECK(oAccess.GetQueryCount() == 1);
+        TEST_CHECK(abyBuffer[0] == 1);
+    }
+
+    if (hReadDS != NULL)
+        GDALClose(hReadDS);
+    if (hWriteDS != NULL)
+        GDALClose(hWriteDS);
+
+    CPLSetConfigOption("POSTGIS_RASTER_TILE_CACHE_SIZE", NULL);
+    PostGISRasterDBAccess::SetInstance(poPrevious);
+}
+
+int main() {
+    GDALRegister_PostGISRaster();
+
+    TestWriteNoTile();
+    TestWriteOverviews();
+    TestWriteInvalidatesTable();
+
+    return TestReport("test_write");
+}
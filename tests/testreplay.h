@@ -0,0 +1,258 @@
+/******************************************************************************
+ * File :    testreplay.h
+ * Project:  PostGIS Raster driver
+ * Purpose:  Checks and scripted query results shared by the tests run
+ *           against PostGISRasterReplayDBAccess
+ * Author:   PostGIS Raster driver contributors
+ *
+ * Last changes: $Id: $
+ *
+ ******************************************************************************
+ * Copyright (c) 2026, PostGIS Raster driver contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ ******************************************************************************/
+#ifndef TESTREPLAY_H_INCLUDED
+#define TESTREPLAY_H_INCLUDED
+
+#include "postgisraster.h"
+#include "cpl_conv.h"
+#include "cpl_string.h"
+
+CPL_C_START
+void GDALRegister_PostGISRaster(void);
+CPL_C_END
+
+#define TEST_CONNECTION "PG:dbname=db host=localhost port=5432 user=gdal " \
+    "schema=public column=rast"
+
+static int nFailures = 0;
+
+#define TEST_CHECK(x) \
+    do { \
+        if (!(x)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                #x); \
+            nFailures++; \
+        } \
+    } while (0)
+
+/**
+ * Replays the scripted results, keeping the queries sent by the driver
+ **/
+class TestReplayDBAccess : public PostGISRasterReplayDBAccess {
+public:
+    char ** papszSent;
+
+    TestReplayDBAccess() {
+        papszSent = NULL;
+    }
+
+    virtual ~TestReplayDBAccess() {
+        CSLDestroy(papszSent);
+    }
+
+    virtual PGresult * Exec(PGconn * poConn, const char * pszQuery) {
+        papszSent = CSLAddString(papszSent, pszQuery);
+        return PostGISRasterReplayDBAccess::Exec(poConn, pszQuery);
+    }
+
+    const char * GetSent(int i) {
+        return (i >= 0 && i < CSLCount(papszSent)) ? papszSent[i] : "";
+    }
+
+    /* Queries sent containing the given text */
+    int CountSent(const char * pszText) {
+        int i, nCount = 0;
+
+        for (i = 0; papszSent != NULL && papszSent[i] != NULL; i++)
+            if (strstr(papszSent[i], pszText) != NULL)
+                nCount++;
+
+        return nCount;
+    }
+};
+
+/**
+ * Results of the queries that open a nXSize x nYSize coverage with square
+ * tiles, registered in raster_columns, with 8 bits bands of nodata 5, and
+ * an overview of factor pszOverviewFactor if not NULL. The pixels are 1x1,
+ * the coverage starts at (0, nYSize), and all its tiles are there
+ **/
+static void AddCoverageGrid(TestReplayDBAccess * poAccess, int nBands,
+    int nXSize, int nYSize, int nBlockSize,
+    const char * pszOverviewFactor = NULL) {
+    static const char * const apszColumnsFields[] = { "srid", "scale_x",
+        "scale_y", "blocksize_x", "blocksize_y", "num_bands", "xmin", "xmax",
+        "ymin", "ymax", "noskew", "reltuples" };
+    static const char * const apszBandFields[] = { "pixeltype", "isnull",
+        "nodata" };
+    static const char * const apszOverviewFields[] = { "overview_factor" };
+    static const char * const apszBand[] = { "8BUI", "f", "5" };
+    CPLString osBlockSize, osBands, osXSize, osYSize, osTiles;
+    const char * apszColumns[12];
+    char ** papszBands = NULL;
+    int i;
+
+    osBlockSize.Printf("%d", nBlockSize);
+    osBands.Printf("%d", nBands);
+    osXSize.Printf("%d", nXSize);
+    osYSize.Printf("%d", nYSize);
+    osTiles.Printf("%d", ((nXSize + nBlockSize - 1) / nBlockSize) *
+        ((nYSize + nBlockSize - 1) / nBlockSize));
+
+    apszColumns[0] = "4326";
+    apszColumns[1] = "1";
+    apszColumns[2] = "-1";
+    apszColumns[3] = osBlockSize.c_str();
+    apszColumns[4] = osBlockSize.c_str();
+    apszColumns[5] = osBands.c_str();
+    apszColumns[6] = "0";
+    apszColumns[7] = osXSize.c_str();
+    apszColumns[8] = "0";
+    apszColumns[9] = osYSize.c_str();
+    apszColumns[10] = "t";
+    apszColumns[11] = osTiles.c_str();
+    poAccess->AddTuples("*", 12, apszColumnsFields, 1, apszColumns);
+
+    for (i = 0; i < nBands; i++) {
+        papszBands = CSLAddString(papszBands, apszBand[0]);
+        papszBands = CSLAddString(papszBands, apszBand[1]);
+        papszBands = CSLAddString(papszBands, apszBand[2]);
+    }
+    poAccess->AddTuples("*", 3, apszBandFields, nBands, papszBands);
+    CSLDestroy(papszBands);
+
+    poAccess->AddTuples("*", 1, apszOverviewFields,
+        (pszOverviewFactor != NULL) ? 1 : 0, &pszOverviewFactor);
+}
+
+/**
+ * The 100x100 coverage with 10x10 tiles of AddCoverageGrid
+ **/
+static void AddCoverage(TestReplayDBAccess * poAccess, int nBands) {
+    AddCoverageGrid(poAccess, nBands, 100, 100, 10);
+}
+
+/**
+ * Hex WKB of a tile of an AddCoverageGrid coverage of nYSize lines: one 8
+ * bits band, of nodata 5, whose pixel (x, y) of the coverage is
+ * pfnValue(x, y)
+ **/
+static CPLString GetTileHex(int nYSize, int nBlockSize, int nBlockXOff,
+    int nBlockYOff, GByte (*pfnValue)(int, int)) {
+    GByte abyHeader[RASTER_HEADER_SIZE + 2];
+    double adfGeo[6];
+    GUInt16 nValue16;
+    GInt32 nSrid = 4326;
+    CPLString osHex;
+    char * pszHex;
+    GByte * pabyData;
+    int i, x, y;
+
+    /* NDR, version 0, one band */
+    abyHeader[0] = 1;
+    memset(abyHeader + 1, 0, 2);
+    nValue16 = 1;
+    CPL_LSBPTR16(&nValue16);
+    memcpy(abyHeader + 3, &nValue16, 2);
+
+    adfGeo[0] = 1.0;                                /* scale x */
+    adfGeo[1] = -1.0;                               /* scale y */
+    adfGeo[2] = nBlockXOff * nBlockSize;            /* upper left x */
+    adfGeo[3] = nYSize - nBlockYOff * nBlockSize;   /* upper left y */
+    adfGeo[4] = adfGeo[5] = 0.0;                    /* skew */
+    for (i = 0; i < 6; i++) {
+        CPL_LSBPTR64(adfGeo + i);
+        memcpy(abyHeader + 5 + 8 * i, adfGeo + i, 8);
+    }
+
+    CPL_LSBPTR32(&nSrid);
+    memcpy(abyHeader + 53, &nSrid, 4);
+    nValue16 = (GUInt16) nBlockSize;
+    CPL_LSBPTR16(&nValue16);
+    memcpy(abyHeader + 57, &nValue16, 2);
+    memcpy(abyHeader + 59, &nValue16, 2);
+
+    /* 8BUI band, with nodata */
+    abyHeader[61] = BAND_FLAG_HAS_NODATA | 4;
+    abyHeader[62] = 5;
+
+    pszHex = CPLBinaryToHex(RASTER_HEADER_SIZE + 2, abyHeader);
+    osHex = pszHex;
+    CPLFree(pszHex);
+
+    pabyData = (GByte *) CPLMalloc(nBlockSize * nBlockSize);
+    for (y = 0; y < nBlockSize; y++)
+        for (x = 0; x < nBlockSize; x++)
+            pabyData[y * nBlockSize + x] = pfnValue(
+                nBlockXOff * nBlockSize + x, nBlockYOff * nBlockSize + y);
+    pszHex = CPLBinaryToHex(nBlockSize * nBlockSize, pabyData);
+    osHex += pszHex;
+    CPLFree(pszHex);
+    CPLFree(pabyData);
+
+    return osHex;
+}
+
+/**
+ * Result of a query reading all the tiles of an AddCoverageGrid coverage,
+ * in the order of the driver queries (rows from the top)
+ **/
+static void AddTiles(TestReplayDBAccess * poAccess, int nXSize, int nYSize,
+    int nBlockSize, GByte (*pfnValue)(int, int)) {
+    static const char * const apszFields[] = { "st_band" };
+    int nBlocksPerRow = nXSize / nBlockSize;
+    int nBlocks = nBlocksPerRow * (nYSize / nBlockSize);
+    CPLString * paosTiles = new CPLString[nBlocks];
+    const char ** papszValues = new const char *[nBlocks];
+    int i;
+
+    for (i = 0; i < nBlocks; i++) {
+        paosTiles[i] = GetTileHex(nYSize, nBlockSize, i % nBlocksPerRow,
+            i / nBlocksPerRow, pfnValue);
+        papszValues[i] = paosTiles[i].c_str();
+    }
+
+    poAccess->AddTuples("*", 1, apszFields, nBlocks, papszValues);
+
+    delete[] papszValues;
+    delete[] paosTiles;
+}
+
+static void AddValue(TestReplayDBAccess * poAccess, const char * pszValue) {
+    static const char * const apszFields[] = { "value" };
+    const char * apszValues[] = { pszValue };
+
+    poAccess->AddTuples("*", 1, apszFields, 1, apszValues);
+}
+
+/* Exit code of a test program, with a summary of its checks */
+static int TestReport(const char * pszName) {
+    if (nFailures > 0) {
+        fprintf(stderr, "%s: %d checks failed\n", pszName, nFailures);
+        return 1;
+    }
+
+    printf("%s: all checks passed\n", pszName);
+
+    return 0;
+}
+
+#endif /* TESTREPLAY_H_INCLUDED */